@@ -0,0 +1,167 @@
+/*! @file benchmark_collision.cpp
+ *  @brief Contact detection on a terrain with many boxes
+ *
+ * Builds a course of 500 boxes (flights of stairs, like the stairs of a
+ * terrain file, and scattered blocks) on a ground plane, and times contact
+ * detection for the Mini Cheetah at random places on it, checking every box
+ * against the grid of CollisionGrid.  Then times whole simulator steps on the
+ * course and on flat ground.
+ * Run the release build: collision-benchmark [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+#include "Collision/CollisionBox.h"
+#include "Collision/CollisionGrid.h"
+#include "Collision/CollisionPlane.h"
+#include "Dynamics/DynamicsSimulator.h"
+#include "Dynamics/MiniCheetah.h"
+#include "Dynamics/Quadruped.h"
+#include "Math/orientation_tools.h"
+#include "Utilities/Timer.h"
+
+struct BenchmarkResult {
+  double minUs;
+  double medianUs;
+};
+
+static BenchmarkResult summarize(std::vector<double>& times) {
+  std::sort(times.begin(), times.end());
+  return {times[0], times[times.size() / 2]};
+}
+
+// 10 flights of 10 stairs and 400 blocks on a 40 x 40 m field
+static std::vector<Collision<double>*> buildCourse(std::mt19937& rng) {
+  std::uniform_real_distribution<double> dist(-1., 1.);
+  std::vector<Collision<double>*> course;
+  course.push_back(new CollisionPlane<double>(0.7, 0, 0));
+
+  const double rise = 0.05, run = 0.25, width = 1.5;
+  for (int flight = 0; flight < 10; flight++) {
+    Vec3<double> start(20 * dist(rng), 20 * dist(rng), 0);
+    Mat3<double> R =
+        ori::coordinateRotation(CoordinateAxis::Z, M_PI * dist(rng));
+    for (int step = 0; step < 10; step++) {
+      double height = rise * (step + 1);
+      Vec3<double> p =
+          start + R * Vec3<double>(run * (step + 0.5), 0, height / 2);
+      course.push_back(
+          new CollisionBox<double>(0.7, 0, run, width, height, p, R));
+    }
+  }
+
+  for (int i = 0; i < 400; i++) {
+    Vec3<double> p(20 * dist(rng), 20 * dist(rng), 0);
+    Vec3<double> rpy(0, 0, M_PI * dist(rng));
+    course.push_back(new CollisionBox<double>(
+        0.7, 0, 0.3 + 0.3 * std::abs(dist(rng)),
+        0.3 + 0.3 * std::abs(dist(rng)), 0.2 * std::abs(dist(rng)), p,
+        ori::rpyToRotMat(rpy)));
+  }
+  return course;
+}
+
+int main(int argc, char** argv) {
+  int iterations = argc > 1 ? atoi(argv[1]) : 10000;
+  if (iterations < 1) iterations = 1;
+
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<double> dist(-1., 1.);
+  std::vector<Collision<double>*> course = buildCourse(rng);
+
+  FloatingBaseModel<double> model = buildMiniCheetah<double>().buildModel();
+  std::vector<FBModelState<double>> states(iterations);
+  for (auto& state : states) {
+    state.bodyOrientation =
+        ori::rpyToQuat(Vec3<double>(0.1 * dist(rng), 0.1 * dist(rng),
+                                    M_PI * dist(rng)));
+    state.bodyPosition =
+        Vec3<double>(20 * dist(rng), 20 * dist(rng), 0.35 + 0.15 * dist(rng));
+    state.bodyVelocity = 0.5 * SVec<double>::Random();
+    state.q = DVec<double>(12);
+    state.qd = DVec<double>::Zero(12);
+    for (int leg = 0; leg < 4; leg++) {
+      state.q[3 * leg] = 0.1 * dist(rng);
+      state.q[3 * leg + 1] = -0.8 + 0.2 * dist(rng);
+      state.q[3 * leg + 2] = 1.6 + 0.2 * dist(rng);
+    }
+  }
+
+  printf("mini cheetah, %d boxes, %d iterations, median (min)\n",
+         (int)course.size() - 1, iterations);
+
+  // contact detection only, same loops as ContactConstraint
+  CollisionGrid<double> grid;
+  Timer buildTimer;
+  grid.build(course);
+  printf("%-32s %7.2f us, at most %d candidates per point\n", "build grid",
+         buildTimer.getNs() / 1e3, (int)grid.getMaxCandidates());
+
+  std::vector<double> bruteForceTimes(iterations), gridTimes(iterations);
+  size_t bruteForceContacts = 0, gridContacts = 0;
+  double penetration;
+  Mat3<double> frame;
+  for (int i = 0; i < iterations; i++) {
+    model.setState(states[i]);
+    model.forwardKinematics();
+
+    Timer bruteForceTimer;
+    for (size_t p = 0; p < model._nGroundContact; p++) {
+      for (size_t j = 0; j < course.size(); j++) {
+        if (course[j]->ContactDetection(model._pGC[p], penetration, frame))
+          bruteForceContacts++;
+      }
+    }
+    bruteForceTimes[i] = bruteForceTimer.getNs() / 1e3;
+
+    Timer gridTimer;
+    for (size_t p = 0; p < model._nGroundContact; p++) {
+      const size_t* candidates;
+      size_t n = grid.getCandidates(model._pGC[p], candidates);
+      for (size_t k = 0; k < n; k++) {
+        if (grid.mayContain(candidates[k], model._pGC[p]) &&
+            course[candidates[k]]->ContactDetection(model._pGC[p], penetration,
+                                                    frame))
+          gridContacts++;
+      }
+    }
+    gridTimes[i] = gridTimer.getNs() / 1e3;
+  }
+  BenchmarkResult b = summarize(bruteForceTimes);
+  BenchmarkResult g = summarize(gridTimes);
+  printf("%-32s all boxes %7.2f us (min %7.2f)   grid %7.2f us (min %7.2f)\n",
+         "contact detection", b.medianUs, b.minUs, g.medianUs, g.minUs);
+  if (bruteForceContacts != gridContacts) {
+    printf("contacts differ: %d with all boxes, %d with the grid\n",
+           (int)bruteForceContacts, (int)gridContacts);
+    return 1;
+  }
+
+  // whole simulator steps, on the course and on flat ground
+  DynamicsSimulator<double> onCourse(model), onFlat(model);
+  for (auto collision : course) onCourse.addCollision(collision);
+  onFlat.addCollision(course[0]);
+  DVec<double> tau = DVec<double>::Zero(12);
+  std::vector<double> courseTimes(iterations), flatTimes(iterations);
+  for (int i = 0; i < iterations; i++) {
+    onCourse.setState(states[i]);
+    Timer courseTimer;
+    onCourse.step(0.0005, tau, 5e5, 5e3);
+    courseTimes[i] = courseTimer.getNs() / 1e3;
+
+    onFlat.setState(states[i]);
+    Timer flatTimer;
+    onFlat.step(0.0005, tau, 5e5, 5e3);
+    flatTimes[i] = flatTimer.getNs() / 1e3;
+  }
+  BenchmarkResult c = summarize(courseTimes);
+  BenchmarkResult f = summarize(flatTimes);
+  printf("%-32s course   %7.2f us (min %7.2f)   flat %7.2f us (min %7.2f)\n",
+         "simulator step", c.medianUs, c.minUs, f.medianUs, f.minUs);
+
+  for (auto collision : course) delete collision;
+  return 0;
+}
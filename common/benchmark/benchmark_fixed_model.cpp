@@ -0,0 +1,119 @@
+/*! @file benchmark_fixed_model.cpp
+ *  @brief Compare the fixed size and dynamic floating base models
+ *
+ * Times the algorithms the simulator and the WBC run every tick on the Mini
+ * Cheetah model, for a new random state each time.
+ * Run the release build: dynamics-benchmark [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <memory>
+#include <random>
+#include <vector>
+#include "Dynamics/FixedFloatingBaseModel.h"
+#include "Dynamics/MiniCheetah.h"
+#include "Dynamics/Quadruped.h"
+#include "Utilities/Timer.h"
+
+using FixedModel = FixedFloatingBaseModel<double, 13, 18>;
+
+struct BenchmarkResult {
+  double minUs;
+  double medianUs;
+};
+
+enum class Algorithm { Kinematics, MassMatrix, InverseDynamicsTerms, ABA };
+
+static const char* algorithmName(Algorithm algorithm) {
+  switch (algorithm) {
+    case Algorithm::Kinematics:
+      return "kinematics + contact jacobians";
+    case Algorithm::MassMatrix:
+      return "mass matrix";
+    case Algorithm::InverseDynamicsTerms:
+      return "H, Cqd and G";
+    default:
+      return "ABA";
+  }
+}
+
+template <typename Model>
+static void run(Model& model, Algorithm algorithm, const DVec<double>& tau,
+                FBModelStateDerivative<double>& dstate) {
+  switch (algorithm) {
+    case Algorithm::Kinematics:
+      model.forwardKinematics();
+      model.contactJacobians();
+      break;
+    case Algorithm::MassMatrix:
+      model.massMatrix();
+      break;
+    case Algorithm::InverseDynamicsTerms:
+      model.massMatrix();
+      model.generalizedCoriolisForce();
+      model.generalizedGravityForce();
+      break;
+    case Algorithm::ABA:
+      model.runABA(tau, dstate);
+      break;
+  }
+}
+
+template <typename Model>
+static BenchmarkResult timeRuns(Model& model, Algorithm algorithm,
+                                const std::vector<FBModelState<double>>& states,
+                                const DVec<double>& tau) {
+  FBModelStateDerivative<double> dstate;
+  std::vector<double> times(states.size());
+  for (size_t i = 0; i < states.size(); i++) {
+    Timer timer;
+    model.setState(states[i]);
+    run(model, algorithm, tau, dstate);
+    times[i] = timer.getNs() / 1e3;
+  }
+
+  std::sort(times.begin(), times.end());
+  return {times[0], times[times.size() / 2]};
+}
+
+int main(int argc, char** argv) {
+  int iterations = argc > 1 ? atoi(argv[1]) : 10000;
+  if (iterations < 1) iterations = 1;
+
+  FloatingBaseModel<double> dynamic = buildMiniCheetah<double>().buildModel();
+  std::unique_ptr<FixedModel> fixed(new FixedModel(dynamic));
+
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<double> dist(-1., 1.);
+  std::vector<FBModelState<double>> states(iterations);
+  for (auto& state : states) {
+    for (int i = 0; i < 4; i++) state.bodyOrientation[i] = dist(rng);
+    state.bodyOrientation.normalize();
+    for (int i = 0; i < 3; i++) state.bodyPosition[i] = dist(rng);
+    for (int i = 0; i < 6; i++) state.bodyVelocity[i] = dist(rng);
+    state.q = DVec<double>(12);
+    state.qd = DVec<double>(12);
+    for (int i = 0; i < 12; i++) {
+      state.q[i] = dist(rng);
+      state.qd[i] = 10. * dist(rng);
+    }
+  }
+  DVec<double> tau(12);
+  for (int i = 0; i < 12; i++) tau[i] = 5. * dist(rng);
+
+  printf("mini cheetah, %d iterations, median (min)\n", iterations);
+  for (Algorithm algorithm :
+       {Algorithm::Kinematics, Algorithm::MassMatrix,
+        Algorithm::InverseDynamicsTerms, Algorithm::ABA}) {
+    // warm up
+    timeRuns(dynamic, algorithm, states, tau);
+    BenchmarkResult d = timeRuns(dynamic, algorithm, states, tau);
+    BenchmarkResult f = timeRuns(*fixed, algorithm, states, tau);
+    printf("%-32s dynamic %7.2f us (min %7.2f)   fixed %7.2f us (min %7.2f)\n",
+           algorithmName(algorithm), d.medianUs, d.minUs, f.medianUs,
+           f.minUs);
+  }
+  return 0;
+}
@@ -35,6 +35,31 @@ class Collision {
   virtual bool ContactDetection(const Vec3<T>& cp_pos, T& penetration,
                                 Mat3<T>& cp_frame) = 0;
 
+  /*!
+   * Axis aligned box around the points that can be in contact, used by the
+   * broad phase (CollisionGrid) to skip objects far from a point.
+   * @param lo : lower corner in the global frame
+   * @param hi : upper corner in the global frame
+   * @return false if the object is unbounded, then it is checked for every
+   * point
+   */
+  virtual bool getBoundingBox(Vec3<T>& lo, Vec3<T>& hi) {
+    (void)lo;
+    (void)hi;
+    return false;
+  }
+
+  /*!
+   * Called by the simulator before each step, so objects which read their
+   * geometry lazily can get the part near the robot ready.
+   * @param center : point in the global frame, usually the robot
+   * @param radius : distance around the point (m)
+   */
+  virtual void prefetch(const Vec3<T>& center, T radius) {
+    (void)center;
+    (void)radius;
+  }
+
   const T& getFrictionCoeff() { return _mu; }
   const T& getRestitutionCoeff() { return _restitution_coeff; }
 
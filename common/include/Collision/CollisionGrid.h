@@ -0,0 +1,73 @@
+/*!
+ * @file CollisionGrid.h
+ * @brief Broad phase for contact detection
+ *
+ * Uniform grid in the xy plane over the bounding boxes of the collision
+ * objects.  Each cell lists the objects whose bounding box overlaps it, so a
+ * contact point only runs ContactDetection on the objects near it instead of
+ * on every object of the terrain.  Unbounded objects (planes) are in every
+ * cell.
+ */
+
+#ifndef COLLISION_GRID_H
+#define COLLISION_GRID_H
+
+#include <vector>
+
+#include "Collision/Collision.h"
+#include "cppTypes.h"
+
+template <typename T>
+class CollisionGrid {
+ public:
+  void build(const std::vector<Collision<T>*>& collisions);
+
+  /*!
+   * Objects to check for contact at a point, in the order they were added.
+   * Some of them may not contain the point: check with mayContain.
+   * @param p : point in the global frame
+   * @param candidates : set to the first index into the collision list
+   * @return number of candidates
+   */
+  size_t getCandidates(const Vec3<T>& p, const size_t*& candidates) const {
+    size_t cell = _nx * _ny;  // outside of the grid: only unbounded objects
+    T x = (p[0] - _origin[0]) * _invCellSize;
+    T y = (p[1] - _origin[1]) * _invCellSize;
+    if (x >= 0 && y >= 0 && x < (T)_nx && y < (T)_ny) {
+      cell = (size_t)y * _nx + (size_t)x;
+    }
+    candidates = _cellItems.data() + _cellStart[cell];
+    return _cellStart[cell + 1] - _cellStart[cell];
+  }
+
+  /*!
+   * @return true if the point is in the bounding box of collision object idx
+   */
+  bool mayContain(size_t idx, const Vec3<T>& p) const {
+    return (p.array() >= _lo[idx].array()).all() &&
+           (p.array() <= _hi[idx].array()).all();
+  }
+
+  /*!
+   * @return most candidates a point can have
+   */
+  size_t getMaxCandidates() const { return _maxCandidates; }
+
+ private:
+  void cellRange(size_t idx, size_t range[4]) const;
+
+  Vec2<T> _origin = Vec2<T>::Zero();
+  T _cellSize = 1, _invCellSize = 1;
+  size_t _nx = 0, _ny = 0;
+  size_t _maxCandidates = 0;
+
+  // bounding boxes, padded, one per collision object
+  vectorAligned<Vec3<T>> _lo, _hi;
+
+  // objects of cell i are _cellItems[_cellStart[i] .. _cellStart[i + 1]],
+  // cell _nx * _ny is for points outside of the grid
+  std::vector<size_t> _cellStart;
+  std::vector<size_t> _cellItems;
+};
+
+#endif  // COLLISION_GRID_H
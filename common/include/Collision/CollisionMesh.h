@@ -42,6 +42,7 @@ class CollisionMesh : public Collision<T> {
   virtual ~CollisionMesh() {}
   virtual bool ContactDetection(const Vec3<T>& cp_pos, T& penetration,
                                 Mat3<T>& cp_frame);
+  virtual bool getBoundingBox(Vec3<T>& lo, Vec3<T>& hi);
 
  private:
   T _size[3];
@@ -0,0 +1,104 @@
+/*!
+ * @file CollisionTiledHeightMap.h
+ * @brief Collision logic for a height map too large for memory
+ *
+ * The heights are in a binary file (see writeFile) cut into square tiles.  The
+ * file is memory mapped, and the tiles under the contact points are copied
+ * into a small cache when they are first touched.  When the cache is full, the
+ * tile farthest from the point being checked is evicted and its pages are
+ * released, so only the tiles around the robot use memory, however long the
+ * course is.
+ *
+ * Heights are interpolated bilinearly inside each grid cell.
+ *
+ * The cache changes during ContactDetection, so a tiled height map can't be
+ * shared between simulators stepped in parallel.
+ */
+
+#ifndef COLLISION_TILED_HEIGHT_MAP_H
+#define COLLISION_TILED_HEIGHT_MAP_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "Collision/Collision.h"
+#include "cppTypes.h"
+
+/*!
+ * Header of a tiled height map file.  It is followed by the tiles, with tile
+ * (tx, ty) at dataOffset + (tx * tilesY + ty) * tileStride bytes.  A tile is
+ * (tileSize + 1) x (tileSize + 1) floats, x major, so its last row and column
+ * repeat the first ones of the next tiles and every grid cell is inside of
+ * one tile.  Samples past the edge of the map repeat the edge.
+ */
+struct TiledHeightMapHeader {
+  char magic[8];         // "TILEHMAP"
+  u64 rows;              // samples along x
+  u64 cols;              // samples along y
+  u64 tileSize;          // grid cells per tile side
+  u64 dataOffset;        // bytes before the first tile, a multiple of 4096
+  u64 tileStride;        // bytes from a tile to the next, a multiple of 4096
+  double grid;           // distance between samples (m)
+  double leftCorner[3];  // global location of sample (0, 0)
+};
+
+template <typename T>
+class CollisionTiledHeightMap : public Collision<T> {
+ public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  CollisionTiledHeightMap(const T& mu, const T& restitution,
+                          const std::string& fileName, size_t cachedTiles = 16);
+  virtual ~CollisionTiledHeightMap();
+  CollisionTiledHeightMap(const CollisionTiledHeightMap&) = delete;
+  CollisionTiledHeightMap& operator=(const CollisionTiledHeightMap&) = delete;
+
+  virtual bool ContactDetection(const Vec3<T>& cp_pos, T& penetration,
+                                Mat3<T>& cp_frame);
+  virtual bool getBoundingBox(Vec3<T>& lo, Vec3<T>& hi);
+
+  bool getHeight(T x, T y, T& height, Vec3<T>& normal);
+  virtual void prefetch(const Vec3<T>& center, T radius);
+
+  /*!
+   * @return number of tiles copied from the file so far
+   */
+  u64 getTileLoads() const { return _tileLoads; }
+
+  /*!
+   * @return number of tiles asked from the kernel by prefetch so far
+   */
+  u64 getTilePrefetches() const { return _tilePrefetches; }
+
+  static void writeFile(const std::string& fileName, size_t rows, size_t cols,
+                        double grid, const Vec3<double>& leftCorner,
+                        size_t tileSize,
+                        const std::function<float(size_t, size_t)>& height);
+
+ private:
+  const T* getTile(size_t tx, size_t ty);
+
+  const char* _map = nullptr;
+  size_t _mapSize = 0;
+  TiledHeightMapHeader _header;
+  size_t _tilesX, _tilesY;
+  size_t _tileSamples;  // (tileSize + 1) squared
+  Vec3<T> _leftCorner;
+  T _grid;
+  T _xMax, _yMax;
+
+  // cache of tiles, slot i holds tile _slotTile[i] (or -1)
+  std::vector<T> _cache;
+  std::vector<s64> _slotTile;
+  std::vector<u64> _slotLastUse;
+  size_t _lastSlot = 0;
+  u64 _useCount = 0;
+  u64 _tileLoads = 0;
+
+  // tiles asked by the last prefetch, x0, x1, y0, y1 (empty if x0 > x1)
+  size_t _prefetchRange[4] = {1, 0, 1, 0};
+  u64 _tilePrefetches = 0;
+};
+
+#endif  // COLLISION_TILED_HEIGHT_MAP_H
@@ -12,6 +12,7 @@
 #include <iostream>
 
 #include "Collision/Collision.h"
+#include "Collision/CollisionGrid.h"
 #include "Dynamics/FloatingBaseModel.h"
 #include "Utilities/Utilities_print.h"
 #include "cppTypes.h"
@@ -46,6 +47,17 @@ class ContactConstraint {
   void AddCollision(Collision<T>* collision) {
     _collision_list.push_back(collision);
     ++_nCollision;
+    _gridValid = false;
+  }
+
+  /*!
+   * Let the collision objects prepare for contacts around a point
+   * @param center : point in the global frame, usually the robot
+   * @param radius : distance around the point (m)
+   */
+  void Prefetch(const Vec3<T>& center, T radius) {
+    for (Collision<T>* collision : _collision_list)
+      collision->prefetch(center, radius);
   }
 
   /*!
@@ -66,10 +78,16 @@ class ContactConstraint {
 
   /*!
    * For visualization
-   * @return cp_pos_list : all contact point position in the global frame.
+   * @return cp_pos_list : contact point positions in the global frame, only
+   * the first getNumContacts() are in contact.
    */
   const vectorAligned<Vec3<T>>& getContactPosList() { return _cp_pos_list; }
 
+  /*!
+   * @return number of contacts found by the last step
+   */
+  size_t getNumContacts() const { return _nContact; }
+
   /*!
    * For visualization
    * @return cp_force_list : all linear contact force described in the global
@@ -82,6 +100,8 @@ class ContactConstraint {
   void _groundContactWithOffset(T K, T D);
 
   size_t _CheckContact();
+  void _BuildGrid();
+  virtual void _AllocateContacts(size_t nContactMax);
 
   vectorAligned<Vec2<T>> _tangentialDeflections;
 
@@ -91,6 +111,14 @@ class ContactConstraint {
   FloatingBaseModel<T>* _model;
 
   std::vector<Collision<T>*> _collision_list;
+
+  // Broad phase, built by the first _CheckContact after AddCollision
+  CollisionGrid<T> _grid;
+  bool _gridValid = false;
+
+  // Contacts found by _CheckContact, one entry per contact, as many as
+  // points times the most candidates of the grid.  Only the first _nContact
+  // are valid.
   std::vector<size_t> _idx_list;
   std::vector<T> _cp_resti_list;
   std::vector<T> _cp_mu_list;
@@ -56,16 +56,32 @@ class ContactImpulse : public ContactConstraint<T> {
   T _penetration_recover_ratio;
   size_t _nDof;
   void _UpdateVelocity(DVec<T>& qdot);
-  void _UpdateQdotOneDirection(size_t idx,
-                               const vectorAligned<D3Mat<T> >& Jc_list,
-                               const T* lambda_list,
-                               const vectorAligned<DVec<T> > AinvB_list,
-                               const T* des_vel_list, const T* min_list,
-                               const T* max_list, DVec<T>& qdot);
+  void _UpdateQdotOneDirection(size_t idx, const DVec<T>& des_vel_list,
+                               const DVec<T>& min_list,
+                               const DVec<T>& max_list, DVec<T>& qdot);
+  virtual void _AllocateContacts(size_t nContactMax);
   size_t _iter_sum;
 
  private:
+  using RowMajorDMat =
+      Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>;
+
   T _dt;
+
+  // Per direction (tangential x, y and normal z), one entry per contact:
+  // the contact Jacobian row, A^-1 J^T, the inverse of J A^-1 J^T and the
+  // impulse.  Rows of _Jc_rows and columns of _AinvB are contiguous for the
+  // Gauss-Seidel sweeps.
+  RowMajorDMat _Jc_rows[3];
+  DMat<T> _AinvB[3];
+  DVec<T> _lambda_list[3];
+  DVec<T> _force_list[3];
+
+  DVec<T> _des_vel_list_z, _des_vel_list_tan;
+  DVec<T> _min_list_z, _max_list_z, _min_list_tan, _max_list_tan;
+
+  DVec<T> _qdot;
+  DVec<T> _AinvB_column;
 };
 
 #endif
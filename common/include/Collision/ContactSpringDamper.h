@@ -47,10 +47,44 @@ class ContactSpringDamper : public ContactConstraint<T> {
     (void)state; /* Do nothing */
   }
 
+  /*!
+   * @return tangential deflection of the ground under each contact point
+   */
+  const vectorAligned<Vec2<T>>& getTangentialDeflections() const {
+    return _tangentialDeflections;
+  }
+
+  /*!
+   * Set the tangential deflections, to go back to an earlier state
+   */
+  void setTangentialDeflections(const vectorAligned<Vec2<T>>& deflections) {
+    _tangentialDeflections = deflections;
+  }
+
+  /*!
+   * @return rate of change of the deflections found by the last
+   * UpdateExternalForces
+   */
+  const vectorAligned<Vec2<T>>& getDeflectionRates() const {
+    return deflectionRate;
+  }
+
+  Mat3<T> getContactDamping(size_t contact, size_t& gcIdx) const;
+  Mat3<T> getContactStiffness(size_t contact) const;
+
  protected:
   size_t _nGC;
+  T _dt = 0;
 
   void _groundContactWithOffset(T K, T D);
+  virtual void _AllocateContacts(size_t nContactMax);
+
+  // derivative of the local contact force by the local velocity (diagonal,
+  // sign flipped), with the spring taken implicitly over _dt
+  vectorAligned<Vec3<T>> _cp_damping_list;
+  // derivative of the local contact force by the local displacement (diagonal,
+  // sign flipped)
+  vectorAligned<Vec3<T>> _cp_stiffness_list;
 
   vectorAligned<Vec2<T>> deflectionRate;
   vectorAligned<Vec2<T>> _tangentialDeflections;
@@ -361,7 +361,7 @@ class ControlParameter {
    * @return the value of the control parameter
    */
   ControlParameterValue get(ControlParameterValueKind kind) {
-    ControlParameterValue value;
+    ControlParameterValue value{};  // no stray bytes in snapshot files
     if (kind != _kind) {
       throw std::runtime_error("Control parameter type mismatch in get");
     }
@@ -39,7 +39,8 @@ class RobotControlParameters : public ControlParameters {
         INIT_PARAMETER(foot_sensor_noise_position),
         INIT_PARAMETER(foot_sensor_noise_velocity),
         INIT_PARAMETER(foot_height_sensor_noise),
-        INIT_PARAMETER(use_rc){}
+        INIT_PARAMETER(use_rc),
+        INIT_PARAMETER(phase_locked_control){}
 
   DECLARE_PARAMETER(double, myValue)
   DECLARE_PARAMETER(double, control_mode)
@@ -62,6 +63,9 @@ class RobotControlParameters : public ControlParameters {
   DECLARE_PARAMETER(double, foot_height_sensor_noise)
 
   DECLARE_PARAMETER(s64, use_rc);
+
+  // run the controller right after each spi transfer, in the same thread
+  DECLARE_PARAMETER(s64, phase_locked_control);
 };
 
 #endif  // PROJECT_ROBOTPARAMETERS_H
@@ -9,7 +9,10 @@
 #ifndef PROJECT_SIMULATORPARAMETERS_H
 #define PROJECT_SIMULATORPARAMETERS_H
 
+#include <stdexcept>
+
 #include "ControlParameters/ControlParameters.h"
+#include "Dynamics/DynamicsIntegrator.h"
 
 #define SIMULATOR_DEFAULT_PARAMETERS "/simulator-defaults.yaml"
 #define MINI_CHEETAH_DEFAULT_PARAMETERS "/mini-cheetah-defaults.yaml"
@@ -34,6 +37,9 @@ class SimulatorControlParameters : public ControlParameters {
         INIT_PARAMETER(floor_kp),
         INIT_PARAMETER(floor_kd),
         INIT_PARAMETER(use_spring_damper),
+        INIT_PARAMETER(dynamics_integrator),
+        INIT_PARAMETER(dynamics_max_substeps),
+        INIT_PARAMETER(dynamics_error_tolerance),
         INIT_PARAMETER(sim_state_lcm),
         INIT_PARAMETER(sim_lcm_ttl),
         INIT_PARAMETER(go_home),
@@ -59,6 +65,10 @@ class SimulatorControlParameters : public ControlParameters {
   DECLARE_PARAMETER(double, floor_kp)
   DECLARE_PARAMETER(double, floor_kd)
   DECLARE_PARAMETER(s64, use_spring_damper)
+  // DynamicsIntegrator, for spring-damper contact only
+  DECLARE_PARAMETER(s64, dynamics_integrator)
+  DECLARE_PARAMETER(s64, dynamics_max_substeps)
+  DECLARE_PARAMETER(double, dynamics_error_tolerance)
   DECLARE_PARAMETER(s64, sim_state_lcm)
   DECLARE_PARAMETER(s64, sim_lcm_ttl)
 
@@ -70,6 +80,20 @@ class SimulatorControlParameters : public ControlParameters {
   DECLARE_PARAMETER(double, home_kp_ang)
   DECLARE_PARAMETER(double, home_kd_ang)
 
+  /*!
+   * @return dynamics_integrator, checked against the values of
+   * DynamicsIntegrator
+   */
+  DynamicsIntegrator getDynamicsIntegrator() {
+    // ImplicitContact is the last one
+    if (dynamics_integrator < 0 ||
+        dynamics_integrator > (s64)DynamicsIntegrator::ImplicitContact) {
+      printf("[ERROR] dynamics_integrator %ld is not an integrator\n",
+             (long)dynamics_integrator);
+      throw std::runtime_error("Bad dynamics_integrator!");
+    }
+    return (DynamicsIntegrator)dynamics_integrator;
+  }
 };
 
 #endif  // PROJECT_SIMULATORPARAMETERS_H
@@ -0,0 +1,137 @@
+/*! @file BatchDynamicsSimulator.h
+ *  @brief Simulates many independent copies of a robot in parallel
+ *
+ * Each environment has its own copy of the FloatingBaseModel, its own state
+ * and contact model, and a DynamicsSimulator.  The collision objects are
+ * owned by the batch and shared, read-only, by all environments.  Steps are
+ * split across a pool of worker threads and the calling thread.  Doesn't do
+ * any graphics.
+ */
+
+#ifndef PROJECT_BATCHDYNAMICSSIMULATOR_H
+#define PROJECT_BATCHDYNAMICSSIMULATOR_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "DynamicsSimulator.h"
+#include "cTypes.h"
+#include "cppTypes.h"
+
+/*!
+ * Computes the torques of an environment from its state, for rollouts
+ * @param env : index of the environment
+ * @param step : index of the step in the rollout
+ * @param state : state of the environment
+ * @param tau : output joint torques
+ */
+template <typename T>
+using BatchController = std::function<void(
+    size_t env, size_t step, const FBModelState<T>& state, DVec<T>& tau)>;
+
+/*!
+ * Independent robots which are stepped in parallel
+ */
+template <typename T>
+class BatchDynamicsSimulator {
+ public:
+  BatchDynamicsSimulator(const FloatingBaseModel<T>& model, size_t nEnvs,
+                         bool useSpringDamper = false);
+  ~BatchDynamicsSimulator();
+  BatchDynamicsSimulator(const BatchDynamicsSimulator&) = delete;
+  BatchDynamicsSimulator& operator=(const BatchDynamicsSimulator&) = delete;
+
+  void start(int workers);
+  void stop();
+
+  /*!
+   * @return true if there are worker threads
+   */
+  bool isRunning() const { return !_workers.empty(); }
+
+  /*!
+   * @return number of worker threads (besides the one calling step)
+   */
+  int workerCount() const { return (int)_workers.size(); }
+
+  /*!
+   * @return number of environments
+   */
+  size_t size() const { return _envs.size(); }
+
+  void addCollisionPlane(T mu, T rest, T height);
+  void addCollisionBox(T mu, T rest, T depth, T width, T height,
+                       const Vec3<T>& pos, const Mat3<T>& ori);
+  void addCollisionMesh(T mu, T rest, T grid_size,
+                        const Vec3<T>& left_corner_loc,
+                        const DMat<T>& height_map);
+
+  /*!
+   * Set the state of an environment
+   */
+  void setState(size_t env, const FBModelState<T>& state) {
+    _envs[env]->sim.setState(state);
+  }
+
+  /*!
+   * Set the state of all environments
+   */
+  void setAllStates(const FBModelState<T>& state) {
+    for (auto& env : _envs) env->sim.setState(state);
+  }
+
+  /*!
+   * Get the state of an environment
+   */
+  const FBModelState<T>& getState(size_t env) const {
+    return _envs[env]->sim.getState();
+  }
+
+  /*!
+   * Get the simulator of an environment, for everything else (homing,
+   * external forces, contact forces...).  Must not be used during step().
+   */
+  DynamicsSimulator<T>& getSimulator(size_t env) { return _envs[env]->sim; }
+
+  void step(T dt, const std::vector<DVec<T>>& tau, T kp, T kd);
+  void rollout(size_t nSteps, T dt, T kp, T kd,
+               const BatchController<T>& controller);
+
+ private:
+  /*!
+   * One robot, the simulator keeps a reference to the model
+   */
+  struct Environment {
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+    Environment(const FloatingBaseModel<T>& m, bool useSpringDamper)
+        : model(m), sim(model, useSpringDamper) {}
+    FloatingBaseModel<T> model;
+    DynamicsSimulator<T> sim;
+    DVec<T> tau;
+  };
+
+  void addCollision(Collision<T>* collision);
+  void run(const std::function<void(size_t)>& job);
+  void runJobs();
+  void workerLoop();
+
+  std::vector<std::unique_ptr<Environment>> _envs;
+  std::vector<std::unique_ptr<Collision<T>>> _collisions;
+
+  // the job of the current round is called for each environment
+  std::vector<std::thread> _workers;
+  std::mutex _mutex;
+  std::condition_variable _roundStart, _roundDone;
+  const std::function<void(size_t)>* _job = nullptr;
+  std::atomic<size_t> _nextEnv{0};
+  u64 _round = 0;
+  int _activeWorkers = 0;
+  bool _running = false;
+};
+
+#endif  // PROJECT_BATCHDYNAMICSSIMULATOR_H
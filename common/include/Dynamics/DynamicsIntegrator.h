@@ -0,0 +1,19 @@
+/*! @file DynamicsIntegrator.h
+ *  @brief Integrators of the dynamics simulator
+ */
+
+#ifndef PROJECT_DYNAMICSINTEGRATOR_H
+#define PROJECT_DYNAMICSINTEGRATOR_H
+
+/*!
+ * How DynamicsSimulator integrates the state over a step.  Impulse based
+ * contact only works with SemiImplicitEuler.
+ */
+enum class DynamicsIntegrator {
+  Euler,              // explicit, the default with spring-damper contact
+  SemiImplicitEuler,  // velocities first, then positions with the new ones
+  RK4,                // Runge-Kutta, with the contact forces of every stage
+  ImplicitContact     // semi-implicit, contact springs and dampers implicit
+};
+
+#endif  // PROJECT_DYNAMICSINTEGRATOR_H
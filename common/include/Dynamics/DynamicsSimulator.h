@@ -12,7 +12,10 @@
 #include "Collision/CollisionBox.h"
 #include "Collision/CollisionMesh.h"
 #include "Collision/CollisionPlane.h"
+#include "Collision/CollisionTiledHeightMap.h"
 #include "Collision/ContactConstraint.h"
+#include "Collision/ContactSpringDamper.h"
+#include "DynamicsIntegrator.h"
 #include "FloatingBaseModel.h"
 #include "Math/orientation_tools.h"
 #include "spatial.h"
@@ -35,6 +38,20 @@ struct RobotHomingInfo {
   bool active_flag;
 };
 
+/*!
+ * Everything a DynamicsSimulator carries from a step to the next, to resume a
+ * simulation exactly where it was
+ */
+template <typename T>
+struct DynamicsSimulatorSnapshot {
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  FBModelState<T> state;
+  FBModelStateDerivative<T> dstate;
+  SVec<T> lastBodyVelocity;
+  vectorAligned<Vec2<T>> tangentialDeflections;  // spring-damper contact only
+  size_t substeps = 1;
+};
+
 /*!
  * Class (containing state) for dynamics simulation of a floating-base system
  */
@@ -45,9 +62,36 @@ class DynamicsSimulator {
   DynamicsSimulator(
       FloatingBaseModel<T>& model,
       bool useSpringDamper = false);  //! Initialize simulator with given model
+  ~DynamicsSimulator() { delete _contact_constr; }
+  DynamicsSimulator(const DynamicsSimulator&) = delete;
+  DynamicsSimulator& operator=(const DynamicsSimulator&) = delete;
   void step(T dt, const DVec<T>& tau, T kp,
             T kd);  //! Simulate forward one step
 
+  void setIntegrator(DynamicsIntegrator integrator);
+  DynamicsIntegrator getIntegrator() const { return _integrator; }
+  void setAdaptiveSubsteps(size_t maxSubsteps, T tolerance);
+
+  /*!
+   * Estimate the error of every step, even without adaptive substeps.  This
+   * takes each step twice (once whole, once in halves), and keeps the halves.
+   */
+  void setErrorEstimation(bool estimate) { _estimateError = estimate; }
+
+  /*!
+   * @return largest error estimate of the substeps of the last step, in m
+   * (or rad) of the generalized positions.  Zero if not estimated.
+   */
+  T getLastError() const { return _lastError; }
+
+  /*!
+   * @return number of substeps the last step was cut into
+   */
+  size_t getSubsteps() const { return _substeps; }
+
+  void saveSnapshot(DynamicsSimulatorSnapshot<T>& snapshot) const;
+  void restoreSnapshot(const DynamicsSimulatorSnapshot<T>& snapshot);
+
   //! Find _dstate with the articulated body algorithm
   void runABA(const DVec<T>& tau) { _model.runABA(tau, _dstate); }
 
@@ -135,6 +179,29 @@ class DynamicsSimulator {
         new CollisionMesh<T>(mu, rest, grid_size, left_corner_loc, height_map));
   }
 
+  /*!
+   * Add a tiled height map, streamed from a file
+   * @param mu : friction coefficient
+   * @param rest : restitution coefficient
+   * @param fileName : tiled height map file
+   * @param cachedTiles : number of tiles kept in memory
+   */
+  void addCollisionTiledHeightMap(T mu, T rest, const std::string& fileName,
+                                  size_t cachedTiles) {
+    _contact_constr->AddCollision(new CollisionTiledHeightMap<T>(
+        mu, rest, fileName, cachedTiles));
+  }
+
+  /*!
+   * Add a collision object which is not owned by the simulator, so it can be
+   * shared with other simulators.  It must outlive the simulator, and must not
+   * be modified while the simulators are stepped.
+   * @param collision : the collision object
+   */
+  void addCollision(Collision<T>* collision) {
+    _contact_constr->AddCollision(collision);
+  }
+
   /*!
    * Get the number of bodies (not including rotors)
    * @return number of bodies
@@ -164,15 +231,56 @@ class DynamicsSimulator {
 
  private:
   void updateCollisions(T dt, T kp, T kd);  //! Update ground collision list
+  void stepOnce(T dt, const DVec<T>& tau, T kp, T kd);
+  void stepRK4(T dt, const DVec<T>& tau, T kp, T kd);
+  void evaluateRK4Stage(size_t stage, const DVec<T>& tau, T kp, T kd);
+  void applyHomingForces();
+  void implicitContactAcceleration(T dt);
+  void saveState();
+  void restoreState();
+  T stateError(const FBModelState<T>& a, const FBModelState<T>& b, T dt);
+
   FBModelState<T> _state;
   FBModelStateDerivative<T> _dstate;
   FloatingBaseModel<T>& _model;
   vector<CollisionPlane<T>> _collisionPlanes;
   ContactConstraint<T>* _contact_constr;
+  ContactSpringDamper<T>* _springDamper = nullptr;  // same as _contact_constr
   SVec<T> _lastBodyVelocity;
   bool _useSpringDamper;
 
+  DynamicsIntegrator _integrator;
+  vectorAligned<SVec<T>> _externalForcesAtStep;
+
+  // substeps and error estimate
+  size_t _maxSubsteps = 1;
+  size_t _substeps = 1;
+  T _errorTolerance = 1e-4;
+  bool _estimateError = false;
+  T _lastError = 0;
+  FBModelState<T> _savedState, _wholeStepState;
+  FBModelStateDerivative<T> _savedDState;
+  SVec<T> _savedLastBodyVelocity;
+  vectorAligned<Vec2<T>> _savedDeflections;
+
+  // RK4 stages
+  FBModelState<T> _rk4Start, _stageState;
+  FBModelStateDerivative<T> _stageDState[4];
+  Quat<T> _stageDQuat[4];
+  DVec<T> _stageQd[4];
+  vectorAligned<Vec2<T>> _rk4StartDeflections, _stageDeflections;
+  vectorAligned<Vec2<T>> _stageDeflectionRate[4];
+
+  // implicit contact
+  DMat<T> _implicitA;
+  DVec<T> _implicitAcc, _implicitRhs;
+  DMat<T> _implicitDampedJc;
+  Eigen::LDLT<DMat<T>> _implicitLdlt;
+
   RobotHomingInfo<T> _homing;
+
+  // distance around the body which the collision objects get ready each step
+  T _prefetchRadius = 2;
 };
 
 #endif  // PROJECT_DYNAMICSSIMULATOR_H
@@ -0,0 +1,638 @@
+/*! @file FixedFloatingBaseModel.h
+ *  @brief Floating base model with the number of bodies fixed at compile time
+ *
+ * A copy of a FloatingBaseModel, with the same algorithms, made for the robots
+ * which are built by Quadruped::buildModel (18 dofs, 12 rotors).  It is faster
+ * than the FloatingBaseModel because:
+ *   - all the per-body quantities and results are fixed size Eigen types, so
+ *     there is no heap allocation after construction
+ *   - all joints are revolute, so the motion subspace of a joint is a unit
+ *     vector and products with it are replaced by picking an element
+ *   - spatial transforms are stored as a rotation and a translation
+ *     (CompactSXform) instead of a 6x6 matrix
+ *   - the loops over the tree are unrolled at compile time
+ *
+ * Bodies are numbered like in the FloatingBaseModel: the floating base is body
+ * 5 and the joints are 6 to NDof - 1, so results can be compared index by
+ * index.
+ */
+
+#ifndef LIBBIOMIMETICS_FIXEDFLOATINGBASEMODEL_H
+#define LIBBIOMIMETICS_FIXEDFLOATINGBASEMODEL_H
+
+#include <array>
+#include <stdexcept>
+#include <type_traits>
+
+#include "FloatingBaseModel.h"
+
+/*!
+ * Spatial transform made of a rotation E and a translation r, equal to the
+ * 6x6 matrix createSXform(E, r) = [E 0; -E r x, E]
+ */
+template <typename T>
+struct CompactSXform {
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  Mat3<T> E;
+  Vec3<T> r;
+
+  CompactSXform() : E(Mat3<T>::Identity()), r(Vec3<T>::Zero()) {}
+  CompactSXform(const Mat3<T>& rotation, const Vec3<T>& translation)
+      : E(rotation), r(translation) {}
+
+  /*!
+   * Split a 6x6 spatial transform
+   */
+  explicit CompactSXform(const Mat6<T>& X)
+      : E(rotationFromSXform(X)), r(translationFromSXform(X)) {}
+
+  /*!
+   * @return the 6x6 spatial transform
+   */
+  Mat6<T> toMatrix() const { return createSXform(E, r); }
+
+  /*!
+   * X * v for a motion vector
+   */
+  SVec<T> apply(const SVec<T>& v) const {
+    SVec<T> out;
+    Vec3<T> w = v.template head<3>();
+    Vec3<T> lin = v.template tail<3>();
+    out.template head<3>() = E * w;
+    out.template tail<3>() = E * (lin - r.cross(w));
+    return out;
+  }
+
+  /*!
+   * X^T * f for a force vector
+   */
+  SVec<T> applyTranspose(const SVec<T>& f) const {
+    SVec<T> out;
+    Vec3<T> lin = E.transpose() * f.template tail<3>();
+    out.template head<3>() =
+        E.transpose() * f.template head<3>() + r.cross(lin);
+    out.template tail<3>() = lin;
+    return out;
+  }
+
+  /*!
+   * X^T * I * X, like for moving a (articulated) inertia to the parent body
+   */
+  Mat6<T> congruence(const Mat6<T>& I) const {
+    // rotate the blocks, then shift the origin by r
+    Mat3<T> A = E.transpose() * I.template topLeftCorner<3, 3>() * E;
+    Mat3<T> B = E.transpose() * I.template topRightCorner<3, 3>() * E;
+    Mat3<T> C = E.transpose() * I.template bottomLeftCorner<3, 3>() * E;
+    Mat3<T> D = E.transpose() * I.template bottomRightCorner<3, 3>() * E;
+    Mat3<T> S = vectorToSkewMat(r);
+
+    Mat6<T> out;
+    out.template topLeftCorner<3, 3>() = A - B * S + S * (C - D * S);
+    out.template topRightCorner<3, 3>() = B + S * D;
+    out.template bottomLeftCorner<3, 3>() = C - D * S;
+    out.template bottomRightCorner<3, 3>() = D;
+    return out;
+  }
+
+  /*!
+   * this * X
+   */
+  CompactSXform operator*(const CompactSXform& X) const {
+    return CompactSXform(E * X.E, X.r + X.E.transpose() * r);
+  }
+};
+
+/*!
+ * Call f(std::integral_constant<int, i>()) for i in [Begin, End), unrolled
+ */
+template <int Begin, int End, typename F>
+inline void unrolledFor(F&& f) {
+  if constexpr (Begin < End) {
+    f(std::integral_constant<int, Begin>());
+    unrolledFor<Begin + 1, End>(f);
+  }
+}
+
+/*!
+ * Call f(std::integral_constant<int, i>()) for i in [Begin, End), in reverse
+ * order and unrolled
+ */
+template <int Begin, int End, typename F>
+inline void unrolledForReverse(F&& f) {
+  if constexpr (Begin < End) {
+    f(std::integral_constant<int, End - 1>());
+    unrolledForReverse<Begin, End - 1>(f);
+  }
+}
+
+/*!
+ * Floating base model with NBodies bodies (the floating base and one per
+ * revolute joint) and NDof degrees of freedom.  Each joint has a rotor.
+ * For the quadrupeds, this is FixedFloatingBaseModel<T, 13, 18>.
+ */
+template <typename T, int NBodies, int NDof>
+class FixedFloatingBaseModel {
+  static_assert(NDof == NBodies + 5,
+                "the floating base has 6 dofs, the joints one each");
+
+ public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  static constexpr int nJoints = NDof - 6;
+  using GenVec = Eigen::Matrix<T, NDof, 1>;
+  using JointVec = Eigen::Matrix<T, nJoints, 1>;
+  using MassMat = Eigen::Matrix<T, NDof, NDof>;
+  using ContactJacobian = Eigen::Matrix<T, 3, NDof>;
+
+  explicit FixedFloatingBaseModel(const FloatingBaseModel<T>& model);
+
+  /*!
+   * Update the state, invalidating previous results
+   * @param state : the new state, with nJoints joint positions and velocities
+   */
+  void setState(const FBModelState<T>& state) {
+    _bodyOrientation = state.bodyOrientation;
+    _bodyPosition = state.bodyPosition;
+    _bodyVelocity = state.bodyVelocity;
+    _q = state.q;
+    _qd = state.qd;
+
+    _biasAccelerationsUpToDate = false;
+    _compositeInertiasUpToDate = false;
+
+    resetCalculationFlags();
+  }
+
+  /*!
+   * Mark all previously calculated values as invalid
+   */
+  void resetCalculationFlags() {
+    _articulatedBodiesUpToDate = false;
+    _kinematicsUpToDate = false;
+  }
+
+  /*!
+   * Set the flag to enable computing contact info for a given contact point
+   * @param gc_index : index of contact point
+   * @param flag : enable/disable contact calculation
+   */
+  void setContactComputeFlag(size_t gc_index, bool flag) {
+    _compute_contact_info[gc_index] = flag;
+  }
+
+  /*!
+   * Set all external forces to zero
+   */
+  void resetExternalForces() {
+    for (auto& f : _externalForces) f.setZero();
+  }
+
+  void forwardKinematics();
+  void biasAccelerations();
+  void compositeInertias();
+  void contactJacobians();
+  void updateArticulatedBodies();
+
+  const GenVec& generalizedGravityForce();
+  const GenVec& generalizedCoriolisForce();
+  const MassMat& massMatrix();
+
+  template <typename Derived>
+  void runABA(const Eigen::MatrixBase<Derived>& tau,
+              FBModelStateDerivative<T>& dstate);
+
+  /*!
+   * Get the mass matrix for the system
+   */
+  const MassMat& getMassMatrix() const { return _H; }
+
+  /*!
+   * Get the gravity term (generalized forces)
+   */
+  const GenVec& getGravityForce() const { return _G; }
+
+  /*!
+   * Get the coriolis term (generalized forces)
+   */
+  const GenVec& getCoriolisForce() const { return _Cqd; }
+
+  /// MODEL, copied from the FloatingBaseModel
+  Vec3<T> _gravity;
+  std::array<int, NDof> _parents;
+  std::array<T, NDof> _gearRatios;
+  std::array<int, NDof> _axes;  // index of the rotation axis in a SVec
+  std::array<CompactSXform<T>, NDof> _Xtree, _Xrot;
+  std::array<Mat6<T>, NDof> _Ibody, _Irot;
+
+  size_t _nGroundContact = 0;
+  vector<size_t> _gcParent;
+  vector<Vec3<T>> _gcLocation;
+  vector<uint64_t> _footIndicesGC;
+  vector<bool> _compute_contact_info;
+
+  vector<Vec3<T>> _pGC;
+  vector<Vec3<T>> _vGC;
+  vectorAligned<ContactJacobian> _Jc;
+  vectorAligned<Vec3<T>> _Jcdqd;
+
+  /// BEGIN ALGORITHM SUPPORT VARIABLES
+  Quat<T> _bodyOrientation;
+  Vec3<T> _bodyPosition;
+  SVec<T> _bodyVelocity;
+  JointVec _q, _qd;
+
+  std::array<SVec<T>, NDof> _v, _vrot, _a, _avp, _avprot, _c, _crot, _fvp,
+      _fvprot, _ag, _agrot;
+  std::array<SVec<T>, NDof> _U, _Urot, _Utot, _pA, _pArot;
+  std::array<SVec<T>, NDof> _externalForces;
+  std::array<T, NDof> _d, _u;
+
+  std::array<Mat6<T>, NDof> _IC, _IA;
+  std::array<CompactSXform<T>, NDof> _Xup, _Xuprot, _Xa;
+
+  MassMat _H;
+  GenVec _Cqd, _G;
+
+  Eigen::LDLT<Mat6<T>> _invIA5;
+
+  bool _kinematicsUpToDate = false;
+  bool _biasAccelerationsUpToDate = false;
+  bool _compositeInertiasUpToDate = false;
+  bool _articulatedBodiesUpToDate = false;
+};
+
+/*!
+ * Copy a model.  Throws if it does not have NDof dofs or has a joint which is
+ * not revolute.
+ */
+template <typename T, int NBodies, int NDof>
+FixedFloatingBaseModel<T, NBodies, NDof>::FixedFloatingBaseModel(
+    const FloatingBaseModel<T>& model)
+    : _gravity(model._gravity) {
+  if (model._nDof != NDof) {
+    throw std::runtime_error(
+        "FixedFloatingBaseModel has the wrong number of dofs");
+  }
+
+  for (int i = 0; i < NDof; i++) {
+    _parents[i] = model._parents[i];
+    _gearRatios[i] = model._gearRatios[i];
+    _Xtree[i] = CompactSXform<T>(model._Xtree[i]);
+    _Xrot[i] = CompactSXform<T>(model._Xrot[i]);
+    _Ibody[i] = model._Ibody[i].getMatrix();
+    _Irot[i] = model._Irot[i].getMatrix();
+    _axes[i] = 0;
+    if (i < 6) continue;
+
+    if (model._jointTypes[i] != JointType::Revolute) {
+      throw std::runtime_error(
+          "FixedFloatingBaseModel only supports revolute joints");
+    }
+    _axes[i] = (int)model._jointAxes[i];
+  }
+
+  _nGroundContact = model._nGroundContact;
+  _gcParent = model._gcParent;
+  _gcLocation = model._gcLocation;
+  _footIndicesGC = model._footIndicesGC;
+  _compute_contact_info = model._compute_contact_info;
+  _pGC.resize(_nGroundContact);
+  _vGC.resize(_nGroundContact);
+  _Jc.resize(_nGroundContact);
+  _Jcdqd.resize(_nGroundContact);
+
+  _bodyOrientation << 1, 0, 0, 0;
+  _bodyPosition.setZero();
+  _bodyVelocity.setZero();
+  _q.setZero();
+  _qd.setZero();
+  resetExternalForces();
+  _H.setZero();
+  _Cqd.setZero();
+  _G.setZero();
+}
+
+/*!
+ * Forward kinematics of all bodies.  Computes _Xup (from up the tree) and _Xa
+ * (from absolute), the velocities _v and coriolis accelerations _c of the
+ * bodies and rotors, and the position and velocity of the contact points.
+ */
+template <typename T, int NBodies, int NDof>
+void FixedFloatingBaseModel<T, NBodies, NDof>::forwardKinematics() {
+  if (_kinematicsUpToDate) return;
+
+  _Xup[5] = CompactSXform<T>(quaternionToRotationMatrix(_bodyOrientation),
+                             _bodyPosition);
+  _Xa[5] = _Xup[5];
+  _v[5] = _bodyVelocity;
+
+  unrolledFor<6, NDof>([&](auto idx) {
+    constexpr int i = decltype(idx)::value;
+    const int axis = _axes[i];
+    const int parent = _parents[i];
+    const T qd = _qd[i - 6];
+    const T qdRot = qd * _gearRatios[i];
+    CoordinateAxis jointAxis = (CoordinateAxis)axis;
+
+    // the joint rotates the tree transform, and the velocity only changes
+    // about the joint axis
+    _Xup[i].E = coordinateRotation(jointAxis, _q[i - 6]) * _Xtree[i].E;
+    _Xup[i].r = _Xtree[i].r;
+    _v[i] = _Xup[i].apply(_v[parent]);
+    _v[i][axis] += qd;
+
+    _Xuprot[i].E =
+        coordinateRotation(jointAxis, _q[i - 6] * _gearRatios[i]) * _Xrot[i].E;
+    _Xuprot[i].r = _Xrot[i].r;
+    _vrot[i] = _Xuprot[i].apply(_v[parent]);
+    _vrot[i][axis] += qdRot;
+
+    // v x (S * qd)
+    SVec<T> vJ = SVec<T>::Zero();
+    vJ[axis] = qd;
+    _c[i] = motionCrossProduct(_v[i], vJ);
+    vJ[axis] = qdRot;
+    _crot[i] = motionCrossProduct(_vrot[i], vJ);
+
+    _Xa[i] = _Xup[i] * _Xa[parent];
+  });
+
+  for (size_t j = 0; j < _nGroundContact; j++) {
+    if (!_compute_contact_info[j]) continue;
+    size_t i = _gcParent[j];
+    const Vec3<T>& location = _gcLocation[j];
+
+    // the inverse of _Xa is (E^T, -E r)
+    Vec3<T> wLocal = _v[i].template head<3>();
+    Vec3<T> vLocal = _v[i].template tail<3>() + wLocal.cross(location);
+    _pGC[j] = _Xa[i].r + _Xa[i].E.transpose() * location;
+    _vGC[j] = _Xa[i].E.transpose() * vLocal;
+  }
+  _kinematicsUpToDate = true;
+}
+
+/*!
+ * Computes the velocity product accelerations _avp and _avprot
+ */
+template <typename T, int NBodies, int NDof>
+void FixedFloatingBaseModel<T, NBodies, NDof>::biasAccelerations() {
+  if (_biasAccelerationsUpToDate) return;
+  forwardKinematics();
+  _avp[5].setZero();
+
+  unrolledFor<6, NDof>([&](auto idx) {
+    constexpr int i = decltype(idx)::value;
+    _avp[i] = _Xup[i].apply(_avp[_parents[i]]) + _c[i];
+    _avprot[i] = _Xuprot[i].apply(_avp[_parents[i]]) + _crot[i];
+  });
+  _biasAccelerationsUpToDate = true;
+}
+
+/*!
+ * Computes the composite rigid body inertias _IC.  _IC[i] does not contain
+ * rotor i.
+ */
+template <typename T, int NBodies, int NDof>
+void FixedFloatingBaseModel<T, NBodies, NDof>::compositeInertias() {
+  if (_compositeInertiasUpToDate) return;
+  forwardKinematics();
+
+  for (int i = 5; i < NDof; i++) _IC[i] = _Ibody[i];
+
+  unrolledForReverse<6, NDof>([&](auto idx) {
+    constexpr int i = decltype(idx)::value;
+    _IC[_parents[i]] +=
+        _Xup[i].congruence(_IC[i]) + _Xuprot[i].congruence(_Irot[i]);
+  });
+  _compositeInertiasUpToDate = true;
+}
+
+/*!
+ * Computes the mass matrix (H) of the inverse dynamics
+ */
+template <typename T, int NBodies, int NDof>
+auto FixedFloatingBaseModel<T, NBodies, NDof>::massMatrix() -> const MassMat& {
+  compositeInertias();
+  _H.setZero();
+  _H.template topLeftCorner<6, 6>() = _IC[5];
+
+  unrolledFor<6, NDof>([&](auto idx) {
+    constexpr int j = decltype(idx)::value;
+    const int axis = _axes[j];
+    const T gr = _gearRatios[j];
+
+    // spatial force for a unit qdd_j: the axis column of the inertias
+    SVec<T> f = _IC[j].col(axis);
+    SVec<T> frot = gr * _Irot[j].col(axis);
+    _H(j, j) = f[axis] + gr * frot[axis];
+
+    f = _Xup[j].applyTranspose(f) + _Xuprot[j].applyTranspose(frot);
+    int i = _parents[j];
+    while (i > 5) {
+      _H(i, j) = f[_axes[i]];
+      _H(j, i) = _H(i, j);
+      f = _Xup[i].applyTranspose(f);
+      i = _parents[i];
+    }
+
+    _H.template block<6, 1>(0, j) = f;
+    _H.template block<1, 6>(j, 0) = f.transpose();
+  });
+  return _H;
+}
+
+/*!
+ * Computes the generalized gravity force (G) of the inverse dynamics
+ */
+template <typename T, int NBodies, int NDof>
+auto FixedFloatingBaseModel<T, NBodies, NDof>::generalizedGravityForce()
+    -> const GenVec& {
+  compositeInertias();
+
+  SVec<T> aGravity;
+  aGravity << 0, 0, 0, _gravity[0], _gravity[1], _gravity[2];
+  _ag[5] = _Xup[5].apply(aGravity);
+  _G.template head<6>() = -_IC[5] * _ag[5];
+
+  unrolledFor<6, NDof>([&](auto idx) {
+    constexpr int i = decltype(idx)::value;
+    const int axis = _axes[i];
+    _ag[i] = _Xup[i].apply(_ag[_parents[i]]);
+    _agrot[i] = _Xuprot[i].apply(_ag[_parents[i]]);
+    _G[i] = -_IC[i].row(axis).dot(_ag[i]) -
+            _gearRatios[i] * _Irot[i].row(axis).dot(_agrot[i]);
+  });
+  return _G;
+}
+
+/*!
+ * Computes the generalized coriolis forces (Cqd) of the inverse dynamics
+ */
+template <typename T, int NBodies, int NDof>
+auto FixedFloatingBaseModel<T, NBodies, NDof>::generalizedCoriolisForce()
+    -> const GenVec& {
+  biasAccelerations();
+
+  SVec<T> hfb = _Ibody[5] * _v[5];
+  _fvp[5] = _Ibody[5] * _avp[5] + forceCrossProduct(_v[5], hfb);
+
+  unrolledFor<6, NDof>([&](auto idx) {
+    constexpr int i = decltype(idx)::value;
+    SVec<T> hi = _Ibody[i] * _v[i];
+    _fvp[i] = _Ibody[i] * _avp[i] + forceCrossProduct(_v[i], hi);
+    SVec<T> hr = _Irot[i] * _vrot[i];
+    _fvprot[i] = _Irot[i] * _avprot[i] + forceCrossProduct(_vrot[i], hr);
+  });
+
+  unrolledForReverse<6, NDof>([&](auto idx) {
+    constexpr int i = decltype(idx)::value;
+    const int axis = _axes[i];
+    _Cqd[i] = _fvp[i][axis] + _gearRatios[i] * _fvprot[i][axis];
+    _fvp[_parents[i]] +=
+        _Xup[i].applyTranspose(_fvp[i]) + _Xuprot[i].applyTranspose(_fvprot[i]);
+  });
+
+  _Cqd.template head<6>() = _fvp[5];
+  return _Cqd;
+}
+
+/*!
+ * Compute the contact Jacobians (3 x NDof matrices) for the velocity of each
+ * contact point expressed in absolute coordinates
+ */
+template <typename T, int NBodies, int NDof>
+void FixedFloatingBaseModel<T, NBodies, NDof>::contactJacobians() {
+  forwardKinematics();
+  biasAccelerations();
+
+  for (size_t k = 0; k < _nGroundContact; k++) {
+    _Jc[k].setZero();
+    _Jcdqd[k].setZero();
+    if (!_compute_contact_info[k]) continue;
+
+    int i = _gcParent[k];
+
+    // contact frame: at the point, with the orientation of the world
+    CompactSXform<T> Xc(_Xa[i].E.transpose(), _gcLocation[k]);
+    SVec<T> ac = Xc.apply(_avp[i]);
+    SVec<T> vc = Xc.apply(_v[i]);
+    _Jcdqd[k] = spatialToLinearAcceleration(ac, vc);
+
+    // linear rows of the transform to the contact frame, [P Q]
+    Mat3<T> P = -Xc.E * vectorToSkewMat(Xc.r);
+    Mat3<T> Q = Xc.E;
+
+    // from tips to base
+    while (i > 5) {
+      _Jc[k].col(i) = P.col(_axes[i]);
+      const CompactSXform<T>& X = _Xup[i];
+      Q = Q * X.E;
+      P = P * X.E - Q * vectorToSkewMat(X.r);
+      i = _parents[i];
+    }
+    _Jc[k].template block<3, 3>(0, 0) = P;
+    _Jc[k].template block<3, 3>(0, 3) = Q;
+  }
+}
+
+/*!
+ * Computes the articulated body inertias _IA, and the parts of the articulated
+ * body algorithm which only depend on positions
+ */
+template <typename T, int NBodies, int NDof>
+void FixedFloatingBaseModel<T, NBodies, NDof>::updateArticulatedBodies() {
+  if (_articulatedBodiesUpToDate) return;
+  forwardKinematics();
+
+  for (int i = 5; i < NDof; i++) _IA[i] = _Ibody[i];
+
+  unrolledForReverse<6, NDof>([&](auto idx) {
+    constexpr int i = decltype(idx)::value;
+    const int axis = _axes[i];
+    const T gr = _gearRatios[i];
+
+    _U[i] = _IA[i].col(axis);
+    _Urot[i] = gr * _Irot[i].col(axis);
+    _Utot[i] = _Xup[i].applyTranspose(_U[i]) +
+               _Xuprot[i].applyTranspose(_Urot[i]);
+    _d[i] = gr * _Urot[i][axis] + _U[i][axis];
+
+    _IA[_parents[i]] += _Xup[i].congruence(_IA[i]) +
+                        _Xuprot[i].congruence(_Irot[i]) -
+                        _Utot[i] * _Utot[i].transpose() / _d[i];
+  });
+
+  _invIA5.compute(_IA[5]);
+  _articulatedBodiesUpToDate = true;
+}
+
+/*!
+ * Articulated body algorithm, including the _externalForces
+ * @param tau : nJoints joint torques
+ * @param dstate : the accelerations
+ */
+template <typename T, int NBodies, int NDof>
+template <typename Derived>
+void FixedFloatingBaseModel<T, NBodies, NDof>::runABA(
+    const Eigen::MatrixBase<Derived>& tau, FBModelStateDerivative<T>& dstate) {
+  forwardKinematics();
+  updateArticulatedBodies();
+
+  SVec<T> aGravity;
+  aGravity << 0, 0, 0, _gravity[0], _gravity[1], _gravity[2];
+
+  SVec<T> ivProduct = _Ibody[5] * _v[5];
+  _pA[5] = forceCrossProduct(_v[5], ivProduct);
+
+  unrolledFor<6, NDof>([&](auto idx) {
+    constexpr int i = decltype(idx)::value;
+    SVec<T> iv = _Ibody[i] * _v[i];
+    _pA[i] = forceCrossProduct(_v[i], iv);
+    iv = _Irot[i] * _vrot[i];
+    _pArot[i] = forceCrossProduct(_vrot[i], iv);
+  });
+
+  // external forces are in absolute coordinates
+  for (int i = 5; i < NDof; i++) {
+    const CompactSXform<T>& Xa = _Xa[i];
+    const SVec<T>& fext = _externalForces[i];
+    Vec3<T> f = fext.template tail<3>();
+    _pA[i].template head<3>() -=
+        Xa.E * (fext.template head<3>() - Xa.r.cross(f));
+    _pA[i].template tail<3>() -= Xa.E * f;
+  }
+
+  unrolledForReverse<6, NDof>([&](auto idx) {
+    constexpr int i = decltype(idx)::value;
+    const int axis = _axes[i];
+    const T gr = _gearRatios[i];
+    _u[i] = tau[i - 6] - _pA[i][axis] - gr * _pArot[i][axis] -
+            _U[i].dot(_c[i]) - _Urot[i].dot(_crot[i]);
+
+    _pA[_parents[i]] +=
+        _Xup[i].applyTranspose(_pA[i] + _IA[i] * _c[i]) +
+        _Xuprot[i].applyTranspose(_pArot[i] + _Irot[i] * _crot[i]) +
+        _Utot[i] * _u[i] / _d[i];
+  });
+
+  // include gravity and compute acceleration of floating base
+  _a[5] = _Xup[5].apply(-aGravity);
+  SVec<T> afb = _invIA5.solve(-_pA[5] - _IA[5] * _a[5]);
+  _a[5] += afb;
+
+  dstate.qdd.resize(nJoints);
+  unrolledFor<6, NDof>([&](auto idx) {
+    constexpr int i = decltype(idx)::value;
+    const int parent = _parents[i];
+    T qdd = (_u[i] - _Utot[i].dot(_a[parent])) / _d[i];
+    dstate.qdd[i - 6] = qdd;
+    _a[i] = _Xup[i].apply(_a[parent]) + _c[i];
+    _a[i][_axes[i]] += qdd;
+  });
+
+  dstate.dBodyPosition =
+      _Xup[5].E.transpose() * _bodyVelocity.template tail<3>();
+  dstate.dBodyVelocity = afb;
+}
+
+#endif  // LIBBIOMIMETICS_FIXEDFLOATINGBASEMODEL_H
@@ -22,6 +22,7 @@
 #include <vector>
 
 #include "Math/orientation_tools.h"
+#include "MassMatrixLTL.h"
 #include "SpatialInertia.h"
 #include "spatial.h"
 
@@ -203,10 +204,18 @@ class FloatingBaseModel {
 
   DVec<T> generalizedGravityForce();
   DVec<T> generalizedCoriolisForce();
-  DMat<T> massMatrix();
+  const DMat<T>& massMatrix();
   DVec<T> inverseDynamics(const FBModelStateDerivative<T>& dState);
   void runABA(const DVec<T>& tau, FBModelStateDerivative<T>& dstate);
 
+  void inverseDynamicsDerivatives(const FBModelStateDerivative<T>& dState,
+                                  DMat<T>& dtau_dq, DMat<T>& dtau_dqd,
+                                  DMat<T>& dtau_dqdd);
+  void forwardDynamicsDerivatives(const DVec<T>& tau,
+                                  FBModelStateDerivative<T>& dstate,
+                                  DMat<T>& dqdd_dq, DMat<T>& dqdd_dqd,
+                                  DMat<T>& dqdd_dtau);
+
   size_t _nDof = 0;
   Vec3<T> _gravity;
   vector<int> _parents;
@@ -268,6 +277,11 @@ class FloatingBaseModel {
   vectorAligned<D3Mat<T>> _Jc;
   vectorAligned<Vec3<T>> _Jcdqd;
 
+  // derivatives of the inverse dynamics quantities, with respect to q, qd and
+  // qdd side by side (6 x 3 _nDof)
+  vectorAligned<D6Mat<T>> _Dv, _Dvrot, _Da, _Darot, _Df, _Dfrot;
+  MassMatrixLTL<T> _HFactor;
+
   bool _kinematicsUpToDate = false;
   bool _biasAccelerationsUpToDate = false;
   bool _accelerationsUpToDate = false;
@@ -0,0 +1,152 @@
+/*! @file MassMatrixLTL.h
+ *  @brief Sparse factorization of the mass matrix of a kinematic tree
+ *
+ * The mass matrix H of a kinematic tree has H(i,j) = 0 unless dof i is an
+ * ancestor of dof j, or the other way around.  This branch-induced sparsity
+ * is kept by factoring H = L^T L, with L lower triangular and L(i,j) != 0
+ * only if j is an ancestor of i (or i = j).  This is the LTL factorization
+ * of "Rigid Body Dynamics Algorithms" by Featherstone, Chapter 6.5.  It needs
+ * no pivoting, is much cheaper than a dense LU of H and gives inverses which
+ * are exactly symmetric.
+ *
+ * The 6 dofs of the floating base form a chain (dof i - 1 is the parent of
+ * dof i), so their 6x6 block is factored as a dense block, and body i of a
+ * FloatingBaseModel is dof i for the joints.
+ */
+
+#ifndef LIBBIOMIMETICS_MASSMATRIXLTL_H
+#define LIBBIOMIMETICS_MASSMATRIXLTL_H
+
+#include <cmath>
+#include <vector>
+
+#include "cppTypes.h"
+
+template <typename T>
+class MassMatrixLTL {
+ public:
+  MassMatrixLTL() {}
+
+  /*!
+   * @param bodyParents : parent of each body of a FloatingBaseModel (its
+   * _parents), which start with the 6 floating base dofs
+   */
+  explicit MassMatrixLTL(const std::vector<int>& bodyParents) {
+    setParents(bodyParents);
+  }
+
+  /*!
+   * Set the tree from the parents of the bodies of a FloatingBaseModel
+   */
+  void setParents(const std::vector<int>& bodyParents) {
+    _lambda.resize(bodyParents.size());
+    for (size_t i = 0; i < bodyParents.size(); i++)
+      _lambda[i] = i < 6 ? (int)i - 1 : bodyParents[i];
+    _factored = false;
+  }
+
+  /*!
+   * Factor a mass matrix of the tree
+   * @return false if H is not positive definite
+   */
+  bool factor(const DMat<T>& H) {
+    int n = (int)_lambda.size();
+    _L = H;
+    for (int k = n - 1; k >= 0; k--) {
+      if (!(_L(k, k) > 0)) {
+        _factored = false;
+        return false;
+      }
+      _L(k, k) = std::sqrt(_L(k, k));
+      for (int i = _lambda[k]; i >= 0; i = _lambda[i]) _L(k, i) /= _L(k, k);
+      for (int i = _lambda[k]; i >= 0; i = _lambda[i])
+        for (int j = i; j >= 0; j = _lambda[j]) _L(i, j) -= _L(k, i) * _L(k, j);
+    }
+    _L.template triangularView<Eigen::StrictlyUpper>().setZero();
+    _factored = true;
+    return true;
+  }
+
+  bool isFactored() const { return _factored; }
+
+  /*!
+   * Get the factor L, with H = L^T L
+   */
+  const DMat<T>& getL() const { return _L; }
+
+  /*!
+   * X = L^-1 X
+   */
+  template <typename Derived>
+  void applyLInverse(Eigen::MatrixBase<Derived>& X) const {
+    int n = (int)_lambda.size();
+    for (int i = 0; i < n; i++) {
+      for (int j = _lambda[i]; j >= 0; j = _lambda[j])
+        X.row(i) -= _L(i, j) * X.row(j);
+      X.row(i) /= _L(i, i);
+    }
+  }
+
+  /*!
+   * X = L^-T X.  As H^-1 = L^-1 L^-T, this is an inverse square root of H:
+   * (L^-T X)^T (L^-T X) = X^T H^-1 X
+   */
+  template <typename Derived>
+  void applyLInverseTranspose(Eigen::MatrixBase<Derived>& X) const {
+    for (int i = (int)_lambda.size() - 1; i >= 0; i--) {
+      X.row(i) /= _L(i, i);
+      for (int j = _lambda[i]; j >= 0; j = _lambda[j])
+        X.row(j) -= _L(i, j) * X.row(i);
+    }
+  }
+
+  /*!
+   * X = H^-1 X
+   */
+  template <typename Derived>
+  void solveInPlace(Eigen::MatrixBase<Derived>& X) const {
+    applyLInverseTranspose(X);
+    applyLInverse(X);
+  }
+
+  /*!
+   * @return H^-1 b
+   */
+  DVec<T> solve(const DVec<T>& b) const {
+    DVec<T> x = b;
+    solveInPlace(x);
+    return x;
+  }
+
+  /*!
+   * @return H^-1 M
+   */
+  DMat<T> inverseTimes(const DMat<T>& M) const {
+    DMat<T> X = M;
+    solveInPlace(X);
+    return X;
+  }
+
+  /*!
+   * @return L^-T M, see applyLInverseTranspose
+   */
+  DMat<T> sqrtInverseTimes(const DMat<T>& M) const {
+    DMat<T> X = M;
+    applyLInverseTranspose(X);
+    return X;
+  }
+
+  /*!
+   * @return H^-1
+   */
+  DMat<T> inverse() const {
+    return inverseTimes(DMat<T>::Identity(_L.rows(), _L.cols()));
+  }
+
+ private:
+  std::vector<int> _lambda;  // parent dof of each dof, -1 for the root
+  DMat<T> _L;
+  bool _factored = false;
+};
+
+#endif  // LIBBIOMIMETICS_MASSMATRIXLTL_H
@@ -6,6 +6,9 @@
 #define PROJECT_IMUSIMULATOR_H
 
 #include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
 
 #include "ControlParameters/SimulatorParameters.h"
 #include "Dynamics/FloatingBaseModel.h"
@@ -48,6 +51,24 @@ class ImuSimulator {
                           const FBModelStateDerivative<T>& robotStateD,
                           CheaterState<T>& state);
 
+  /*!
+   * @return state of the noise generator, as text
+   */
+  std::string getRandomState() const {
+    std::ostringstream ss;
+    ss << _mt;
+    return ss.str();
+  }
+
+  /*!
+   * Set the state of the noise generator, from getRandomState
+   */
+  void setRandomState(const std::string& randomState) {
+    std::istringstream ss(randomState);
+    ss >> _mt;
+    if (ss.fail()) throw std::runtime_error("bad IMU noise generator state");
+  }
+
  private:
   SimulatorControlParameters& _simSettings;
   std::mt19937 _mt;
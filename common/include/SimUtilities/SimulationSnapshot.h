@@ -0,0 +1,67 @@
+/*! @file SimulationSnapshot.h
+ *  @brief State of a whole simulation, to save, restore and copy it
+ *
+ * Holds what the simulator side carries from a step to the next: the robot
+ * and contact state, the spine boards, the IMU noise generator, the gamepad,
+ * the clocks and the control parameters a script can change.  Restoring it
+ * into a simulation of the same robot, terrain and simulator parameters
+ * resumes it bit for bit.  The robot controller is not part of it, it keeps
+ * its own state.
+ *
+ * Files are raw native binary, only meant to be read back by the same build.
+ */
+
+#ifndef PROJECT_SIMULATIONSNAPSHOT_H
+#define PROJECT_SIMULATIONSNAPSHOT_H
+
+#include <string>
+#include <vector>
+
+#include "ControlParameters/ControlParameters.h"
+#include "Dynamics/DynamicsSimulator.h"
+#include "SimUtilities/GamepadCommand.h"
+#include "SimUtilities/SpineBoard.h"
+#include "cppTypes.h"
+
+/*!
+ * Value of a control parameter
+ */
+struct SnapshotParameter {
+  std::string name;
+  ControlParameterValueKind kind;
+  ControlParameterValue value;
+};
+
+struct SimulationSnapshot {
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  double time = 0;
+  double timeOfNextLowLevelControl = 0;
+  double timeOfNextHighLevelControl = 0;
+  u64 highLevelIterations = 0;
+  u64 scriptPosition = 0;  // next event of the SimulationScript
+
+  DynamicsSimulatorSnapshot<double> dynamics;
+  DVec<double> tau;
+
+  SpiData spiData;
+  SpiCommand spiCommand;
+  float spineTorque[4][3];
+  s32 spineIterations[4];
+
+  std::string imuRandomState;
+  GamepadCommand gamepad;
+
+  std::vector<SnapshotParameter> robotParameters;
+  std::vector<SnapshotParameter> userParameters;  // empty without user ones
+
+  static void saveParameters(const ControlParameters& params,
+                             std::vector<SnapshotParameter>& values);
+  static void restoreParameters(const std::vector<SnapshotParameter>& values,
+                                ControlParameters& params);
+
+  void save(const std::string& fileName) const;
+  void load(const std::string& fileName);
+};
+
+#endif  // PROJECT_SIMULATIONSNAPSHOT_H
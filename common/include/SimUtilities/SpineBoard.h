@@ -60,6 +60,10 @@ class SpineBoard {
   void run();
   void resetData();
   void resetCommand();
+
+  //! Number of runs, to save and restore the board
+  s32 getIterations() const { return iter_counter; }
+  void setIterations(s32 iterations) { iter_counter = iterations; }
   SpiCommand* cmd = nullptr;
   SpiData* data = nullptr;
   float torque_out[3];
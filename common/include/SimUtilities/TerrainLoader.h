@@ -0,0 +1,44 @@
+/*! @file TerrainLoader.h
+ *  @brief Reads a terrain yaml file
+ *
+ * The terrain file is a list of elements (infinite-plane, box, stairs, mesh,
+ * tiled-mesh).
+ * The loader parses it and hands each collision object to a callback, so the
+ * graphical simulator and the headless runner read the same files.
+ */
+
+#ifndef PROJECT_TERRAINLOADER_H
+#define PROJECT_TERRAINLOADER_H
+
+#include <functional>
+#include <string>
+
+#include "cppTypes.h"
+
+/*!
+ * Called for each collision object of the terrain
+ */
+struct TerrainCallbacks {
+  // mu, restitution, height, graphics size x/y, checkers x/y
+  std::function<void(double, double, double, double, double, double, double)>
+      addPlane;
+
+  // mu, restitution, depth, width, height, position, orientation, transparent
+  std::function<void(double, double, double, double, double,
+                     const Vec3<double>&, const Mat3<double>&, bool)>
+      addBox;
+
+  // mu, restitution, grid size, left corner, height map, transparent
+  std::function<void(double, double, double, const Vec3<double>&,
+                     const DMat<double>&, bool)>
+      addMesh;
+
+  // mu, restitution, tiled height map file, tiles kept in memory
+  std::function<void(double, double, const std::string&, size_t)>
+      addTiledMesh;
+};
+
+void loadTerrainFile(const std::string& terrainFileName,
+                     const TerrainCallbacks& callbacks);
+
+#endif  // PROJECT_TERRAINLOADER_H
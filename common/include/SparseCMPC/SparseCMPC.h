@@ -1,26 +1,54 @@
 #ifndef CHEETAH_SOFTWARE_SPARSECMPC_H
 #define CHEETAH_SOFTWARE_SPARSECMPC_H
 
+#include <memory>
 #include "GraphSearch.h"
 #include "cppTypes.h"
-
-// SparseTriple copy from JCQP
-template<typename T>
-struct SparseTriple {
-  T value;
-  u32 r, c;
-};
+#include "third-party/JCQP/CholeskySparseSolver.h"
 
 struct BblockID {
   u32 foot;
   u32 timestep;
 };
 
+enum class SparseCMPCSolver {
+  OSQP,
+  JCQP
+};
+
+/*!
+ * KKT factorization of the JCQP solver, for one contact sequence
+ */
+struct SparseCMPCFactorCacheEntry {
+  std::vector<u8> contacts; // contact bitmask of each step
+  std::unique_ptr<CholeskySparseSolver<double>> solver;
+  u64 lastUse = 0;
+};
+
 class SparseCMPC {
 public:
   SparseCMPC();
   void run();
 
+  /*!
+   * Pick the QP solver.  With JCQP, the ordering and symbolic factorization of the KKT matrix are
+   * cached by contact sequence, as the sparsity pattern only depends on which feet are in contact.
+   */
+  void setSolver(SparseCMPCSolver solver) {
+    _solver = solver;
+  }
+
+  void clearFactorCache() {
+    _factorCache.clear();
+    _factorCacheHits = 0;
+    _factorCacheMisses = 0;
+  }
+
+  // JCQP solves which reused a cached symbolic factorization / had to do it from scratch
+  u64 getFactorCacheHits() const { return _factorCacheHits; }
+  u64 getFactorCacheMisses() const { return _factorCacheMisses; }
+  static constexpr std::size_t kFactorCacheSize = 32;
+
 
   // setup methods
   template<typename T>
@@ -89,7 +117,7 @@ private:
   u32 getStateIndex(u32 trajIdx);
   u32 getControlIndex(u32 bBlockIdx);
   u32 addConstraint(u32 size);
-  void addConstraintTriple(double value, u32 row, u32 col);
+  void addConstraintTriple(double value, u32 row, u32 col, bool structural = false);
 
   void addX0Constraint();
   void addDynamicsConstraints();
@@ -99,8 +127,9 @@ private:
   void addLinearStateCost();
   void addQuadraticControlCost();
 
-  void runSolver();
+  void runSolverJCQP();
   void runSolverOSQP();
+  CholeskySparseSolver<double>* getCachedFactorization();
 
   // inputs
   Mat3<double> _Ibody;
@@ -132,6 +161,12 @@ private:
   u32 _trajectoryLength;
   u32 _bBlockCount;
   u32 _constraintCount;
+
+  // solver
+  SparseCMPCSolver _solver = SparseCMPCSolver::OSQP;
+  std::vector<SparseCMPCFactorCacheEntry> _factorCache;
+  std::vector<u8> _cacheKey;
+  u64 _factorCacheUses = 0, _factorCacheHits = 0, _factorCacheMisses = 0;
 };
 
 #endif //CHEETAH_SOFTWARE_SPARSECMPC_H
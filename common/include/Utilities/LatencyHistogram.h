@@ -0,0 +1,79 @@
+/*! @file LatencyHistogram.h
+ *  @brief Histogram of durations with log-linear buckets, for tail latency
+ *
+ * Like an HDR histogram: durations in ns up to 2 * kSubBuckets are counted
+ * exactly, larger ones in kSubBuckets buckets per power of two, so a
+ * percentile is within 1 / kSubBuckets (about 3%) of the true value from
+ * 64 ns to a minute.  The maximum is kept exactly.
+ *
+ * One thread records, any thread may read at the same time: counters are
+ * atomics written without read-modify-write, so recording never locks.
+ */
+
+#ifndef PROJECT_LATENCYHISTOGRAM_H
+#define PROJECT_LATENCYHISTOGRAM_H
+
+#include <atomic>
+
+#include "cTypes.h"
+
+class LatencyHistogram {
+ public:
+  static constexpr int kSubBucketBits = 5;
+  static constexpr u64 kSubBuckets = 1 << kSubBucketBits;
+  static constexpr int kMaxBits = 36;  // durations are clamped to 68.7 s
+  static constexpr u64 kMaxValue = (1ull << kMaxBits) - 1;
+  static constexpr size_t kBuckets =
+      (kMaxBits - kSubBucketBits + 1) * kSubBuckets;
+
+  LatencyHistogram() { reset(); }
+  LatencyHistogram(const LatencyHistogram&) = delete;
+  LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+  /*!
+   * Count a duration.  Recording thread only.
+   * @param ns : duration in nanoseconds
+   */
+  void record(u64 ns) {
+    if (ns > kMaxValue) ns = kMaxValue;
+    std::atomic<u64>& bucket = _counts[bucketIndex(ns)];
+    bucket.store(bucket.load(std::memory_order_relaxed) + 1,
+                 std::memory_order_relaxed);
+    if (ns > _max.load(std::memory_order_relaxed))
+      _max.store(ns, std::memory_order_relaxed);
+    _count.store(_count.load(std::memory_order_relaxed) + 1,
+                 std::memory_order_release);
+  }
+
+  /*!
+   * Bucket of a duration
+   */
+  static size_t bucketIndex(u64 ns) {
+    if (ns < 2 * kSubBuckets) return ns;
+    int msb = 63 - __builtin_clzll(ns);
+    int shift = msb - kSubBucketBits;
+    return (shift + 1) * kSubBuckets + ((ns >> shift) - kSubBuckets);
+  }
+
+  /*!
+   * Largest duration counted in a bucket
+   */
+  static u64 bucketUpperBound(size_t index) {
+    if (index < 2 * kSubBuckets) return index;
+    int shift = (int)(index / kSubBuckets) - 1;
+    u64 sub = index % kSubBuckets + kSubBuckets;
+    return ((sub + 1) << shift) - 1;
+  }
+
+  u64 getCount() const { return _count.load(std::memory_order_acquire); }
+  u64 getMax() const { return _max.load(std::memory_order_relaxed); }
+  u64 getPercentile(double percentile) const;
+  void reset();
+
+ private:
+  std::atomic<u64> _counts[kBuckets];
+  std::atomic<u64> _count;
+  std::atomic<u64> _max;
+};
+
+#endif  // PROJECT_LATENCYHISTOGRAM_H
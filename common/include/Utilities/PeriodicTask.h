@@ -2,17 +2,105 @@
  * @file PeriodicTask.h
  * @brief Implementation of a periodic function running in a separate thread.
  * Periodic tasks have a task manager, which measure how long they take to run.
+ *
+ * Every task keeps histograms of its runtime and of how late it wakes up after
+ * its timer expires, and counts the periods it missed, since it started.  The
+ * task manager can export a summary to shared memory for other programs
+ * (scripts/task_status.py).
+ *
+ * Each task thread can have its own scheduling policy, priority and CPUs,
+ * set from a yaml file by task name (config/mini-cheetah-task-schedule.yaml),
+ * instead of inheriting those of the thread which started it.
+ *
+ * A task graph runs several tasks one after the other in a single thread each
+ * period, like SPI then control, so a task runs as soon as the data it needs
+ * is ready instead of at its own period.
  */
 
 #ifndef PROJECT_PERIODICTASK_H
 #define PROJECT_PERIODICTASK_H
 
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <map>
+#include <memory>
 #include <string>
 #include <thread>
 #include <vector>
 
+#include "Utilities/LatencyHistogram.h"
+#include "Utilities/SharedMemory.h"
+#include "Utilities/Timer.h"
+
+#define PERIODIC_TASK_STATUS_SHARED_MEMORY_NAME "periodic-task-status"
+#define PERIODIC_TASK_STATUS_MAX_TASKS 64
+
 class PeriodicTaskManager;
 
+/*!
+ * How the thread of a task is scheduled.  A policy of -1 or an empty list of
+ * CPUs keeps the policy or CPUs of the thread which starts the task.
+ */
+struct PeriodicTaskSchedule {
+  int policy = -1;        // SCHED_OTHER, SCHED_FIFO or SCHED_RR
+  int priority = 0;       // 1 to 99 for SCHED_FIFO and SCHED_RR, else 0
+  std::vector<int> cpus;  // CPUs the thread may run on
+
+  std::string toString() const;
+  PeriodicTaskSchedule applyToThisThread(const std::string& name) const;
+};
+
+/*!
+ * The periods of a periodic loop, apart from the clock: when the next run
+ * should start, and how many periods a late run missed.  Times are in ns.
+ */
+class PeriodCounter {
+ public:
+  /*!
+   * Start counting, with a first period starting at startNs
+   */
+  void start(u64 periodNs, u64 startNs) {
+    _periodNs = std::max((u64)1, periodNs);
+    _periodStartNs = startNs;
+  }
+
+  /*!
+   * @param runEndNs : time at which the last run ended
+   * @return time to sleep until for the next run, or 0 if its period already
+   * started
+   */
+  u64 getWakeupNs(u64 runEndNs) const {
+    if (runEndNs - _periodStartNs >= _periodNs) return 0;
+    return _periodStartNs + _periodNs;
+  }
+
+  /*!
+   * Go to the period of the next run.  The periods which started during the
+   * last run are missed, except the last one where the next run goes.
+   * @param runEndNs : time at which the last run ended
+   * @return number of periods missed
+   */
+  u64 next(u64 runEndNs) {
+    u64 periods = std::max((u64)1, (runEndNs - _periodStartNs) / _periodNs);
+    _periodStartNs += periods * _periodNs;
+    return periods - 1;
+  }
+
+  /*!
+   * @return how late a run starting at nowNs is, after the start of its period
+   */
+  u64 getLatenessNs(u64 nowNs) const {
+    return nowNs > _periodStartNs ? nowNs - _periodStartNs : 0;
+  }
+
+  u64 getPeriodStartNs() const { return _periodStartNs; }
+
+ private:
+  u64 _periodNs = 1;
+  u64 _periodStartNs = 0;
+};
+
 /*!
  * A single periodic task which will call run() at the given frequency
  */
@@ -50,8 +138,63 @@ class PeriodicTask {
    */
   float getMaxRuntime() { return _maxRuntime; }
 
+  /*!
+   * Get the histogram of the runtimes since the task started
+   */
+  const LatencyHistogram& getRuntimeHistogram() const {
+    return _runtimeHistogram;
+  }
+
+  /*!
+   * Get the histogram of the delays from timer expirations to wakeups
+   */
+  const LatencyHistogram& getWakeupHistogram() const {
+    return _wakeupHistogram;
+  }
+
+  /*!
+   * Get the number of periods without a run because the previous run was
+   * late, since the task started
+   */
+  u64 getMissedPeriods() const { return _missedPeriods.load(); }
+
+  const std::string& getName() const { return _name; }
+  bool isRunning() const { return _running; }
+
+  /*!
+   * Set how the thread is scheduled, from the next start
+   */
+  void setSchedule(const PeriodicTaskSchedule& schedule) {
+    _schedule = schedule;
+  }
+
+  /*!
+   * Get how the thread should be scheduled
+   */
+  const PeriodicTaskSchedule& getSchedule() const { return _schedule; }
+
+  /*!
+   * Get how the thread was actually scheduled when the task last started,
+   * which differs from the requested schedule if applying it failed.  The
+   * tasks of a graph run like the graph.
+   */
+  const PeriodicTaskSchedule& getEffectiveSchedule() const {
+    return _graph ? _graph->getEffectiveSchedule() : _effectiveSchedule;
+  }
+
+ protected:
+  /*!
+   * Get the time at which the current period started, in ns of
+   * CLOCK_MONOTONIC.  Only from run().
+   */
+  u64 getPeriodStartNs() const { return _periodStartNs; }
+
  private:
-  void loopFunction();
+  friend class PeriodicTaskGraph;
+
+  void loopFunction(std::promise<void>* scheduled);
+  void applySchedule();
+  void runTimed();
 
   float _period;
   volatile bool _running = false;
@@ -59,10 +202,42 @@ class PeriodicTask {
   float _lastPeriodTime = 0;
   float _maxPeriod = 0;
   float _maxRuntime = 0;
+  LatencyHistogram _runtimeHistogram;
+  LatencyHistogram _wakeupHistogram;
+  std::atomic<u64> _missedPeriods{0};
+  PeriodicTaskSchedule _schedule;
+  PeriodicTaskSchedule _effectiveSchedule;
+  Timer _periodTimer;
+  u64 _periodStartNs = 0;
+  PeriodicTask* _graph = nullptr;  // graph which runs this task
   std::string _name;
   std::thread _thread;
 };
 
+/*!
+ * Summary of a task, in shared memory.  Durations are in ns.
+ */
+struct PeriodicTaskStatus {
+  char name[32];
+  float period;
+  u32 running;
+  u64 runs;
+  u64 missedPeriods;
+  u64 runtime[4];  // p50, p99, p99.9, max
+  u64 wakeup[4];   // p50, p99, p99.9, max
+};
+
+/*!
+ * Summary of all tasks, in shared memory.  The sequence number is odd while
+ * the table is written: readers copy the table and retry if the sequence
+ * number was odd or changed.
+ */
+struct PeriodicTaskStatusTable {
+  std::atomic<u64> sequence;
+  u32 nTasks;
+  PeriodicTaskStatus tasks[PERIODIC_TASK_STATUS_MAX_TASKS];
+};
+
 /*!
  * A collection of periodic tasks which can be monitored together
  */
@@ -74,9 +249,59 @@ class PeriodicTaskManager {
   void printStatus();
   void printStatusOfSlowTasks();
   void stopAll();
+  void exportStatus(
+      const std::string& name = PERIODIC_TASK_STATUS_SHARED_MEMORY_NAME);
+  void setSchedule(const std::string& taskName,
+                   const PeriodicTaskSchedule& schedule);
+  bool getSchedule(const std::string& taskName,
+                   PeriodicTaskSchedule& schedule) const;
+  void loadSchedules(const std::string& fileName);
 
  private:
   std::vector<PeriodicTask*> _tasks;
+  std::map<std::string, PeriodicTaskSchedule> _schedules;
+  std::unique_ptr<SharedMemoryObject<PeriodicTaskStatusTable>> _statusExport;
+};
+
+/*!
+ * Tasks run one after the other by the thread of the graph, every period of
+ * the graph, instead of by their own threads.  A task runs once the tasks it
+ * comes after are done, but not before its phase: a delay from the start of
+ * the period.  A task with a period which is a multiple of the period of the
+ * graph runs every few periods.
+ *
+ * The tasks keep their own statistics, where the wakeup delay is from their
+ * phase to when they start.  The graph counts the missed periods.
+ */
+class PeriodicTaskGraph : public PeriodicTask {
+ public:
+  PeriodicTaskGraph(PeriodicTaskManager* taskManager, float period,
+                    std::string name);
+  ~PeriodicTaskGraph() { stop(); }
+  void addTask(PeriodicTask* task,
+               const std::vector<PeriodicTask*>& after = {},
+               float phase = 0);
+  void init() override;
+  void run() override;
+  void cleanup() override;
+
+  /*!
+   * Get the tasks in the order they run
+   */
+  const std::vector<PeriodicTask*>& getOrder() const { return _order; }
+
+ private:
+  struct Node {
+    PeriodicTask* task;
+    std::vector<PeriodicTask*> after;
+    u64 phaseNs;
+    u64 decimation;
+  };
+
+  std::vector<Node> _nodes;
+  std::vector<Node*> _orderedNodes;
+  std::vector<PeriodicTask*> _order;
+  u64 _periodCount = 0;
 };
 
 /*!
@@ -107,7 +332,7 @@ class PrintTaskStatus : public PeriodicTask {
   void run() override { 
     // DH: Disable printing
     //_tm->printStatus();
-    (void) _tm; // ignored unused warning
+    _tm->exportStatus();
   }
 
   void init() override {}
@@ -0,0 +1,86 @@
+/*! @file SpscRing.h
+ *  @brief Lock-free ring buffer with one producer thread and one consumer
+ * thread
+ *
+ * The slots are allocated up front and values are copied in and out, so
+ * neither side allocates, locks or makes system calls.
+ */
+
+#ifndef PROJECT_SPSCRING_H
+#define PROJECT_SPSCRING_H
+
+#include <atomic>
+#include <vector>
+
+#include "cTypes.h"
+
+template <typename T>
+class SpscRing {
+ public:
+  /*!
+   * @param capacity : number of values the ring can hold, rounded up to a
+   * power of two
+   */
+  explicit SpscRing(size_t capacity) {
+    size_t size = 1;
+    while (size < capacity) size *= 2;
+    _slots.resize(size);
+    _mask = size - 1;
+  }
+
+  SpscRing(const SpscRing&) = delete;
+  SpscRing& operator=(const SpscRing&) = delete;
+
+  /*!
+   * Copy a value into the ring.  Producer thread only.
+   * @return false (and nothing is copied) if the ring is full
+   */
+  bool push(const T& value) {
+    u64 head = _head.load(std::memory_order_relaxed);
+    if (head - _tailCache > _mask) {
+      _tailCache = _tail.load(std::memory_order_acquire);
+      if (head - _tailCache > _mask) return false;
+    }
+    _slots[head & _mask] = value;
+    _head.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  /*!
+   * Copy the oldest value out of the ring.  Consumer thread only.
+   * @return false if the ring is empty
+   */
+  bool pop(T& value) {
+    u64 tail = _tail.load(std::memory_order_relaxed);
+    if (tail == _headCache) {
+      _headCache = _head.load(std::memory_order_acquire);
+      if (tail == _headCache) return false;
+    }
+    value = _slots[tail & _mask];
+    _tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /*!
+   * @return number of values in the ring, may be out of date by the time it
+   * is used
+   */
+  size_t size() const {
+    return _head.load(std::memory_order_acquire) -
+           _tail.load(std::memory_order_acquire);
+  }
+
+  size_t capacity() const { return _slots.size(); }
+
+ private:
+  std::vector<T> _slots;
+  size_t _mask;
+
+  // each side on its own cache line, with its copy of the other side's index
+  alignas(64) std::atomic<u64> _head{0};
+  u64 _tailCache = 0;
+  alignas(64) std::atomic<u64> _tail{0};
+  u64 _headCache = 0;
+};
+
+#endif  // PROJECT_SPSCRING_H
@@ -0,0 +1,177 @@
+/*! @file TelemetryPublisher.h
+ *  @brief Sends telemetry (LCM messages) from a low priority thread
+ *
+ * Real-time tasks push copies of their messages into a ring per channel (see
+ * SpscRing), which never blocks and never makes a system call.  The publisher
+ * thread wakes up every period, encodes and sends whatever is in the rings.
+ * If a ring is full the message is dropped and counted, the real-time task
+ * never waits for the network.
+ *
+ * Each channel must only be pushed to from one thread at a time.  Channels are
+ * added before start.
+ *
+ * The publisher thread doesn't inherit the real-time policy of the thread
+ * which starts it: it runs as SCHED_OTHER (nice 10) unless it is given another
+ * schedule, e.g. the "telemetry" entry of the task schedule yaml.
+ */
+
+#ifndef PROJECT_TELEMETRYPUBLISHER_H
+#define PROJECT_TELEMETRYPUBLISHER_H
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Utilities/PeriodicTask.h"
+#include "Utilities/SpscRing.h"
+#include "cTypes.h"
+
+#ifdef LCM_MSG
+#include <lcm/lcm-cpp.hpp>
+#endif
+
+/*!
+ * Counters of one channel
+ */
+class TelemetryChannelBase {
+ public:
+  explicit TelemetryChannelBase(const std::string& name) : _name(name) {}
+  virtual ~TelemetryChannelBase() = default;
+
+  /*!
+   * Send the messages in the ring.  Publisher thread only.
+   * @return number of messages sent
+   */
+  virtual size_t publishPending() = 0;
+
+  const std::string& getName() const { return _name; }
+  u64 getPushedCount() const { return _pushed.load(); }
+  u64 getDroppedCount() const { return _dropped.load(); }
+  u64 getPublishedCount() const { return _published.load(); }
+
+ protected:
+  std::string _name;
+  std::atomic<u64> _pushed{0};
+  std::atomic<u64> _dropped{0};
+  std::atomic<u64> _published{0};
+};
+
+/*!
+ * Ring of messages of one type, and how to send them
+ */
+template <typename Msg>
+class TelemetryChannel : public TelemetryChannelBase {
+ public:
+  TelemetryChannel(const std::string& name, size_t capacity,
+                   std::function<void(const Msg&)> send)
+      : TelemetryChannelBase(name), _ring(capacity), _send(std::move(send)) {}
+
+  /*!
+   * Queue a copy of a message
+   * @return false if the ring was full and the message was dropped
+   */
+  bool push(const Msg& msg) {
+    _pushed.fetch_add(1, std::memory_order_relaxed);
+    if (!_ring.push(msg)) {
+      _dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    return true;
+  }
+
+  size_t publishPending() override {
+    size_t n = 0;
+    while (_ring.pop(_message)) {
+      _send(_message);
+      n++;
+    }
+    _published.fetch_add(n, std::memory_order_relaxed);
+    return n;
+  }
+
+ private:
+  SpscRing<Msg> _ring;
+  std::function<void(const Msg&)> _send;
+  Msg _message;  // publisher thread's copy, messages can be large
+};
+
+class TelemetryPublisher {
+ public:
+  explicit TelemetryPublisher(const std::string& name = "telemetry",
+                              double period = 0.001)
+      : _name(name), _period(period), _schedule(getDefaultSchedule()) {}
+  ~TelemetryPublisher() { stop(); }
+  TelemetryPublisher(const TelemetryPublisher&) = delete;
+  TelemetryPublisher& operator=(const TelemetryPublisher&) = delete;
+
+  /*!
+   * Add a channel, before start
+   * @param name : name of the channel, for the status
+   * @param capacity : number of messages the ring holds
+   * @param send : sends one message, called from the publisher thread
+   * @return the channel to push messages to, owned by the publisher
+   */
+  template <typename Msg>
+  TelemetryChannel<Msg>* addChannel(const std::string& name, size_t capacity,
+                                    std::function<void(const Msg&)> send) {
+    auto* channel = new TelemetryChannel<Msg>(name, capacity, std::move(send));
+    _channels.emplace_back(channel);
+    return channel;
+  }
+
+#ifdef LCM_MSG
+  /*!
+   * Add a channel which publishes to LCM
+   */
+  template <typename Msg>
+  TelemetryChannel<Msg>* addLcmChannel(lcm::LCM* lcm,
+                                       const std::string& channel,
+                                       size_t capacity = 16) {
+    return addChannel<Msg>(channel, capacity, [lcm, channel](const Msg& msg) {
+      lcm->publish(channel, &msg);
+    });
+  }
+#endif
+
+  void start();
+  void stop();
+  size_t publishPending();
+  u64 getDroppedCount() const;
+  void printStatus() const;
+
+  bool isRunning() const { return _running; }
+
+  /*!
+   * Set how the publisher thread is scheduled, from the next start
+   */
+  void setSchedule(const PeriodicTaskSchedule& schedule) {
+    _schedule = schedule;
+  }
+
+  /*!
+   * Get how the publisher thread was actually scheduled when it last started
+   */
+  const PeriodicTaskSchedule& getEffectiveSchedule() const {
+    return _effectiveSchedule;
+  }
+
+  static void setDefaultSchedule(const PeriodicTaskSchedule& schedule);
+  static PeriodicTaskSchedule getDefaultSchedule();
+
+ private:
+  void publishLoop(std::promise<void>* scheduled);
+
+  std::string _name;
+  double _period;
+  std::vector<std::unique_ptr<TelemetryChannelBase>> _channels;
+  std::atomic<bool> _running{false};
+  std::thread _thread;
+  PeriodicTaskSchedule _schedule;
+  PeriodicTaskSchedule _effectiveSchedule;
+};
+
+#endif  // PROJECT_TELEMETRYPUBLISHER_H
@@ -0,0 +1,118 @@
+/*!
+ * @file CollisionGrid.cpp
+ * @brief Broad phase for contact detection
+ */
+
+#include "Collision/CollisionGrid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+
+/*!
+ * Build the grid for a list of collision objects.  Objects can't move after
+ * this.
+ * @param collisions : collision objects, the indices of the candidates are
+ * indices into this list
+ */
+template <typename T>
+void CollisionGrid<T>::build(const std::vector<Collision<T>*>& collisions) {
+  const T inf = std::numeric_limits<T>::infinity();
+  // so rounding in the rotation of a box can't move a point out of its
+  // bounding box
+  const T margin = 1e-4;
+
+  size_t n = collisions.size();
+  _lo.resize(n);
+  _hi.resize(n);
+
+  std::vector<T> sizes;
+  Vec2<T> lower(inf, inf), upper(-inf, -inf);
+  for (size_t i = 0; i < n; i++) {
+    if (collisions[i]->getBoundingBox(_lo[i], _hi[i])) {
+      _lo[i] -= Vec3<T>::Constant(margin);
+      _hi[i] += Vec3<T>::Constant(margin);
+    } else {
+      _lo[i] = Vec3<T>::Constant(-inf);
+      _hi[i] = Vec3<T>::Constant(inf);
+    }
+
+    if (std::isfinite(_lo[i][0]) && std::isfinite(_lo[i][1]) &&
+        std::isfinite(_hi[i][0]) && std::isfinite(_hi[i][1])) {
+      lower = lower.cwiseMin(_lo[i].template head<2>());
+      upper = upper.cwiseMax(_hi[i].template head<2>());
+      sizes.push_back(std::max(_hi[i][0] - _lo[i][0], _hi[i][1] - _lo[i][1]));
+    }
+  }
+
+  if (sizes.empty()) {
+    _nx = _ny = 0;
+  } else {
+    // cells about the size of a typical object, but not too many of them
+    std::nth_element(sizes.begin(), sizes.begin() + sizes.size() / 2,
+                     sizes.end());
+    Vec2<T> area = upper - lower;
+    T maxCells = std::max(T(1024), T(16 * sizes.size()));
+    _cellSize = std::max(sizes[sizes.size() / 2],
+                         std::sqrt(area[0] * area[1] / maxCells));
+    _cellSize = std::max(_cellSize, 4 * margin);
+    _invCellSize = 1 / _cellSize;
+    _origin = lower;
+    _nx = (size_t)(area[0] * _invCellSize) + 1;
+    _ny = (size_t)(area[1] * _invCellSize) + 1;
+  }
+
+  // two passes: count the objects in each cell, then fill the cells in the
+  // order of the objects
+  size_t outside = _nx * _ny;
+  auto forEachCell = [&](size_t i, std::function<void(size_t)> f) {
+    if (!std::isfinite(_lo[i][0]) || !std::isfinite(_lo[i][1]) ||
+        !std::isfinite(_hi[i][0]) || !std::isfinite(_hi[i][1])) {
+      for (size_t c = 0; c <= outside; c++) f(c);
+      return;
+    }
+    size_t range[4];
+    cellRange(i, range);
+    for (size_t y = range[2]; y <= range[3]; y++)
+      for (size_t x = range[0]; x <= range[1]; x++) f(y * _nx + x);
+  };
+
+  _cellStart.assign(outside + 2, 0);
+  for (size_t i = 0; i < n; i++)
+    forEachCell(i, [&](size_t c) { _cellStart[c]++; });
+
+  _maxCandidates = 0;
+  size_t total = 0;
+  for (size_t c = 0; c <= outside; c++) {
+    size_t count = _cellStart[c];
+    _maxCandidates = std::max(_maxCandidates, count);
+    _cellStart[c] = total;
+    total += count;
+  }
+  _cellStart[outside + 1] = total;
+
+  _cellItems.resize(total);
+  std::vector<size_t> next(_cellStart.begin(), _cellStart.end() - 1);
+  for (size_t i = 0; i < n; i++)
+    forEachCell(i, [&](size_t c) { _cellItems[next[c]++] = i; });
+}
+
+/*!
+ * Cells overlapped by the bounding box of an object
+ * @param idx : index of the object
+ * @param range : set to first x, last x, first y, last y
+ */
+template <typename T>
+void CollisionGrid<T>::cellRange(size_t idx, size_t range[4]) const {
+  for (size_t axis = 0; axis < 2; axis++) {
+    size_t nCells = axis == 0 ? _nx : _ny;
+    T lo = (_lo[idx][axis] - _origin[axis]) * _invCellSize;
+    T hi = (_hi[idx][axis] - _origin[axis]) * _invCellSize;
+    range[2 * axis] = lo > 0 ? std::min((size_t)lo, nCells - 1) : 0;
+    range[2 * axis + 1] = hi > 0 ? std::min((size_t)hi, nCells - 1) : 0;
+  }
+}
+
+template class CollisionGrid<double>;
+template class CollisionGrid<float>;
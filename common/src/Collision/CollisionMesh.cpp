@@ -4,6 +4,9 @@
  */
 
 #include "Collision/CollisionMesh.h"
+
+#include <limits>
+
 #include "Utilities/Utilities_print.h"
 
 /*!
@@ -66,5 +69,18 @@ bool CollisionMesh<T>::ContactDetection(const Vec3<T>& cp_pos, T& penetration,
   return false;
 }
 
+/*!
+ * Bounding box of the height map.  Everything below the surface is in
+ * contact, so it is unbounded in z.
+ */
+template <typename T>
+bool CollisionMesh<T>::getBoundingBox(Vec3<T>& lo, Vec3<T>& hi) {
+  lo = _left_corner_loc;
+  hi = _left_corner_loc + Vec3<T>(_x_max, _y_max, 0);
+  lo[2] = -std::numeric_limits<T>::infinity();
+  hi[2] = std::numeric_limits<T>::infinity();
+  return true;
+}
+
 template class CollisionMesh<double>;
 template class CollisionMesh<float>;
@@ -0,0 +1,388 @@
+/*!
+ * @file CollisionTiledHeightMap.cpp
+ * @brief Collision logic for a height map too large for memory
+ */
+
+#include "Collision/CollisionTiledHeightMap.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+static const char tiledHeightMapMagic[8] = {'T', 'I', 'L', 'E',
+                                            'H', 'M', 'A', 'P'};
+static const size_t tiledHeightMapAlignment = 4096;
+
+static size_t roundUp(size_t bytes, size_t alignment) {
+  return (bytes + alignment - 1) / alignment * alignment;
+}
+
+/*!
+ * a * b + c, unless it doesn't fit in 64 bits
+ * @return false on overflow
+ */
+static bool multiplyAdd(u64 a, u64 b, u64 c, u64& result) {
+  if (a != 0 && b > (std::numeric_limits<u64>::max() - c) / a) return false;
+  result = a * b + c;
+  return true;
+}
+
+/*!
+ * Check a header against the size of its file.  The sizes are computed in 64
+ * bits with overflow checks, so a corrupt header can't wrap around to a size
+ * which fits in the file.
+ * @param tilesX : number of tiles along x
+ * @param tilesY : number of tiles along y
+ * @param tileSamples : number of samples in a tile
+ * @return false if the header is bad or the file too short for its tiles
+ */
+static bool checkHeader(const TiledHeightMapHeader& header, u64 fileSize,
+                        u64& tilesX, u64& tilesY, u64& tileSamples) {
+  if (memcmp(header.magic, tiledHeightMapMagic, 8) != 0) return false;
+  if (header.rows < 2 || header.cols < 2 || header.tileSize < 1) return false;
+  if (!(std::isfinite(header.grid) && header.grid > 0)) return false;
+  for (double corner : header.leftCorner) {
+    if (!std::isfinite(corner)) return false;
+  }
+
+  // grid cells over cells per tile, rounded up
+  tilesX = (header.rows - 2) / header.tileSize + 1;
+  tilesY = (header.cols - 2) / header.tileSize + 1;
+
+  u64 side, tileBytes, tiles, expectedSize;
+  if (!multiplyAdd(1, header.tileSize, 1, side) ||
+      !multiplyAdd(side, side, 0, tileSamples) ||
+      !multiplyAdd(tileSamples, sizeof(float), 0, tileBytes) ||
+      !multiplyAdd(tilesX, tilesY, 0, tiles) ||
+      !multiplyAdd(tiles, header.tileStride, header.dataOffset,
+                   expectedSize)) {
+    return false;
+  }
+  return header.tileStride >= tileBytes &&
+         header.dataOffset >= sizeof(TiledHeightMapHeader) &&
+         expectedSize <= fileSize;
+}
+
+/*!
+ * Tell the kernel what we need from part of the mapping.  The range is shrunk
+ * to whole pages.
+ */
+static void adviseRange(const char* start, size_t size, int advice) {
+  size_t page = sysconf(_SC_PAGESIZE);
+  uintptr_t begin = roundUp((uintptr_t)start, page);
+  uintptr_t end = ((uintptr_t)start + size) / page * page;
+  if (end > begin) madvise((void*)begin, end - begin, advice);
+}
+
+/*!
+ * Open a tiled height map file
+ * @param mu : coefficient of friction
+ * @param restitution : rebounding ratio (v+/v-)
+ * @param fileName : file written by writeFile
+ * @param cachedTiles : number of tiles kept in memory, at least 4
+ */
+template <typename T>
+CollisionTiledHeightMap<T>::CollisionTiledHeightMap(const T& mu,
+                                                    const T& restitution,
+                                                    const std::string& fileName,
+                                                    size_t cachedTiles)
+    : Collision<T>(mu, restitution) {
+  int fd = open(fileName.c_str(), O_RDONLY);
+  if (fd < 0) {
+    printf("[ERROR] Tiled height map %s: %s\n", fileName.c_str(),
+           strerror(errno));
+    throw std::runtime_error("Failed to open tiled height map!");
+  }
+
+  struct stat s;
+  fstat(fd, &s);
+  _mapSize = s.st_size;
+  if (_mapSize < sizeof(TiledHeightMapHeader)) {
+    close(fd);
+    throw std::runtime_error("Tiled height map " + fileName + " is too short");
+  }
+  void* map = mmap(nullptr, _mapSize, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    printf("[ERROR] Tiled height map %s mmap: %s\n", fileName.c_str(),
+           strerror(errno));
+    throw std::runtime_error("Failed to map tiled height map!");
+  }
+  _map = (const char*)map;
+
+  memcpy(&_header, _map, sizeof(_header));
+  u64 tilesX = 0, tilesY = 0, tileSamples = 0;
+  if (!checkHeader(_header, _mapSize, tilesX, tilesY, tileSamples)) {
+    munmap(map, _mapSize);
+    throw std::runtime_error(fileName + " is not a tiled height map");
+  }
+  _tilesX = tilesX;
+  _tilesY = tilesY;
+  _tileSamples = tileSamples;
+
+  for (size_t i = 0; i < 3; i++) _leftCorner[i] = _header.leftCorner[i];
+  _grid = _header.grid;
+  _xMax = (_header.rows - 1) * _grid;
+  _yMax = (_header.cols - 1) * _grid;
+
+  cachedTiles = std::max(cachedTiles, size_t(4));
+  _cache.resize(cachedTiles * _tileSamples);
+  _slotTile.assign(cachedTiles, -1);
+  _slotLastUse.assign(cachedTiles, 0);
+
+  printf(
+      "[Tiled Height Map] %s: %d x %d samples of %.3f m, %d x %d tiles, %d "
+      "cached\n",
+      fileName.c_str(), (int)_header.rows, (int)_header.cols, _header.grid,
+      (int)_tilesX, (int)_tilesY, (int)cachedTiles);
+}
+
+template <typename T>
+CollisionTiledHeightMap<T>::~CollisionTiledHeightMap() {
+  munmap((void*)_map, _mapSize);
+}
+
+/*!
+ * Find a tile in the cache, or copy it from the file.  When the cache is full,
+ * the tile farthest from the point (then the least recently used) is evicted.
+ * @param tx : tile index along x
+ * @param ty : tile index along y
+ * @return the heights of the tile
+ */
+template <typename T>
+const T* CollisionTiledHeightMap<T>::getTile(size_t tx, size_t ty) {
+  s64 tile = tx * _tilesY + ty;
+  _useCount++;
+  if (_slotTile[_lastSlot] != tile) {
+    size_t slots = _slotTile.size();
+    size_t slot = 0;
+    while (slot < slots && _slotTile[slot] != tile) slot++;
+
+    if (slot == slots) {
+      // miss, pick the slot to replace
+      slot = 0;
+      s64 worstDistance = -1;
+      for (size_t i = 0; i < slots; i++) {
+        s64 distance = std::numeric_limits<s64>::max();
+        if (_slotTile[i] >= 0) {
+          s64 dx = _slotTile[i] / _tilesY - (s64)tx;
+          s64 dy = _slotTile[i] % _tilesY - (s64)ty;
+          distance = std::max(std::abs(dx), std::abs(dy));
+        }
+        if (distance > worstDistance ||
+            (distance == worstDistance &&
+             _slotLastUse[i] < _slotLastUse[slot])) {
+          worstDistance = distance;
+          slot = i;
+        }
+      }
+
+      // copy, then release the pages, the cache is all we keep
+      const float* src =
+          (const float*)(_map + _header.dataOffset + tile * _header.tileStride);
+      T* dst = _cache.data() + slot * _tileSamples;
+      for (size_t i = 0; i < _tileSamples; i++) dst[i] = src[i];
+      adviseRange((const char*)src, _header.tileStride, MADV_DONTNEED);
+      _slotTile[slot] = tile;
+      _tileLoads++;
+    }
+    _lastSlot = slot;
+  }
+  _slotLastUse[_lastSlot] = _useCount;
+  return _cache.data() + _lastSlot * _tileSamples;
+}
+
+/*!
+ * Height of the map, interpolated bilinearly
+ * @param x : global x
+ * @param y : global y
+ * @param height : global height of the surface at (x, y)
+ * @param normal : normal of the surface at (x, y)
+ * @return false if (x, y) is not on the map
+ */
+template <typename T>
+bool CollisionTiledHeightMap<T>::getHeight(T x, T y, T& height,
+                                           Vec3<T>& normal) {
+  T u = (x - _leftCorner[0]) / _grid;
+  T v = (y - _leftCorner[1]) / _grid;
+  if (!(u >= 0 && v >= 0 && u < (T)(_header.rows - 1) &&
+        v < (T)(_header.cols - 1)))
+    return false;
+
+  size_t i = std::min((size_t)u, (size_t)_header.rows - 2);
+  size_t j = std::min((size_t)v, (size_t)_header.cols - 2);
+  T fx = u - i;
+  T fy = v - j;
+
+  size_t n = _header.tileSize;
+  const T* tile = getTile(i / n, j / n);
+  const T* h = tile + (i % n) * (n + 1) + (j % n);
+  T h00 = h[0], h01 = h[1], h10 = h[n + 1], h11 = h[n + 2];
+
+  height = _leftCorner[2] + (1 - fx) * (1 - fy) * h00 + fx * (1 - fy) * h10 +
+           (1 - fx) * fy * h01 + fx * fy * h11;
+  T dhdx = ((1 - fy) * (h10 - h00) + fy * (h11 - h01)) / _grid;
+  T dhdy = ((1 - fx) * (h01 - h00) + fx * (h11 - h10)) / _grid;
+  normal = Vec3<T>(-dhdx, -dhdy, 1).normalized();
+  return true;
+}
+
+/*!
+ * check whether the contact happens or not
+ * cp_frame let you know which direction is normal (z) and which directions are
+ * x and y. The frame is basically contact coordinate w.r.t global.
+ */
+template <typename T>
+bool CollisionTiledHeightMap<T>::ContactDetection(const Vec3<T>& cp_pos,
+                                                  T& penetration,
+                                                  Mat3<T>& cp_frame) {
+  T height;
+  Vec3<T> normal;
+  if (!getHeight(cp_pos[0], cp_pos[1], height, normal)) return false;
+  if (cp_pos[2] >= height) return false;
+
+  // x axis is the slope along global x
+  Vec3<T> xAxis = Vec3<T>(normal[2], 0, -normal[0]).normalized();
+  cp_frame.template block<3, 1>(0, 0) = xAxis;
+  cp_frame.template block<3, 1>(0, 1) = normal.cross(xAxis);
+  cp_frame.template block<3, 1>(0, 2) = normal;
+
+  // distance to the tangent plane
+  penetration = (cp_pos[2] - height) * normal[2];
+  return true;
+}
+
+/*!
+ * Bounding box of the map.  Everything below the surface is in contact, so it
+ * is unbounded in z.
+ */
+template <typename T>
+bool CollisionTiledHeightMap<T>::getBoundingBox(Vec3<T>& lo, Vec3<T>& hi) {
+  lo = _leftCorner;
+  hi = _leftCorner + Vec3<T>(_xMax, _yMax, 0);
+  lo[2] = -std::numeric_limits<T>::infinity();
+  hi[2] = std::numeric_limits<T>::infinity();
+  return true;
+}
+
+/*!
+ * Start reading the tiles near a point from the file in the background, so
+ * the contact detection doesn't wait for the disk when the robot gets there.
+ * The simulator calls this every step: the kernel is only asked again when
+ * the robot moves to other tiles.
+ * @param center : point, usually the robot
+ * @param radius : distance along x and y to read around the point (m)
+ */
+template <typename T>
+void CollisionTiledHeightMap<T>::prefetch(const Vec3<T>& center, T radius) {
+  T tileLength = _header.tileSize * _grid;
+  auto tileRange = [&](size_t axis, size_t tiles, size_t& first,
+                       size_t& last) {
+    T lo = (center[axis] - radius - _leftCorner[axis]) / tileLength;
+    T hi = (center[axis] + radius - _leftCorner[axis]) / tileLength;
+    if (hi < 0 || lo >= (T)tiles) return false;
+    first = lo > 0 ? (size_t)lo : 0;
+    last = std::min((size_t)hi, tiles - 1);
+    return true;
+  };
+
+  size_t x0, x1, y0, y1;
+  if (!tileRange(0, _tilesX, x0, x1) || !tileRange(1, _tilesY, y0, y1)) return;
+  if (x0 == _prefetchRange[0] && x1 == _prefetchRange[1] &&
+      y0 == _prefetchRange[2] && y1 == _prefetchRange[3])
+    return;
+
+  for (size_t tx = x0; tx <= x1; tx++) {
+    for (size_t ty = y0; ty <= y1; ty++) {
+      bool asked = tx >= _prefetchRange[0] && tx <= _prefetchRange[1] &&
+                   ty >= _prefetchRange[2] && ty <= _prefetchRange[3];
+      if (asked) continue;
+      adviseRange(_map + _header.dataOffset +
+                      (tx * _tilesY + ty) * _header.tileStride,
+                  _header.tileStride, MADV_WILLNEED);
+      _tilePrefetches++;
+    }
+  }
+  _prefetchRange[0] = x0;
+  _prefetchRange[1] = x1;
+  _prefetchRange[2] = y0;
+  _prefetchRange[3] = y1;
+}
+
+/*!
+ * Write a tiled height map file.  The heights are asked for one tile at a
+ * time, so the map doesn't need to fit in memory.
+ * @param fileName : file to write
+ * @param rows : number of samples along x
+ * @param cols : number of samples along y
+ * @param grid : distance between samples (m)
+ * @param leftCorner : global location of sample (0, 0)
+ * @param tileSize : grid cells per tile side
+ * @param height : height of sample (i, j), relative to leftCorner
+ */
+template <typename T>
+void CollisionTiledHeightMap<T>::writeFile(
+    const std::string& fileName, size_t rows, size_t cols, double grid,
+    const Vec3<double>& leftCorner, size_t tileSize,
+    const std::function<float(size_t, size_t)>& height) {
+  if (rows < 2 || cols < 2 || tileSize < 1 ||
+      !(std::isfinite(grid) && grid > 0)) {
+    throw std::runtime_error("bad size for tiled height map " + fileName);
+  }
+
+  TiledHeightMapHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, tiledHeightMapMagic, 8);
+  header.rows = rows;
+  header.cols = cols;
+  header.tileSize = tileSize;
+  header.dataOffset =
+      roundUp(sizeof(TiledHeightMapHeader), tiledHeightMapAlignment);
+  header.tileStride = roundUp((tileSize + 1) * (tileSize + 1) * sizeof(float),
+                              tiledHeightMapAlignment);
+  header.grid = grid;
+  for (size_t i = 0; i < 3; i++) header.leftCorner[i] = leftCorner[i];
+
+  FILE* f = fopen(fileName.c_str(), "wb");
+  if (!f) {
+    printf("[ERROR] Tiled height map %s: %s\n", fileName.c_str(),
+           strerror(errno));
+    throw std::runtime_error("Failed to write tiled height map!");
+  }
+
+  std::vector<char> headerBytes(header.dataOffset, 0);
+  memcpy(headerBytes.data(), &header, sizeof(header));
+  bool ok = fwrite(headerBytes.data(), 1, headerBytes.size(), f) ==
+            headerBytes.size();
+
+  size_t tilesX = (rows + tileSize - 2) / tileSize;
+  size_t tilesY = (cols + tileSize - 2) / tileSize;
+  std::vector<float> tile(header.tileStride / sizeof(float), 0.f);
+  for (size_t tx = 0; ok && tx < tilesX; tx++) {
+    for (size_t ty = 0; ok && ty < tilesY; ty++) {
+      for (size_t a = 0; a <= tileSize; a++) {
+        for (size_t b = 0; b <= tileSize; b++) {
+          tile[a * (tileSize + 1) + b] =
+              height(std::min(tx * tileSize + a, rows - 1),
+                     std::min(ty * tileSize + b, cols - 1));
+        }
+      }
+      ok = fwrite(tile.data(), 1, header.tileStride, f) == header.tileStride;
+    }
+  }
+
+  if (fclose(f) != 0 || !ok) {
+    throw std::runtime_error("Failed to write tiled height map " + fileName);
+  }
+}
+
+template class CollisionTiledHeightMap<double>;
+template class CollisionTiledHeightMap<float>;
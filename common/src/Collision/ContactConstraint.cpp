@@ -6,43 +6,65 @@
 #include "Collision/ContactConstraint.h"
 
 /*!
- * Check all points for contact.  If contact occurs, add to list of in-contact points
+ * Check all points for contact.  If contact occurs, add to list of in-contact
+ * points.  Each point is only checked against the collision objects of its
+ * grid cell, in the order they were added.  The lists are allocated when the
+ * grid is built, so this doesn't allocate unless a collision was added.
  * @return Number of points in contact
  */
 template <typename T>
 size_t ContactConstraint<T>::_CheckContact() {
-  _cp_pos_list.clear();
-  _cp_local_force_list.clear();
-  _cp_penetration_list.clear();
+  if (!_gridValid) _BuildGrid();
 
-  _cp_frame_list.clear();
-  _cp_resti_list.clear();
-  _cp_mu_list.clear();
-  _idx_list.clear();
-
-  Vec3<T> tmp_vec;
-  Mat3<T> cp_frame;
-
-  T penetration;
+  size_t nContact = 0;
   for (size_t i(0); i < _model->_nGroundContact; ++i) {
     _cp_force_list[i].setZero();
-    for (size_t j(0); j < _nCollision; ++j) {
-      if (_collision_list[j]->ContactDetection(_model->_pGC[i], penetration,
-                                               cp_frame)) {
+    const size_t* candidates;
+    size_t nCandidates = _grid.getCandidates(_model->_pGC[i], candidates);
+    for (size_t k(0); k < nCandidates; ++k) {
+      size_t j = candidates[k];
+      if (!_grid.mayContain(j, _model->_pGC[i])) continue;
+      if (_collision_list[j]->ContactDetection(_model->_pGC[i],
+                                               _cp_penetration_list[nContact],
+                                               _cp_frame_list[nContact])) {
         // Contact Happens
-        _cp_pos_list.push_back(_model->_pGC[i]);
-        _cp_local_force_list.push_back(Vec3<T>::Zero());
-        _cp_frame_list.push_back(cp_frame);
-        _cp_penetration_list.push_back(penetration);
-
-        _idx_list.push_back(i);
-
-        _cp_resti_list.push_back(_collision_list[j]->getRestitutionCoeff());
-        _cp_mu_list.push_back(_collision_list[j]->getFrictionCoeff());
+        _cp_pos_list[nContact] = _model->_pGC[i];
+        _cp_local_force_list[nContact].setZero();
+        _idx_list[nContact] = i;
+        _cp_resti_list[nContact] = _collision_list[j]->getRestitutionCoeff();
+        _cp_mu_list[nContact] = _collision_list[j]->getFrictionCoeff();
+        ++nContact;
       }
     }
   }
-  return _cp_pos_list.size();
+  return nContact;
+}
+
+/*!
+ * Build the broad phase for the collision objects and size the contact lists
+ * for it
+ */
+template <typename T>
+void ContactConstraint<T>::_BuildGrid() {
+  _grid.build(_collision_list);
+  _AllocateContacts(_model->_nGroundContact * _grid.getMaxCandidates());
+  _gridValid = true;
+}
+
+/*!
+ * Size the contact lists for the largest possible number of contacts
+ * @param nContactMax : number of ground contact points times the most
+ * collision objects a point can touch
+ */
+template <typename T>
+void ContactConstraint<T>::_AllocateContacts(size_t nContactMax) {
+  _idx_list.resize(nContactMax);
+  _cp_resti_list.resize(nContactMax);
+  _cp_mu_list.resize(nContactMax);
+  _cp_penetration_list.resize(nContactMax);
+  _cp_local_force_list.resize(nContactMax);
+  _cp_pos_list.resize(nContactMax);
+  _cp_frame_list.resize(nContactMax);
 }
 
 template class ContactConstraint<double>;
@@ -12,6 +12,7 @@
  */
 template <typename T>
 void ContactSpringDamper<T>::UpdateExternalForces(T K, T D, T dt) {
+  _dt = dt;
   CC::_nContact = CC::_CheckContact();
   for (size_t i(0); i < _nGC; ++i) {
     // first assume there's no contact, so the ground "springs back"
@@ -24,11 +25,6 @@ void ContactSpringDamper<T>::UpdateExternalForces(T K, T D, T dt) {
           forceToSpatialForce(CC::_cp_force_list[CC::_idx_list[i]],
                               CC::_cp_pos_list[i]);
     }
-    static int count(0);
-    ++count;
-    if (count > 5) {
-      // exit(0);
-    }
   }
 
   for (size_t i(0); i < _nGC; ++i) {
@@ -57,8 +53,16 @@ void ContactSpringDamper<T>::_groundContactWithOffset(T K, T D) {
     CC::_cp_local_force_list[i][0] = 0;
     CC::_cp_local_force_list[i][1] = 0;
     CC::_cp_local_force_list[i][2] = 0;
+    _cp_damping_list[i].setZero();
+    _cp_stiffness_list[i].setZero();
 
     if (normalForce > 0) {
+      // both the spring (through the penetration or deflection at the end of
+      // the step) and the damper depend on the velocity
+      T damping = zr * (D + _dt * K);
+      _cp_damping_list[i] = Vec3<T>(damping, damping, damping);
+      _cp_stiffness_list[i] = Vec3<T>(zr * K, zr * K, zr * K);
+
       CC::_cp_local_force_list[i][2] =
           normalForce;  // set the normal force. This is in the plane's
                         // coordinates for now
@@ -89,6 +93,10 @@ void ContactSpringDamper<T>::_groundContactWithOffset(T K, T D) {
             tangentialForce / r;  // adjust tangential force to avoid slipping
         deflectionRate[CC::_idx_list[i]] =
             -(tangentialForce + tangentialSpringForce) / (D * zr);
+        _cp_damping_list[i][0] = 0;
+        _cp_damping_list[i][1] = 0;
+        _cp_stiffness_list[i][0] = 0;
+        _cp_stiffness_list[i][1] = 0;
       }
       // set forces
       CC::_cp_local_force_list[i][0] = tangentialForce[0];
@@ -100,5 +108,41 @@ void ContactSpringDamper<T>::_groundContactWithOffset(T K, T D) {
   }
 }
 
+/*!
+ * Damping of a contact for implicit integration: the local contact force
+ * changes by -damping * (change of the velocity of the contact point).
+ * Slipping contacts only have damping along the normal.
+ * @param contact : contact found by the last UpdateExternalForces
+ * @param gcIdx : set to the ground contact point of the contact
+ * @return damping in the global frame
+ */
+template <typename T>
+Mat3<T> ContactSpringDamper<T>::getContactDamping(size_t contact,
+                                                  size_t& gcIdx) const {
+  gcIdx = CC::_idx_list[contact];
+  const Mat3<T>& R = CC::_cp_frame_list[contact];
+  return R * _cp_damping_list[contact].asDiagonal() * R.transpose();
+}
+
+/*!
+ * Stiffness of a contact for implicit integration: the local contact force
+ * changes by -stiffness * (displacement of the contact point).  Slipping
+ * contacts only have stiffness along the normal.
+ * @param contact : contact found by the last UpdateExternalForces
+ * @return stiffness in the global frame
+ */
+template <typename T>
+Mat3<T> ContactSpringDamper<T>::getContactStiffness(size_t contact) const {
+  const Mat3<T>& R = CC::_cp_frame_list[contact];
+  return R * _cp_stiffness_list[contact].asDiagonal() * R.transpose();
+}
+
+template <typename T>
+void ContactSpringDamper<T>::_AllocateContacts(size_t nContactMax) {
+  ContactConstraint<T>::_AllocateContacts(nContactMax);
+  _cp_damping_list.resize(nContactMax);
+  _cp_stiffness_list.resize(nContactMax);
+}
+
 template class ContactSpringDamper<double>;
 template class ContactSpringDamper<float>;
@@ -0,0 +1,192 @@
+/*! @file BatchDynamicsSimulator.cpp
+ *  @brief Simulates many independent copies of a robot in parallel
+ */
+
+#include "Dynamics/BatchDynamicsSimulator.h"
+#include <stdio.h>
+#include <stdexcept>
+
+/*!
+ * Create nEnvs environments, all with a copy of the model and a zero state
+ */
+template <typename T>
+BatchDynamicsSimulator<T>::BatchDynamicsSimulator(
+    const FloatingBaseModel<T>& model, size_t nEnvs, bool useSpringDamper) {
+  for (size_t i = 0; i < nEnvs; i++) {
+    _envs.emplace_back(new Environment(model, useSpringDamper));
+    _envs.back()->tau = DVec<T>::Zero(model._nDof - 6);
+  }
+}
+
+template <typename T>
+BatchDynamicsSimulator<T>::~BatchDynamicsSimulator() {
+  stop();
+}
+
+/*!
+ * Start the worker threads
+ * @param workers : number of threads besides the one calling step()
+ */
+template <typename T>
+void BatchDynamicsSimulator<T>::start(int workers) {
+  if (isRunning() || workers <= 0) return;
+  _running = true;
+  for (int i = 0; i < workers; i++)
+    _workers.emplace_back(&BatchDynamicsSimulator<T>::workerLoop, this);
+  printf("[Batch Simulator] Started %d workers for %d environments\n", workers,
+         (int)_envs.size());
+}
+
+/*!
+ * Stop the worker threads.  Must not be called during step().
+ */
+template <typename T>
+void BatchDynamicsSimulator<T>::stop() {
+  if (!isRunning()) return;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _running = false;
+  }
+  _roundStart.notify_all();
+  for (auto& worker : _workers) worker.join();
+  _workers.clear();
+}
+
+/*!
+ * Add a collision plane (xy plane) to all environments
+ * @param mu : friction coefficient
+ * @param rest : restitution coefficient
+ * @param height : height of plane
+ */
+template <typename T>
+void BatchDynamicsSimulator<T>::addCollisionPlane(T mu, T rest, T height) {
+  addCollision(new CollisionPlane<T>(mu, rest, height));
+}
+
+/*!
+ * Add a box to all environments, see DynamicsSimulator::addCollisionBox
+ */
+template <typename T>
+void BatchDynamicsSimulator<T>::addCollisionBox(T mu, T rest, T depth,
+                                                T width, T height,
+                                                const Vec3<T>& pos,
+                                                const Mat3<T>& ori) {
+  addCollision(
+      new CollisionBox<T>(mu, rest, depth, width, height, pos, ori));
+}
+
+/*!
+ * Add a height map mesh to all environments, see
+ * DynamicsSimulator::addCollisionMesh
+ */
+template <typename T>
+void BatchDynamicsSimulator<T>::addCollisionMesh(
+    T mu, T rest, T grid_size, const Vec3<T>& left_corner_loc,
+    const DMat<T>& height_map) {
+  addCollision(new CollisionMesh<T>(mu, rest, grid_size, left_corner_loc,
+                                    height_map));
+}
+
+template <typename T>
+void BatchDynamicsSimulator<T>::addCollision(Collision<T>* collision) {
+  _collisions.emplace_back(collision);
+  for (auto& env : _envs) env->sim.addCollision(collision);
+}
+
+/*!
+ * Take one simulation step in every environment
+ * @param dt : timestep duration
+ * @param tau : joint torques of each environment
+ * @param kp : spring constant of the contacts
+ * @param kd : damping constant of the contacts
+ */
+template <typename T>
+void BatchDynamicsSimulator<T>::step(T dt, const std::vector<DVec<T>>& tau,
+                                     T kp, T kd) {
+  if (tau.size() != _envs.size()) {
+    throw std::runtime_error("need joint torques for every environment");
+  }
+  run([&](size_t i) { _envs[i]->sim.step(dt, tau[i], kp, kd); });
+}
+
+/*!
+ * Simulate every environment for nSteps steps, with torques from a controller.
+ * The controller is called from several threads at once, but never twice at
+ * once for the same environment.
+ */
+template <typename T>
+void BatchDynamicsSimulator<T>::rollout(size_t nSteps, T dt, T kp, T kd,
+                                        const BatchController<T>& controller) {
+  run([&](size_t i) {
+    Environment& env = *_envs[i];
+    for (size_t k = 0; k < nSteps; k++) {
+      controller(i, k, env.sim.getState(), env.tau);
+      env.sim.step(dt, env.tau, kp, kd);
+    }
+  });
+}
+
+/*!
+ * Call job for every environment, on the workers and the calling thread.
+ * Blocks until all environments are done.
+ */
+template <typename T>
+void BatchDynamicsSimulator<T>::run(const std::function<void(size_t)>& job) {
+  _job = &job;
+  _nextEnv = 0;
+
+  if (isRunning()) {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _round++;
+      _activeWorkers = (int)_workers.size();
+    }
+    _roundStart.notify_all();
+  }
+
+  runJobs();
+
+  if (isRunning()) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _roundDone.wait(lock, [this] { return _activeWorkers == 0; });
+  }
+  _job = nullptr;
+}
+
+/*!
+ * Claim and run environments until none are left
+ */
+template <typename T>
+void BatchDynamicsSimulator<T>::runJobs() {
+  size_t count = _envs.size();
+  for (;;) {
+    size_t i = _nextEnv.fetch_add(1);
+    if (i >= count) return;
+    (*_job)(i);
+  }
+}
+
+template <typename T>
+void BatchDynamicsSimulator<T>::workerLoop() {
+  u64 round = 0;
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(_mutex);
+      _roundStart.wait(lock, [&] { return _round != round || !_running; });
+      if (!_running) return;
+      round = _round;
+    }
+
+    runJobs();
+
+    bool last;
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      last = --_activeWorkers == 0;
+    }
+    if (last) _roundDone.notify_one();
+  }
+}
+
+template class BatchDynamicsSimulator<double>;
+template class BatchDynamicsSimulator<float>;
@@ -10,6 +10,8 @@
 #include "Collision/ContactSpringDamper.h"
 #include "Utilities/Utilities_print.h"
 
+#include <stdexcept>
+
 /*!
  * Initialize the dynamics simulator by allocating memory for ABA matrices
  */
@@ -18,9 +20,12 @@ DynamicsSimulator<T>::DynamicsSimulator(FloatingBaseModel<T> &model,
                                         bool useSpringDamper)
     : _model(model), _useSpringDamper(useSpringDamper) {
   if (_useSpringDamper) {
-    _contact_constr = new ContactSpringDamper<T>(&_model);
+    _springDamper = new ContactSpringDamper<T>(&_model);
+    _contact_constr = _springDamper;
+    _integrator = DynamicsIntegrator::Euler;
   } else {
     _contact_constr = new ContactImpulse<T>(&_model);
+    _integrator = DynamicsIntegrator::SemiImplicitEuler;
   }
 
   _state.bodyVelocity = SVec<T>::Zero();
@@ -30,6 +35,46 @@ DynamicsSimulator<T>::DynamicsSimulator(FloatingBaseModel<T> &model,
   _state.qd = DVec<T>::Zero(_model._nDof - 6);
   _dstate.qdd = DVec<T>::Zero(_model._nDof - 6);
   _lastBodyVelocity.setZero();
+
+  // implicit contact works in place, so steps don't allocate
+  _implicitA.resize(_model._nDof, _model._nDof);
+  _implicitAcc.resize(_model._nDof);
+  _implicitRhs.resize(_model._nDof);
+  _implicitDampedJc.resize(3, _model._nDof);
+  _implicitLdlt = Eigen::LDLT<DMat<T>>(_model._nDof);
+  _homing.active_flag = false;
+}
+
+/*!
+ * Choose the integrator.  Impulse based contact only works with
+ * SemiImplicitEuler.
+ */
+template <typename T>
+void DynamicsSimulator<T>::setIntegrator(DynamicsIntegrator integrator) {
+  if (!_useSpringDamper &&
+      integrator != DynamicsIntegrator::SemiImplicitEuler) {
+    throw std::runtime_error(
+        "impulse contact needs the semi-implicit Euler integrator");
+  }
+  _integrator = integrator;
+}
+
+/*!
+ * Cut steps into substeps when their error estimate is too large.  The number
+ * of substeps is a power of two, it doubles when a substep is over the
+ * tolerance and halves after steps well under it.
+ * @param maxSubsteps : most substeps per step (rounded down to a power of two),
+ * 1 turns this off
+ * @param tolerance : error allowed per substep, in m (or rad) of the
+ * generalized positions
+ */
+template <typename T>
+void DynamicsSimulator<T>::setAdaptiveSubsteps(size_t maxSubsteps,
+                                               T tolerance) {
+  _maxSubsteps = 1;
+  while (_maxSubsteps * 2 <= maxSubsteps) _maxSubsteps *= 2;
+  _errorTolerance = tolerance;
+  _substeps = std::min(_substeps, _maxSubsteps);
 }
 
 /*!
@@ -38,14 +83,79 @@ DynamicsSimulator<T>::DynamicsSimulator(FloatingBaseModel<T> &model,
  * @param tau : joint torques
  */
 template <typename T>
-void DynamicsSimulator<T>::step(T dt, const DVec<T> &tau, T kp, T kd ) {
-  // fwd-kin on gc points
-  // compute ground contact forces
-  // aba
-  // integrate
-  forwardKinematics();           // compute forward kinematics
-  updateCollisions(dt, kp, kd);  // process collisions
-  // Process Homing
+void DynamicsSimulator<T>::step(T dt, const DVec<T> &tau, T kp, T kd) {
+  _contact_constr->Prefetch(_state.bodyPosition, _prefetchRadius);
+  _externalForcesAtStep = _model._externalForces;
+  if (_maxSubsteps == 1 && !_estimateError) {
+    _substeps = 1;
+    stepOnce(dt, tau, kp, kd);
+    return;
+  }
+
+  // step doubling: compare each substep with two half substeps
+  int order = _integrator == DynamicsIntegrator::RK4 ? 4 : 1;
+  _lastError = 0;
+  size_t done = 0;  // in units of the smallest possible substep
+  while (done < _maxSubsteps) {
+    T h = dt / _substeps;
+    saveState();
+    stepOnce(h, tau, kp, kd);
+    _wholeStepState = _state;
+    restoreState();
+    stepOnce(h / 2, tau, kp, kd);
+    stepOnce(h / 2, tau, kp, kd);
+    T error = stateError(_wholeStepState, _state, h);
+
+    if (error > _errorTolerance && _substeps < _maxSubsteps) {
+      // try again with smaller substeps
+      restoreState();
+      _substeps *= 2;
+      continue;
+    }
+    _lastError = std::max(_lastError, error);
+    done += _maxSubsteps / _substeps;
+  }
+
+  // the error goes down by 2^(order + 1) when the substeps are halved
+  if (_substeps > 1 && _lastError * (T)(2 << order) < _errorTolerance) {
+    _substeps /= 2;
+  }
+}
+
+/*!
+ * Take a step without substeps, starting from the external forces given
+ * before step
+ */
+template <typename T>
+void DynamicsSimulator<T>::stepOnce(T dt, const DVec<T> &tau, T kp, T kd) {
+  _model._externalForces = _externalForcesAtStep;
+  if (_integrator == DynamicsIntegrator::RK4) {
+    stepRK4(dt, tau, kp, kd);
+  } else {
+    // fwd-kin on gc points
+    // compute ground contact forces
+    // aba
+    // integrate
+    forwardKinematics();           // compute forward kinematics
+    updateCollisions(dt, kp, kd);  // process collisions
+    applyHomingForces();
+    runABA(tau);                   // dynamics algorithm
+    if (_integrator == DynamicsIntegrator::ImplicitContact) {
+      implicitContactAcceleration(dt);
+    }
+    integrate(dt);                 // step forward
+  }
+
+  _model.setState(_state);
+  _model.resetExternalForces();  // clear external forces
+  _model.resetCalculationFlags();
+}
+
+/*!
+ * Process Homing
+ */
+template <typename T>
+void DynamicsSimulator<T>::applyHomingForces() {
   if( _homing.active_flag) {
 
     Mat3<T> R10_des = rpyToRotMat(_homing.rpy);              // R10_des
@@ -63,14 +173,197 @@ void DynamicsSimulator<T>::step(T dt, const DVec<T> &tau, T kp, T kd ) {
     _model._externalForces.at(5).head(3) += _homing.kp_ang*angle_axis - _homing.kd_ang*_model.getAngularVelocity(5);
 
   }
+}
+
+/*!
+ * Replace the accelerations found by the ABA with the ones where the contact
+ * forces are taken at the end of the step, linearized in the velocities:
+ * (H + dt J^T (D + dt K) J) qdd_implicit = H qdd - dt J^T K J v, with K and D
+ * the stiffness and damping of the contacts.  The last term is the spring
+ * stretched by the velocity at the start of the step.  This keeps stiff
+ * contacts stable with long steps.
+ */
+template <typename T>
+void DynamicsSimulator<T>::implicitContactAcceleration(T dt) {
+  size_t nContact = _springDamper->getNumContacts();
+  if (nContact == 0) return;
+
+  size_t nDof = _model._nDof;
+  _implicitAcc.template head<6>() = _dstate.dBodyVelocity;
+  _implicitAcc.tail(nDof - 6) = _dstate.qdd;
+
+  _model.contactJacobians();
+  _implicitA = _model.massMatrix();
+  _implicitRhs.noalias() = _implicitA * _implicitAcc;
+  for (size_t i = 0; i < nContact; i++) {
+    size_t gc;
+    // the damping of the contacts includes dt K
+    Mat3<T> damping = _springDamper->getContactDamping(i, gc);
+    Vec3<T> springForce =
+        dt * _springDamper->getContactStiffness(i) * _model._vGC[gc];
+    _implicitDampedJc.noalias() = dt * damping * _model._Jc[gc];
+    _implicitA.noalias() += _model._Jc[gc].transpose() * _implicitDampedJc;
+    _implicitRhs.noalias() -= _model._Jc[gc].transpose() * springForce;
+  }
+  _implicitLdlt.compute(_implicitA);
+  _implicitAcc = _implicitLdlt.solve(_implicitRhs);
+
+  _dstate.dBodyVelocity = _implicitAcc.template head<6>();
+  _dstate.qdd = _implicitAcc.tail(nDof - 6);
+}
+
+/*!
+ * Runge-Kutta step.  The contact forces (and the deflections of the ground) are
+ * found again at every stage.
+ */
+template <typename T>
+void DynamicsSimulator<T>::stepRK4(T dt, const DVec<T> &tau, T kp, T kd) {
+  const T stageTime[4] = {0, dt / 2, dt / 2, dt};
+  _rk4Start = _state;
+  _rk4StartDeflections = _springDamper->getTangentialDeflections();
+
+  for (size_t stage = 0; stage < 4; stage++) {
+    // state at the stage, from the derivative of the stage before
+    _stageState = _rk4Start;
+    _stageDeflections = _rk4StartDeflections;
+    if (stage > 0) {
+      T h = stageTime[stage];
+      size_t k = stage - 1;
+      _stageState.bodyOrientation += h * _stageDQuat[k];
+      _stageState.bodyOrientation.normalize();
+      _stageState.bodyPosition += h * _stageDState[k].dBodyPosition;
+      _stageState.bodyVelocity += h * _stageDState[k].dBodyVelocity;
+      _stageState.q += h * _stageQd[k];
+      _stageState.qd += h * _stageDState[k].qdd;
+      for (size_t i = 0; i < _stageDeflections.size(); i++)
+        _stageDeflections[i] += h * _stageDeflectionRate[k][i];
+    }
+    evaluateRK4Stage(stage, tau, kp, kd);
+  }
+
+  // weighted sum of the stages
+  const T weight[4] = {dt / 6, dt / 3, dt / 3, dt / 6};
+  _state = _rk4Start;
+  _dstate.dBodyPosition.setZero();
+  _dstate.dBodyVelocity.setZero();
+  _dstate.qdd.setZero(_rk4Start.qd.rows());
+  _stageDeflections = _rk4StartDeflections;
+  for (size_t k = 0; k < 4; k++) {
+    _state.bodyOrientation += weight[k] * _stageDQuat[k];
+    _state.bodyPosition += weight[k] * _stageDState[k].dBodyPosition;
+    _state.bodyVelocity += weight[k] * _stageDState[k].dBodyVelocity;
+    _state.q += weight[k] * _stageQd[k];
+    _state.qd += weight[k] * _stageDState[k].qdd;
+    for (size_t i = 0; i < _stageDeflections.size(); i++)
+      _stageDeflections[i] += weight[k] * _stageDeflectionRate[k][i];
+
+    _dstate.dBodyPosition += (weight[k] / dt) * _stageDState[k].dBodyPosition;
+    _dstate.dBodyVelocity += (weight[k] / dt) * _stageDState[k].dBodyVelocity;
+    _dstate.qdd += (weight[k] / dt) * _stageDState[k].qdd;
+  }
+  _state.bodyOrientation.normalize();
+  _springDamper->setTangentialDeflections(_stageDeflections);
+}
+
+/*!
+ * Find the derivative of _stageState, with _stageDeflections
+ */
+template <typename T>
+void DynamicsSimulator<T>::evaluateRK4Stage(size_t stage, const DVec<T> &tau,
+                                            T kp, T kd) {
+  _model._externalForces = _externalForcesAtStep;
+  _model.setState(_stageState);
+  _model.forwardKinematics();
+  _springDamper->setTangentialDeflections(_stageDeflections);
+  _contact_constr->UpdateExternalForces(kp, kd, 0);  // deflections stay
+  applyHomingForces();
+  _model.runABA(tau, _stageDState[stage]);
+
+  _stageDQuat[stage] = quatDerivative(
+      _stageState.bodyOrientation,
+      _stageState.bodyVelocity.template block<3, 1>(0, 0));
+  _stageQd[stage] = _stageState.qd;
+  _stageDeflectionRate[stage] = _springDamper->getDeflectionRates();
+}
+
+/*!
+ * Copy the state of the simulation.  The collision objects, the homing and
+ * the settings are not part of it.
+ */
+template <typename T>
+void DynamicsSimulator<T>::saveSnapshot(
+    DynamicsSimulatorSnapshot<T>& snapshot) const {
+  snapshot.state = _state;
+  snapshot.dstate = _dstate;
+  snapshot.lastBodyVelocity = _lastBodyVelocity;
+  if (_springDamper)
+    snapshot.tangentialDeflections = _springDamper->getTangentialDeflections();
+  else
+    snapshot.tangentialDeflections.clear();
+  snapshot.substeps = _substeps;
+}
 
+/*!
+ * Go back to a state copied by saveSnapshot, from this simulator or another
+ * one of the same robot with the same kind of contact.  The next steps are
+ * then the same as the ones after saveSnapshot, bit for bit.
+ */
+template <typename T>
+void DynamicsSimulator<T>::restoreSnapshot(
+    const DynamicsSimulatorSnapshot<T>& snapshot) {
+  if (_springDamper && snapshot.tangentialDeflections.size() !=
+                           _springDamper->getTangentialDeflections().size()) {
+    throw std::runtime_error(
+        "snapshot is not of a simulator with the same contact");
+  }
+  _state = snapshot.state;
+  _dstate = snapshot.dstate;
+  _lastBodyVelocity = snapshot.lastBodyVelocity;
+  if (_springDamper)
+    _springDamper->setTangentialDeflections(snapshot.tangentialDeflections);
+  _substeps = std::min(std::max(snapshot.substeps, (size_t)1), _maxSubsteps);
+  _model.setState(_state);
+}
 
-  runABA(tau);                   // dynamics algorithm
-  integrate(dt);                 // step forward
+/*!
+ * Keep the state before a substep, to take it again
+ */
+template <typename T>
+void DynamicsSimulator<T>::saveState() {
+  _savedState = _state;
+  _savedDState = _dstate;
+  _savedLastBodyVelocity = _lastBodyVelocity;
+  if (_springDamper)
+    _savedDeflections = _springDamper->getTangentialDeflections();
+}
 
+/*!
+ * Go back to the state kept by saveState
+ */
+template <typename T>
+void DynamicsSimulator<T>::restoreState() {
+  _state = _savedState;
+  _dstate = _savedDState;
+  _lastBodyVelocity = _savedLastBodyVelocity;
+  if (_springDamper) _springDamper->setTangentialDeflections(_savedDeflections);
   _model.setState(_state);
-  _model.resetExternalForces();  // clear external forces
-  _model.resetCalculationFlags();
+}
+
+/*!
+ * Difference between two states, as the largest difference of the
+ * generalized positions or of the generalized velocities times dt
+ */
+template <typename T>
+T DynamicsSimulator<T>::stateError(const FBModelState<T> &a,
+                                   const FBModelState<T> &b, T dt) {
+  T error = (a.bodyPosition - b.bodyPosition).cwiseAbs().maxCoeff();
+  error = std::max(
+      error, (a.bodyOrientation - b.bodyOrientation).cwiseAbs().maxCoeff());
+  error = std::max(error, (a.q - b.q).cwiseAbs().maxCoeff());
+  error = std::max(
+      error, dt * (a.bodyVelocity - b.bodyVelocity).cwiseAbs().maxCoeff());
+  error = std::max(error, dt * (a.qd - b.qd).cwiseAbs().maxCoeff());
+  return error;
 }
 
 /*!
@@ -91,7 +384,7 @@ void DynamicsSimulator<T>::updateCollisions(T dt, T kp, T kd) {
  */
 template <typename T>
 void DynamicsSimulator<T>::integrate(T dt) {
-  if (_useSpringDamper) {
+  if (_integrator == DynamicsIntegrator::Euler) {
     Vec3<T> omegaBody = _state.bodyVelocity.template block<3, 1>(0, 0);
     Mat6<T> X = createSXform(quaternionToRotationMatrix(_state.bodyOrientation),
                              _state.bodyPosition);
@@ -112,7 +405,7 @@ void DynamicsSimulator<T>::integrate(T dt) {
     _state.bodyVelocity += _dstate.dBodyVelocity * dt;
 
     // Contact Constraint Velocity Updated
-    _contact_constr->UpdateQdot(_state);
+    if (!_useSpringDamper) _contact_constr->UpdateQdot(_state);
 
     // Prepare body velocity integration
     RotMat<T> R_body = quaternionToRotationMatrix(_state.bodyOrientation);
@@ -126,8 +419,10 @@ void DynamicsSimulator<T>::integrate(T dt) {
     _state.bodyPosition += _dstate.dBodyPosition * dt;
     _state.bodyOrientation =
         integrateQuatImplicit(_state.bodyOrientation, omegaBody, dt);
-    _dstate.dBodyVelocity = (_state.bodyVelocity - _lastBodyVelocity) / dt;
-    _lastBodyVelocity = _state.bodyVelocity;
+    if (!_useSpringDamper) {
+      _dstate.dBodyVelocity = (_state.bodyVelocity - _lastBodyVelocity) / dt;
+      _lastBodyVelocity = _state.bodyVelocity;
+    }
   }
 }
 
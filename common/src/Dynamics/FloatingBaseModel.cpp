@@ -48,7 +48,7 @@ T FloatingBaseModel<T>::applyTestForce(const int gc_index,
   size_t i_opsp = _gcParent.at(gc_index);
   size_t i = i_opsp;
 
-  dstate_out = DVec<T>::Zero(_nDof);
+  dstate_out.setZero(_nDof);
 
   // Rotation to absolute coords
   Mat3<T> Rai = _Xa[i].template block<3, 3>(0, 0).transpose();
@@ -78,7 +78,8 @@ T FloatingBaseModel<T>::applyTestForce(const int gc_index,
 
   dstate_out.head(6) = _invIA5.solve(F);
   LambdaInv += F.dot(dstate_out.head(6));
-  dstate_out.tail(_nDof - 6) += _qdd_from_base_accel * dstate_out.head(6);
+  dstate_out.tail(_nDof - 6).noalias() +=
+      _qdd_from_base_accel * dstate_out.head(6);
 
   return LambdaInv;
 }
@@ -227,6 +228,13 @@ void FloatingBaseModel<T>::addDynamicsVars(int count) {
     _pA.push_back(zero6);
     _pArot.push_back(zero6);
     _externalForces.push_back(zero6);
+
+    _Dv.push_back(D6Mat<T>());
+    _Dvrot.push_back(D6Mat<T>());
+    _Da.push_back(D6Mat<T>());
+    _Darot.push_back(D6Mat<T>());
+    _Df.push_back(D6Mat<T>());
+    _Dfrot.push_back(D6Mat<T>());
   }
 
   _J.push_back(D6Mat<T>::Zero(6, _nDof));
@@ -253,6 +261,14 @@ void FloatingBaseModel<T>::resizeSystemMatricies() {
     _Jc[i].setZero(3, _nDof);
     _Jcdqd[i].setZero();
   }
+  for (size_t i = 0; i < _Dv.size(); i++) {
+    _Dv[i].setZero(6, 3 * _nDof);
+    _Dvrot[i].setZero(6, 3 * _nDof);
+    _Da[i].setZero(6, 3 * _nDof);
+    _Darot[i].setZero(6, 3 * _nDof);
+    _Df[i].setZero(6, 3 * _nDof);
+    _Dfrot[i].setZero(6, 3 * _nDof);
+  }
   _qdd_from_subqdd.resize(_nDof - 6, _nDof - 6);
   _qdd_from_base_accel.resize(_nDof - 6, 6);
   _state.q = DVec<T>::Zero(_nDof - 6);
@@ -570,7 +586,7 @@ void FloatingBaseModel<T>::contactJacobians() {
     _Jcdqd[k] = spatialToLinearAcceleration(ac, vc);
 
     // rows for linear velcoity in the world
-    D3Mat<T> Xout = Xc.template bottomRows<3>();
+    Eigen::Matrix<T, 3, 6> Xout = Xc.template bottomRows<3>();
 
     // from tips to base
     while (i > 5) {
@@ -775,7 +791,7 @@ void FloatingBaseModel<T>::compositeInertias() {
  * @return H (_nDof x _nDof matrix)
  */
 template <typename T>
-DMat<T> FloatingBaseModel<T>::massMatrix() {
+const DMat<T>& FloatingBaseModel<T>::massMatrix() {
   compositeInertias();
   _H.setZero();
 
@@ -876,6 +892,154 @@ DVec<T> FloatingBaseModel<T>::inverseDynamics(
   return genForce;
 }
 
+/*!
+ * Jacobian of x *_f h (forceCrossProduct) with respect to the motion vector x
+ */
+template <typename T>
+static Mat6<T> forceCrossProductJacobian(const SVec<T> &h) {
+  Mat6<T> J = Mat6<T>::Zero();
+  Mat3<T> n = vectorToSkewMat(Vec3<T>(h.template head<3>()));
+  Mat3<T> f = vectorToSkewMat(Vec3<T>(h.template tail<3>()));
+  J.template topLeftCorner<3, 3>() = -n;
+  J.template topRightCorner<3, 3>() = -f;
+  J.template bottomLeftCorner<3, 3>() = -f;
+  return J;
+}
+
+/*!
+ * Computes the partial derivatives of the inverse dynamics, by differentiating
+ * each step of the recursive Newton-Euler algorithm (forward mode, with the
+ * derivatives with respect to all of q, qd and qdd carried along as columns of
+ * _Dv, _Da, ...).
+ *
+ * The derivatives with respect to the first 6 entries of q are for a
+ * perturbation [dtheta, dp] of the floating base, in body coordinates: the
+ * orientation becomes R * exp(dtheta x), with R from body to world.  The ones
+ * with respect to the first 6 entries of qd and qdd are for the body velocity
+ * and its derivative.
+ *
+ * @param dState : the accelerations, as for inverseDynamics
+ * @param dtau_dq : _nDof x _nDof
+ * @param dtau_dqd : _nDof x _nDof
+ * @param dtau_dqdd : _nDof x _nDof, the mass matrix
+ */
+template <typename T>
+void FloatingBaseModel<T>::inverseDynamicsDerivatives(
+    const FBModelStateDerivative<T> &dState, DMat<T> &dtau_dq,
+    DMat<T> &dtau_dqd, DMat<T> &dtau_dqdd) {
+  // values of the intermediates, and of the forces summed up the tree (_f)
+  inverseDynamics(dState);
+
+  const size_t n = _nDof;
+  const size_t iq = 0, iqd = n, iqdd = 2 * n;
+
+  // floating base: the velocity is qd, and the orientation turns gravity
+  Vec3<T> gBody = rotationFromSXform(_Xup[5]) * _gravity;
+  _Dv[5].setZero();
+  _Da[5].setZero();
+  _Dv[5].template middleCols<6>(iqd).setIdentity();
+  _Da[5].template middleCols<6>(iqdd).setIdentity();
+  _Da[5].template block<3, 3>(3, iq) = -vectorToSkewMat(gBody);
+
+  // from base to tips
+  for (size_t i = 6; i < n; i++) {
+    size_t p = _parents[i];
+    T qd = _state.qd[i - 6];
+    SVec<T> vJ = _S[i] * qd;
+    SVec<T> vJrot = _Srot[i] * qd;
+
+    // v = Xup v_p + S qd
+    _Dv[i] = _Xup[i] * _Dv[p];
+    _Dv[i].col(iq + i) += motionCrossProduct(SVec<T>(_Xup[i] * _v[p]), _S[i]);
+    _Dv[i].col(iqd + i) += _S[i];
+    _Dvrot[i] = _Xuprot[i] * _Dv[p];
+    _Dvrot[i].col(iq + i) +=
+        motionCrossProduct(SVec<T>(_Xuprot[i] * _v[p]), _Srot[i]);
+    _Dvrot[i].col(iqd + i) += _Srot[i];
+
+    // a = Xup a_p + S qdd + v x vJ
+    _Da[i] = _Xup[i] * _Da[p] - motionCrossMatrix(vJ) * _Dv[i];
+    _Da[i].col(iq + i) += motionCrossProduct(SVec<T>(_Xup[i] * _a[p]), _S[i]);
+    _Da[i].col(iqd + i) += motionCrossProduct(_v[i], _S[i]);
+    _Da[i].col(iqdd + i) += _S[i];
+    _Darot[i] = _Xuprot[i] * _Da[p] - motionCrossMatrix(vJrot) * _Dvrot[i];
+    _Darot[i].col(iq + i) +=
+        motionCrossProduct(SVec<T>(_Xuprot[i] * _a[p]), _Srot[i]);
+    _Darot[i].col(iqd + i) += motionCrossProduct(_vrot[i], _Srot[i]);
+    _Darot[i].col(iqdd + i) += _Srot[i];
+  }
+
+  // f = I a + v x* I v
+  for (size_t i = 5; i < n; i++) {
+    const Mat6<T> &I = _Ibody[i].getMatrix();
+    _Df[i] = I * _Da[i] + (forceCrossProductJacobian(SVec<T>(I * _v[i])) +
+                           forceCrossMatrix(_v[i]) * I) *
+                              _Dv[i];
+    if (i < 6) continue;
+    const Mat6<T> &Ir = _Irot[i].getMatrix();
+    _Dfrot[i] = Ir * _Darot[i] +
+                (forceCrossProductJacobian(SVec<T>(Ir * _vrot[i])) +
+                 forceCrossMatrix(_vrot[i]) * Ir) *
+                    _Dvrot[i];
+  }
+
+  // from tips to base, _f[i] is already summed over the subtree of i
+  dtau_dq.resize(n, n);
+  dtau_dqd.resize(n, n);
+  dtau_dqdd.resize(n, n);
+  for (size_t i = n - 1; i > 5; i--) {
+    size_t p = _parents[i];
+    Eigen::Matrix<T, 1, Eigen::Dynamic> row =
+        _S[i].transpose() * _Df[i] + _Srot[i].transpose() * _Dfrot[i];
+    dtau_dq.row(i) = row.segment(iq, n);
+    dtau_dqd.row(i) = row.segment(iqd, n);
+    dtau_dqdd.row(i) = row.segment(iqdd, n);
+
+    // f_p += Xup^T f
+    _Df[p] += _Xup[i].transpose() * _Df[i] +
+              _Xuprot[i].transpose() * _Dfrot[i];
+    _Df[p].col(iq + i) +=
+        _Xup[i].transpose() * forceCrossProduct(_S[i], _f[i]) +
+        _Xuprot[i].transpose() * forceCrossProduct(_Srot[i], _frot[i]);
+  }
+  dtau_dq.template topRows<6>() = _Df[5].middleCols(iq, n);
+  dtau_dqd.template topRows<6>() = _Df[5].middleCols(iqd, n);
+  dtau_dqdd.template topRows<6>() = _Df[5].middleCols(iqdd, n);
+}
+
+/*!
+ * Runs the articulated body algorithm and computes the partial derivatives of
+ * its accelerations, from the ones of the inverse dynamics:
+ * dqdd/dx = -H^-1 dtau/dx and dqdd/dtau = H^-1.  _externalForces are not
+ * differentiated.  See inverseDynamicsDerivatives for the floating base
+ * coordinates.
+ * @param tau : joint torques
+ * @param dstate : the accelerations, as for runABA
+ * @param dqdd_dq : _nDof x _nDof, derivative of [dBodyVelocity; qdd]
+ * @param dqdd_dqd : _nDof x _nDof
+ * @param dqdd_dtau : _nDof x (_nDof - 6)
+ */
+template <typename T>
+void FloatingBaseModel<T>::forwardDynamicsDerivatives(
+    const DVec<T> &tau, FBModelStateDerivative<T> &dstate, DMat<T> &dqdd_dq,
+    DMat<T> &dqdd_dqd, DMat<T> &dqdd_dtau) {
+  runABA(tau, dstate);
+
+  DMat<T> H;
+  inverseDynamicsDerivatives(dstate, dqdd_dq, dqdd_dqd, H);
+  _HFactor.setParents(_parents);
+  if (!_HFactor.factor(H)) {
+    throw std::runtime_error("mass matrix is not positive definite");
+  }
+
+  dqdd_dq *= -1;
+  dqdd_dqd *= -1;
+  _HFactor.solveInPlace(dqdd_dq);
+  _HFactor.solveInPlace(dqdd_dqd);
+  dqdd_dtau = _HFactor.inverseTimes(
+      DMat<T>::Identity(_nDof, _nDof).rightCols(_nDof - 6));
+}
+
 template <typename T>
 void FloatingBaseModel<T>::runABA(const DVec<T> &tau,
                                   FBModelStateDerivative<T> &dstate) {
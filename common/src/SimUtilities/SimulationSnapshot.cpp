@@ -0,0 +1,232 @@
+/*! @file SimulationSnapshot.cpp
+ *  @brief Save and load the state of a whole simulation
+ */
+
+#include "SimUtilities/SimulationSnapshot.h"
+
+#include <stdio.h>
+#include <cstring>
+#include <stdexcept>
+
+static const char snapshotMagic[8] = {'S', 'I', 'M', 'S', 'N', 'A', 'P', '2'};
+
+namespace {
+
+/*!
+ * Writes raw values to a file, closes it when done
+ */
+class SnapshotWriter {
+ public:
+  explicit SnapshotWriter(const std::string& fileName)
+      : _fileName(fileName), _f(fopen(fileName.c_str(), "wb")) {
+    if (!_f) throw std::runtime_error("could not open snapshot " + fileName);
+  }
+  ~SnapshotWriter() {
+    if (_f) fclose(_f);
+  }
+
+  void bytes(const void* data, size_t size) {
+    if (fwrite(data, 1, size, _f) != size)
+      throw std::runtime_error("could not write snapshot " + _fileName);
+  }
+  template <typename V>
+  void value(const V& v) {
+    bytes(&v, sizeof(V));
+  }
+  template <typename M>
+  void matrix(const M& m) {
+    value((u64)m.size());
+    bytes(m.data(), m.size() * sizeof(typename M::Scalar));
+  }
+  void string(const std::string& s) {
+    value((u64)s.size());
+    bytes(s.data(), s.size());
+  }
+  void parameters(const std::vector<SnapshotParameter>& values) {
+    value((u64)values.size());
+    for (auto& v : values) {
+      string(v.name);
+      value(v.kind);
+      value(v.value);
+    }
+  }
+
+  void close() {
+    int error = fclose(_f);
+    _f = nullptr;
+    if (error) throw std::runtime_error("could not write snapshot " + _fileName);
+  }
+
+ private:
+  std::string _fileName;
+  FILE* _f;
+};
+
+/*!
+ * Reads what SnapshotWriter wrote, checking the sizes
+ */
+class SnapshotReader {
+ public:
+  explicit SnapshotReader(const std::string& fileName)
+      : _fileName(fileName), _f(fopen(fileName.c_str(), "rb")) {
+    if (!_f) throw std::runtime_error("could not open snapshot " + fileName);
+  }
+  ~SnapshotReader() { fclose(_f); }
+
+  void bytes(void* data, size_t size) {
+    if (fread(data, 1, size, _f) != size) bad();
+  }
+  template <typename V>
+  void value(V& v) {
+    bytes(&v, sizeof(V));
+  }
+  template <typename M>
+  void matrix(M& m) {
+    u64 size;
+    value(size);
+    if (M::SizeAtCompileTime == Eigen::Dynamic) {
+      if (size > (1 << 20)) bad();
+      m.resize(size);
+    } else if (size != (u64)m.size()) {
+      bad();
+    }
+    bytes(m.data(), m.size() * sizeof(typename M::Scalar));
+  }
+  void string(std::string& s) {
+    u64 size;
+    value(size);
+    if (size > (1 << 20)) bad();
+    s.resize(size);
+    bytes(&s[0], size);
+  }
+  void parameters(std::vector<SnapshotParameter>& values) {
+    u64 size;
+    value(size);
+    if (size > (1 << 20)) bad();
+    values.resize(size);
+    for (auto& v : values) {
+      string(v.name);
+      value(v.kind);
+      value(v.value);
+    }
+  }
+
+  [[noreturn]] void bad() {
+    throw std::runtime_error("bad snapshot " + _fileName);
+  }
+
+ private:
+  std::string _fileName;
+  FILE* _f;
+};
+
+}  // namespace
+
+/*!
+ * Write the snapshot to a file
+ */
+void SimulationSnapshot::save(const std::string& fileName) const {
+  SnapshotWriter w(fileName);
+  w.bytes(snapshotMagic, sizeof(snapshotMagic));
+  w.value(time);
+  w.value(timeOfNextLowLevelControl);
+  w.value(timeOfNextHighLevelControl);
+  w.value(highLevelIterations);
+  w.value(scriptPosition);
+
+  w.matrix(dynamics.state.bodyOrientation);
+  w.matrix(dynamics.state.bodyPosition);
+  w.matrix(dynamics.state.bodyVelocity);
+  w.matrix(dynamics.state.q);
+  w.matrix(dynamics.state.qd);
+  w.matrix(dynamics.dstate.dBodyPosition);
+  w.matrix(dynamics.dstate.dBodyVelocity);
+  w.matrix(dynamics.dstate.qdd);
+  w.matrix(dynamics.lastBodyVelocity);
+  w.value((u64)dynamics.tangentialDeflections.size());
+  for (auto& deflection : dynamics.tangentialDeflections) w.matrix(deflection);
+  w.value((u64)dynamics.substeps);
+  w.matrix(tau);
+
+  w.value(spiData);
+  w.value(spiCommand);
+  w.value(spineTorque);
+  w.value(spineIterations);
+
+  w.string(imuRandomState);
+  w.value(gamepad);
+  w.parameters(robotParameters);
+  w.parameters(userParameters);
+  w.close();
+}
+
+/*!
+ * Read a snapshot written by save
+ */
+void SimulationSnapshot::load(const std::string& fileName) {
+  SnapshotReader r(fileName);
+  char magic[sizeof(snapshotMagic)];
+  r.bytes(magic, sizeof(magic));
+  if (memcmp(magic, snapshotMagic, sizeof(magic))) r.bad();
+  r.value(time);
+  r.value(timeOfNextLowLevelControl);
+  r.value(timeOfNextHighLevelControl);
+  r.value(highLevelIterations);
+  r.value(scriptPosition);
+
+  r.matrix(dynamics.state.bodyOrientation);
+  r.matrix(dynamics.state.bodyPosition);
+  r.matrix(dynamics.state.bodyVelocity);
+  r.matrix(dynamics.state.q);
+  r.matrix(dynamics.state.qd);
+  r.matrix(dynamics.dstate.dBodyPosition);
+  r.matrix(dynamics.dstate.dBodyVelocity);
+  r.matrix(dynamics.dstate.qdd);
+  r.matrix(dynamics.lastBodyVelocity);
+  u64 nDeflections;
+  r.value(nDeflections);
+  if (nDeflections > (1 << 20)) r.bad();
+  dynamics.tangentialDeflections.resize(nDeflections);
+  for (auto& deflection : dynamics.tangentialDeflections) r.matrix(deflection);
+  u64 substeps;
+  r.value(substeps);
+  dynamics.substeps = substeps;
+  r.matrix(tau);
+
+  r.value(spiData);
+  r.value(spiCommand);
+  r.value(spineTorque);
+  r.value(spineIterations);
+
+  r.string(imuRandomState);
+  r.value(gamepad);
+  r.parameters(robotParameters);
+  r.parameters(userParameters);
+}
+
+/*!
+ * Copy the values of all the parameters of a collection
+ * @param params : parameters to copy
+ * @param values : set to their names and values
+ */
+void SimulationSnapshot::saveParameters(
+    const ControlParameters& params, std::vector<SnapshotParameter>& values) {
+  values.clear();
+  for (auto& kv : params.collection._map) {
+    SnapshotParameter v;
+    v.name = kv.first;
+    v.kind = kv.second->_kind;
+    v.value = kv.second->get(v.kind);
+    values.push_back(v);
+  }
+}
+
+/*!
+ * Set parameters back to values copied by saveParameters
+ * @param values : names and values of the parameters
+ * @param params : parameters to set
+ */
+void SimulationSnapshot::restoreParameters(
+    const std::vector<SnapshotParameter>& values, ControlParameters& params) {
+  for (auto& v : values) params.collection.lookup(v.name).set(v.value, v.kind);
+}
@@ -1,5 +1,6 @@
 #include "SparseCMPC/SparseCMPC.h"
 #include "Math/orientation_tools.h"
+#include "third-party/JCQP/QpProblem.h"
 #include <Utilities/Timer.h>
 
 
@@ -67,8 +68,11 @@ void SparseCMPC::run() {
   //printf("t2: %.3f\n", timer.getMs());
 
   // Solve!
-  //runSolver();
-  runSolverOSQP();
+  if(_solver == SparseCMPCSolver::JCQP) {
+    runSolverJCQP();
+  } else {
+    runSolverOSQP();
+  }
 }
 
 /*!
@@ -169,10 +173,15 @@ u32 SparseCMPC::addConstraint(u32 size) {
   return rv;
 }
 
-void SparseCMPC::addConstraintTriple(double value, u32 row, u32 col) {
+/*!
+ * Add an entry to the constraint matrix.  Zeros are skipped, unless the entry is structural:
+ * one which is only zero for some values of the state or feet, and has to stay in the
+ * sparsity pattern so the pattern only depends on the contact sequence.
+ */
+void SparseCMPC::addConstraintTriple(double value, u32 row, u32 col, bool structural) {
   assert(col < 12 * _trajectoryLength + 3 * _bBlockCount);
   assert(row < _constraintCount);
-  if(value != 0) {
+  if(value != 0 || structural) {
     _constraintTriples.push_back({value, row, col});
   }
 }
@@ -198,7 +207,8 @@ void SparseCMPC::addX0Constraint() {
     u32 bbIdx = _runningContactCounts[0] + i;
     for(u32 ax = 0; ax < 3; ax++) { // columns within the b block (forces axes)
       for(u32 row = 0; row < 12; row++) { // rows within the b block
-        addConstraintTriple(-_bBlocks[bbIdx](row, ax), constraint_idx + row, getControlIndex(bbIdx) + ax);
+        addConstraintTriple(-_bBlocks[bbIdx](row, ax), constraint_idx + row, getControlIndex(bbIdx) + ax,
+                            row >= 6 && row < 9);
       }
     }
   }
@@ -233,7 +243,9 @@ void SparseCMPC::addDynamicsConstraints() {
     // get -A[n] * x[n-1]
     for(u32 r = 0; r < 12; r++) {
       for(u32 c = 0; c < 12; c++) {
-        addConstraintTriple(-_aMat[i](r,c), constraint_idx + r, prev_state_idx + c);
+        // yaw rotation
+        addConstraintTriple(-_aMat[i](r,c), constraint_idx + r, prev_state_idx + c,
+                            r < 2 && c >= 6 && c < 8);
       }
     }
 
@@ -245,7 +257,8 @@ void SparseCMPC::addDynamicsConstraints() {
         for(u32 col = 0; col < 3; col++) {
           addConstraintTriple(-_bBlocks[bb_idx + contact](row, col),
             constraint_idx + row,
-            getControlIndex(bb_idx + contact) + col);
+            getControlIndex(bb_idx + contact) + col,
+            row >= 6 && row < 9); // r x f torque
         }
       }
     }
@@ -341,8 +354,7 @@ void SparseCMPC::addLinearStateCost() {
 
 }
 
-#if 0
-void SparseCMPC::runSolver() {
+void SparseCMPC::runSolverJCQP() {
   u32 varCount = 12 * _trajectoryLength + 3 * _bBlockCount;
   //printf("[SparseCMPC] Run %d, %d\n", varCount, _constraintCount);
   assert(_constraintCount == _ub.size());
@@ -350,16 +362,13 @@ void SparseCMPC::runSolver() {
   assert(varCount == _linearCost.size());
 
 
-  QpProblem<double> solver(varCount, _constraintCount, false);
+  QpProblem<double> solver(varCount, _constraintCount, false, false);
   solver.A_triples = std::move(_constraintTriples);
   solver.P_triples = std::move(_costTriples);
-  solver.u = Vector<double>(_ub.size());
-  solver.l = Vector<double>(_ub.size());
   for(u32 i = 0; i < _constraintCount; i++) {
     solver.u[i] = _ub[i];
     solver.l[i] = _lb[i];
   }
-  solver.q = Vector<double>(varCount);
   for(u32 i = 0; i < varCount; i++) {
     solver.q[i] = _linearCost[i];
   }
@@ -370,10 +379,48 @@ void SparseCMPC::runSolver() {
   solver.settings.sigma = 1e-6;
 
 
-  solver.runFromTriples(-1, true);
+  solver.runFromTriples(-1, false, getCachedFactorization());
+  if(solver.reusedSymbolicFactor()) {
+    _factorCacheHits++;
+  } else {
+    _factorCacheMisses++;
+  }
   _result = solver.getSolution().cast<float>();
 }
-#endif
+
+/*!
+ * Find the JCQP solver set up for the current contact sequence.  If there is none, the least
+ * recently used one is handed out, and will be set up from scratch by the QP.
+ */
+CholeskySparseSolver<double>* SparseCMPC::getCachedFactorization() {
+  _cacheKey.clear();
+  for(auto& contactState : _contactTrajectory) {
+    u8 mask = 0;
+    for(u32 foot = 0; foot < 4; foot++) {
+      if(contactState.contact[foot]) mask |= (1 << foot);
+    }
+    _cacheKey.push_back(mask);
+  }
+
+  _factorCacheUses++;
+  SparseCMPCFactorCacheEntry* oldest = nullptr;
+  for(auto& entry : _factorCache) {
+    if(entry.contacts == _cacheKey) {
+      entry.lastUse = _factorCacheUses;
+      return entry.solver.get();
+    }
+    if(!oldest || entry.lastUse < oldest->lastUse) oldest = &entry;
+  }
+
+  if(_factorCache.size() < kFactorCacheSize) {
+    _factorCache.emplace_back();
+    oldest = &_factorCache.back();
+    oldest->solver.reset(new CholeskySparseSolver<double>());
+  }
+  oldest->contacts = _cacheKey;
+  oldest->lastUse = _factorCacheUses;
+  return oldest->solver.get();
+}
 
 //static const char* names[] = {"roll", "pitch", "yaw", "x", "y", "z", "roll-rate", "pitch-rate", "yaw-rate", "xv", "yv", "zv"};
 
@@ -0,0 +1,37 @@
+/*! @file LatencyHistogram.cpp
+ *  @brief Histogram of durations with log-linear buckets, for tail latency
+ */
+
+#include "Utilities/LatencyHistogram.h"
+
+#include <algorithm>
+
+/*!
+ * Duration under which the given percent of the recorded durations are,
+ * rounded up to the end of its bucket (and at most the maximum).  Read while
+ * recording, the result is for a state in between.
+ * @param percentile : 0 to 100
+ * @return duration in ns, 0 if nothing was recorded
+ */
+u64 LatencyHistogram::getPercentile(double percentile) const {
+  u64 count = getCount();
+  if (count == 0) return 0;
+  percentile = std::min(std::max(percentile, 0.), 100.);
+  u64 rank = std::max((u64)1, (u64)(percentile / 100. * count + 0.5));
+
+  u64 seen = 0;
+  for (size_t i = 0; i < kBuckets; i++) {
+    seen += _counts[i].load(std::memory_order_relaxed);
+    if (seen >= rank) return std::min(bucketUpperBound(i), getMax());
+  }
+  return getMax();
+}
+
+/*!
+ * Forget everything.  Not while a thread is recording.
+ */
+void LatencyHistogram::reset() {
+  for (auto& bucket : _counts) bucket.store(0, std::memory_order_relaxed);
+  _max.store(0, std::memory_order_relaxed);
+  _count.store(0, std::memory_order_release);
+}
@@ -3,17 +3,134 @@
  * @brief Implementation of a periodic function running in a separate thread.
  * Periodic tasks have a task manager, which measure how long they take to run.
  */
-#ifdef linux
- #include <sys/timerfd.h>
-#endif
-
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
 #include <unistd.h>
+#include <algorithm>
 #include <cmath>
+#include <cstring>
+#include <stdexcept>
 
+#include "Utilities/ParamHandler.hpp"
 #include "Utilities/PeriodicTask.h"
 #include "Utilities/Timer.h"
 #include "Utilities/Utilities_print.h"
 
+/*!
+ * Current time of CLOCK_MONOTONIC in ns
+ */
+static u64 monotonicNs() {
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (u64)now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+/*!
+ * Sleep until a time of CLOCK_MONOTONIC, in ns
+ */
+static void sleepUntilNs(u64 ns) {
+#ifdef linux
+  timespec until;
+  until.tv_sec = ns / 1000000000ull;
+  until.tv_nsec = ns % 1000000000ull;
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, nullptr) ==
+         EINTR) {
+  }
+#else
+  u64 now = monotonicNs();
+  if (ns > now) usleep((ns - now) / 1000);
+#endif
+}
+
+/*!
+ * Describe a schedule, like "fifo 60, cpu 2-3"
+ */
+std::string PeriodicTaskSchedule::toString() const {
+  std::string result;
+  switch (policy) {
+    case SCHED_OTHER:
+      result = "other";
+      break;
+    case SCHED_FIFO:
+      result = "fifo " + std::to_string(priority);
+      break;
+    case SCHED_RR:
+      result = "rr " + std::to_string(priority);
+      break;
+    default:
+      result = "inherit";
+  }
+
+  result += ", cpu ";
+  if (cpus.empty()) return result + "inherit";
+  std::vector<int> sorted = cpus;
+  std::sort(sorted.begin(), sorted.end());
+  for (size_t i = 0; i < sorted.size();) {
+    // runs of consecutive CPUs as ranges
+    size_t j = i;
+    while (j + 1 < sorted.size() && sorted[j + 1] == sorted[j] + 1) j++;
+    if (i > 0) result += ",";
+    result += std::to_string(sorted[i]);
+    if (j > i) result += "-" + std::to_string(sorted[j]);
+    i = j + 1;
+  }
+  return result;
+}
+
+
+/*!
+ * Set the policy, priority and CPUs of the calling thread, and read back what
+ * it got.  Failures are printed, and the thread keeps what it inherited.
+ * @param name : name of the thread, for the messages
+ * @return how the thread is actually scheduled
+ */
+PeriodicTaskSchedule PeriodicTaskSchedule::applyToThisThread(
+    const std::string& name) const {
+  PeriodicTaskSchedule effective = *this;
+#ifdef linux
+  pthread_t self = pthread_self();
+  if (!cpus.empty()) {
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    for (int cpu : cpus) {
+      if (cpu >= 0 && cpu < CPU_SETSIZE) CPU_SET(cpu, &cpuSet);
+    }
+    int error = pthread_setaffinity_np(self, sizeof(cpuSet), &cpuSet);
+    if (error) {
+      printf("[PeriodicTask] Failed to run %s on cpu %s: %s\n", name.c_str(),
+             toString().c_str(), strerror(error));
+    }
+  }
+
+  if (policy >= 0) {
+    sched_param param;
+    param.sched_priority = priority;
+    int error = pthread_setschedparam(self, policy, &param);
+    if (error) {
+      printf("[PeriodicTask] Failed to schedule %s as %s: %s\n", name.c_str(),
+             toString().c_str(), strerror(error));
+    }
+  }
+
+  int currentPolicy;
+  sched_param param;
+  if (!pthread_getschedparam(self, &currentPolicy, &param)) {
+    effective.policy = currentPolicy;
+    effective.priority = param.sched_priority;
+  }
+  cpu_set_t cpuSet;
+  if (!pthread_getaffinity_np(self, sizeof(cpuSet), &cpuSet)) {
+    effective.cpus.clear();
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+      if (CPU_ISSET(cpu, &cpuSet)) effective.cpus.push_back(cpu);
+    }
+  }
+#else
+  (void)name;
+#endif
+  return effective;
+}
 
 /*!
  * Construct a new task within a TaskManager
@@ -31,20 +148,38 @@ PeriodicTask::PeriodicTask(PeriodicTaskManager* taskManager, float period,
  * Begin running task
  */
 void PeriodicTask::start() {
+  if (_graph) {
+    printf("[PeriodicTask] Tried to start %s but it runs in %s!\n",
+           _name.c_str(), _graph->getName().c_str());
+    return;
+  }
   if (_running) {
     printf("[PeriodicTask] Tried to start %s but it was already running!\n",
            _name.c_str());
     return;
   }
   init();
+  _runtimeHistogram.reset();
+  _wakeupHistogram.reset();
+  _missedPeriods = 0;
+  _periodTimer.start();
   _running = true;
-  _thread = std::thread(&PeriodicTask::loopFunction, this);
+  // return once the thread is scheduled as it should be
+  std::promise<void> scheduled;
+  std::future<void> applied = scheduled.get_future();
+  _thread = std::thread(&PeriodicTask::loopFunction, this, &scheduled);
+  applied.wait();
 }
 
 /*!
  * Stop running task
  */
 void PeriodicTask::stop() {
+  if (_graph && _running) {
+    // the graph can't run without this task
+    _graph->stop();
+    return;
+  }
   if (!_running) {
     printf("[PeriodicTask] Tried to stop %s but it wasn't running!\n",
            _name.c_str());
@@ -64,6 +199,15 @@ bool PeriodicTask::isSlow() {
   return _maxPeriod > _period * 1.3f || _maxRuntime > _period;
 }
 
+/*!
+ * Set the policy, priority and CPUs of the calling thread from a task's
+ * schedule, and read back what it got.  Failures are printed, and the thread
+ * keeps what it inherited.
+ */
+void PeriodicTask::applySchedule() {
+  _effectiveSchedule = _schedule.applyToThisThread(_name);
+}
+
 /*!
  * Reset max statistics
  */
@@ -77,73 +221,292 @@ void PeriodicTask::clearMax() {
  */
 void PeriodicTask::printStatus() {
   if (!_running) return;
+  // tails since the start, in us
+  double rt99 = _runtimeHistogram.getPercentile(99) / 1e3;
+  double rt999 = _runtimeHistogram.getPercentile(99.9) / 1e3;
+  double wake99 = _wakeupHistogram.getPercentile(99) / 1e3;
+  double wakeMax = _wakeupHistogram.getMax() / 1e3;
+  unsigned long missed = (unsigned long)getMissedPeriods();
+  std::string schedule = getEffectiveSchedule().toString();
   if (isSlow()) {
-    printf_color(PrintColor::Red, "|%-20s|%6.4f|%6.4f|%6.4f|%6.4f|%6.4f\n",
+    printf_color(PrintColor::Red,
+                 "|%-20s|%6.4f|%6.4f|%6.4f|%6.4f|%6.4f"
+                 "|%8.1f|%8.1f|%8.1f|%8.1f|%6lu|%s\n",
                  _name.c_str(), _lastRuntime, _maxRuntime, _period,
-                 _lastPeriodTime, _maxPeriod);
+                 _lastPeriodTime, _maxPeriod, rt99, rt999, wake99, wakeMax,
+                 missed, schedule.c_str());
   } else {
-    printf("|%-20s|%6.4f|%6.4f|%6.4f|%6.4f|%6.4f\n", _name.c_str(),
-           _lastRuntime, _maxRuntime, _period, _lastPeriodTime, _maxPeriod);
+    printf(
+        "|%-20s|%6.4f|%6.4f|%6.4f|%6.4f|%6.4f|%8.1f|%8.1f|%8.1f|%8.1f|%6lu"
+        "|%s\n",
+        _name.c_str(), _lastRuntime, _maxRuntime, _period, _lastPeriodTime,
+        _maxPeriod, rt99, rt999, wake99, wakeMax, missed, schedule.c_str());
   }
 }
 
 /*!
- * Call the task in a timed loop.  Uses a timerfd
+ * Call run() and measure how long it took, and the time since the last call
  */
-void PeriodicTask::loopFunction() {
-#ifdef linux
-  auto timerFd = timerfd_create(CLOCK_MONOTONIC, 0);
-#endif
+void PeriodicTask::runTimed() {
+  _lastPeriodTime = (float)_periodTimer.getSeconds();
+  _periodTimer.start();
+  run();
+  s64 runtimeNs = _periodTimer.getNs();
+  _lastRuntime = (float)(runtimeNs / 1e9);
+  _runtimeHistogram.record((u64)runtimeNs);
+  _maxPeriod = std::max(_maxPeriod, _lastPeriodTime);
+  _maxRuntime = std::max(_maxRuntime, _lastRuntime);
+}
+
+/*!
+ * Call the task in a timed loop.  Sleeps until the absolute start of each
+ * period, so how late each wakeup is is known and delays don't accumulate.
+ */
+void PeriodicTask::loopFunction(std::promise<void>* scheduled) {
+  applySchedule();
+  scheduled->set_value();
+
   int seconds = (int)_period;
   int nanoseconds = (int)(1e9 * std::fmod(_period, 1.f));
+  PeriodCounter periods;
+  periods.start((u64)seconds * 1000000000 + (u64)nanoseconds, monotonicNs());
+  _periodStartNs = periods.getPeriodStartNs();
 
-  Timer t;
+  printf("[PeriodicTask] Start %s (%d s, %d ns, %s)\n", _name.c_str(), seconds,
+         nanoseconds, _effectiveSchedule.toString().c_str());
+  while (_running) {
+    runTimed();
 
-#ifdef linux
-  itimerspec timerSpec;
-  timerSpec.it_interval.tv_sec = seconds;
-  timerSpec.it_value.tv_sec = seconds;
-  timerSpec.it_value.tv_nsec = nanoseconds;
-  timerSpec.it_interval.tv_nsec = nanoseconds;
+    u64 nowNs = monotonicNs();
+    u64 wakeupNs = periods.getWakeupNs(nowNs);
+    u64 missed = periods.next(nowNs);
+    if (wakeupNs) {
+      sleepUntilNs(wakeupNs);
+      nowNs = monotonicNs();
+    }
+    _periodStartNs = periods.getPeriodStartNs();
+    _wakeupHistogram.record(periods.getLatenessNs(nowNs));
+    _missedPeriods.store(_missedPeriods.load() + missed);
+  }
+  printf("[PeriodicTask] %s has stopped!\n", _name.c_str());
+}
 
-  timerfd_settime(timerFd, 0, &timerSpec, nullptr);
+/*!
+ * Construct an empty task graph within a TaskManager
+ * @param taskManager : Parent task manager
+ * @param period : how often to run the tasks
+ * @param name : name of the graph
+ */
+PeriodicTaskGraph::PeriodicTaskGraph(PeriodicTaskManager* taskManager,
+                                     float period, std::string name)
+    : PeriodicTask(taskManager, period, name) {}
 
-  unsigned long long missed = 0;
-#endif
+/*!
+ * Add a task, which then only runs in this graph.  Not while the graph runs.
+ * @param task : task which isn't running, with a period which is a multiple
+ * of the period of the graph
+ * @param after : tasks of the graph which must be done before the task starts
+ * @param phase : earliest start of the task after the start of the period, in
+ * seconds
+ */
+void PeriodicTaskGraph::addTask(PeriodicTask* task,
+                                const std::vector<PeriodicTask*>& after,
+                                float phase) {
+  if (task == this || task->_graph || task->isRunning() || isRunning()) {
+    throw std::runtime_error("[PeriodicTaskGraph] can't add " +
+                             task->getName() + " to " + getName());
+  }
+  double ratio = (double)task->getPeriod() / getPeriod();
+  u64 decimation = (u64)std::max(1l, std::lround(ratio));
+  if (std::fabs(ratio - decimation) > 0.01 * decimation) {
+    throw std::runtime_error("[PeriodicTaskGraph] period of " +
+                             task->getName() +
+                             " isn't a multiple of the period of " + getName());
+  }
+  if (phase < 0 || phase >= getPeriod()) {
+    throw std::runtime_error("[PeriodicTaskGraph] phase of " +
+                             task->getName() + " isn't within the period");
+  }
 
-  printf("[PeriodicTask] Start %s (%d s, %d ns)\n", _name.c_str(), seconds,
-         nanoseconds);
-  while (_running) {
-    _lastPeriodTime = (float)t.getSeconds();
-    t.start();
-    run();
-    _lastRuntime = (float)t.getSeconds();
-#ifdef linux
-    int m = read(timerFd, &missed, sizeof(missed));
-    (void)m;
-#endif
-    _maxPeriod = std::max(_maxPeriod, _lastPeriodTime);
-    _maxRuntime = std::max(_maxRuntime, _lastRuntime);
+  task->_graph = this;
+  _nodes.push_back({task, after, (u64)(1e9 * phase), decimation});
+}
+
+/*!
+ * Order the tasks: each after those it depends on, then by phase, then as
+ * added.  Then initialize them.
+ */
+void PeriodicTaskGraph::init() {
+  _orderedNodes.clear();
+  _order.clear();
+  auto ordered = [&](PeriodicTask* task) {
+    return std::find(_order.begin(), _order.end(), task) != _order.end();
+  };
+  while (_order.size() < _nodes.size()) {
+    Node* next = nullptr;
+    for (auto& node : _nodes) {
+      if (ordered(node.task) ||
+          !std::all_of(node.after.begin(), node.after.end(), ordered)) {
+        continue;
+      }
+      if (!next || node.phaseNs < next->phaseNs) next = &node;
+    }
+    if (!next) {
+      throw std::runtime_error("[PeriodicTaskGraph] tasks of " + getName() +
+                               " depend on each other or on other tasks");
+    }
+    _orderedNodes.push_back(next);
+    _order.push_back(next->task);
   }
-  printf("[PeriodicTask] %s has stopped!\n", _name.c_str());
+
+  printf("[PeriodicTaskGraph] %s runs", getName().c_str());
+  for (auto& task : _order) printf(" %s", task->getName().c_str());
+  printf("\n");
+
+  for (auto& task : _order) {
+    task->init();
+    task->_runtimeHistogram.reset();
+    task->_wakeupHistogram.reset();
+    task->_missedPeriods = 0;
+    task->_periodTimer.start();
+    task->_running = true;
+  }
+  _periodCount = 0;
 }
 
-PeriodicTaskManager::~PeriodicTaskManager() {}
+/*!
+ * Run the tasks due this period, in order, each not before its phase
+ */
+void PeriodicTaskGraph::run() {
+  u64 periodStartNs = getPeriodStartNs();
+  for (auto& node : _orderedNodes) {
+    if (_periodCount % node->decimation) continue;
+    u64 phaseNs = periodStartNs + node->phaseNs;
+    u64 nowNs = monotonicNs();
+    if (nowNs < phaseNs) {
+      sleepUntilNs(phaseNs);
+      nowNs = monotonicNs();
+    }
+    PeriodicTask* task = node->task;
+    task->_wakeupHistogram.record(nowNs > phaseNs ? nowNs - phaseNs : 0);
+    task->_periodStartNs = periodStartNs;
+    task->runTimed();
+  }
+  _periodCount++;
+}
+
+/*!
+ * Clean up the tasks, once the graph has stopped
+ */
+void PeriodicTaskGraph::cleanup() {
+  for (auto& task : _order) {
+    task->_running = false;
+    task->cleanup();
+  }
+}
+
+PeriodicTaskManager::~PeriodicTaskManager() {
+  if (_statusExport) _statusExport->destroy();
+}
 
 /*!
  * Add a new task to a task manager
  */
 void PeriodicTaskManager::addTask(PeriodicTask* task) {
   _tasks.push_back(task);
+  auto schedule = _schedules.find(task->getName());
+  if (schedule != _schedules.end()) task->setSchedule(schedule->second);
+}
+
+/*!
+ * Set how the tasks with a name are scheduled, from their next start.  Also
+ * for the tasks added later.
+ */
+void PeriodicTaskManager::setSchedule(const std::string& taskName,
+                                      const PeriodicTaskSchedule& schedule) {
+  _schedules[taskName] = schedule;
+  for (auto& task : _tasks) {
+    if (task->getName() == taskName) task->setSchedule(schedule);
+  }
+}
+
+/*!
+ * Get the schedule set for a name, for threads which are not periodic tasks
+ * but should be scheduled from the same file
+ * @return false if no schedule was set for the name
+ */
+bool PeriodicTaskManager::getSchedule(const std::string& taskName,
+                                      PeriodicTaskSchedule& schedule) const {
+  auto found = _schedules.find(taskName);
+  if (found == _schedules.end()) return false;
+  schedule = found->second;
+  return true;
+}
+
+/*!
+ * Read the schedules of tasks from a yaml file, with a map for each task name:
+ *   policy: "other", "fifo", "rr" or "inherit" (the default)
+ *   priority: for "fifo" and "rr"
+ *   cpus: list of CPUs, all those of the starting thread if missing
+ * @param fileName : path to the yaml file
+ */
+void PeriodicTaskManager::loadSchedules(const std::string& fileName) {
+  printf("[PeriodicTaskManager] Load task schedules %s\n", fileName.c_str());
+  ParamHandler paramHandler(fileName);
+  if (!paramHandler.fileOpenedSuccessfully()) {
+    printf("[ERROR] could not open yaml file for task schedules\n");
+    throw std::runtime_error("yaml bad");
+  }
+
+  for (auto& taskName : paramHandler.getKeys()) {
+    PeriodicTaskSchedule schedule;
+    std::string policy = "inherit";
+    paramHandler.getString(taskName, "policy", policy);
+    if (policy == "other") {
+      schedule.policy = SCHED_OTHER;
+    } else if (policy == "fifo") {
+      schedule.policy = SCHED_FIFO;
+    } else if (policy == "rr") {
+      schedule.policy = SCHED_RR;
+    } else if (policy != "inherit") {
+      throw std::runtime_error("task schedule bad policy: " + taskName + " " +
+                               policy);
+    }
+
+    if (schedule.policy == SCHED_FIFO || schedule.policy == SCHED_RR) {
+      if (!paramHandler.getValue<int>(taskName, "priority",
+                                      schedule.priority) ||
+          schedule.priority < sched_get_priority_min(schedule.policy) ||
+          schedule.priority > sched_get_priority_max(schedule.policy)) {
+        throw std::runtime_error("task schedule bad priority: " + taskName);
+      }
+    }
+
+    paramHandler.getVector<int>(taskName, "cpus", schedule.cpus);
+#ifdef linux
+    for (int cpu : schedule.cpus) {
+      if (cpu < 0 || cpu >= CPU_SETSIZE) {
+        throw std::runtime_error("task schedule bad cpu: " + taskName + " " +
+                                 std::to_string(cpu));
+      }
+    }
+#endif
+
+    printf("[PeriodicTaskManager] %s: %s\n", taskName.c_str(),
+           schedule.toString().c_str());
+    setSchedule(taskName, schedule);
+  }
 }
 
 /*!
  * Print the status of all tasks and rest max statistics
  */
 void PeriodicTaskManager::printStatus() {
-  printf("\n----------------------------TASKS----------------------------\n");
-  printf("|%-20s|%-6s|%-6s|%-6s|%-6s|%-6s\n", "name", "rt", "rt-max", "T-des",
-         "T-act", "T-max");
+  printf("\n----------------------------TASKS----------------------------"
+         "----------------------------------------\n");
+  printf("|%-20s|%-6s|%-6s|%-6s|%-6s|%-6s|%-8s|%-8s|%-8s|%-8s|%-6s|%s\n",
+         "name", "rt", "rt-max", "T-des", "T-act", "T-max", "rt-p99",
+         "rt-p999", "wake-p99", "wake-max", "missed", "sched");
   printf("-----------------------------------------------------------\n");
   for (auto& task : _tasks) {
     task->printStatus();
@@ -164,6 +527,50 @@ void PeriodicTaskManager::printStatusOfSlowTasks() {
   }
 }
 
+/*!
+ * Write the summary of all tasks to a shared memory object, created on the
+ * first call.  The histograms are read while the tasks record, so a summary
+ * can be off by the runs recorded while it is written.
+ * @param name : name of the shared memory object
+ */
+void PeriodicTaskManager::exportStatus(const std::string& name) {
+  if (!_statusExport) {
+    _statusExport.reset(new SharedMemoryObject<PeriodicTaskStatusTable>());
+    _statusExport->create(name, true);
+    _statusExport->getObject().sequence = 0;
+  }
+
+  PeriodicTaskStatusTable& table = _statusExport->getObject();
+  u64 sequence = table.sequence.load(std::memory_order_relaxed);
+  table.sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  table.nTasks =
+      std::min(_tasks.size(), (size_t)PERIODIC_TASK_STATUS_MAX_TASKS);
+  for (u32 i = 0; i < table.nTasks; i++) {
+    PeriodicTask* task = _tasks[i];
+    PeriodicTaskStatus& status = table.tasks[i];
+    memset(status.name, 0, sizeof(status.name));
+    strncpy(status.name, task->getName().c_str(), sizeof(status.name) - 1);
+    status.period = task->getPeriod();
+    status.running = task->isRunning();
+    status.runs = task->getRuntimeHistogram().getCount();
+    status.missedPeriods = task->getMissedPeriods();
+    const LatencyHistogram* histograms[2] = {&task->getRuntimeHistogram(),
+                                             &task->getWakeupHistogram()};
+    u64* summaries[2] = {status.runtime, status.wakeup};
+    for (int h = 0; h < 2; h++) {
+      summaries[h][0] = histograms[h]->getPercentile(50);
+      summaries[h][1] = histograms[h]->getPercentile(99);
+      summaries[h][2] = histograms[h]->getPercentile(99.9);
+      summaries[h][3] = histograms[h]->getMax();
+    }
+  }
+
+  std::atomic_thread_fence(std::memory_order_release);
+  table.sequence.store(sequence + 2, std::memory_order_release);
+}
+
 /*!
  * Stop all tasks
  */
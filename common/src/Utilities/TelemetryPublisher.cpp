@@ -0,0 +1,126 @@
+/*! @file TelemetryPublisher.cpp
+ *  @brief Sends telemetry (LCM messages) from a low priority thread
+ */
+
+#include "Utilities/TelemetryPublisher.h"
+
+#include <sched.h>
+#include <stdio.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <chrono>
+
+static std::mutex defaultScheduleMutex;
+
+/*!
+ * Schedule of new publishers, low priority on the CPUs of the thread which
+ * starts them until setDefaultSchedule
+ */
+static PeriodicTaskSchedule& defaultPublisherSchedule() {
+  static PeriodicTaskSchedule schedule = [] {
+    PeriodicTaskSchedule s;
+    s.policy = SCHED_OTHER;
+    return s;
+  }();
+  return schedule;
+}
+
+/*!
+ * Set the schedule of the publishers constructed from now on, so publishers
+ * created deep inside of controllers are scheduled like the others.  The
+ * policy is forced to SCHED_OTHER if it was left to inherit, which could be
+ * the real-time policy of the starting thread.
+ */
+void TelemetryPublisher::setDefaultSchedule(
+    const PeriodicTaskSchedule& schedule) {
+  std::lock_guard<std::mutex> lock(defaultScheduleMutex);
+  PeriodicTaskSchedule& defaultSchedule = defaultPublisherSchedule();
+  defaultSchedule = schedule;
+  if (defaultSchedule.policy < 0) {
+    defaultSchedule.policy = SCHED_OTHER;
+    defaultSchedule.priority = 0;
+  }
+}
+
+/*!
+ * Get the schedule publishers are constructed with
+ */
+PeriodicTaskSchedule TelemetryPublisher::getDefaultSchedule() {
+  std::lock_guard<std::mutex> lock(defaultScheduleMutex);
+  return defaultPublisherSchedule();
+}
+
+/*!
+ * Start the publisher thread.  Returns once the thread is scheduled as it
+ * should be.
+ */
+void TelemetryPublisher::start() {
+  if (_running) return;
+  _running = true;
+  std::promise<void> scheduled;
+  std::future<void> applied = scheduled.get_future();
+  _thread = std::thread(&TelemetryPublisher::publishLoop, this, &scheduled);
+  applied.wait();
+}
+
+/*!
+ * Stop the publisher thread, after sending what is left in the rings
+ */
+void TelemetryPublisher::stop() {
+  if (!_running) return;
+  _running = false;
+  _thread.join();
+  publishPending();
+}
+
+/*!
+ * Send the messages in all rings.  Only from the publisher thread while it
+ * runs, or from one other thread when it doesn't.
+ * @return number of messages sent
+ */
+size_t TelemetryPublisher::publishPending() {
+  size_t n = 0;
+  for (auto& channel : _channels) n += channel->publishPending();
+  return n;
+}
+
+/*!
+ * @return number of messages dropped because their ring was full, on all
+ * channels
+ */
+u64 TelemetryPublisher::getDroppedCount() const {
+  u64 dropped = 0;
+  for (auto& channel : _channels) dropped += channel->getDroppedCount();
+  return dropped;
+}
+
+/*!
+ * Print the counters of every channel
+ */
+void TelemetryPublisher::printStatus() const {
+  printf("[TelemetryPublisher] %s\n", _name.c_str());
+  for (auto& channel : _channels) {
+    printf("  %-30s pushed %10lu  published %10lu  dropped %8lu\n",
+           channel->getName().c_str(), (unsigned long)channel->getPushedCount(),
+           (unsigned long)channel->getPublishedCount(),
+           (unsigned long)channel->getDroppedCount());
+  }
+}
+
+void TelemetryPublisher::publishLoop(std::promise<void>* scheduled) {
+  _effectiveSchedule = _schedule.applyToThisThread(_name);
+#ifdef __linux__
+  // below the real-time tasks, but not starved by other programs.  Nice only
+  // matters to SCHED_OTHER threads.
+  if (_effectiveSchedule.policy == SCHED_OTHER)
+    setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), 10);
+#endif
+  scheduled->set_value();
+
+  auto period = std::chrono::duration<double>(_period);
+  while (_running) {
+    publishPending();
+    std::this_thread::sleep_for(period);
+  }
+}
@@ -175,3 +175,99 @@ TEST(JCQP, test_solver_sparse) {
 
   printf("diff %g %g\n", diff.minCoeff(), diff.maxCoeff());
 }
+
+// random sparse symmetric positive definite (diagonally dominant) matrix, as
+// sorted triples.  The pattern depends on seed.
+static std::vector<SparseTriple<double>> randomSparseSpd(int n, int seed) {
+  DenseMatrix<double> A(n, n);
+  A.setZero();
+  for (int i = 0; i < n; i++) {
+    A(i, i) = n;
+    for (int j = 0; j < i; j++) {
+      if ((7 * i + 3 * j + seed) % 11 == 0) {
+        A(i, j) = A(j, i) = std::sin(i + 2. * j);
+      }
+    }
+  }
+
+  std::vector<SparseTriple<double>> tris;
+  for (int c = 0; c < n; c++) {
+    for (int r = 0; r < n; r++) {
+      if (A(r, c) != 0) tris.push_back({A(r, c), (u32)r, (u32)c});
+    }
+  }
+  return tris;
+}
+
+TEST(JCQP, test_solver_sparse_refactor) {
+  int n = 100;
+  auto tris = randomSparseSpd(n, 0);
+  CholeskySparseSolver<double> solver;
+  EXPECT_FALSE(solver.updateValues(tris));
+  solver.preSetup(tris, n, false);
+  solver.setup(false);
+  EXPECT_TRUE(solver.isSetup());
+
+  // same pattern, new values
+  auto tris2 = tris;
+  for (auto& tri : tris2) {
+    tri.value *= 1.5;
+    if (tri.r == tri.c) tri.value += 2.;
+  }
+  EXPECT_TRUE(solver.updateValues(tris2));
+  solver.factor();
+
+  CholeskySparseSolver<double> fresh;
+  fresh.preSetup(tris2, n, false);
+  fresh.setup(false);
+
+  Vector<double> b(n);
+  b.setRandom();
+  Vector<double> x = b, x2 = b;
+  solver.solve(x);
+  fresh.solve(x2);
+  for (int i = 0; i < n; i++) {
+    EXPECT_TRUE(fpEqual(x[i], x2[i], 1e-9));
+  }
+
+  // a different pattern is refused, and the old factorization is kept
+  auto tris3 = randomSparseSpd(n, 1);
+  EXPECT_FALSE(solver.updateValues(tris3));
+  tris2.pop_back();
+  EXPECT_FALSE(solver.updateValues(tris2));
+  x = b;
+  solver.solve(x);
+  for (int i = 0; i < n; i++) {
+    EXPECT_TRUE(fpEqual(x[i], x2[i], 1e-9));
+  }
+}
+
+TEST(JCQP, test_result_sparse_triples_cached) {
+  CholeskySparseSolver<double> cache;
+  for (int i = 0; i < 3; i++) {
+    // the zero in A stays in the pattern
+    QpProblem<double> problem(2, 3, false, false);
+    problem.A_triples = {{1., 0, 0}, {1., 0, 1}, {i == 1 ? 0. : 1., 1, 0},
+                         {1., 2, 1}};
+    problem.P_triples = {{4. + i, 0, 0}, {1., 0, 1}, {1., 1, 0}, {2., 1, 1}};
+    problem.u << 1., 0.7, 0.7;
+    problem.l << 1., 0., 0.;
+    problem.q << 0, 0;
+
+    QpProblem<double> uncached(2, 3, false, false);
+    uncached.A_triples = problem.A_triples;
+    uncached.P_triples = problem.P_triples;
+    uncached.u = problem.u;
+    uncached.l = problem.l;
+    uncached.q = problem.q;
+
+    problem.runFromTriples(-1, false, &cache);
+    uncached.runFromTriples(-1, false);
+    EXPECT_EQ(i > 0, problem.reusedSymbolicFactor());
+    EXPECT_FALSE(uncached.reusedSymbolicFactor());
+    for (int j = 0; j < 2; j++) {
+      EXPECT_TRUE(fpEqual(problem.getSolution()[j],
+                          uncached.getSolution()[j], 1e-9));
+    }
+  }
+}
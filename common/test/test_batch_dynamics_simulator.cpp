@@ -0,0 +1,108 @@
+/*! @file test_batch_dynamics_simulator.cpp
+ *  @brief Test simulating many robots in parallel
+ *
+ * Every environment of the batch must do exactly what a DynamicsSimulator of
+ * its own does, with any number of worker threads.
+ */
+
+#include "Dynamics/BatchDynamicsSimulator.h"
+#include "Dynamics/DynamicsSimulator.h"
+#include "Dynamics/FloatingBaseModel.h"
+#include "Dynamics/MiniCheetah.h"
+#include "Dynamics/Quadruped.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+// standing a little above the ground, leaning and kicking depending on env
+static FBModelState<double> initialState(size_t env) {
+  FBModelState<double> state;
+  state.bodyOrientation = rpyToQuat(Vec3<double>(0.05 * env, -0.02 * env, 0));
+  state.bodyPosition = Vec3<double>(0, 0, 0.3 + 0.01 * env);
+  state.bodyVelocity << 0, 0, 0, 0.1 * env, 0, 0;
+  state.q = DVec<double>(12);
+  state.qd = DVec<double>::Zero(12);
+  for (int leg = 0; leg < 4; leg++) {
+    state.q[3 * leg] = 0;
+    state.q[3 * leg + 1] = -0.8;
+    state.q[3 * leg + 2] = 1.6;
+  }
+  return state;
+}
+
+// joint PD to the initial pose
+static void controller(size_t env, size_t step, const FBModelState<double>& state,
+                       DVec<double>& tau) {
+  DVec<double> qDes = initialState(env).q;
+  tau = 20. * (qDes - state.q) - 0.5 * state.qd;
+  tau[1] += 0.01 * step;
+}
+
+static void expectSameState(const FBModelState<double>& a,
+                            const FBModelState<double>& b) {
+  EXPECT_EQ(a.bodyPosition, b.bodyPosition);
+  EXPECT_EQ(a.bodyOrientation, b.bodyOrientation);
+  EXPECT_EQ(a.bodyVelocity, b.bodyVelocity);
+  EXPECT_EQ(a.q, b.q);
+  EXPECT_EQ(a.qd, b.qd);
+}
+
+TEST(BatchDynamicsSimulator, matchesSingleSimulators) {
+  FloatingBaseModel<double> model = buildMiniCheetah<double>().buildModel();
+  const size_t nEnvs = 7, nSteps = 200;
+  const double dt = 0.001, kp = 5e5, kd = 5e3;
+
+  // one simulator per environment, one after the other
+  std::vector<FBModelState<double>> reference;
+  for (size_t env = 0; env < nEnvs; env++) {
+    FloatingBaseModel<double> envModel = model;
+    DynamicsSimulator<double> sim(envModel);
+    sim.addCollisionPlane(0.7, 0, 0);
+    sim.setState(initialState(env));
+    DVec<double> tau;
+    for (size_t k = 0; k < nSteps; k++) {
+      controller(env, k, sim.getState(), tau);
+      sim.step(dt, tau, kp, kd);
+    }
+    reference.push_back(sim.getState());
+  }
+
+  // the robots did not stay where they started
+  EXPECT_GT((reference[3].q - initialState(3).q).norm(), 1e-3);
+
+  for (int workers : {0, 3}) {
+    // rollout
+    BatchDynamicsSimulator<double> batch(model, nEnvs);
+    batch.start(workers);
+    EXPECT_EQ(workers, batch.workerCount());
+    EXPECT_EQ(nEnvs, batch.size());
+    batch.addCollisionPlane(0.7, 0, 0);
+    for (size_t env = 0; env < nEnvs; env++)
+      batch.setState(env, initialState(env));
+    batch.rollout(nSteps, dt, kp, kd, controller);
+    for (size_t env = 0; env < nEnvs; env++)
+      expectSameState(reference[env], batch.getState(env));
+
+    // step by step
+    for (size_t env = 0; env < nEnvs; env++)
+      batch.setState(env, initialState(env));
+    std::vector<DVec<double>> tau(nEnvs);
+    for (size_t k = 0; k < nSteps; k++) {
+      for (size_t env = 0; env < nEnvs; env++)
+        controller(env, k, batch.getState(env), tau[env]);
+      batch.step(dt, tau, kp, kd);
+    }
+    for (size_t env = 0; env < nEnvs; env++)
+      expectSameState(reference[env], batch.getState(env));
+
+    batch.stop();
+    EXPECT_FALSE(batch.isRunning());
+  }
+}
+
+TEST(BatchDynamicsSimulator, torquesForEveryEnvironment) {
+  FloatingBaseModel<double> model = buildMiniCheetah<double>().buildModel();
+  BatchDynamicsSimulator<double> batch(model, 3);
+  std::vector<DVec<double>> tau(2, DVec<double>::Zero(12));
+  EXPECT_THROW(batch.step(0.001, tau, 0, 0), std::runtime_error);
+}
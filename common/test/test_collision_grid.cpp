@@ -0,0 +1,94 @@
+/*! @file test_collision_grid.cpp
+ *  @brief Test the broad phase of contact detection
+ *
+ * The grid must never drop an object a point is in contact with, and must
+ * keep the objects in the order they were added, so contacts come out the
+ * same as when checking every object.
+ */
+
+#include <random>
+
+#include "Collision/CollisionBox.h"
+#include "Collision/CollisionGrid.h"
+#include "Collision/CollisionMesh.h"
+#include "Collision/CollisionPlane.h"
+#include "Math/orientation_tools.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+TEST(CollisionGrid, sameContactsAsBruteForce) {
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<double> dist(-1., 1.);
+
+  std::vector<Collision<double>*> collisions;
+  collisions.push_back(new CollisionPlane<double>(0.7, 0, 0));
+  for (int i = 0; i < 300; i++) {
+    Vec3<double> p(10 * dist(rng), 10 * dist(rng), 0.3 * dist(rng));
+    Vec3<double> rpy(0.3 * dist(rng), 0.3 * dist(rng), 3 * dist(rng));
+    double depth = 0.2 + 0.5 * std::abs(dist(rng));
+    double width = 0.2 + 0.5 * std::abs(dist(rng));
+    double height = 0.1 + 0.2 * std::abs(dist(rng));
+    collisions.push_back(new CollisionBox<double>(
+        0.7, 0, depth, width, height, p, ori::rpyToRotMat(rpy)));
+  }
+  // a big box, overlapping many cells
+  collisions.push_back(new CollisionBox<double>(
+      0.7, 0, 4, 3, 0.5, Vec3<double>(2, -3, 0), Mat3<double>::Identity()));
+  DMat<double> heightMap(20, 30);
+  for (int i = 0; i < 20; i++)
+    for (int j = 0; j < 30; j++) heightMap(i, j) = 0.1 * dist(rng);
+  collisions.push_back(new CollisionMesh<double>(
+      0.7, 0, 0.1, Vec3<double>(-5, 4, 0.2), heightMap));
+
+  CollisionGrid<double> grid;
+  grid.build(collisions);
+  EXPECT_LT(grid.getMaxCandidates(), 20u);
+
+  size_t nContacts = 0;
+  for (int i = 0; i < 20000; i++) {
+    // points all over the terrain and beyond it
+    Vec3<double> p(12 * dist(rng), 12 * dist(rng), 0.4 * dist(rng));
+
+    std::vector<size_t> bruteForce;
+    double penetration;
+    Mat3<double> frame;
+    for (size_t j = 0; j < collisions.size(); j++) {
+      if (collisions[j]->ContactDetection(p, penetration, frame))
+        bruteForce.push_back(j);
+    }
+
+    std::vector<size_t> broadPhase;
+    const size_t* candidates;
+    size_t nCandidates = grid.getCandidates(p, candidates);
+    EXPECT_LE(nCandidates, grid.getMaxCandidates());
+    for (size_t k = 0; k < nCandidates; k++) {
+      size_t j = candidates[k];
+      if (k > 0) {
+        EXPECT_LT(candidates[k - 1], j);
+      }
+      if (grid.mayContain(j, p) &&
+          collisions[j]->ContactDetection(p, penetration, frame))
+        broadPhase.push_back(j);
+    }
+    ASSERT_EQ(bruteForce, broadPhase);
+    nContacts += bruteForce.size();
+  }
+  EXPECT_GT(nContacts, 10000u);
+
+  for (auto collision : collisions) delete collision;
+}
+
+TEST(CollisionGrid, onlyUnbounded) {
+  CollisionPlane<double> ground(0.7, 0, 0);
+  std::vector<Collision<double>*> collisions = {&ground};
+  CollisionGrid<double> grid;
+  grid.build(collisions);
+
+  const size_t* candidates;
+  ASSERT_EQ(1u, grid.getCandidates(Vec3<double>(1e3, -1e3, 0), candidates));
+  EXPECT_EQ(0u, candidates[0]);
+
+  grid.build({});
+  EXPECT_EQ(0u, grid.getCandidates(Vec3<double>::Zero(), candidates));
+}
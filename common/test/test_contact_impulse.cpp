@@ -0,0 +1,71 @@
+/*! @file test_contact_impulse.cpp
+ *  @brief Test the impulse-based contact dynamics
+ *
+ * Drop a standing Mini Cheetah on the ground and check the impulses the
+ * contact solver finds.
+ */
+
+#include "Collision/CollisionBox.h"
+#include "Collision/CollisionPlane.h"
+#include "Collision/ContactImpulse.h"
+#include "Dynamics/FloatingBaseModel.h"
+#include "Dynamics/MiniCheetah.h"
+#include "Dynamics/Quadruped.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+TEST(ContactImpulse, feetStopOnGround) {
+  FloatingBaseModel<double> model = buildMiniCheetah<double>().buildModel();
+  const double dt = 0.0005, mu = 0.6;
+
+  FBModelState<double> state;
+  state.bodyOrientation << 1, 0.02, -0.01, 0.03;
+  state.bodyOrientation.normalize();
+  state.bodyPosition = Vec3<double>(0, 0, 0.3);
+  state.bodyVelocity << 0.1, -0.2, 0.05, 0.4, -0.1, -0.8;
+  state.q = DVec<double>(12);
+  state.qd = DVec<double>::Zero(12);
+  for (int leg = 0; leg < 4; leg++) {
+    state.q[3 * leg] = 0;
+    state.q[3 * leg + 1] = -0.8;
+    state.q[3 * leg + 2] = 1.6;
+  }
+  model.setState(state);
+  model.forwardKinematics();
+
+  // the ground is just above the lowest foot, so (only) the feet touch it
+  double height = -1e10;
+  for (auto foot : model._footIndicesGC)
+    height = std::max(height, model._pGC[foot][2] + 1e-3);
+
+  ContactImpulse<double> contact(&model);
+  CollisionPlane<double> ground(mu, 0, height);
+  CollisionBox<double> faraway(mu, 0, 1, 1, 1, Vec3<double>(10, 0, 0),
+                               Mat3<double>::Identity());
+  contact.AddCollision(&faraway);
+  contact.AddCollision(&ground);
+  contact.UpdateExternalForces(0, 0, dt);
+
+  // twice, with the same buffers
+  for (int run = 0; run < 2; run++) {
+    FBModelState<double> after = state;
+    model.setState(after);
+    contact.UpdateQdot(after);
+    EXPECT_EQ(4u, contact.getNumContacts());
+
+    model.setState(after);
+    model.forwardKinematics();
+    for (auto foot : model._footIndicesGC) {
+      // no foot goes into the ground any more
+      EXPECT_GT(model._vGC[foot][2], -1e-4);
+
+      // impulses push, inside the friction cone
+      Vec3<double> f = contact.getGCForce(foot);
+      EXPECT_GT(f[2], 0);
+      EXPECT_LE(f.head<2>().norm(), std::sqrt(2.) * mu * f[2] + 1e-6);
+    }
+    EXPECT_LT(after.bodyVelocity[5], 0.1);
+    EXPECT_GT(after.bodyVelocity[5], state.bodyVelocity[5]);
+  }
+}
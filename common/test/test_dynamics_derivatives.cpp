@@ -0,0 +1,168 @@
+/*! @file test_dynamics_derivatives.cpp
+ *  @brief Test the analytical derivatives of the dynamics
+ *
+ * Compare the derivatives of the inverse and forward dynamics of the Mini
+ * Cheetah against central differences
+ */
+
+#include "Dynamics/FloatingBaseModel.h"
+#include "Dynamics/MiniCheetah.h"
+#include "Dynamics/Quadruped.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include <functional>
+
+using namespace spatial;
+
+static FBModelState<double> makeState() {
+  FBModelState<double> state;
+  state.bodyOrientation << 0.8, -0.2, 0.3, 0.4;
+  state.bodyOrientation.normalize();
+  state.bodyPosition = Vec3<double>(0.3, -0.2, 0.4);
+  state.bodyVelocity << 0.5, -1., 0.3, 1.2, 0.4, -0.7;
+  state.q = DVec<double>(12);
+  state.qd = DVec<double>(12);
+  for (int i = 0; i < 12; i++) {
+    state.q[i] = 0.2 * i - 1.1;
+    state.qd[i] = 3. * std::sin(i + 1.);
+  }
+  return state;
+}
+
+/*!
+ * Move the state along coordinate k of q or qd, with the floating base
+ * coordinates of inverseDynamicsDerivatives
+ */
+static void perturb(FBModelState<double>& state, bool velocity, int k,
+                    double h) {
+  if (velocity) {
+    if (k < 6)
+      state.bodyVelocity[k] += h;
+    else
+      state.qd[k - 6] += h;
+    return;
+  }
+
+  // R (body to world) becomes R * exp(dtheta x), and the position moves by
+  // R dp
+  Mat3<double> E = quaternionToRotationMatrix(state.bodyOrientation);
+  if (k < 3) {
+    Mat3<double> expTheta =
+        Eigen::AngleAxis<double>(h, Vec3<double>::Unit(k)).toRotationMatrix();
+    state.bodyOrientation =
+        rotationMatrixToQuaternion(Mat3<double>(expTheta.transpose() * E));
+  } else if (k < 6) {
+    state.bodyPosition += E.transpose() * Vec3<double>::Unit(k - 3) * h;
+  } else {
+    state.q[k - 6] += h;
+  }
+}
+
+/*!
+ * Central difference of f along coordinate k of q, qd or qdd
+ */
+static DMat<double> centralDifference(
+    std::function<DVec<double>(const FBModelState<double>&,
+                               const DVec<double>&)>
+        f,
+    const FBModelState<double>& state, const DVec<double>& qdd, int which) {
+  const double h = 1e-6;
+  DMat<double> D(18, 18);
+  for (int k = 0; k < 18; k++) {
+    FBModelState<double> plus = state, minus = state;
+    DVec<double> qddPlus = qdd, qddMinus = qdd;
+    if (which < 2) {
+      perturb(plus, which == 1, k, h);
+      perturb(minus, which == 1, k, -h);
+    } else {
+      qddPlus[k] += h;
+      qddMinus[k] -= h;
+    }
+    D.col(k) = (f(plus, qddPlus) - f(minus, qddMinus)) / (2 * h);
+  }
+  return D;
+}
+
+static void expectMatrixNear(const DMat<double>& ref, const DMat<double>& x,
+                             double relTol) {
+  ASSERT_EQ(ref.rows(), x.rows());
+  ASSERT_EQ(ref.cols(), x.cols());
+  double tol = relTol * ref.cwiseAbs().maxCoeff();
+  for (int i = 0; i < ref.rows(); i++)
+    for (int j = 0; j < ref.cols(); j++)
+      EXPECT_NEAR(ref(i, j), x(i, j), tol) << "at " << i << ", " << j;
+}
+
+TEST(DynamicsDerivatives, inverseDynamics) {
+  FloatingBaseModel<double> model = buildMiniCheetah<double>().buildModel();
+  FBModelState<double> state = makeState();
+
+  // the orientation survives the round trip used by perturb()
+  Mat3<double> E = quaternionToRotationMatrix(state.bodyOrientation);
+  ASSERT_LT((quaternionToRotationMatrix(rotationMatrixToQuaternion(E)) - E)
+                .norm(),
+            1e-12);
+
+  DVec<double> qdd(18);
+  for (int i = 0; i < 18; i++) qdd[i] = 5. * std::cos(2. * i);
+
+  auto id = [&](const FBModelState<double>& x, const DVec<double>& a) {
+    FBModelStateDerivative<double> dx;
+    dx.dBodyVelocity = a.head<6>();
+    dx.qdd = a.tail<12>();
+    model.setState(x);
+    return model.inverseDynamics(dx);
+  };
+
+  DMat<double> dq, dqd, dqdd;
+  FBModelStateDerivative<double> dState;
+  dState.dBodyVelocity = qdd.head<6>();
+  dState.qdd = qdd.tail<12>();
+  model.setState(state);
+  model.inverseDynamicsDerivatives(dState, dq, dqd, dqdd);
+
+  DMat<double> H = model.massMatrix();
+  expectMatrixNear(H, dqdd, 1e-12);
+  expectMatrixNear(centralDifference(id, state, qdd, 0), dq, 1e-6);
+  expectMatrixNear(centralDifference(id, state, qdd, 1), dqd, 1e-6);
+  expectMatrixNear(centralDifference(id, state, qdd, 2), dqdd, 1e-6);
+
+  // the base position does not change the dynamics
+  EXPECT_EQ(0., dq.middleCols<3>(3).norm());
+}
+
+TEST(DynamicsDerivatives, forwardDynamics) {
+  FloatingBaseModel<double> model = buildMiniCheetah<double>().buildModel();
+  FBModelState<double> state = makeState();
+  DVec<double> tau(12);
+  for (int i = 0; i < 12; i++) tau[i] = 4. * std::cos(i);
+
+  auto fd = [&](const FBModelState<double>& x, const DVec<double>& t) {
+    FBModelStateDerivative<double> dx;
+    model.setState(x);
+    model.runABA(t.tail<12>(), dx);
+    DVec<double> out(18);
+    out << dx.dBodyVelocity, dx.qdd;
+    return out;
+  };
+
+  DMat<double> dq, dqd, dtau;
+  FBModelStateDerivative<double> dstate;
+  model.setState(state);
+  model.forwardDynamicsDerivatives(tau, dstate, dq, dqd, dtau);
+  ASSERT_EQ(18, dtau.rows());
+  ASSERT_EQ(12, dtau.cols());
+
+  // same accelerations as the ABA
+  DVec<double> tau18(18);
+  tau18 << DVec<double>::Zero(6), tau;
+  DVec<double> qdd = fd(state, tau18);
+  EXPECT_LT((dstate.qdd - qdd.tail<12>()).norm(), 1e-9);
+
+  expectMatrixNear(centralDifference(fd, state, tau18, 0), dq, 1e-6);
+  expectMatrixNear(centralDifference(fd, state, tau18, 1), dqd, 1e-6);
+  expectMatrixNear(centralDifference(fd, state, tau18, 2).rightCols<12>(),
+                   dtau, 1e-6);
+}
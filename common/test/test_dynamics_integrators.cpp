@@ -0,0 +1,147 @@
+/*! @file test_dynamics_integrators.cpp
+ *  @brief Test the integrators of the dynamics simulator
+ *
+ * Mini Cheetah with spring-damper contact, at the stiffness of the simulator
+ * defaults.
+ */
+
+#include "ControlParameters/SimulatorParameters.h"
+#include "Dynamics/DynamicsSimulator.h"
+#include "Dynamics/MiniCheetah.h"
+#include "Dynamics/Quadruped.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+static const double floorKp = 5e5, floorKd = 5e3;
+
+static FBModelState<double> standing(double height) {
+  FBModelState<double> state;
+  state.bodyOrientation << 1, 0, 0, 0;
+  state.bodyPosition = Vec3<double>(0, 0, height);
+  state.bodyVelocity.setZero();
+  state.q = DVec<double>(12);
+  state.qd = DVec<double>::Zero(12);
+  for (int leg = 0; leg < 4; leg++) {
+    state.q[3 * leg] = 0;
+    state.q[3 * leg + 1] = -0.8;
+    state.q[3 * leg + 2] = 1.6;
+  }
+  return state;
+}
+
+// high in the air, spinning and kicking
+static FBModelState<double> flying() {
+  FBModelState<double> state = standing(2);
+  state.bodyVelocity << 1, -2, 3, 0.5, 0, 1;
+  for (int i = 0; i < 12; i++) state.q[i] += 0.05 * i;
+  return state;
+}
+
+// joint PD to the standing pose (or no torque if kp is 0), on the ground, for
+// a time
+static FBModelState<double> simulate(DynamicsIntegrator integrator, double dt,
+                                     const FBModelState<double>& start,
+                                     double duration, double kp = 40,
+                                     size_t maxSubsteps = 1,
+                                     size_t* mostSubsteps = nullptr) {
+  FloatingBaseModel<double> model = buildMiniCheetah<double>().buildModel();
+  DynamicsSimulator<double> sim(model, true);
+  sim.setIntegrator(integrator);
+  sim.setAdaptiveSubsteps(maxSubsteps, 1e-6);
+  sim.addCollisionPlane(0.7, 0, 0);
+  sim.setState(start);
+
+  DVec<double> qDes = standing(0).q;
+  for (int i = 0; i < (int)std::round(duration / dt); i++) {
+    const FBModelState<double>& state = sim.getState();
+    DVec<double> tau = kp * (qDes - state.q) - (kp / 40) * state.qd;
+    sim.step(dt, tau, floorKp, floorKd);
+    if (mostSubsteps)
+      *mostSubsteps = std::max(*mostSubsteps, sim.getSubsteps());
+  }
+  return sim.getState();
+}
+
+TEST(DynamicsIntegrators, implicitContactTakesLongSteps) {
+  FBModelState<double> reference =
+      simulate(DynamicsIntegrator::Euler, 0.0001, standing(0.3), 1);
+  FBModelState<double> implicit =
+      simulate(DynamicsIntegrator::ImplicitContact, 0.002, standing(0.3), 1);
+  EXPECT_NEAR(reference.bodyPosition[2], implicit.bodyPosition[2], 1e-3);
+  EXPECT_LT((reference.q - implicit.q).cwiseAbs().maxCoeff(), 1e-2);
+  EXPECT_LT(implicit.bodyVelocity.norm(), 0.1);
+}
+
+TEST(DynamicsIntegrators, implicitContactLanding) {
+  // the springs are stretched by the velocity at the start of each step too,
+  // without that the errors are 8.5e-4 and 0.057
+  FBModelState<double> start = standing(0.32);
+  start.bodyVelocity[5] = -2;
+  FBModelState<double> reference =
+      simulate(DynamicsIntegrator::Euler, 0.00005, start, 0.2);
+  FBModelState<double> implicit =
+      simulate(DynamicsIntegrator::ImplicitContact, 0.002, start, 0.2);
+  EXPECT_NEAR(reference.bodyPosition[2], implicit.bodyPosition[2], 7e-4);
+  EXPECT_LT((reference.bodyVelocity - implicit.bodyVelocity).norm(), 0.045);
+}
+
+TEST(DynamicsIntegrators, implicitContactWithoutContact) {
+  // in the air it's the semi-implicit integrator
+  FBModelState<double> a =
+      simulate(DynamicsIntegrator::SemiImplicitEuler, 0.001, flying(), 0.1);
+  FBModelState<double> b =
+      simulate(DynamicsIntegrator::ImplicitContact, 0.001, flying(), 0.1);
+  EXPECT_EQ(a.bodyPosition, b.bodyPosition);
+  EXPECT_EQ(a.q, b.q);
+}
+
+TEST(DynamicsIntegrators, rk4Order) {
+  // no torque: a controller running at dt would be a first order error
+  FBModelState<double> reference =
+      simulate(DynamicsIntegrator::RK4, 0.0001, flying(), 0.2, 0);
+  auto error = [&](DynamicsIntegrator integrator, double dt) {
+    FBModelState<double> s = simulate(integrator, dt, flying(), 0.2, 0);
+    return (reference.q - s.q).norm();
+  };
+
+  double rk4Ratio = error(DynamicsIntegrator::RK4, 0.004) /
+                    error(DynamicsIntegrator::RK4, 0.002);
+  double eulerRatio = error(DynamicsIntegrator::SemiImplicitEuler, 0.004) /
+                      error(DynamicsIntegrator::SemiImplicitEuler, 0.002);
+  EXPECT_GT(rk4Ratio, 10);
+  EXPECT_LT(eulerRatio, 3);
+  EXPECT_LT(error(DynamicsIntegrator::RK4, 0.004),
+            error(DynamicsIntegrator::SemiImplicitEuler, 0.0005));
+}
+
+TEST(DynamicsIntegrators, adaptiveSubsteps) {
+  // landing from a drop with explicit Euler and steps too long for it
+  FBModelState<double> reference =
+      simulate(DynamicsIntegrator::Euler, 0.0001, standing(0.35), 0.5);
+  size_t mostSubsteps = 0;
+  FBModelState<double> adaptive =
+      simulate(DynamicsIntegrator::Euler, 0.002, standing(0.35), 0.5, 40, 32,
+               &mostSubsteps);
+  EXPECT_GT(mostSubsteps, 1u);
+  EXPECT_NEAR(reference.bodyPosition[2], adaptive.bodyPosition[2], 1e-3);
+}
+
+TEST(DynamicsIntegrators, impulseIsSemiImplicit) {
+  FloatingBaseModel<double> model = buildMiniCheetah<double>().buildModel();
+  DynamicsSimulator<double> sim(model, false);
+  EXPECT_EQ(DynamicsIntegrator::SemiImplicitEuler, sim.getIntegrator());
+  EXPECT_THROW(sim.setIntegrator(DynamicsIntegrator::RK4),
+               std::runtime_error);
+}
+
+TEST(DynamicsIntegrators, integratorParameter) {
+  SimulatorControlParameters params;
+  params.dynamics_integrator = 3;
+  EXPECT_EQ(DynamicsIntegrator::ImplicitContact,
+            params.getDynamicsIntegrator());
+  params.dynamics_integrator = 4;
+  EXPECT_THROW(params.getDynamicsIntegrator(), std::runtime_error);
+  params.dynamics_integrator = -1;
+  EXPECT_THROW(params.getDynamicsIntegrator(), std::runtime_error);
+}
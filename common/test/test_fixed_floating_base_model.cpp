@@ -0,0 +1,130 @@
+/*! @file test_fixed_floating_base_model.cpp
+ *  @brief Test the fixed size floating base model
+ *
+ * Compare every algorithm of the FixedFloatingBaseModel against the
+ * FloatingBaseModel it was built from
+ */
+
+#include "Dynamics/FixedFloatingBaseModel.h"
+#include "Dynamics/FloatingBaseModel.h"
+#include "Dynamics/MiniCheetah.h"
+#include "Dynamics/Quadruped.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include <random>
+
+using namespace spatial;
+
+using QuadrupedModel = FixedFloatingBaseModel<double, 13, 18>;
+
+static FBModelState<double> randomState(std::mt19937& rng) {
+  std::uniform_real_distribution<double> dist(-1., 1.);
+  FBModelState<double> state;
+  for (int i = 0; i < 4; i++) state.bodyOrientation[i] = dist(rng);
+  state.bodyOrientation.normalize();
+  state.bodyPosition = Vec3<double>(dist(rng), dist(rng), dist(rng));
+  state.q = DVec<double>(12);
+  state.qd = DVec<double>(12);
+  for (int i = 0; i < 6; i++) state.bodyVelocity[i] = 3. * dist(rng);
+  for (int i = 0; i < 12; i++) {
+    state.q[i] = 2. * dist(rng);
+    state.qd[i] = 10. * dist(rng);
+  }
+  return state;
+}
+
+template <typename A, typename B>
+static void expectNear(const Eigen::MatrixBase<A>& a,
+                       const Eigen::MatrixBase<B>& b, double tol) {
+  ASSERT_EQ(a.rows(), b.rows());
+  ASSERT_EQ(a.cols(), b.cols());
+  for (int i = 0; i < a.rows(); i++)
+    for (int j = 0; j < a.cols(); j++) EXPECT_NEAR(a(i, j), b(i, j), tol);
+}
+
+static void compareModels(FloatingBaseModel<double> model) {
+  QuadrupedModel fixed(model);
+  std::mt19937 rng(23);
+  std::uniform_real_distribution<double> dist(-1., 1.);
+
+  for (int trial = 0; trial < 10; trial++) {
+    FBModelState<double> state = randomState(rng);
+    model.setState(state);
+    fixed.setState(state);
+
+    // kinematics of the contact points
+    model.forwardKinematics();
+    fixed.forwardKinematics();
+    for (size_t k = 0; k < model._nGroundContact; k++) {
+      expectNear(model._pGC[k], fixed._pGC[k], 1e-10);
+      expectNear(model._vGC[k], fixed._vGC[k], 1e-10);
+    }
+
+    model.contactJacobians();
+    fixed.contactJacobians();
+    for (size_t k = 0; k < model._nGroundContact; k++) {
+      expectNear(model._Jc[k], fixed._Jc[k], 1e-10);
+      expectNear(model._Jcdqd[k], fixed._Jcdqd[k], 1e-8);
+    }
+
+    // inverse dynamics terms
+    expectNear(model.massMatrix(), fixed.massMatrix(), 1e-10);
+    expectNear(model.generalizedGravityForce(), fixed.generalizedGravityForce(),
+               1e-9);
+    expectNear(model.generalizedCoriolisForce(),
+               fixed.generalizedCoriolisForce(), 1e-8);
+
+    // forward dynamics, with a force on a foot
+    DVec<double> tau(12);
+    for (int i = 0; i < 12; i++) tau[i] = 10. * dist(rng);
+    model.resetExternalForces();
+    fixed.resetExternalForces();
+    for (int i = 0; i < 6; i++) {
+      double f = 20. * dist(rng);
+      model._externalForces[8][i] = f;
+      fixed._externalForces[8][i] = f;
+    }
+
+    FBModelStateDerivative<double> dstate, fixedDstate;
+    model.runABA(tau, dstate);
+    fixed.runABA(tau, fixedDstate);
+    expectNear(dstate.dBodyPosition, fixedDstate.dBodyPosition, 1e-10);
+    expectNear(dstate.dBodyVelocity, fixedDstate.dBodyVelocity, 1e-6);
+    expectNear(dstate.qdd, fixedDstate.qdd, 1e-6);
+  }
+}
+
+TEST(FixedFloatingBaseModel, matchesMiniCheetah) {
+  compareModels(buildMiniCheetah<double>().buildModel());
+}
+
+TEST(FixedFloatingBaseModel, compactTransforms) {
+  RotMat<double> E = coordinateRotation(CoordinateAxis::X, .3) *
+                     coordinateRotation(CoordinateAxis::Z, -1.2);
+  Vec3<double> r(.1, -.2, .3);
+  CompactSXform<double> X(E, r);
+  CompactSXform<double> Y(coordinateRotation(CoordinateAxis::Y, .7),
+                          Vec3<double>(-.5, .4, .2));
+  SVec<double> v;
+  v << 1, 2, 3, 4, 5, 6;
+  Mat6<double> I = SpatialInertia<double>(
+                       2., Vec3<double>(.1, .2, -.1),
+                       rotInertiaOfBox(2., Vec3<double>(.3, .2, .1)))
+                       .getMatrix();
+
+  expectNear(X.toMatrix() * v, X.apply(v), 1e-12);
+  expectNear(X.toMatrix().transpose() * v, X.applyTranspose(v), 1e-12);
+  expectNear(X.toMatrix().transpose() * I * X.toMatrix(), X.congruence(I),
+             1e-12);
+  expectNear(X.toMatrix() * Y.toMatrix(), (X * Y).toMatrix(), 1e-12);
+  expectNear(X.toMatrix(), CompactSXform<double>(X.toMatrix()).toMatrix(),
+             1e-12);
+}
+
+TEST(FixedFloatingBaseModel, wrongModel) {
+  FloatingBaseModel<double> model;
+  model.addBase(1., Vec3<double>(0, 0, 0), Mat3<double>::Identity());
+  EXPECT_THROW(QuadrupedModel fixed(model), std::runtime_error);
+}
@@ -0,0 +1,135 @@
+/*! @file test_headless_simulation.cpp
+ *  @brief Test snapshots and forks of the headless simulation
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include "HeadlessSimulation.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+static const char* headlessScriptFile = "test_headless_simulation.txt";
+static const char* headlessSnapshotFile = "test_headless_simulation.snap";
+
+/*!
+ * Joint PD to a standing pose, with the gain of a robot parameter
+ */
+class HeadlessTestController : public RobotController {
+ public:
+  void initializeController() override {}
+  void runController() override {
+    for (int leg = 0; leg < 4; leg++) {
+      _legController->commands[leg].qDes = Vec3<float>(0, -0.8, 1.6);
+      _legController->commands[leg].kpJoint =
+          Mat3<float>::Identity() * _controlParameters->testValue;
+      _legController->commands[leg].kdJoint = Mat3<float>::Identity() * 0.5;
+    }
+  }
+  void updateVisualization() override {}
+  ControlParameters* getUserControlParameters() override { return nullptr; }
+};
+
+static void writeHeadlessScript() {
+  FILE* f = fopen(headlessScriptFile, "w");
+  ASSERT_TRUE(f);
+  fputs("0.05 set testValue 40\n", f);
+  fputs("0.05 a 1\n", f);
+  fclose(f);
+}
+
+TEST(HeadlessSimulation, restoreUndoesScript) {
+  writeHeadlessScript();
+  HeadlessTestController controller;
+  HeadlessSimulation sim(RobotType::MINI_CHEETAH, &controller);
+  sim.loadScript(headlessScriptFile);
+  remove(headlessScriptFile);
+
+  sim.run(0.02);
+  double testValue = sim.getRobotParams().testValue;
+  ASSERT_NE(40, testValue);
+  SimulationSnapshot snapshot = sim.snapshot();
+
+  sim.run(0.06);
+  EXPECT_EQ(40, sim.getRobotParams().testValue);
+  EXPECT_NE(snapshot.dynamics.state.q, sim.getRobotState().q);
+
+  sim.restore(snapshot);
+  EXPECT_EQ(testValue, sim.getRobotParams().testValue);
+  EXPECT_EQ(snapshot.time, sim.getTime());
+  EXPECT_EQ(snapshot.dynamics.state.q, sim.getRobotState().q);
+  EXPECT_EQ(snapshot.dynamics.state.bodyPosition,
+            sim.getRobotState().bodyPosition);
+
+  // the script runs again from the snapshot
+  sim.run(0.06);
+  EXPECT_EQ(40, sim.getRobotParams().testValue);
+}
+
+TEST(HeadlessSimulation, snapshotFile) {
+  HeadlessTestController controller;
+  HeadlessSimulation sim(RobotType::MINI_CHEETAH, &controller);
+  sim.run(0.02);
+  SimulationSnapshot saved = sim.snapshot();
+  saved.save(headlessSnapshotFile);
+
+  SimulationSnapshot loaded;
+  loaded.load(headlessSnapshotFile);
+  remove(headlessSnapshotFile);
+  EXPECT_EQ(saved.time, loaded.time);
+  EXPECT_EQ(saved.dynamics.state.q, loaded.dynamics.state.q);
+  EXPECT_EQ(saved.imuRandomState, loaded.imuRandomState);
+  ASSERT_EQ(saved.robotParameters.size(), loaded.robotParameters.size());
+  EXPECT_TRUE(loaded.userParameters.empty());
+
+  double testValue = sim.getRobotParams().testValue;
+  sim.getRobotParams().testValue = testValue + 1;
+  sim.run(0.02);
+  sim.restore(loaded);
+  EXPECT_EQ(testValue, sim.getRobotParams().testValue);
+  EXPECT_EQ(saved.dynamics.state.qd, sim.getRobotState().qd);
+
+  FILE* f = fopen(headlessSnapshotFile, "w");
+  ASSERT_TRUE(f);
+  fputs("not a snapshot", f);
+  fclose(f);
+  EXPECT_THROW(loaded.load(headlessSnapshotFile), std::runtime_error);
+  remove(headlessSnapshotFile);
+}
+
+TEST(HeadlessSimulation, forkRunsLikeTheOriginal) {
+  writeHeadlessScript();
+  HeadlessTestController controller;
+  HeadlessSimulation sim(RobotType::MINI_CHEETAH, &controller);
+  sim.loadScript(headlessScriptFile);
+  remove(headlessScriptFile);
+  sim.run(0.02);
+
+  size_t copy = sim.fork(1);
+  sim.run(0.06);
+  SimulationSnapshot snapshot = sim.snapshot();
+  if (copy) {
+    // no gtest in the copy, it only reports how it ended
+    int status = 0;
+    try {
+      snapshot.save(headlessSnapshotFile);
+    } catch (const std::exception&) {
+      status = 1;
+    }
+    _exit(status);
+  }
+
+  ASSERT_EQ(0, sim.waitForForks());
+  SimulationSnapshot fromCopy;
+  fromCopy.load(headlessSnapshotFile);
+  remove(headlessSnapshotFile);
+  EXPECT_EQ(snapshot.time, fromCopy.time);
+  EXPECT_EQ(snapshot.highLevelIterations, fromCopy.highLevelIterations);
+  EXPECT_EQ(snapshot.scriptPosition, fromCopy.scriptPosition);
+  EXPECT_EQ(snapshot.dynamics.state.q, fromCopy.dynamics.state.q);
+  EXPECT_EQ(snapshot.dynamics.state.bodyPosition,
+            fromCopy.dynamics.state.bodyPosition);
+  EXPECT_EQ(snapshot.tau, fromCopy.tau);
+  EXPECT_TRUE(fromCopy.gamepad.a);
+}
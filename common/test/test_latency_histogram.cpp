@@ -0,0 +1,76 @@
+/*! @file test_latency_histogram.cpp
+ *  @brief Test the histogram of durations
+ */
+
+#include <algorithm>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "Utilities/LatencyHistogram.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+TEST(LatencyHistogram, buckets) {
+  // every value is in a bucket which ends at or after it, and the buckets
+  // are contiguous
+  u64 lastUpper = 0;
+  for (size_t i = 1; i < LatencyHistogram::kBuckets; i++) {
+    u64 upper = LatencyHistogram::bucketUpperBound(i);
+    EXPECT_GT(upper, lastUpper);
+    EXPECT_EQ(i, LatencyHistogram::bucketIndex(lastUpper + 1));
+    EXPECT_EQ(i, LatencyHistogram::bucketIndex(upper));
+    // bucket width is within 1/32 of its values
+    EXPECT_LE((double)(upper - lastUpper), 1. + upper / 32.);
+    lastUpper = upper;
+  }
+  EXPECT_EQ(LatencyHistogram::kMaxValue, lastUpper);
+}
+
+TEST(LatencyHistogram, percentiles) {
+  LatencyHistogram histogram;
+  EXPECT_EQ(0u, histogram.getPercentile(50));
+
+  std::mt19937 rng(0);
+  std::lognormal_distribution<double> dist(11, 1);  // around 60 us
+  std::vector<u64> values(100000);
+  for (auto& v : values) {
+    v = (u64)dist(rng);
+    histogram.record(v);
+  }
+  std::sort(values.begin(), values.end());
+  EXPECT_EQ(values.size(), histogram.getCount());
+  EXPECT_EQ(values.back(), histogram.getMax());
+
+  for (double p : {1., 50., 90., 99., 99.9, 100.}) {
+    u64 exact = values[std::min(values.size() - 1,
+                                (size_t)(p / 100 * values.size() + 0.5) - 1)];
+    u64 estimate = histogram.getPercentile(p);
+    EXPECT_GE(estimate, exact) << p;
+    EXPECT_LE(estimate, exact + exact / 32 + 1) << p;
+  }
+
+  histogram.record(1000ull * LatencyHistogram::kMaxValue);
+  EXPECT_EQ(LatencyHistogram::kMaxValue, histogram.getMax());
+
+  histogram.reset();
+  EXPECT_EQ(0u, histogram.getCount());
+  EXPECT_EQ(0u, histogram.getMax());
+}
+
+TEST(LatencyHistogram, readWhileRecording) {
+  LatencyHistogram histogram;
+  std::atomic<bool> done{false};
+  std::thread recorder([&] {
+    for (u64 i = 0; i < 1000000; i++) histogram.record(1000 + i % 1000);
+    done = true;
+  });
+  while (!done) {
+    u64 p50 = histogram.getPercentile(50);
+    EXPECT_TRUE(p50 == 0 || (p50 >= 1000 && p50 < 2100));
+  }
+  recorder.join();
+  EXPECT_EQ(1000000u, histogram.getCount());
+  EXPECT_EQ(1999u, histogram.getMax());
+}
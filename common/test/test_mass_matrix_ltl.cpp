@@ -0,0 +1,61 @@
+/*! @file test_mass_matrix_ltl.cpp
+ *  @brief Test the sparse factorization of the mass matrix
+ */
+
+#include "Dynamics/FloatingBaseModel.h"
+#include "Dynamics/MassMatrixLTL.h"
+#include "Dynamics/MiniCheetah.h"
+#include "Dynamics/Quadruped.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+TEST(MassMatrixLTL, miniCheetah) {
+  FloatingBaseModel<double> model = buildMiniCheetah<double>().buildModel();
+
+  FBModelState<double> state;
+  state.bodyOrientation << 0.9, 0.1, -0.3, 0.2;
+  state.bodyOrientation.normalize();
+  state.bodyPosition = Vec3<double>(0.1, 0.2, 0.3);
+  state.bodyVelocity << 1, 2, 3, 4, 5, 6;
+  state.q = DVec<double>(12);
+  state.qd = DVec<double>::Zero(12);
+  for (int i = 0; i < 12; i++) state.q[i] = 0.3 * i - 1.5;
+  model.setState(state);
+  DMat<double> H = model.massMatrix();
+
+  MassMatrixLTL<double> ltl(model.getParentVector());
+  EXPECT_FALSE(ltl.isFactored());
+  ASSERT_TRUE(ltl.factor(H));
+  EXPECT_TRUE(ltl.isFactored());
+
+  // H = L^T L, and L keeps the sparsity of the legs
+  const DMat<double>& L = ltl.getL();
+  EXPECT_LT((L.transpose() * L - H).norm(), 1e-12 * H.norm());
+  EXPECT_EQ(0., L(9, 6));
+  EXPECT_EQ(0., L(17, 10));
+  EXPECT_NE(0., L(8, 6));
+  EXPECT_NE(0., L(17, 3));
+
+  DMat<double> Hinv = H.inverse();
+  EXPECT_LT((ltl.inverse() - Hinv).norm(), 1e-9 * Hinv.norm());
+
+  DVec<double> b(18);
+  for (int i = 0; i < 18; i++) b[i] = std::sin(i);
+  EXPECT_LT((ltl.solve(b) - Hinv * b).norm(), 1e-9 * (Hinv * b).norm());
+
+  DMat<double> M(18, 5);
+  for (int i = 0; i < 18; i++)
+    for (int j = 0; j < 5; j++) M(i, j) = std::cos(i + 3 * j);
+  EXPECT_LT((ltl.inverseTimes(M) - Hinv * M).norm(), 1e-9 * (Hinv * M).norm());
+
+  // an inverse square root: (L^-T M)^T (L^-T M) = M^T H^-1 M
+  DMat<double> S = ltl.sqrtInverseTimes(M);
+  DMat<double> MHinvM = M.transpose() * Hinv * M;
+  EXPECT_LT((S.transpose() * S - MHinvM).norm(), 1e-9 * MHinvM.norm());
+
+  // not positive definite
+  H(12, 12) = -1;
+  EXPECT_FALSE(ltl.factor(H));
+  EXPECT_FALSE(ltl.isFactored());
+}
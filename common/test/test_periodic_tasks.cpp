@@ -2,6 +2,7 @@
 #include "gtest/gtest.h"
 
 #include "Utilities/PeriodicTask.h"
+#include "Utilities/utilities.h"
 
 class TestPeriodicTask : public PeriodicTask {
  public:
@@ -72,3 +73,206 @@ TEST(PeriodicTask, test1) {
 
   // taskManager.stopAll(); test destructors cleaning things up instead
 }
+
+class LateTask : public PeriodicTask {
+ public:
+  using PeriodicTask::PeriodicTask;
+  int _counter = 0;
+
+  void run() override {
+    // every 10th run takes two and a half periods
+    if (++_counter % 10 == 0) usleep(12500);
+  }
+  void init() override {}
+  void cleanup() override {}
+};
+
+TEST(PeriodicTask, missedPeriods) {
+  // the loop of a 5 ms task, with made up times: every 10th run takes 12.5 ms
+  // and every wakeup is 0.1 ms late
+  const u64 ms = 1000000;
+  PeriodCounter periods;
+  periods.start(5 * ms, 7 * ms);
+  LatencyHistogram wakeup;
+  u64 nowNs = 7 * ms;
+  u64 missed = 0;
+  for (int run = 1; run <= 100; run++) {
+    u64 periodStartNs = periods.getPeriodStartNs();
+    bool late = run % 10 == 0;
+    nowNs += late ? 12500000 : ms;
+    u64 wakeupNs = periods.getWakeupNs(nowNs);
+    u64 runMissed = periods.next(nowNs);
+    if (wakeupNs) {
+      EXPECT_EQ(periods.getPeriodStartNs(), wakeupNs);
+      nowNs = wakeupNs + 100000;
+    }
+    missed += runMissed;
+    wakeup.record(periods.getLatenessNs(nowNs));
+
+    // a late run misses the next period, and the run after it starts 2.6 ms
+    // late in the period after that
+    EXPECT_EQ(late ? 0u : periodStartNs + 5 * ms, wakeupNs);
+    EXPECT_EQ(late ? 1u : 0u, runMissed);
+    EXPECT_EQ(periodStartNs + (late ? 10 : 5) * ms,
+              periods.getPeriodStartNs());
+    EXPECT_EQ(late ? 2600000u : 100000u, periods.getLatenessNs(nowNs));
+  }
+  EXPECT_EQ(10u, missed);
+  EXPECT_EQ(100u, wakeup.getCount());
+  EXPECT_EQ((7 + 5 * 110) * ms, periods.getPeriodStartNs());
+
+  // the histogram rounds up to its buckets
+  EXPECT_GE(wakeup.getPercentile(50), 100000u);
+  EXPECT_LT(wakeup.getPercentile(50), 2600000u);
+  EXPECT_GE(wakeup.getPercentile(99), 2600000u);
+  EXPECT_EQ(2600000u, wakeup.getMax());
+
+  // a clock which didn't move still waits for the next period
+  periods.start(0, 3 * ms);
+  EXPECT_EQ(3 * ms + 1, periods.getWakeupNs(3 * ms));
+  EXPECT_EQ(0u, periods.next(3 * ms));
+  EXPECT_EQ(0u, periods.getLatenessNs(2 * ms));
+}
+
+TEST(PeriodicTask, latencyStatistics) {
+  // real scheduling, so only what any machine guarantees is checked
+  PeriodicTaskManager taskManager;
+  LateTask task(&taskManager, 0.005f, "late-task");
+  task.start();
+  usleep(600000);
+  task.stop();
+
+  const LatencyHistogram& runtime = task.getRuntimeHistogram();
+  EXPECT_EQ((u64)task._counter, runtime.getCount());
+  EXPECT_GE(runtime.getMax(), 12500000u);
+
+  // each late run covers the start of at least two periods
+  int lateRuns = task._counter / 10;
+  EXPECT_GE(task.getMissedPeriods(), (u64)lateRuns);
+  EXPECT_EQ(runtime.getCount(), task.getWakeupHistogram().getCount());
+  if (lateRuns > 0) {
+    EXPECT_GE(task.getWakeupHistogram().getMax(), 2400000u);
+  }
+
+  // another program's view of the summary
+  taskManager.exportStatus("test-periodic-task-status");
+  SharedMemoryObject<PeriodicTaskStatusTable> view;
+  view.attach("test-periodic-task-status");
+  const PeriodicTaskStatusTable& table = view.getObject();
+  EXPECT_EQ(0u, table.sequence % 2);
+  ASSERT_EQ(1u, table.nTasks);
+  EXPECT_STREQ("late-task", table.tasks[0].name);
+  EXPECT_EQ(0u, table.tasks[0].running);
+  EXPECT_EQ(runtime.getCount(), table.tasks[0].runs);
+  EXPECT_EQ(task.getMissedPeriods(), table.tasks[0].missedPeriods);
+  EXPECT_EQ(runtime.getPercentile(99), table.tasks[0].runtime[1]);
+  EXPECT_EQ(runtime.getMax(), table.tasks[0].runtime[3]);
+}
+
+TEST(PeriodicTask, schedule) {
+  PeriodicTaskSchedule schedule;
+  EXPECT_EQ("inherit, cpu inherit", schedule.toString());
+  schedule.policy = SCHED_FIFO;
+  schedule.priority = 60;
+  schedule.cpus = {3, 0, 1, 5};
+  EXPECT_EQ("fifo 60, cpu 0-1,3,5", schedule.toString());
+
+  // the robot's schedules, for the tasks added before and after
+  PeriodicTaskManager taskManager;
+  TestPeriodicTask vis(&taskManager, 0.0167f, "lcm-vis");
+  taskManager.loadSchedules(
+      getConfigDirectoryPath("mini-cheetah-task-schedule.yaml"));
+  TestPeriodicTask spi(&taskManager, 0.002f, "spi");
+  EXPECT_EQ(SCHED_OTHER, vis.getSchedule().policy);
+  EXPECT_EQ(std::vector<int>({0, 1}), vis.getSchedule().cpus);
+  EXPECT_EQ(SCHED_FIFO, spi.getSchedule().policy);
+  EXPECT_EQ(60, spi.getSchedule().priority);
+  EXPECT_EQ(std::vector<int>({3}), spi.getSchedule().cpus);
+
+  // run on one of our CPUs, without real-time priority
+  cpu_set_t allowed;
+  ASSERT_EQ(0, sched_getaffinity(0, sizeof(allowed), &allowed));
+  int cpu = 0;
+  while (!CPU_ISSET(cpu, &allowed)) cpu++;
+  TestPeriodicTask task(&taskManager, 0.002f, "scheduled-task");
+  schedule.policy = SCHED_OTHER;
+  schedule.priority = 0;
+  schedule.cpus = {cpu};
+  taskManager.setSchedule("scheduled-task", schedule);
+  task.start();
+  EXPECT_EQ(SCHED_OTHER, task.getEffectiveSchedule().policy);
+  EXPECT_EQ(std::vector<int>({cpu}), task.getEffectiveSchedule().cpus);
+  task.stop();
+}
+
+class ChainTask : public PeriodicTask {
+ public:
+  ChainTask(PeriodicTaskManager* taskManager, float period, std::string name,
+            std::vector<std::string>* log)
+      : PeriodicTask(taskManager, period, name), _log(log) {}
+  std::vector<std::string>* _log;
+  double _minOffset = 1;
+  bool _init = false;
+  bool _cleanedUp = false;
+
+  void run() override {
+    _log->push_back(getName());
+    Timer now;
+    double offset = now._startTime.tv_sec + now._startTime.tv_nsec / 1e9 -
+                    getPeriodStartNs() / 1e9;
+    _minOffset = std::min(_minOffset, offset);
+  }
+  void init() override { _init = true; }
+  void cleanup() override { _cleanedUp = true; }
+};
+
+TEST(PeriodicTask, graph) {
+  PeriodicTaskManager taskManager;
+  std::vector<std::string> log;
+  ChainTask write(&taskManager, 0.01f, "write", &log);
+  ChainTask control(&taskManager, 0.005f, "control", &log);
+  ChainTask read(&taskManager, 0.005f, "read", &log);
+  ChainTask late(&taskManager, 0.005f, "late", &log);
+  PeriodicTaskGraph graph(&taskManager, 0.005f, "graph");
+
+  // added in any order, run in the order of the dependencies
+  graph.addTask(&late, {}, 0.002f);
+  graph.addTask(&write, {&control});
+  graph.addTask(&control, {&read});
+  graph.addTask(&read);
+  EXPECT_THROW(graph.addTask(&read), std::runtime_error);
+
+  // only the graph runs them
+  read.start();
+  EXPECT_FALSE(read.isRunning());
+  graph.start();
+  EXPECT_TRUE(read.isRunning() && read._init);
+  EXPECT_EQ(std::vector<PeriodicTask*>({&read, &control, &write, &late}),
+            graph.getOrder());
+  usleep(100000);
+  read.stop();  // stops the graph
+  EXPECT_FALSE(graph.isRunning());
+  EXPECT_FALSE(write.isRunning());
+  EXPECT_TRUE(write._cleanedUp);
+
+  // write runs every other period
+  ASSERT_GE(log.size(), 7u);
+  std::vector<std::string> periods(log.begin(), log.begin() + 7);
+  EXPECT_EQ(std::vector<std::string>({"read", "control", "write", "late",
+                                      "read", "control", "late"}),
+            periods);
+  EXPECT_EQ((control.getRuntimeHistogram().getCount() + 1) / 2,
+            write.getRuntimeHistogram().getCount());
+  EXPECT_GE(late._minOffset, 0.002);
+  EXPECT_EQ(graph.getEffectiveSchedule().policy,
+            late.getEffectiveSchedule().policy);
+
+  // tasks which wait for each other can't run
+  PeriodicTaskGraph cycle(&taskManager, 0.005f, "cycle");
+  ChainTask a(&taskManager, 0.005f, "a", &log);
+  ChainTask b(&taskManager, 0.005f, "b", &log);
+  cycle.addTask(&a, {&b});
+  cycle.addTask(&b, {&a});
+  EXPECT_THROW(cycle.start(), std::runtime_error);
+  EXPECT_THROW(cycle.addTask(&write), std::runtime_error);
+}
@@ -0,0 +1,97 @@
+/*! @file test_rt_spi.cpp
+ *  @brief Test the spine board SPI driver with its loopback device
+ */
+
+#ifdef linux
+
+#include <sched.h>
+#include <string.h>
+
+#include "rt/rt_spi.h"
+#include "Utilities/Timer.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+static spi_command_t makeCommand() {
+  spi_command_t command;
+  memset(&command, 0, sizeof(command));
+  for (int leg = 0; leg < 4; leg++) {
+    command.q_des_abad[leg] = 0.1f * leg - 0.2f;
+    command.q_des_hip[leg] = -0.8f + 0.05f * leg;
+    command.q_des_knee[leg] = 1.6f - 0.1f * leg;
+    command.qd_des_abad[leg] = 0.5f * leg;
+    command.qd_des_hip[leg] = -1.f;
+    command.qd_des_knee[leg] = 2.f + leg;
+    command.flags[leg] = 1 + leg;
+  }
+  return command;
+}
+
+TEST(RtSpi, loopback) {
+  spi_use_loopback(0);
+  spi_command_t command = makeCommand();
+  spi_data_t serial, concurrent;
+
+  // the data is the command, through the conversions of each board
+  spi_set_concurrent(false);
+  spi_send_receive(&command, &serial);
+  for (int leg = 0; leg < 4; leg++) {
+    EXPECT_NEAR(command.q_des_abad[leg], serial.q_abad[leg], 1e-5);
+    EXPECT_NEAR(command.q_des_hip[leg], serial.q_hip[leg], 1e-5);
+    EXPECT_NEAR(command.q_des_knee[leg], serial.q_knee[leg], 1e-5);
+    EXPECT_NEAR(command.qd_des_abad[leg], serial.qd_abad[leg], 1e-5);
+    EXPECT_NEAR(command.qd_des_hip[leg], serial.qd_hip[leg], 1e-5);
+    EXPECT_NEAR(command.qd_des_knee[leg], serial.qd_knee[leg], 1e-5);
+    EXPECT_EQ(command.flags[leg], serial.flags[leg]);
+  }
+
+  spi_set_concurrent(true);
+  spi_send_receive(&command, &concurrent);
+  EXPECT_EQ(serial.spi_driver_status + (1 << 16),
+            concurrent.spi_driver_status);
+  concurrent.spi_driver_status = serial.spi_driver_status;
+  EXPECT_EQ(0, memcmp(&serial, &concurrent, sizeof(serial)));
+}
+
+TEST(RtSpi, concurrentTransfers) {
+  // both boards take 2 ms, in parallel
+  spi_use_loopback(2000);
+  spi_command_t command = makeCommand();
+  spi_data_t data;
+  const int n = 20;
+
+  spi_set_concurrent(false);
+  Timer serialTimer;
+  for (int i = 0; i < n; i++) spi_send_receive(&command, &data);
+  double serial = serialTimer.getSeconds();
+
+  spi_set_concurrent(true);
+  Timer concurrentTimer;
+  for (int i = 0; i < n; i++) spi_send_receive(&command, &data);
+  double concurrent = concurrentTimer.getSeconds();
+
+  EXPECT_GE(serial, n * 0.004);
+  EXPECT_GE(concurrent, n * 0.002);
+  EXPECT_LT(concurrent, 0.75 * serial);
+  EXPECT_NEAR(command.q_des_knee[3], data.q_knee[3], 1e-5);
+}
+
+TEST(RtSpi, workerSchedule) {
+  spi_use_loopback(0);
+  spi_set_concurrent(true);
+  spi_command_t command = makeCommand();
+  spi_data_t data;
+
+  PeriodicTaskSchedule schedule;
+  schedule.policy = SCHED_OTHER;
+  schedule.cpus = {0};
+  spi_set_worker_schedule(schedule);
+  spi_send_receive(&command, &data);
+  PeriodicTaskSchedule effective = spi_get_worker_schedule();
+  EXPECT_EQ(SCHED_OTHER, effective.policy);
+  EXPECT_EQ(std::vector<int>{0}, effective.cpus);
+  EXPECT_NEAR(command.q_des_knee[3], data.q_knee[3], 1e-5);
+}
+
+#endif
@@ -0,0 +1,172 @@
+/*! @file test_simulation_script.cpp
+ *  @brief Test the parser of headless simulation scripts
+ */
+
+#include <stdio.h>
+
+#include "SimulationScript.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+static const char* scriptFile = "test_simulation_script.txt";
+
+class ScriptRobotParameters : public ControlParameters {
+ public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  ScriptRobotParameters()
+      : ControlParameters("script-robot-parameters"),
+        control_mode_param("control_mode", control_mode, collection),
+        gain_param("gain", gain, collection),
+        offset_param("offset", offset, collection) {}
+
+  double control_mode = 0;
+  ControlParameter control_mode_param;
+
+  double gain = 0;
+  ControlParameter gain_param;
+
+  Vec3<double> offset = Vec3<double>::Zero();
+  ControlParameter offset_param;
+};
+
+class ScriptUserParameters : public ControlParameters {
+ public:
+  ScriptUserParameters()
+      : ControlParameters("script-user-parameters"),
+        gain_param("gain", gain, collection) {}
+
+  double gain = 0;
+  ControlParameter gain_param;
+};
+
+static void writeScript(const char* text) {
+  FILE* f = fopen(scriptFile, "w");
+  ASSERT_TRUE(f);
+  fputs(text, f);
+  fclose(f);
+}
+
+TEST(SimulationScript, commentsAndBlankLines) {
+  writeScript(
+      "# time name values\n"
+      "\n"
+      "   \n"
+      "  # indented comment\n"
+      "0.5 a 1 # trailing comment\n"
+      "1.0 leftStickAnalog 0.25 -0.5\n");
+  SimulationScript script;
+  script.load(scriptFile);
+  EXPECT_EQ(2u, script.size());
+
+  GamepadCommand gamepad;
+  ScriptRobotParameters robotParams;
+  script.apply(2.0, gamepad, robotParams, nullptr);
+  EXPECT_TRUE(script.isDone());
+  EXPECT_TRUE(gamepad.a);
+  EXPECT_FLOAT_EQ(0.25f, gamepad.leftStickAnalog[0]);
+  EXPECT_FLOAT_EQ(-0.5f, gamepad.leftStickAnalog[1]);
+  remove(scriptFile);
+}
+
+TEST(SimulationScript, sortsByTime) {
+  writeScript(
+      "2.0 set control_mode 3\n"
+      "1.0 set control_mode 1\n"
+      "1.0 set control_mode 2\n"
+      "0.5 b 1\n");
+  SimulationScript script;
+  script.load(scriptFile);
+  ASSERT_EQ(4u, script.size());
+
+  GamepadCommand gamepad;
+  ScriptRobotParameters robotParams;
+
+  script.apply(0.4, gamepad, robotParams, nullptr);
+  EXPECT_EQ(0u, script.getPosition());
+  EXPECT_FALSE(gamepad.b);
+
+  script.apply(0.5, gamepad, robotParams, nullptr);
+  EXPECT_EQ(1u, script.getPosition());
+  EXPECT_TRUE(gamepad.b);
+
+  // events at the same time keep the order of the file
+  script.apply(1.5, gamepad, robotParams, nullptr);
+  EXPECT_EQ(3u, script.getPosition());
+  EXPECT_EQ(2, robotParams.control_mode);
+
+  script.apply(2.0, gamepad, robotParams, nullptr);
+  EXPECT_TRUE(script.isDone());
+  EXPECT_EQ(3, robotParams.control_mode);
+  remove(scriptFile);
+}
+
+TEST(SimulationScript, setParameters) {
+  writeScript(
+      "0 set offset [1, 2.5, -3]\n"
+      "0 set gain 4\n");
+  SimulationScript script;
+  script.load(scriptFile);
+
+  GamepadCommand gamepad;
+  ScriptRobotParameters robotParams;
+  ScriptUserParameters userParams;
+  script.apply(0, gamepad, robotParams, &userParams);
+  EXPECT_EQ(Vec3<double>(1, 2.5, -3), robotParams.offset);
+
+  // a user parameter hides the robot parameter with the same name
+  EXPECT_EQ(4, userParams.gain);
+  EXPECT_EQ(0, robotParams.gain);
+  remove(scriptFile);
+}
+
+TEST(SimulationScript, malformedLines) {
+  SimulationScript script;
+  EXPECT_THROW(script.load("does-not-exist.txt"), std::runtime_error);
+
+  writeScript("0 a 1\nsoon a 1\n");
+  try {
+    script.load(scriptFile);
+    FAIL() << "bad time was accepted";
+  } catch (const std::runtime_error& e) {
+    EXPECT_THAT(e.what(), ::testing::HasSubstr("line 2"));
+  }
+
+  writeScript("1.0\n");
+  EXPECT_THROW(script.load(scriptFile), std::runtime_error);
+  remove(scriptFile);
+}
+
+static std::string applyError(const char* text) {
+  writeScript(text);
+  SimulationScript script;
+  script.load(scriptFile);
+  GamepadCommand gamepad;
+  ScriptRobotParameters robotParams;
+  std::string error;
+  try {
+    script.apply(10, gamepad, robotParams, nullptr);
+  } catch (const std::runtime_error& e) {
+    error = e.what();
+  }
+  remove(scriptFile);
+  return error;
+}
+
+TEST(SimulationScript, badEvents) {
+  using ::testing::AllOf;
+  using ::testing::HasSubstr;
+  EXPECT_THAT(applyError("0 a 1\n0 a yes\n"),
+              AllOf(HasSubstr("line 2"), HasSubstr("yes")));
+  EXPECT_THAT(applyError("0 leftStickAnalog 0.5 1e999\n"),
+              AllOf(HasSubstr("line 1"), HasSubstr("1e999")));
+  EXPECT_THAT(applyError("0 b 0.5x\n"), HasSubstr("0.5x"));
+  EXPECT_THAT(applyError("0 leftStickAnalog 0.5\n"), HasSubstr("needs 2"));
+  EXPECT_THAT(applyError("0 jump 1\n"), HasSubstr("unknown input jump"));
+  EXPECT_THAT(applyError("0 set gain\n"), HasSubstr("line 1"));
+  EXPECT_THAT(applyError("0 set gain lots\n"),
+              AllOf(HasSubstr("line 1"), HasSubstr("lots")));
+  EXPECT_THAT(applyError("0 set offset 1\n"), HasSubstr("offset"));
+  EXPECT_THAT(applyError("0 set nothing 1\n"),
+              AllOf(HasSubstr("line 1"), HasSubstr("unknown parameter")));
+}
@@ -0,0 +1,186 @@
+/*! @file test_simulation_snapshot.cpp
+ *  @brief Test saving and restoring simulations
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+#include <cstring>
+
+#include "Dynamics/DynamicsSimulator.h"
+#include "Dynamics/MiniCheetah.h"
+#include "Dynamics/Quadruped.h"
+#include "SimUtilities/ImuSimulator.h"
+#include "SimUtilities/SimulationSnapshot.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+static FBModelState<double> dropping() {
+  FBModelState<double> state;
+  state.bodyOrientation << 1, 0, 0, 0;
+  state.bodyPosition = Vec3<double>(0, 0, 0.32);
+  state.bodyVelocity << 0.1, 0.2, 0, 0.3, 0, 0;
+  state.q = DVec<double>(12);
+  state.qd = DVec<double>::Zero(12);
+  for (int leg = 0; leg < 4; leg++) {
+    state.q[3 * leg] = 0;
+    state.q[3 * leg + 1] = -0.8;
+    state.q[3 * leg + 2] = 1.6;
+  }
+  return state;
+}
+
+// steps with a torque that depends on the step, sliding the feet on the floor
+static void run(DynamicsSimulator<double>& sim, int first, int n) {
+  for (int i = first; i < first + n; i++) {
+    DVec<double> tau = DVec<double>::Constant(12, 3 * std::sin(0.01 * i));
+    sim.step(0.0005, tau, 5e5, 5e3);
+  }
+}
+
+static void expectSameState(const FBModelState<double>& a,
+                            const FBModelState<double>& b) {
+  EXPECT_EQ(a.bodyOrientation, b.bodyOrientation);
+  EXPECT_EQ(a.bodyPosition, b.bodyPosition);
+  EXPECT_EQ(a.bodyVelocity, b.bodyVelocity);
+  EXPECT_EQ(a.q, b.q);
+  EXPECT_EQ(a.qd, b.qd);
+}
+
+TEST(SimulationSnapshot, dynamicsResumeBitExact) {
+  for (int mode = 0; mode < 4; mode++) {
+    FloatingBaseModel<double> modelA = buildMiniCheetah<double>().buildModel();
+    FloatingBaseModel<double> modelB = buildMiniCheetah<double>().buildModel();
+    bool springDamper = mode > 0;
+    DynamicsSimulator<double> a(modelA, springDamper), b(modelB, springDamper);
+    if (mode == 2) a.setIntegrator(DynamicsIntegrator::RK4);
+    if (mode == 2) b.setIntegrator(DynamicsIntegrator::RK4);
+    if (mode == 3) a.setAdaptiveSubsteps(8, 1e-7);
+    if (mode == 3) b.setAdaptiveSubsteps(8, 1e-7);
+    a.addCollisionPlane(0.4, 0, 0);
+    b.addCollisionPlane(0.4, 0, 0);
+    a.setState(dropping());
+
+    // b takes over from the middle of a's run
+    run(a, 0, 300);
+    DynamicsSimulatorSnapshot<double> snapshot;
+    a.saveSnapshot(snapshot);
+    run(a, 300, 300);
+    b.restoreSnapshot(snapshot);
+    run(b, 300, 300);
+    expectSameState(a.getState(), b.getState());
+    EXPECT_EQ(a.getDState().qdd, b.getDState().qdd);
+
+    // and a goes back
+    a.restoreSnapshot(snapshot);
+    run(a, 300, 300);
+    expectSameState(a.getState(), b.getState());
+  }
+}
+
+TEST(SimulationSnapshot, differentContact) {
+  FloatingBaseModel<double> modelA = buildMiniCheetah<double>().buildModel();
+  FloatingBaseModel<double> modelB = buildMiniCheetah<double>().buildModel();
+  DynamicsSimulator<double> a(modelA, false), b(modelB, true);
+  DynamicsSimulatorSnapshot<double> snapshot;
+  a.saveSnapshot(snapshot);
+  EXPECT_THROW(b.restoreSnapshot(snapshot), std::runtime_error);
+}
+
+TEST(SimulationSnapshot, imuNoise) {
+  SimulatorControlParameters params;
+  params.vectornav_imu_accelerometer_noise = 0.01;
+  params.vectornav_imu_gyro_noise = 0.01;
+  params.vectornav_imu_quat_noise = 0.01;
+  ImuSimulator<double> a(params, 7), b(params, 3);
+  FBModelState<double> state = dropping();
+  FBModelStateDerivative<double> dstate;
+  dstate.dBodyPosition.setZero();
+  dstate.dBodyVelocity.setZero();
+  dstate.qdd = DVec<double>::Zero(12);
+
+  VectorNavData dataA, dataB;
+  a.updateVectornav(state, dstate, &dataA);
+  b.setRandomState(a.getRandomState());
+  for (int i = 0; i < 10; i++) {
+    a.updateVectornav(state, dstate, &dataA);
+    b.updateVectornav(state, dstate, &dataB);
+    EXPECT_EQ(dataA.gyro, dataB.gyro);
+    EXPECT_EQ(dataA.accelerometer, dataB.accelerometer);
+    EXPECT_EQ(dataA.quat, dataB.quat);
+  }
+  EXPECT_THROW(b.setRandomState("not a state"), std::runtime_error);
+}
+
+TEST(SimulationSnapshot, file) {
+  const char* fileName = "test_simulation_snapshot.bin";
+  FloatingBaseModel<double> model = buildMiniCheetah<double>().buildModel();
+  DynamicsSimulator<double> sim(model, true);
+  sim.addCollisionPlane(0.4, 0, 0);
+  sim.setState(dropping());
+  run(sim, 0, 200);
+
+  SimulationSnapshot saved;
+  saved.time = 0.1;
+  saved.timeOfNextLowLevelControl = 0.1002;
+  saved.timeOfNextHighLevelControl = 0.102;
+  saved.highLevelIterations = 50;
+  saved.scriptPosition = 3;
+  sim.saveSnapshot(saved.dynamics);
+  saved.tau = DVec<double>::Constant(12, 1.5);
+  memset(&saved.spiData, 0, sizeof(saved.spiData));
+  memset(&saved.spiCommand, 0, sizeof(saved.spiCommand));
+  saved.spiData.q_knee[2] = 1.25f;
+  saved.spiCommand.kp_hip[1] = 20.f;
+  for (int leg = 0; leg < 4; leg++) {
+    for (int joint = 0; joint < 3; joint++)
+      saved.spineTorque[leg][joint] = leg - 0.5f * joint;
+    saved.spineIterations[leg] = 100 + leg;
+  }
+  saved.imuRandomState = "1 2 3";
+  saved.gamepad.a = true;
+  saved.gamepad.leftStickAnalog << 0.5f, -0.25f;
+  saved.save(fileName);
+
+  SimulationSnapshot loaded;
+  loaded.load(fileName);
+  EXPECT_EQ(saved.time, loaded.time);
+  EXPECT_EQ(saved.timeOfNextLowLevelControl, loaded.timeOfNextLowLevelControl);
+  EXPECT_EQ(saved.timeOfNextHighLevelControl,
+            loaded.timeOfNextHighLevelControl);
+  EXPECT_EQ(saved.highLevelIterations, loaded.highLevelIterations);
+  EXPECT_EQ(saved.scriptPosition, loaded.scriptPosition);
+  expectSameState(saved.dynamics.state, loaded.dynamics.state);
+  EXPECT_EQ(saved.dynamics.dstate.qdd, loaded.dynamics.dstate.qdd);
+  ASSERT_EQ(saved.dynamics.tangentialDeflections.size(),
+            loaded.dynamics.tangentialDeflections.size());
+  for (size_t i = 0; i < saved.dynamics.tangentialDeflections.size(); i++)
+    EXPECT_EQ(saved.dynamics.tangentialDeflections[i],
+              loaded.dynamics.tangentialDeflections[i]);
+  EXPECT_EQ(saved.tau, loaded.tau);
+  EXPECT_EQ(0, memcmp(&saved.spiData, &loaded.spiData, sizeof(SpiData)));
+  EXPECT_EQ(0,
+            memcmp(&saved.spiCommand, &loaded.spiCommand, sizeof(SpiCommand)));
+  EXPECT_EQ(0, memcmp(saved.spineTorque, loaded.spineTorque,
+                      sizeof(saved.spineTorque)));
+  EXPECT_EQ(0, memcmp(saved.spineIterations, loaded.spineIterations,
+                      sizeof(saved.spineIterations)));
+  EXPECT_EQ(saved.imuRandomState, loaded.imuRandomState);
+  EXPECT_TRUE(loaded.gamepad.a);
+  EXPECT_EQ(saved.gamepad.leftStickAnalog, loaded.gamepad.leftStickAnalog);
+
+  // the restored simulator goes on like the original
+  FloatingBaseModel<double> model2 = buildMiniCheetah<double>().buildModel();
+  DynamicsSimulator<double> sim2(model2, true);
+  sim2.addCollisionPlane(0.4, 0, 0);
+  sim2.restoreSnapshot(loaded.dynamics);
+  run(sim, 200, 100);
+  run(sim2, 200, 100);
+  expectSameState(sim.getState(), sim2.getState());
+
+  // truncated file
+  ASSERT_EQ(0, truncate(fileName, 100));
+  EXPECT_THROW(loaded.load(fileName), std::runtime_error);
+  remove(fileName);
+  EXPECT_THROW(loaded.load(fileName), std::runtime_error);
+}
@@ -0,0 +1,85 @@
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include "SparseCMPC/SparseCMPC.h"
+#include "Math/orientation_tools.h"
+
+// trotting in place, yaw given by the orientation
+static void setupTrot(SparseCMPC& mpc, double yaw, int offset) {
+  const int horizon = 10;
+  Mat3<double> inertia;
+  inertia << 0.07, 0, 0, 0, 0.26, 0, 0, 0, 0.242;
+  Vec12<double> weights;
+  weights << 0.25, 0.25, 10, 2, 2, 20, 0, 0, 0.3, 0.2, 0.2, 0.2;
+  std::vector<double> dt(horizon, 0.03);
+  mpc.setRobotParameters(inertia, 9., 120.);
+  mpc.setFriction(0.4);
+  mpc.setWeights(weights, 4e-5);
+  mpc.setDtTrajectory(dt);
+
+  Vec3<double> p(0, 0, 0.29), v(0.1, 0, 0), w(0, 0, 0);
+  Vec3<double> rpy(0, 0, yaw);
+  Vec4<double> q = ori::rpyToQuat(rpy);
+  mpc.setX0(p, v, q, w);
+
+  std::vector<ContactState> contacts;
+  vectorAligned<Vec12<double>> traj;
+  for (int i = 0; i < horizon; i++) {
+    bool a = ((i + offset) / 5) % 2 == 0;
+    contacts.emplace_back(a, !a, !a, a);
+    Vec12<double> x;
+    x << 0, 0, yaw, 0.1 * 0.03 * i, 0, 0.29, 0, 0, 0, 0.1, 0, 0;
+    traj.push_back(x);
+  }
+  mpc.setContactTrajectory(contacts.data(), contacts.size());
+  mpc.setStateTrajectory(traj);
+
+  Vec12<double> feet;
+  feet << 0.19, -0.11, -0.29, 0.19, 0.11, -0.29, -0.19, -0.11, -0.29, -0.19,
+      0.11, -0.29;
+  mpc.setFeet(feet);
+}
+
+TEST(SparseCMPC, jcqpFactorizationCache) {
+  SparseCMPC mpc;
+  mpc.setSolver(SparseCMPCSolver::JCQP);
+
+  // same contacts, different yaw: only the first solve sets up the KKT
+  // factorization, even though a yaw of exactly 0 has zeros in the dynamics
+  setupTrot(mpc, 0., 0);
+  mpc.run();
+  setupTrot(mpc, 0.3, 0);
+  mpc.run();
+  Vec12<float> cached = mpc.getResult();
+  EXPECT_EQ(1u, mpc.getFactorCacheHits());
+  EXPECT_EQ(1u, mpc.getFactorCacheMisses());
+
+  // new contact sequence
+  setupTrot(mpc, 0.3, 2);
+  mpc.run();
+  EXPECT_EQ(1u, mpc.getFactorCacheHits());
+  EXPECT_EQ(2u, mpc.getFactorCacheMisses());
+
+  // back to the first one, and the same result as without the cache
+  setupTrot(mpc, 0.3, 0);
+  mpc.run();
+  EXPECT_EQ(2u, mpc.getFactorCacheHits());
+  EXPECT_EQ(2u, mpc.getFactorCacheMisses());
+  Vec12<float> result = mpc.getResult();
+
+  mpc.clearFactorCache();
+  setupTrot(mpc, 0.3, 0);
+  mpc.run();
+  EXPECT_EQ(0u, mpc.getFactorCacheHits());
+  EXPECT_EQ(1u, mpc.getFactorCacheMisses());
+  Vec12<float> uncached = mpc.getResult();
+  for (int i = 0; i < 12; i++) {
+    EXPECT_NEAR(uncached[i], cached[i], 1e-3);
+    EXPECT_NEAR(uncached[i], result[i], 1e-3);
+  }
+
+  // the feet in contact hold the robot up
+  float fz = 0;
+  for (int foot = 0; foot < 4; foot++) fz += uncached[3 * foot + 2];
+  EXPECT_NEAR(9. * 9.81, fz, 10.);
+}
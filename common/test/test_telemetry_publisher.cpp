@@ -0,0 +1,139 @@
+/*! @file test_telemetry_publisher.cpp
+ *  @brief Test the lock-free ring and the telemetry publisher
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <thread>
+#include <vector>
+
+#include "Utilities/SpscRing.h"
+#include "Utilities/TelemetryPublisher.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+struct TestMessage {
+  u64 sequence;
+  double payload[32];
+};
+
+TEST(SpscRing, fullAndEmpty) {
+  SpscRing<int> ring(5);
+  EXPECT_EQ(8u, ring.capacity());
+  int value;
+  EXPECT_FALSE(ring.pop(value));
+  for (int i = 0; i < 8; i++) EXPECT_TRUE(ring.push(i));
+  EXPECT_FALSE(ring.push(8));
+  EXPECT_EQ(8u, ring.size());
+  for (int i = 0; i < 8; i++) {
+    ASSERT_TRUE(ring.pop(value));
+    EXPECT_EQ(i, value);
+  }
+  EXPECT_FALSE(ring.pop(value));
+}
+
+TEST(SpscRing, twoThreads) {
+  SpscRing<TestMessage> ring(16);
+  const u64 n = 200000;
+  std::thread producer([&] {
+    TestMessage msg;
+    for (u64 i = 0; i < n; i++) {
+      msg.sequence = i;
+      for (auto& x : msg.payload) x = i;
+      while (!ring.push(msg)) std::this_thread::yield();
+    }
+  });
+
+  TestMessage msg;
+  u64 expected = 0;
+  while (expected < n) {
+    if (!ring.pop(msg)) {
+      std::this_thread::yield();
+      continue;
+    }
+    ASSERT_EQ(expected, msg.sequence);
+    for (auto& x : msg.payload) ASSERT_EQ((double)expected, x);
+    expected++;
+  }
+  producer.join();
+  EXPECT_EQ(0u, ring.size());
+}
+
+TEST(TelemetryPublisher, dropsWhenFull) {
+  TelemetryPublisher publisher("test");
+  std::vector<u64> sent;
+  auto* channel = publisher.addChannel<TestMessage>(
+      "test_channel", 4,
+      [&](const TestMessage& msg) { sent.push_back(msg.sequence); });
+
+  // not started: the ring fills up
+  TestMessage msg;
+  for (u64 i = 0; i < 10; i++) {
+    msg.sequence = i;
+    EXPECT_EQ(i < 4, channel->push(msg));
+  }
+  EXPECT_EQ(10u, channel->getPushedCount());
+  EXPECT_EQ(6u, channel->getDroppedCount());
+  EXPECT_EQ(6u, publisher.getDroppedCount());
+  EXPECT_EQ(4u, publisher.publishPending());
+  EXPECT_EQ(std::vector<u64>({0, 1, 2, 3}), sent);
+  EXPECT_EQ(4u, channel->getPublishedCount());
+}
+
+TEST(TelemetryPublisher, publishesInOrder) {
+  TelemetryPublisher publisher("test", 0.0005);
+  std::vector<u64> sentA, sentB;
+  auto* a = publisher.addChannel<TestMessage>(
+      "a", 64, [&](const TestMessage& msg) { sentA.push_back(msg.sequence); });
+  auto* b = publisher.addChannel<u64>(
+      "b", 64, [&](const u64& msg) { sentB.push_back(msg); });
+  publisher.start();
+
+  TestMessage msg;
+  u64 dropped = 0;
+  for (u64 i = 0; i < 2000; i++) {
+    msg.sequence = i;
+    if (!a->push(msg)) dropped++;
+    b->push(i);
+    if (i % 32 == 0) std::this_thread::sleep_for(std::chrono::microseconds(500));
+  }
+  publisher.stop();  // sends what is left
+
+  EXPECT_EQ(dropped, a->getDroppedCount());
+  EXPECT_EQ(2000u, sentA.size() + dropped);
+  EXPECT_EQ(2000u, sentB.size() + b->getDroppedCount());
+  for (size_t i = 1; i < sentA.size(); i++) EXPECT_LT(sentA[i - 1], sentA[i]);
+  for (size_t i = 1; i < sentB.size(); i++) EXPECT_LT(sentB[i - 1], sentB[i]);
+}
+
+#ifdef linux
+TEST(TelemetryPublisher, doesNotInheritRealTimePolicy) {
+  // start the publisher from a FIFO thread, like the hardware bridge does
+  // (skipped if this process may not use real-time policies)
+  TelemetryPublisher publisher("test");
+  bool fifo = false;
+  std::thread starter([&] {
+    sched_param param;
+    param.sched_priority = 10;
+    fifo = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0;
+    publisher.start();
+  });
+  starter.join();
+  EXPECT_EQ(SCHED_OTHER, publisher.getEffectiveSchedule().policy);
+  EXPECT_EQ(0, publisher.getEffectiveSchedule().priority);
+  publisher.stop();
+  if (!fifo) printf("[ SKIPPED  ] starting thread could not be SCHED_FIFO\n");
+
+  // CPUs from a schedule, policy left to inherit is still SCHED_OTHER
+  PeriodicTaskSchedule schedule;
+  schedule.cpus = {0};
+  TelemetryPublisher::setDefaultSchedule(schedule);
+  TelemetryPublisher pinned("test");
+  TelemetryPublisher::setDefaultSchedule(PeriodicTaskSchedule());
+  pinned.start();
+  EXPECT_EQ(SCHED_OTHER, pinned.getEffectiveSchedule().policy);
+  EXPECT_EQ(std::vector<int>({0}), pinned.getEffectiveSchedule().cpus);
+  pinned.stop();
+}
+#endif
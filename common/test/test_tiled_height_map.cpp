@@ -0,0 +1,217 @@
+/*! @file test_tiled_height_map.cpp
+ *  @brief Test the memory mapped, tiled height map
+ *
+ * Writes small maps with small tiles and a small cache, so walking over them
+ * loads and evicts many tiles.
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <cmath>
+#include <limits>
+#include <random>
+
+#include "Collision/CollisionTiledHeightMap.h"
+#include "Dynamics/DynamicsSimulator.h"
+#include "Dynamics/MiniCheetah.h"
+#include "Dynamics/Quadruped.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+static const char* testFile = "test_tiled_height_map.bin";
+
+static float bumps(size_t i, size_t j) {
+  return 0.2f * std::sin(0.13f * i) * std::cos(0.07f * j) + 0.001f * j;
+}
+
+TEST(TiledHeightMap, bilinearEverywhere) {
+  const size_t rows = 103, cols = 61;
+  const double grid = 0.05;
+  const Vec3<double> corner(-2, 1, 0.3);
+  CollisionTiledHeightMap<double>::writeFile(testFile, rows, cols, grid,
+                                             corner, 8, bumps);
+  CollisionTiledHeightMap<double> map(0.7, 0, testFile, 4);
+
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<double> dist(0., 1.);
+  for (int k = 0; k < 20000; k++) {
+    double u = dist(rng) * (rows - 1), v = dist(rng) * (cols - 1);
+    if (k < 1000) {  // on the samples, including the ones between tiles
+      u = std::floor(u);
+      v = std::floor(v);
+    }
+    size_t i = (size_t)u, j = (size_t)v;
+    double fx = u - i, fy = v - j;
+    double expected =
+        corner[2] + (1 - fx) * (1 - fy) * bumps(i, j) +
+        fx * (1 - fy) * bumps(i + 1, j) + (1 - fx) * fy * bumps(i, j + 1) +
+        fx * fy * bumps(i + 1, j + 1);
+
+    double height;
+    Vec3<double> normal;
+    ASSERT_TRUE(map.getHeight(corner[0] + u * grid, corner[1] + v * grid,
+                              height, normal));
+    EXPECT_NEAR(expected, height, 1e-6);
+    EXPECT_NEAR(1, normal.norm(), 1e-9);
+    EXPECT_GT(normal[2], 0);
+  }
+
+  // 13 x 8 tiles through a cache of 4
+  EXPECT_GT(map.getTileLoads(), 100u);
+
+  double height;
+  Vec3<double> normal;
+  EXPECT_FALSE(map.getHeight(corner[0] - 0.01, corner[1] + 1, height, normal));
+  EXPECT_FALSE(map.getHeight(corner[0] + 1, corner[1] + cols * grid, height,
+                             normal));
+  remove(testFile);
+}
+
+TEST(TiledHeightMap, slopeContact) {
+  // a plane: z = 0.1 x - 0.2 y, stored as floats
+  const double grid = 0.1;
+  CollisionTiledHeightMap<double>::writeFile(
+      testFile, 50, 40, grid, Vec3<double>::Zero(), 16,
+      [&](size_t i, size_t j) { return 0.1 * grid * i - 0.2 * grid * j; });
+  CollisionTiledHeightMap<double> map(0.7, 0, testFile);
+
+  Vec3<double> expectedNormal = Vec3<double>(-0.1, 0.2, 1).normalized();
+  Vec3<double> p(2.34, 1.56, 0.1 * 2.34 - 0.2 * 1.56 - 0.01);
+  double penetration;
+  Mat3<double> frame;
+  ASSERT_TRUE(map.ContactDetection(p, penetration, frame));
+  EXPECT_NEAR(-0.01 * expectedNormal[2], penetration, 1e-6);
+  EXPECT_TRUE((frame.col(2) - expectedNormal).norm() < 1e-6);
+  EXPECT_TRUE((frame.transpose() * frame - Mat3<double>::Identity()).norm() <
+              1e-9);
+  EXPECT_NEAR(1, frame.determinant(), 1e-9);
+
+  p[2] += 0.02;
+  EXPECT_FALSE(map.ContactDetection(p, penetration, frame));
+
+  Vec3<double> lo, hi;
+  ASSERT_TRUE(map.getBoundingBox(lo, hi));
+  EXPECT_NEAR(4.9, hi[0], 1e-9);
+  EXPECT_NEAR(3.9, hi[1], 1e-9);
+  remove(testFile);
+}
+
+TEST(TiledHeightMap, badFile) {
+  FILE* f = fopen(testFile, "w");
+  fprintf(f, "0 0 0\n0 0 0\n");
+  fclose(f);
+  EXPECT_THROW(CollisionTiledHeightMap<double>(0.7, 0, testFile),
+               std::runtime_error);
+  remove(testFile);
+  EXPECT_THROW(CollisionTiledHeightMap<double>(0.7, 0, testFile),
+               std::runtime_error);
+}
+
+/*!
+ * Write a small map, then overwrite one field of its header
+ */
+template <typename V>
+static void writeBadHeader(size_t offset, V value) {
+  CollisionTiledHeightMap<double>::writeFile(
+      testFile, 21, 21, 0.1, Vec3<double>::Zero(), 4,
+      [](size_t, size_t) { return 0.f; });
+  FILE* f = fopen(testFile, "r+b");
+  ASSERT_TRUE(f);
+  fseek(f, offset, SEEK_SET);
+  fwrite(&value, sizeof(value), 1, f);
+  fclose(f);
+}
+
+TEST(TiledHeightMap, badHeader) {
+  const u64 huge = 1ull << 62;
+  const double nan = std::numeric_limits<double>::quiet_NaN();
+  auto expectBad = [](const char* what) {
+    EXPECT_THROW(CollisionTiledHeightMap<double>(0.7, 0, testFile),
+                 std::runtime_error)
+        << what;
+  };
+
+  // the same number of rows, still a good map
+  writeBadHeader(offsetof(TiledHeightMapHeader, rows), (u64)21);
+  EXPECT_NO_THROW(CollisionTiledHeightMap<double>(0.7, 0, testFile));
+
+  writeBadHeader(offsetof(TiledHeightMapHeader, grid), 0.);
+  expectBad("zero grid");
+  writeBadHeader(offsetof(TiledHeightMapHeader, grid), -0.1);
+  expectBad("negative grid");
+  writeBadHeader(offsetof(TiledHeightMapHeader, grid), nan);
+  expectBad("NaN grid");
+  writeBadHeader(offsetof(TiledHeightMapHeader, leftCorner), nan);
+  expectBad("NaN corner");
+  writeBadHeader(offsetof(TiledHeightMapHeader, rows), (u64)0);
+  expectBad("no rows");
+  writeBadHeader(offsetof(TiledHeightMapHeader, cols), (u64)1);
+  expectBad("one column");
+  writeBadHeader(offsetof(TiledHeightMapHeader, tileSize), (u64)0);
+  expectBad("empty tiles");
+
+  // sizes which only fit in the file after wrapping around
+  writeBadHeader(offsetof(TiledHeightMapHeader, tileSize), huge);
+  expectBad("huge tiles");
+  writeBadHeader(offsetof(TiledHeightMapHeader, rows), huge);
+  expectBad("huge rows");
+  writeBadHeader(offsetof(TiledHeightMapHeader, tileStride), huge);
+  expectBad("huge stride");
+  writeBadHeader(offsetof(TiledHeightMapHeader, dataOffset), ~(u64)0);
+  expectBad("huge offset");
+  remove(testFile);
+
+  EXPECT_THROW(CollisionTiledHeightMap<double>::writeFile(
+                   testFile, 21, 21, 0, Vec3<double>::Zero(), 4,
+                   [](size_t, size_t) { return 0.f; }),
+               std::runtime_error);
+}
+
+TEST(TiledHeightMap, prefetchOnlyNewTiles) {
+  // 10 x 10 tiles of 1 m
+  CollisionTiledHeightMap<double>::writeFile(
+      testFile, 101, 101, 0.1, Vec3<double>::Zero(), 10,
+      [](size_t, size_t) { return 0.f; });
+  CollisionTiledHeightMap<double> map(0.7, 0, testFile);
+
+  map.prefetch(Vec3<double>(4.5, 4.5, 0), 1);  // tiles 3 to 5 along x and y
+  EXPECT_EQ(9u, map.getTilePrefetches());
+  map.prefetch(Vec3<double>(4.7, 4.4, 0), 1);  // same tiles
+  EXPECT_EQ(9u, map.getTilePrefetches());
+  map.prefetch(Vec3<double>(5.5, 4.5, 0), 1);  // tiles 4 to 6 along x
+  EXPECT_EQ(12u, map.getTilePrefetches());
+  map.prefetch(Vec3<double>(-5, 4.5, 0), 1);  // off the map
+  EXPECT_EQ(12u, map.getTilePrefetches());
+  map.prefetch(Vec3<double>(0.2, 9.8, 0), 1);  // corner, 2 x 2 tiles
+  EXPECT_EQ(16u, map.getTilePrefetches());
+  EXPECT_EQ(0u, map.getTileLoads());
+  remove(testFile);
+}
+
+TEST(TiledHeightMap, simulatorPrefetchesAroundBody) {
+  // 20 x 20 tiles of 1 m, flat at z = 0
+  CollisionTiledHeightMap<double>::writeFile(
+      testFile, 201, 201, 0.1, Vec3<double>(-10, -10, 0), 10,
+      [](size_t, size_t) { return 0.f; });
+  CollisionTiledHeightMap<double> map(0.7, 0, testFile);
+
+  FloatingBaseModel<double> model = buildMiniCheetah<double>().buildModel();
+  DynamicsSimulator<double> sim(model, true);
+  sim.addCollision(&map);
+  FBModelState<double> state;
+  state.bodyOrientation << 1, 0, 0, 0;
+  state.bodyPosition = Vec3<double>(0.5, 0.5, 0.4);
+  state.bodyVelocity.setZero();
+  state.q = DVec<double>::Zero(12);
+  state.qd = DVec<double>::Zero(12);
+  sim.setState(state);
+
+  DVec<double> tau = DVec<double>::Zero(12);
+  sim.step(1e-3, tau, 5e5, 5e3);
+  u64 prefetches = map.getTilePrefetches();
+  EXPECT_GT(prefetches, 0u);
+  sim.step(1e-3, tau, 5e5, 5e3);  // hasn't moved to other tiles
+  EXPECT_EQ(prefetches, map.getTilePrefetches());
+  remove(testFile);
+}
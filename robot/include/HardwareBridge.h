@@ -24,6 +24,8 @@
 #include "Utilities/PeriodicTask.h"
 #ifdef LCM_MSG
 #include <lcm/lcm-cpp.hpp>
+#include "Utilities/TelemetryPublisher.h"
+#include "rt/rt_spi.h"
 #include "control_parameter_request_lcmt.hpp"
 #include "control_parameter_respones_lcmt.hpp"
 #include "gamepad_lcmt.hpp"
@@ -126,15 +128,24 @@ class MiniCheetahHardwareBridge : public HardwareBridge {
   VectorNavData _vectorNavData;
 #ifdef LCM_MSG
   lcm::LCM _spiLcm;
+  TelemetryChannel<spi_data_t>* _spiDataChannel = nullptr;
+  TelemetryChannel<spi_command_t>* _spiCommandChannel = nullptr;
 #endif
 #ifdef USE_MICROSTRAIN
   lcm::LCM _microstrainLcm;
+  TelemetryChannel<microstrain_lcmt>* _microstrainChannel = nullptr;
   std::thread _microstrainThread;
   LordImu _microstrainImu;
   microstrain_lcmt _microstrainData;
   bool _microstrainInit = false;
 #endif
   bool _load_parameters_from_file;
+#ifdef LCM_MSG
+  // spi and microstrain messages are sent from here, not from their tasks.
+  // Declared after every lcm::LCM it publishes through: members are destroyed
+  // in reverse order, and its destructor sends what is left in the rings.
+  TelemetryPublisher _telemetry{"hardware-telemetry"};
+#endif
 };
 
 #ifdef CHEETAH3
@@ -0,0 +1,125 @@
+/*! @file HeadlessSimulation.h
+ *  @brief Runs a RobotController and the simulator in the same process,
+ * without graphics.
+ *
+ * The simulator and the controller take turns in lockstep (no shared memory,
+ * no semaphores, no wall clock), so a run only depends on its inputs and goes
+ * as fast as the CPU allows.  Meant for regression runs of many scenarios:
+ * a terrain file, a script of gamepad inputs (see SimulationScript) and a
+ * trajectory log.
+ *
+ * A run can be saved and restored with snapshot and restore, and copied with
+ * fork, to try other gains or inputs from the middle of a run.
+ */
+
+#ifndef PROJECT_HEADLESSSIMULATION_H
+#define PROJECT_HEADLESSSIMULATION_H
+
+#include <stdio.h>
+#include <sys/types.h>
+#include <string>
+#include <vector>
+
+#include "ControlParameters/RobotParameters.h"
+#include "ControlParameters/SimulatorParameters.h"
+#include "Dynamics/DynamicsSimulator.h"
+#include "Dynamics/Quadruped.h"
+#include "RobotRunner.h"
+#include "SimUtilities/ImuSimulator.h"
+#include "SimUtilities/SimulationSnapshot.h"
+#include "SimUtilities/SimulatorMessage.h"
+#include "SimUtilities/SpineBoard.h"
+#include "SimulationScript.h"
+#include "Utilities/PeriodicTask.h"
+
+class HeadlessSimulation {
+ public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  HeadlessSimulation(RobotType robot, RobotController* robot_ctrl);
+  ~HeadlessSimulation();
+  HeadlessSimulation(const HeadlessSimulation&) = delete;
+  HeadlessSimulation& operator=(const HeadlessSimulation&) = delete;
+
+  void loadTerrainFile(const std::string& terrainFileName);
+  void loadScript(const std::string& scriptFileName);
+  void openLog(const std::string& logFileName, double logPeriod);
+  void run(double duration);
+
+  SimulationSnapshot snapshot() const;
+  void restore(const SimulationSnapshot& snapshot);
+  size_t fork(size_t copies);
+  int waitForForks();
+
+  /*!
+   * Explicitly set the state of the robot
+   */
+  void setRobotState(const FBModelState<double>& state) {
+    _simulator->setState(state);
+  }
+
+  /*!
+   * @return state of the simulated robot
+   */
+  const FBModelState<double>& getRobotState() { return _simulator->getState(); }
+
+  /*!
+   * @return simulated time (s)
+   */
+  double getTime() const { return _currentSimTime; }
+
+  /*!
+   * @return number of times the controller ran
+   */
+  u64 getControllerIterations() const { return _highLevelIterations; }
+
+  SimulatorControlParameters& getSimParams() { return _simParams; }
+  RobotControlParameters& getRobotParams() { return _robotParams; }
+
+ private:
+  void step(double dt, double dtLowLevelControl, double dtHighLevelControl);
+  void lowLevelControl();
+  void highLevelControl();
+  void writeLog();
+  void closeLog();
+
+  RobotType _robot;
+  RobotController* _robotCtrl;
+  PeriodicTaskManager _taskManager;
+  RobotRunner* _robotRunner = nullptr;
+
+  SimulatorControlParameters _simParams;
+  RobotControlParameters _robotParams;
+  ControlParameters* _userParams = nullptr;
+
+  Quadruped<double> _quadruped;
+  FloatingBaseModel<double> _model;
+  DynamicsSimulator<double>* _simulator = nullptr;
+  ImuSimulator<double>* _imuSimulator = nullptr;
+  std::vector<ActuatorModel<double>> _actuatorModels;
+  SpineBoard _spineBoards[4];
+  SpiData _spiData;
+  SpiCommand _spiCommand;
+  DVec<double> _tau;
+
+  // what would be in shared memory with the graphical simulator
+  SimulatorToRobotMessage _simToRobot;
+  RobotToSimulatorMessage _robotToSim;
+
+  SimulationScript _script;
+  GamepadCommand _gamepad;
+
+  FILE* _log = nullptr;
+  double _logPeriod = 0;
+  double _timeOfNextLog = 0;
+  u64 _logSamples = 0;
+
+  double _currentSimTime = 0;
+  double _timeOfNextLowLevelControl = 0;
+  double _timeOfNextHighLevelControl = 0;
+  u64 _highLevelIterations = 0;
+  bool _robotRunnerInitialized = false;
+
+  std::vector<pid_t> _forks;
+};
+
+#endif  // PROJECT_HEADLESSSIMULATION_H
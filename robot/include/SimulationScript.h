@@ -0,0 +1,71 @@
+/*! @file SimulationScript.h
+ *  @brief Timed gamepad inputs and parameter changes for headless simulation
+ *
+ * A script is a text file with one event per line:
+ *
+ *   # time  name                values
+ *   0.0     set control_mode    1
+ *   1.5     leftStickAnalog     0 0.5
+ *   3.0     a                   1
+ *
+ * "set" changes a user parameter (or a robot parameter if there is no user
+ * parameter with that name), with the same syntax as the yaml files.  All
+ * other names are fields of GamepadCommand.  Values hold until the next event
+ * on the same field.
+ */
+
+#ifndef PROJECT_SIMULATIONSCRIPT_H
+#define PROJECT_SIMULATIONSCRIPT_H
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "ControlParameters/ControlParameters.h"
+#include "SimUtilities/GamepadCommand.h"
+
+class SimulationScript {
+ public:
+  void load(const std::string& fileName);
+  void apply(double time, GamepadCommand& gamepad,
+             ControlParameters& robotParams, ControlParameters* userParams);
+
+  /*!
+   * @return true if all events have been applied
+   */
+  bool isDone() const { return _nextEvent == _events.size(); }
+
+  /*!
+   * @return number of events in the script
+   */
+  size_t size() const { return _events.size(); }
+
+  /*!
+   * @return index of the next event to apply
+   */
+  size_t getPosition() const { return _nextEvent; }
+
+  /*!
+   * Go to an earlier (or later) event, without applying anything
+   */
+  void setPosition(size_t nextEvent) {
+    _nextEvent = std::min(nextEvent, _events.size());
+  }
+
+ private:
+  struct Event {
+    double time;
+    std::string name;
+    std::vector<std::string> values;
+    int line;
+  };
+
+  void applyEvent(const Event& event, GamepadCommand& gamepad,
+                  ControlParameters& robotParams,
+                  ControlParameters* userParams);
+
+  std::vector<Event> _events;
+  size_t _nextEvent = 0;
+};
+
+#endif  // PROJECT_SIMULATIONSCRIPT_H
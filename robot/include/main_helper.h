@@ -11,5 +11,6 @@
 
 extern MasterConfig gMasterConfig;
 int main_helper(int argc, char** argv, RobotController* ctrl);
+int headless_main_helper(int argc, char** argv, RobotController* ctrl);
 
 #endif  // ROBOT_MAIN_H
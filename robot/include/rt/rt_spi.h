@@ -27,6 +27,8 @@ extern "C" {
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>  //Needed for SPI port
+
+#include "Utilities/PeriodicTask.h"
 #ifdef LCM_MSG
 #include <spi_command_t.hpp>
 #include <spi_data_t.hpp>
@@ -83,6 +85,10 @@ void init_spi();
 
 void spi_send_receive(spi_command_t* command, spi_data_t* data);
 void spi_driver_run();
+void spi_set_concurrent(bool concurrent);
+void spi_use_loopback(unsigned int delay_us);
+void spi_set_worker_schedule(const PeriodicTaskSchedule& schedule);
+PeriodicTaskSchedule spi_get_worker_schedule();
 
 spi_data_t* get_spi_data();
 spi_command_t* get_spi_command();
@@ -9,7 +9,9 @@
 
 #include <sys/mman.h>
 #include <unistd.h>
+#include <algorithm>
 #include <cstring>
+#include <memory>
 #include <thread>
 #include "Configuration.h"
 
@@ -237,12 +239,20 @@ void HardwareBridge::handleControlParameter(
 MiniCheetahHardwareBridge::MiniCheetahHardwareBridge(RobotController* robot_ctrl, bool load_parameters_from_file)
     : HardwareBridge(robot_ctrl), _spiLcm(getLcmUrl(255)), _microstrainLcm(getLcmUrl(255)) {
   _load_parameters_from_file = load_parameters_from_file;
+  _spiDataChannel = _telemetry.addLcmChannel<spi_data_t>(&_spiLcm, "spi_data");
+  _spiCommandChannel =
+      _telemetry.addLcmChannel<spi_command_t>(&_spiLcm, "spi_command");
+  _microstrainChannel = _telemetry.addLcmChannel<microstrain_lcmt>(
+      &_microstrainLcm, "microstrain");
 }
 #else
 #ifdef LCM_MSG
 MiniCheetahHardwareBridge::MiniCheetahHardwareBridge(RobotController* robot_ctrl, bool load_parameters_from_file)
     : HardwareBridge(robot_ctrl), _spiLcm(getLcmUrl(255)) {
   _load_parameters_from_file = load_parameters_from_file;
+  _spiDataChannel = _telemetry.addLcmChannel<spi_data_t>(&_spiLcm, "spi_data");
+  _spiCommandChannel =
+      _telemetry.addLcmChannel<spi_command_t>(&_spiLcm, "spi_command");
 }
 #else
 MiniCheetahHardwareBridge::MiniCheetahHardwareBridge(RobotController* robot_ctrl, bool load_parameters_from_file)
@@ -312,6 +322,22 @@ void MiniCheetahHardwareBridge::run() {
 
   printf("[Hardware Bridge] Got all parameters, starting up!\n");
 
+  // priorities and CPUs of the tasks, so visualization can't delay control
+  taskManager.loadSchedules(
+      getConfigDirectoryPath("mini-cheetah-task-schedule.yaml"));
+  // telemetry publishers are not periodic tasks, but are scheduled from the
+  // same file, including the ones controllers create
+  PeriodicTaskSchedule telemetrySchedule;
+  if (taskManager.getSchedule("telemetry", telemetrySchedule)) {
+    TelemetryPublisher::setDefaultSchedule(telemetrySchedule);
+    _telemetry.setSchedule(TelemetryPublisher::getDefaultSchedule());
+  }
+  // the thread transferring the second spine board, not a periodic task either
+  PeriodicTaskSchedule spiWorkerSchedule;
+  if (taskManager.getSchedule("spi-worker", spiWorkerSchedule)) {
+    spi_set_worker_schedule(spiWorkerSchedule);
+  }
+
   _robotRunner =
       new RobotRunner(_controller, &taskManager, _robotParams.controller_dt, "robot-control");
 
@@ -330,10 +356,27 @@ void MiniCheetahHardwareBridge::run() {
 
   statusTask.start();
 
+#ifdef LCM_MSG
+  // telemetry of the spi and microstrain tasks
+  _telemetry.start();
+#endif
+
   // spi Task start
   PeriodicMemberFunction<MiniCheetahHardwareBridge> spiTask(
       &taskManager, .002, "spi", &MiniCheetahHardwareBridge::runSpi, this);
-  spiTask.start();
+  // phase locked: the controller runs right after each transfer, on fresh
+  // data, and its command goes out on the next one
+  std::unique_ptr<PeriodicTaskGraph> spiControlGraph;
+  if (_robotParams.phase_locked_control) {
+    spiControlGraph.reset(new PeriodicTaskGraph(
+        &taskManager, std::min(.002f, (float)_robotParams.controller_dt),
+        "spi-control"));
+    spiControlGraph->addTask(&spiTask);
+    spiControlGraph->addTask(_robotRunner, {&spiTask});
+    spiControlGraph->start();
+  } else {
+    spiTask.start();
+  }
 
 #ifdef USE_MICROSTRAIN
   // microstrain
@@ -342,7 +385,7 @@ void MiniCheetahHardwareBridge::run() {
 #endif
 
   // robot controller start
-  _robotRunner->start();
+  if (!spiControlGraph) _robotRunner->start();
 
 #ifdef LCM_MSG
   // visualization start
@@ -367,9 +410,18 @@ void MiniCheetahHardwareBridge::run() {
   microstrainLogger.start();
 #endif
 
+#ifdef LCM_MSG
+  u64 telemetryDropped = 0;
+#endif
   for (;;) {
     usleep(1000000);
     // printf("joy %f\n", _robotRunner->driverCommand->leftStickAnalog[0]);
+#ifdef LCM_MSG
+    if (_telemetry.getDroppedCount() != telemetryDropped) {
+      telemetryDropped = _telemetry.getDroppedCount();
+      _telemetry.printStatus();
+    }
+#endif
   }
 }
 
@@ -403,7 +455,7 @@ void MiniCheetahHardwareBridge::runMicrostrain() {
 
 void MiniCheetahHardwareBridge::logMicrostrain() {
   _microstrainImu.updateLCM(&_microstrainData);
-  _microstrainLcm.publish("microstrain", &_microstrainData);
+  _microstrainChannel->push(_microstrainData);
 }
 #endif
 
@@ -454,8 +506,8 @@ void MiniCheetahHardwareBridge::runSpi() {
   spi_driver_run();
   memcpy(&_spiData, data, sizeof(spi_data_t));
 
-  _spiLcm.publish("spi_data", data);
-  _spiLcm.publish("spi_command", cmd);
+  _spiDataChannel->push(*data);
+  _spiCommandChannel->push(*cmd);
 #else
   spi_driver_run();
 #endif
@@ -0,0 +1,462 @@
+/*! @file HeadlessSimulation.cpp
+ *  @brief Runs a RobotController and the simulator in the same process,
+ * without graphics.
+ */
+
+#include "HeadlessSimulation.h"
+
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cmath>
+#include <stdexcept>
+
+#include "Dynamics/MiniCheetah.h"
+#include "SimUtilities/TerrainLoader.h"
+#include "Utilities/ParamHandler.hpp"
+#include "Utilities/Timer.h"
+#include "Utilities/utilities.h"
+
+/*!
+ * Get the name of the user parameter file the simulator would use
+ */
+static std::string getUserParameterFileName() {
+  std::string path = getConfigDirectoryPath("/default-user-parameters-file.yaml");
+  ParamHandler paramHandler(path);
+  std::string fileName;
+  if (!paramHandler.fileOpenedSuccessfully() ||
+      !paramHandler.getString("file_name", fileName)) {
+    throw std::runtime_error("could not read the user parameter file name from " + path);
+  }
+  return fileName;
+}
+
+/*!
+ * Build the robot and the controller, and load all parameters from the
+ * default files.  The robot starts lying on the ground, like in the simulator.
+ */
+HeadlessSimulation::HeadlessSimulation(RobotType robot,
+                                       RobotController* robot_ctrl)
+    : _robot(robot), _robotCtrl(robot_ctrl), _tau(12) {
+  if (_robot != RobotType::MINI_CHEETAH && _robot != RobotType::CYBERDOG) {
+    throw std::runtime_error("headless simulation only supports mini cheetah");
+  }
+
+  printf("[Headless Simulation] Load parameters...\n");
+  _simParams.initializeFromYamlFile(
+      getConfigDirectoryPath(SIMULATOR_DEFAULT_PARAMETERS));
+  if (!_simParams.isFullyInitialized()) {
+    printf("[ERROR] Simulator parameters are not fully initialized. You forgot: \n%s\n",
+           _simParams.generateUnitializedList().c_str());
+    throw std::runtime_error("simulator not initialized");
+  }
+
+  _robotParams.initializeFromYamlFile(
+      getConfigDirectoryPath(MINI_CHEETAH_DEFAULT_PARAMETERS));
+  if (!_robotParams.isFullyInitialized()) {
+    printf("Not all robot control parameters were initialized. Missing:\n%s\n",
+           _robotParams.generateUnitializedList().c_str());
+    throw std::runtime_error("not all parameters initialized from ini file");
+  }
+
+  _userParams = _robotCtrl->getUserControlParameters();
+  if (_userParams) {
+    _userParams->initializeFromYamlFile(
+        getConfigDirectoryPath(getUserParameterFileName()));
+    if (!_userParams->isFullyInitialized()) {
+      printf("Not all user parameters were initialized. Missing:\n%s\n",
+             _userParams->generateUnitializedList().c_str());
+      throw std::runtime_error("not all user parameters initialized");
+    }
+  }
+
+  printf("[Headless Simulation] Build robot...\n");
+  _quadruped = buildMiniCheetah<double>();
+  _actuatorModels = _quadruped.buildActuatorModels();
+  _model = _quadruped.buildModel();
+  _simulator =
+      new DynamicsSimulator<double>(_model, (bool)_simParams.use_spring_damper);
+  if (_simParams.use_spring_damper)
+    _simulator->setIntegrator(_simParams.getDynamicsIntegrator());
+  _simulator->setAdaptiveSubsteps(
+      (size_t)std::max<s64>(1, _simParams.dynamics_max_substeps),
+      _simParams.dynamics_error_tolerance);
+  _imuSimulator = new ImuSimulator<double>(_simParams);
+
+  // Cheetah lies on the ground
+  FBModelState<double> x0;
+  x0.bodyOrientation = rotationMatrixToQuaternion(
+      ori::coordinateRotation(CoordinateAxis::Z, 0.));
+  x0.bodyPosition.setZero();
+  x0.bodyVelocity.setZero();
+  x0.q = DVec<double>::Zero(12);
+  x0.qd = DVec<double>::Zero(12);
+  x0.bodyPosition[2] = 0.05;
+  for (int leg = 0; leg < 4; leg++) {
+    double side = Quadruped<double>::getSideSign(leg);
+    double front = leg < 2 ? 1. : -1.;
+    x0.q[leg * 3 + 0] = 0.7 * side;
+    x0.q[leg * 3 + 1] = 1. * front;
+    x0.q[leg * 3 + 2] = 2.715 * front;
+  }
+  setRobotState(x0);
+  _tau.setZero();
+
+  for (int leg = 0; leg < 4; leg++) {
+    _spineBoards[leg].init(Quadruped<float>::getSideSign(leg), leg);
+    _spineBoards[leg].data = &_spiData;
+    _spineBoards[leg].cmd = &_spiCommand;
+    _spineBoards[leg].resetData();
+    _spineBoards[leg].resetCommand();
+  }
+  memset(&_spiCommand, 0, sizeof(_spiCommand));
+
+  _simToRobot.robotType = _robot;
+  _robotToSim.errorMessage[0] = '\0';
+
+  _robotRunner =
+      new RobotRunner(_robotCtrl, &_taskManager, 0, "robot-task");
+  _robotRunner->driverCommand = &_simToRobot.gamepadCommand;
+  _robotRunner->spiData = &_simToRobot.spiData;
+  _robotRunner->robotType = _robot;
+  _robotRunner->vectorNavData = &_simToRobot.vectorNav;
+  _robotRunner->cheaterState = &_simToRobot.cheaterState;
+  _robotRunner->spiCommand = &_robotToSim.spiCommand;
+  _robotRunner->controlParameters = &_robotParams;
+  _robotRunner->visualizationData = &_robotToSim.visualizationData;
+  _robotRunner->cheetahMainVisualization = &_robotToSim.mainCheetahVisualization;
+  printf("[Headless Simulation] Ready!\n");
+}
+
+HeadlessSimulation::~HeadlessSimulation() {
+  closeLog();
+  delete _robotRunner;
+  delete _imuSimulator;
+  delete _simulator;
+}
+
+/*!
+ * Add the collision objects of a terrain file
+ */
+void HeadlessSimulation::loadTerrainFile(const std::string& terrainFileName) {
+  TerrainCallbacks callbacks;
+  callbacks.addPlane = [&](double mu, double resti, double height, double,
+                           double, double, double) {
+    _simulator->addCollisionPlane(mu, resti, height);
+  };
+  callbacks.addBox = [&](double mu, double resti, double depth, double width,
+                         double height, const Vec3<double>& pos,
+                         const Mat3<double>& ori, bool) {
+    _simulator->addCollisionBox(mu, resti, depth, width, height, pos, ori);
+  };
+  callbacks.addMesh = [&](double mu, double resti, double grid,
+                          const Vec3<double>& leftCorner,
+                          const DMat<double>& heightMap, bool) {
+    _simulator->addCollisionMesh(mu, resti, grid, leftCorner, heightMap);
+  };
+  callbacks.addTiledMesh = [&](double mu, double resti,
+                               const std::string& fileName,
+                               size_t cachedTiles) {
+    _simulator->addCollisionTiledHeightMap(mu, resti, fileName, cachedTiles);
+  };
+  ::loadTerrainFile(terrainFileName, callbacks);
+}
+
+/*!
+ * Load the script of gamepad inputs and parameter changes
+ */
+void HeadlessSimulation::loadScript(const std::string& scriptFileName) {
+  _script.load(scriptFileName);
+}
+
+/*!
+ * Log the trajectory to a file.  The file starts with two text lines, the
+ * second one has the names of the columns, and then has one record of float32
+ * (native endianness) per sample.
+ * @param logFileName : file to write
+ * @param logPeriod : time between samples, 0 to log every controller step
+ */
+void HeadlessSimulation::openLog(const std::string& logFileName,
+                                 double logPeriod) {
+  closeLog();
+  _log = fopen(logFileName.c_str(), "wb");
+  if (!_log) {
+    throw std::runtime_error("could not open log file " + logFileName);
+  }
+  _logPeriod = logPeriod;
+  _timeOfNextLog = _currentSimTime;
+
+  fprintf(_log, "# cheetah trajectory log, float32 records of 50 columns\n");
+  fprintf(_log, "# time p_x p_y p_z quat_w quat_x quat_y quat_z");
+  fprintf(_log, " omega_x omega_y omega_z v_x v_y v_z");
+  for (auto& name : {"q", "qd", "tau"})
+    for (int i = 0; i < 12; i++) fprintf(_log, " %s_%d", name, i);
+  fprintf(_log, "\n");
+}
+
+void HeadlessSimulation::closeLog() {
+  if (!_log) return;
+  fclose(_log);
+  _log = nullptr;
+  printf("[Headless Simulation] Logged %ld samples\n", (long)_logSamples);
+}
+
+/*!
+ * Simulate for the given time, as fast as possible
+ * @param duration : simulated time (s)
+ */
+void HeadlessSimulation::run(double duration) {
+  double dt = _simParams.dynamics_dt;
+  double dtLowLevelControl = _simParams.low_level_dt;
+  double dtHighLevelControl = _simParams.high_level_dt;
+  u64 nSteps = (u64)std::llround(duration / dt);
+
+  printf(
+      "[Headless Simulation] Running %.3f s (dt %f, dt-low-level %f, "
+      "dt-high-level %f)...\n",
+      duration, dt, dtLowLevelControl, dtHighLevelControl);
+
+  Timer timer;
+  for (u64 i = 0; i < nSteps; i++) {
+    step(dt, dtLowLevelControl, dtHighLevelControl);
+
+    const FBModelState<double>& state = _simulator->getState();
+    if (!state.bodyPosition.allFinite() || !state.q.allFinite()) {
+      throw std::runtime_error("simulation diverged at t = " +
+                               std::to_string(_currentSimTime));
+    }
+  }
+
+  double realTime = timer.getSeconds();
+  printf("[Headless Simulation] Simulated %.3f s in %.3f s (%.1fx real time)\n",
+         duration, realTime, duration / realTime);
+  if (_log) fflush(_log);
+}
+
+/*!
+ * Copy the state of the simulated world
+ */
+SimulationSnapshot HeadlessSimulation::snapshot() const {
+  SimulationSnapshot snapshot;
+  snapshot.time = _currentSimTime;
+  snapshot.timeOfNextLowLevelControl = _timeOfNextLowLevelControl;
+  snapshot.timeOfNextHighLevelControl = _timeOfNextHighLevelControl;
+  snapshot.highLevelIterations = _highLevelIterations;
+  snapshot.scriptPosition = _script.getPosition();
+
+  _simulator->saveSnapshot(snapshot.dynamics);
+  snapshot.tau = _tau;
+
+  snapshot.spiData = _spiData;
+  snapshot.spiCommand = _spiCommand;
+  for (int leg = 0; leg < 4; leg++) {
+    for (int joint = 0; joint < 3; joint++)
+      snapshot.spineTorque[leg][joint] = _spineBoards[leg].torque_out[joint];
+    snapshot.spineIterations[leg] = _spineBoards[leg].getIterations();
+  }
+
+  snapshot.imuRandomState = _imuSimulator->getRandomState();
+  snapshot.gamepad = _gamepad;
+
+  SimulationSnapshot::saveParameters(_robotParams, snapshot.robotParameters);
+  if (_userParams) {
+    SimulationSnapshot::saveParameters(*_userParams, snapshot.userParameters);
+  }
+  return snapshot;
+}
+
+/*!
+ * Go back (or forward) to a snapshot of this simulation, or of another one
+ * with the same terrain, script and simulator parameters.  Only the world and
+ * the robot and user parameters (undoing the script) are restored, the
+ * controller keeps running from its own state, so the run is only the same as
+ * the one after the snapshot if the controller is too.  Use fork to copy the
+ * controller as well.
+ */
+void HeadlessSimulation::restore(const SimulationSnapshot& snapshot) {
+  if (snapshot.tau.size() != _tau.size()) {
+    throw std::runtime_error("snapshot is not of this robot");
+  }
+  SimulationSnapshot::restoreParameters(snapshot.robotParameters, _robotParams);
+  if (_userParams) {
+    SimulationSnapshot::restoreParameters(snapshot.userParameters,
+                                          *_userParams);
+  }
+  _simulator->restoreSnapshot(snapshot.dynamics);
+  _tau = snapshot.tau;
+
+  _currentSimTime = snapshot.time;
+  _timeOfNextLowLevelControl = snapshot.timeOfNextLowLevelControl;
+  _timeOfNextHighLevelControl = snapshot.timeOfNextHighLevelControl;
+  _highLevelIterations = snapshot.highLevelIterations;
+  _script.setPosition(snapshot.scriptPosition);
+
+  _spiData = snapshot.spiData;
+  _spiCommand = snapshot.spiCommand;
+  for (int leg = 0; leg < 4; leg++) {
+    for (int joint = 0; joint < 3; joint++)
+      _spineBoards[leg].torque_out[joint] = snapshot.spineTorque[leg][joint];
+    _spineBoards[leg].setIterations(snapshot.spineIterations[leg]);
+  }
+
+  _imuSimulator->setRandomState(snapshot.imuRandomState);
+  _gamepad = snapshot.gamepad;
+  _timeOfNextLog = _currentSimTime;
+}
+
+/*!
+ * Copy the whole simulation, controller included, into new processes (POSIX
+ * fork).  Every copy goes on from here on its own and runs exactly like the
+ * original would, until they are given different parameters, scripts or
+ * snapshots.  Only the thread calling fork is copied, so the controller must
+ * not have threads of its own.  The log file stays with the original, copies
+ * open their own.  Copies should exit when they are done.
+ * @param copies : number of copies to make
+ * @return 0 in the original, 1 to copies in the copies
+ */
+size_t HeadlessSimulation::fork(size_t copies) {
+  if (_log) fflush(_log);
+  fflush(stdout);
+  fflush(stderr);
+  for (size_t i = 1; i <= copies; i++) {
+    pid_t pid = ::fork();
+    if (pid < 0) {
+      throw std::runtime_error("could not fork the simulation");
+    }
+    if (pid == 0) {
+      if (_log) {
+        fclose(_log);  // already flushed, nothing written twice
+        _log = nullptr;
+      }
+      _forks.clear();
+      return i;
+    }
+    _forks.push_back(pid);
+  }
+  return 0;
+}
+
+/*!
+ * Wait for the copies made by fork to exit
+ * @return number of copies that failed (exited with an error or crashed)
+ */
+int HeadlessSimulation::waitForForks() {
+  int failed = 0;
+  for (pid_t pid : _forks) {
+    int status;
+    if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status) ||
+        WEXITSTATUS(status) != 0) {
+      failed++;
+    }
+  }
+  _forks.clear();
+  return failed;
+}
+
+/*!
+ * Take a single timestep of dt seconds, same as Simulation::step
+ */
+void HeadlessSimulation::step(double dt, double dtLowLevelControl,
+                              double dtHighLevelControl) {
+  if (_currentSimTime >= _timeOfNextLowLevelControl) {
+    lowLevelControl();
+    _timeOfNextLowLevelControl = _timeOfNextLowLevelControl + dtLowLevelControl;
+  }
+
+  if (_currentSimTime >= _timeOfNextHighLevelControl) {
+    highLevelControl();
+    _timeOfNextHighLevelControl =
+        _timeOfNextHighLevelControl + dtHighLevelControl;
+  }
+
+  // actuator model:
+  for (int leg = 0; leg < 4; leg++) {
+    for (int joint = 0; joint < 3; joint++) {
+      _tau[leg * 3 + joint] = _actuatorModels[joint].getTorque(
+          _spineBoards[leg].torque_out[joint],
+          _simulator->getState().qd[leg * 3 + joint]);
+    }
+  }
+
+  if (_log && _currentSimTime >= _timeOfNextLog) {
+    writeLog();
+    _timeOfNextLog += _logPeriod > 0 ? _logPeriod : dtHighLevelControl;
+  }
+
+  // dynamics
+  _currentSimTime += dt;
+
+  RobotHomingInfo<double> homing;
+  homing.active_flag = _simParams.go_home;
+  homing.position = _simParams.home_pos;
+  homing.rpy = _simParams.home_rpy;
+  homing.kp_lin = _simParams.home_kp_lin;
+  homing.kd_lin = _simParams.home_kd_lin;
+  homing.kp_ang = _simParams.home_kp_ang;
+  homing.kd_ang = _simParams.home_kd_ang;
+  _simulator->setHoming(homing);
+
+  _simulator->step(dt, _tau, _simParams.floor_kp, _simParams.floor_kd);
+}
+
+void HeadlessSimulation::lowLevelControl() {
+  const FBModelState<double>& state = _simulator->getState();
+  for (int leg = 0; leg < 4; leg++) {
+    _spiData.q_abad[leg] = state.q[leg * 3 + 0];
+    _spiData.q_hip[leg] = state.q[leg * 3 + 1];
+    _spiData.q_knee[leg] = state.q[leg * 3 + 2];
+
+    _spiData.qd_abad[leg] = state.qd[leg * 3 + 0];
+    _spiData.qd_hip[leg] = state.qd[leg * 3 + 1];
+    _spiData.qd_knee[leg] = state.qd[leg * 3 + 2];
+  }
+
+  for (auto& spineBoard : _spineBoards) {
+    spineBoard.run();
+  }
+}
+
+/*!
+ * Run the robot controller, what the SimulationBridge does for the graphical
+ * simulator
+ */
+void HeadlessSimulation::highLevelControl() {
+  _script.apply(_currentSimTime, _gamepad, _robotParams, _userParams);
+  _simToRobot.gamepadCommand = _gamepad;
+  _simToRobot.gamepadCommand.applyDeadband(_simParams.game_controller_deadband);
+
+  _imuSimulator->updateCheaterState(_simulator->getState(),
+                                    _simulator->getDState(),
+                                    _simToRobot.cheaterState);
+  _imuSimulator->updateVectornav(_simulator->getState(),
+                                 _simulator->getDState(),
+                                 &_simToRobot.vectorNav);
+  _simToRobot.spiData = _spiData;
+
+  if (!_robotRunnerInitialized) {
+    printf("[Headless Simulation] First run of robot controller...\n");
+    _robotRunner->init();
+    _robotRunnerInitialized = true;
+  }
+  _robotRunner->run();
+
+  _spiCommand = _robotToSim.spiCommand;
+  _highLevelIterations++;
+}
+
+/*!
+ * Write one sample of the trajectory
+ */
+void HeadlessSimulation::writeLog() {
+  const FBModelState<double>& state = _simulator->getState();
+  float record[50];
+  int i = 0;
+  record[i++] = _currentSimTime;
+  for (int k = 0; k < 3; k++) record[i++] = state.bodyPosition[k];
+  for (int k = 0; k < 4; k++) record[i++] = state.bodyOrientation[k];
+  for (int k = 0; k < 6; k++) record[i++] = state.bodyVelocity[k];
+  for (int k = 0; k < 12; k++) record[i++] = state.q[k];
+  for (int k = 0; k < 12; k++) record[i++] = state.qd[k];
+  for (int k = 0; k < 12; k++) record[i++] = _tau[k];
+  fwrite(record, sizeof(float), 50, _log);
+  _logSamples++;
+}
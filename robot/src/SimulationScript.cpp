@@ -0,0 +1,182 @@
+/*! @file SimulationScript.cpp
+ *  @brief Timed gamepad inputs and parameter changes for headless simulation
+ */
+
+#include "SimulationScript.h"
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+/*!
+ * Read a script file.  Lines starting with # are comments.
+ * @param fileName : path to the script
+ */
+void SimulationScript::load(const std::string& fileName) {
+  std::ifstream f(fileName);
+  if (!f.good()) {
+    throw std::runtime_error("could not open simulation script " + fileName);
+  }
+
+  _events.clear();
+  _nextEvent = 0;
+
+  std::string line;
+  int lineNumber = 0;
+  while (std::getline(f, line)) {
+    lineNumber++;
+    std::istringstream iss(line);
+    Event event;
+    if (!(iss >> event.time)) {
+      // blank line or comment
+      std::string first;
+      std::istringstream check(line);
+      if (!(check >> first) || first[0] == '#') continue;
+      throw std::runtime_error("bad time in simulation script line " +
+                               std::to_string(lineNumber));
+    }
+
+    if (!(iss >> event.name)) {
+      throw std::runtime_error("missing name in simulation script line " +
+                               std::to_string(lineNumber));
+    }
+
+    std::string value;
+    while (iss >> value) {
+      if (value[0] == '#') break;
+      event.values.push_back(value);
+    }
+    event.line = lineNumber;
+    _events.push_back(event);
+  }
+
+  std::stable_sort(
+      _events.begin(), _events.end(),
+      [](const Event& a, const Event& b) { return a.time < b.time; });
+  printf("[Simulation Script] Loaded %d events from %s\n", (int)_events.size(),
+         fileName.c_str());
+}
+
+/*!
+ * Apply all events up to (and including) the given time
+ * @param time : simulation time
+ * @param gamepad : gamepad command sent to the robot
+ * @param robotParams : robot control parameters
+ * @param userParams : user control parameters, may be null
+ */
+void SimulationScript::apply(double time, GamepadCommand& gamepad,
+                             ControlParameters& robotParams,
+                             ControlParameters* userParams) {
+  while (_nextEvent < _events.size() && _events[_nextEvent].time <= time) {
+    applyEvent(_events[_nextEvent], gamepad, robotParams, userParams);
+    _nextEvent++;
+  }
+}
+
+void SimulationScript::applyEvent(const Event& event, GamepadCommand& gamepad,
+                                  ControlParameters& robotParams,
+                                  ControlParameters* userParams) {
+  auto fail = [&](const std::string& why) {
+    throw std::runtime_error("simulation script line " +
+                             std::to_string(event.line) + ": " + why);
+  };
+
+  auto expectValues = [&](size_t n) {
+    if (event.values.size() != n) {
+      fail(event.name + " needs " + std::to_string(n) + " values");
+    }
+  };
+
+  if (event.name == "set") {
+    if (event.values.size() < 2) fail("set needs a name and a value");
+    const std::string& name = event.values[0];
+    std::string value;
+    for (size_t i = 1; i < event.values.size(); i++) {
+      if (i > 1) value += ' ';
+      value += event.values[i];
+    }
+
+    ControlParameters* params = &robotParams;
+    if (userParams && userParams->collection._map.count(name)) {
+      params = userParams;
+    }
+    if (!params->collection._map.count(name)) {
+      fail("unknown parameter " + name);
+    }
+    ControlParameter& param = params->collection.lookup(name);
+    bool ok = false;
+    try {
+      ok = param.setFromString(value);
+    } catch (const std::exception&) {
+      // the number parsers throw on a bad value
+    }
+    if (!ok) fail("can't set " + name + " to " + value);
+    printf("[Simulation Script] %.3f: %s = %s\n", event.time, name.c_str(),
+           param.toString().c_str());
+    return;
+  }
+
+  std::vector<double> v;
+  for (auto& s : event.values) {
+    size_t used = 0;
+    try {
+      v.push_back(std::stod(s, &used));
+    } catch (const std::logic_error&) {
+      // std::invalid_argument or std::out_of_range
+      used = 0;
+    }
+    if (used != s.size()) fail("bad value " + s);
+  }
+
+  auto setStick = [&](Vec2<float>& stick) {
+    expectValues(2);
+    stick = Vec2<float>(v[0], v[1]);
+  };
+
+  auto setAnalog = [&](float& analog) {
+    expectValues(1);
+    analog = v[0];
+  };
+
+  auto setButton = [&](bool& button) {
+    expectValues(1);
+    button = v[0] != 0;
+  };
+
+  if (event.name == "leftStickAnalog") {
+    setStick(gamepad.leftStickAnalog);
+  } else if (event.name == "rightStickAnalog") {
+    setStick(gamepad.rightStickAnalog);
+  } else if (event.name == "leftTriggerAnalog") {
+    setAnalog(gamepad.leftTriggerAnalog);
+  } else if (event.name == "rightTriggerAnalog") {
+    setAnalog(gamepad.rightTriggerAnalog);
+  } else if (event.name == "leftBumper") {
+    setButton(gamepad.leftBumper);
+  } else if (event.name == "rightBumper") {
+    setButton(gamepad.rightBumper);
+  } else if (event.name == "leftTriggerButton") {
+    setButton(gamepad.leftTriggerButton);
+  } else if (event.name == "rightTriggerButton") {
+    setButton(gamepad.rightTriggerButton);
+  } else if (event.name == "back") {
+    setButton(gamepad.back);
+  } else if (event.name == "start") {
+    setButton(gamepad.start);
+  } else if (event.name == "a") {
+    setButton(gamepad.a);
+  } else if (event.name == "b") {
+    setButton(gamepad.b);
+  } else if (event.name == "x") {
+    setButton(gamepad.x);
+  } else if (event.name == "y") {
+    setButton(gamepad.y);
+  } else if (event.name == "leftStickButton") {
+    setButton(gamepad.leftStickButton);
+  } else if (event.name == "rightStickButton") {
+    setButton(gamepad.rightStickButton);
+  } else {
+    fail("unknown input " + event.name);
+  }
+}
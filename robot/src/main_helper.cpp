@@ -10,6 +10,7 @@
 #include <iostream>
 
 #include "HardwareBridge.h"
+#include "HeadlessSimulation.h"
 #include "SimulationBridge.h"
 #include "main_helper.h"
 #include "RobotController.h"
@@ -142,3 +143,69 @@ int main_helper(int argc, char** argv, RobotController* ctrl) {
 
   return 0;
 }
+
+/*!
+ * Print a message describing the command line of the headless simulation
+ */
+void printHeadlessUsage() {
+  printf(
+      "Usage: robot-headless [duration] [log-file] [terrain-file] "
+      "[script-file] [log-period]\n"
+      "\tduration:      simulated time (s)\n"
+      "\tlog-file:      trajectory log to write, - for none\n"
+      "\tterrain-file:  terrain yaml file, - (or nothing) for the default "
+      "terrain\n"
+      "\tscript-file:   gamepad and parameter script, - (or nothing) for "
+      "none\n"
+      "\tlog-period:    time between log samples (s), 0 (or nothing) for "
+      "every controller step\n");
+}
+
+/*!
+ * Simulate the mini cheetah with the given robot controller, without
+ * graphics, as fast as possible.
+ * @return EXIT_FAILURE if the controller or the simulation threw
+ */
+int headless_main_helper(int argc, char** argv, RobotController* ctrl) {
+  if (argc < 3 || argc > 6) {
+    printHeadlessUsage();
+    return EXIT_FAILURE;
+  }
+
+  auto arg = [&](int i) {
+    return (argc > i && std::string(argv[i]) != "-") ? std::string(argv[i])
+                                                     : std::string();
+  };
+
+  double duration = std::stod(argv[1]);
+  std::string logFile = arg(2);
+  std::string terrainFile = arg(3);
+  std::string scriptFile = arg(4);
+  double logPeriod = argc > 5 ? std::stod(argv[5]) : 0.;
+  if (terrainFile.empty()) {
+    terrainFile = getConfigDirectoryPath("/default-terrain.yaml");
+  }
+
+  printf("[Quadruped] Cheetah Software\n");
+  printf("        Quadruped:  Mini Cheetah\n");
+  printf("        Driver: Headless Simulation\n");
+
+  try {
+    HeadlessSimulation simulation(RobotType::MINI_CHEETAH, ctrl);
+    simulation.loadTerrainFile(terrainFile);
+    if (!scriptFile.empty()) simulation.loadScript(scriptFile);
+    if (!logFile.empty()) simulation.openLog(logFile, logPeriod);
+    simulation.run(duration);
+
+    const FBModelState<double>& state = simulation.getRobotState();
+    Vec3<double> rpy = ori::quatToRPY(state.bodyOrientation);
+    printf("[Headless Simulation] Final position %.3f %.3f %.3f, rpy %.3f %.3f %.3f\n",
+           state.bodyPosition[0], state.bodyPosition[1], state.bodyPosition[2],
+           rpy[0], rpy[1], rpy[2]);
+  } catch (std::exception& e) {
+    printf("[ERROR] Headless simulation failed: %s\n", e.what());
+    return EXIT_FAILURE;
+  }
+
+  return 0;
+}
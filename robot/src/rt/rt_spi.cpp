@@ -5,8 +5,10 @@
 #ifdef linux
 
 #include <byteswap.h>
+#include <errno.h>
 #include <math.h>
 #include <pthread.h>
+#include <semaphore.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -26,8 +28,27 @@ int spi_2_fd = -1;
 
 int spi_open();
 
-static spine_cmd_t g_spine_cmd;
-static spine_data_t g_spine_data;
+// one of each per board, which are transferred at the same time
+static spine_cmd_t g_spine_cmd[2];
+static spine_data_t g_spine_data[2];
+
+// board 1 is transferred by a worker thread while the caller does board 0
+static bool spi_concurrent = true;
+static int spi_worker_state = 0;  // 0 not started, 1 running, -1 failed
+static pthread_t spi_worker;
+static sem_t spi_worker_start;
+static sem_t spi_worker_done;
+static spi_command_t *spi_worker_command;
+static spi_data_t *spi_worker_data;
+// set by the thread calling spi_send_receive, read by the worker after
+// spi_worker_start
+static PeriodicTaskSchedule spi_worker_schedule;
+static bool spi_worker_reschedule = false;
+static PeriodicTaskSchedule spi_worker_effective_schedule;
+
+// loopback device instead of the spine boards
+static bool spi_loopback = false;
+static unsigned int spi_loopback_delay_us = 0;
 
 spi_command_t spi_command_drv;
 spi_data_t spi_data_drv;
@@ -273,64 +294,201 @@ void spine_to_spi(spi_data_t *data, spine_data_t *spine_data, int leg_0) {
 }
 
 /*!
- * send receive data and command from spine
+ * Answer a transfer like a spine board whose motors are exactly where they are
+ * commanded to be
  */
-void spi_send_receive(spi_command_t *command, spi_data_t *data) {
-  // update driver status flag
-  spi_driver_iterations++;
-  data->spi_driver_status = spi_driver_iterations << 16;
+static int spi_loopback_transfer(struct spi_ioc_transfer *message) {
+  uint16_t *tx_buf = (uint16_t *)(uintptr_t)message->tx_buf;
+  uint16_t *rx_buf = (uint16_t *)(uintptr_t)message->rx_buf;
+
+  // copies instead of casts between the word and message types
+  uint16_t words[K_WORDS_PER_MESSAGE];
+  for (int i = 0; i < K_WORDS_PER_MESSAGE; i++)
+    words[i] = (tx_buf[i] >> 8) + ((tx_buf[i] & 0xff) << 8);
+  spine_cmd_t spine_cmd;
+  memcpy(&spine_cmd, words, sizeof(spine_cmd));
+
+  spine_data_t spine_data;
+  for (int i = 0; i < 2; i++) {
+    spine_data.q_abad[i] = spine_cmd.q_des_abad[i];
+    spine_data.q_hip[i] = spine_cmd.q_des_hip[i];
+    spine_data.q_knee[i] = spine_cmd.q_des_knee[i];
+    spine_data.qd_abad[i] = spine_cmd.qd_des_abad[i];
+    spine_data.qd_hip[i] = spine_cmd.qd_des_hip[i];
+    spine_data.qd_knee[i] = spine_cmd.qd_des_knee[i];
+    spine_data.flags[i] = spine_cmd.flags[i];
+  }
+  uint32_t checksum_words[15];
+  memcpy(checksum_words, &spine_data, sizeof(checksum_words));
+  spine_data.checksum = xor_checksum(checksum_words, 14);
+
+  memcpy(words, &spine_data, sizeof(spine_data));
+  memset(rx_buf, 0, message->len);
+  for (int i = 0; i < 30; i++)
+    rx_buf[i] = (words[i] >> 8) + ((words[i] & 0xff) << 8);
+
+  // the time on the wire
+  if (spi_loopback_delay_us) usleep(spi_loopback_delay_us);
+  return message->len;
+}
 
+/*!
+ * send receive data and command of one spine board
+ */
+static void spi_board_send_receive(spi_command_t *command, spi_data_t *data,
+                                   int spi_board) {
   // transmit and receive buffers
   uint16_t tx_buf[K_WORDS_PER_MESSAGE];
   uint16_t rx_buf[K_WORDS_PER_MESSAGE];
 
-  for (int spi_board = 0; spi_board < 2; spi_board++) {
-    // copy command into spine type:
-    spi_to_spine(command, &g_spine_cmd, spi_board * 2);
+  // copy command into spine type:
+  spi_to_spine(command, &g_spine_cmd[spi_board], spi_board * 2);
 
-    // pointers to command/data spine array
-    uint16_t *cmd_d = (uint16_t *)&g_spine_cmd;
-    uint16_t *data_d = (uint16_t *)&g_spine_data;
+  // pointers to command/data spine array
+  uint16_t *cmd_d = (uint16_t *)&g_spine_cmd[spi_board];
+  uint16_t *data_d = (uint16_t *)&g_spine_data[spi_board];
 
-    // zero rx buffer
-    memset(rx_buf, 0, K_WORDS_PER_MESSAGE * sizeof(uint16_t));
+  // zero rx buffer
+  memset(rx_buf, 0, K_WORDS_PER_MESSAGE * sizeof(uint16_t));
 
-    // copy into tx buffer flipping bytes
-    for (int i = 0; i < K_WORDS_PER_MESSAGE; i++)
-      tx_buf[i] = (cmd_d[i] >> 8) + ((cmd_d[i] & 0xff) << 8);
-    // tx_buf[i] = __bswap_16(cmd_d[i]);
+  // copy into tx buffer flipping bytes
+  for (int i = 0; i < K_WORDS_PER_MESSAGE; i++)
+    tx_buf[i] = (cmd_d[i] >> 8) + ((cmd_d[i] & 0xff) << 8);
+  // tx_buf[i] = __bswap_16(cmd_d[i]);
 
-    // each word is two bytes long
-    size_t word_len = 2;  // 16 bit word
+  // each word is two bytes long
+  size_t word_len = 2;  // 16 bit word
 
-    // spi message struct
-    struct spi_ioc_transfer spi_message[1];
+  // spi message struct
+  struct spi_ioc_transfer spi_message[1];
+
+  // zero message struct.
+  memset(spi_message, 0, 1 * sizeof(struct spi_ioc_transfer));
+
+  // set up message struct
+  for (int i = 0; i < 1; i++) {
+    spi_message[i].bits_per_word = spi_bits_per_word;
+    spi_message[i].cs_change = 1;
+    spi_message[i].delay_usecs = 0;
+    spi_message[i].len = word_len * 66;
+    spi_message[i].rx_buf = (uint64_t)rx_buf;
+    spi_message[i].tx_buf = (uint64_t)tx_buf;
+  }
 
-    // zero message struct.
-    memset(spi_message, 0, 1 * sizeof(struct spi_ioc_transfer));
+  // do spi communication
+  int rv = spi_loopback
+               ? spi_loopback_transfer(spi_message)
+               : ioctl(spi_board == 0 ? spi_1_fd : spi_2_fd,
+                       SPI_IOC_MESSAGE(1), &spi_message);
+  (void)rv;
 
-    // set up message struct
-    for (int i = 0; i < 1; i++) {
-      spi_message[i].bits_per_word = spi_bits_per_word;
-      spi_message[i].cs_change = 1;
-      spi_message[i].delay_usecs = 0;
-      spi_message[i].len = word_len * 66;
-      spi_message[i].rx_buf = (uint64_t)rx_buf;
-      spi_message[i].tx_buf = (uint64_t)tx_buf;
+  // flip bytes the other way
+  for (int i = 0; i < 30; i++)
+    data_d[i] = (rx_buf[i] >> 8) + ((rx_buf[i] & 0xff) << 8);
+  // data_d[i] = __bswap_16(rx_buf[i]);
+
+  // copy back to data
+  spine_to_spi(data, &g_spine_data[spi_board], spi_board * 2);
+}
+
+/*!
+ * Transfer board 1 each time spi_send_receive asks
+ */
+static void *spi_worker_run(void *) {
+  for (;;) {
+    while (sem_wait(&spi_worker_start) && errno == EINTR) {
+    }
+    if (spi_worker_reschedule) {
+      spi_worker_effective_schedule =
+          spi_worker_schedule.applyToThisThread("spi-board-1");
+      spi_worker_reschedule = false;
     }
+    spi_board_send_receive(spi_worker_command, spi_worker_data, 1);
+    sem_post(&spi_worker_done);
+  }
+  return nullptr;
+}
+
+/*!
+ * Start the worker thread for board 1, on the first transfer.  It inherits the
+ * policy, priority and CPUs of the spi thread, unless spi_set_worker_schedule
+ * gave it others.
+ * @return false if it can't run, and the boards are transferred one after the
+ * other
+ */
+static bool spi_start_worker() {
+  if (spi_worker_state) return spi_worker_state > 0;
+
+  spi_worker_state = -1;
+  if (sem_init(&spi_worker_start, 0, 0) || sem_init(&spi_worker_done, 0, 0)) {
+    perror("[ERROR: RT SPI] Failed to create spi worker semaphores");
+    return false;
+  }
+  int rv = pthread_create(&spi_worker, NULL, spi_worker_run, NULL);
+  if (rv != 0) {
+    printf("[ERROR: RT SPI] Failed to start spi worker thread: %s\n",
+           strerror(rv));
+    return false;
+  }
+  pthread_setname_np(spi_worker, "spi-board-1");
+  printf("[RT SPI] Transfer both boards at the same time\n");
+  spi_worker_state = 1;
+  return true;
+}
 
-    // do spi communication
-    int rv = ioctl(spi_board == 0 ? spi_1_fd : spi_2_fd, SPI_IOC_MESSAGE(1),
-                   &spi_message);
-    (void)rv;
+/*!
+ * Set the policy, priority and CPUs of the thread which transfers board 1,
+ * from the next transfer on.  Call it from the thread which transfers, or
+ * before the first transfer.
+ */
+void spi_set_worker_schedule(const PeriodicTaskSchedule &schedule) {
+  spi_worker_schedule = schedule;
+  spi_worker_reschedule = true;
+}
 
-    // flip bytes the other way
-    for (int i = 0; i < 30; i++)
-      data_d[i] = (rx_buf[i] >> 8) + ((rx_buf[i] & 0xff) << 8);
-    // data_d[i] = __bswap_16(rx_buf[i]);
+/*!
+ * @return schedule the thread which transfers board 1 really got from the last
+ * spi_set_worker_schedule, policy -1 if it was never set
+ */
+PeriodicTaskSchedule spi_get_worker_schedule() {
+  return spi_worker_effective_schedule;
+}
+
+/*!
+ * Transfer the boards at the same time (the default), or one after the other
+ */
+void spi_set_concurrent(bool concurrent) { spi_concurrent = concurrent; }
 
-    // copy back to data
-    spine_to_spi(data, &g_spine_data, spi_board * 2);
+/*!
+ * Use a loopback device instead of the spine boards, to run without hardware.
+ * Each board answers with its motors exactly where they are commanded to be.
+ * @param delay_us : how long a transfer takes, in us (about 180 for the 132
+ * bytes at 6 MHz)
+ */
+void spi_use_loopback(unsigned int delay_us) {
+  spi_loopback = true;
+  spi_loopback_delay_us = delay_us;
+}
+
+/*!
+ * send receive data and command from spine
+ */
+void spi_send_receive(spi_command_t *command, spi_data_t *data) {
+  // update driver status flag
+  spi_driver_iterations++;
+  data->spi_driver_status = spi_driver_iterations << 16;
+
+  if (spi_concurrent && spi_start_worker()) {
+    // the boards are on separate devices, which transfer in parallel
+    spi_worker_command = command;
+    spi_worker_data = data;
+    sem_post(&spi_worker_start);
+    spi_board_send_receive(command, data, 0);
+    while (sem_wait(&spi_worker_done) && errno == EINTR) {
+    }
+  } else {
+    for (int spi_board = 0; spi_board < 2; spi_board++)
+      spi_board_send_receive(command, data, spi_board);
   }
 }
 
@@ -0,0 +1,65 @@
+#!/usr/bin/env python3
+
+# Convert a text height map (one row of heights per line, like the "mesh"
+# terrain) into a tiled height map file for the "tiled-mesh" terrain.
+# The layout is TiledHeightMapHeader in common/include/Collision/
+# CollisionTiledHeightMap.h.
+#
+# usage: heightmap_to_tiles.py heightmap.txt heightmap.tiles grid x y z
+#        [tile_size]
+
+import struct
+import sys
+from array import array
+
+ALIGNMENT = 4096
+
+
+def round_up(n):
+    return (n + ALIGNMENT - 1) // ALIGNMENT * ALIGNMENT
+
+
+def main():
+    if len(sys.argv) not in (7, 8):
+        print("usage: {} heightmap.txt out.tiles grid x y z [tile_size]"
+              .format(sys.argv[0]))
+        sys.exit(1)
+
+    with open(sys.argv[1]) as f:
+        heights = [[float(h) for h in line.split()] for line in f
+                   if line.strip()]
+    rows = len(heights)
+    cols = len(heights[0])
+    if rows < 2 or cols < 2 or any(len(r) != cols for r in heights):
+        print("height map must be a rectangle of at least 2 x 2 values")
+        sys.exit(1)
+
+    grid = float(sys.argv[3])
+    corner = [float(v) for v in sys.argv[4:7]]
+    tile = int(sys.argv[7]) if len(sys.argv) == 8 else 256
+
+    header_format = "<8s5Q4d"
+    data_offset = round_up(struct.calcsize(header_format))
+    stride = round_up((tile + 1) ** 2 * 4)
+    header = struct.pack(header_format, b"TILEHMAP", rows, cols, tile,
+                         data_offset, stride, grid, *corner)
+    tiles_x = (rows + tile - 2) // tile
+    tiles_y = (cols + tile - 2) // tile
+
+    with open(sys.argv[2], "wb") as out:
+        out.write(header.ljust(data_offset, b"\0"))
+        for tx in range(tiles_x):
+            for ty in range(tiles_y):
+                data = array("f")
+                for a in range(tile + 1):
+                    row = heights[min(tx * tile + a, rows - 1)]
+                    for b in range(tile + 1):
+                        data.append(row[min(ty * tile + b, cols - 1)])
+                out.write(data.tobytes().ljust(stride, b"\0"))
+
+    print("wrote {} x {} samples in {} x {} tiles to {}".format(
+        rows, cols, tiles_x, tiles_y, sys.argv[2]))
+
+
+if __name__ == "__main__":
+    main()
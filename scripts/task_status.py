@@ -0,0 +1,63 @@
+#!/usr/bin/env python3
+
+# Print the latency summary of the periodic tasks of a running robot or
+# simulator program, from the shared memory written by
+# PeriodicTaskManager::exportStatus.  The layout is PeriodicTaskStatusTable
+# in common/include/Utilities/PeriodicTask.h.
+#
+# usage: task_status.py [shared memory name] [refresh period (s)]
+
+import struct
+import sys
+import time
+
+HEADER = struct.Struct("<QI4x")
+TASK = struct.Struct("<32sfIQQ4Q4Q")
+MAX_TASKS = 64
+
+
+def read_table(path):
+    # seqlock: retry while the table is being written
+    while True:
+        with open(path, "rb") as f:
+            data = f.read(HEADER.size + MAX_TASKS * TASK.size)
+        sequence, n_tasks = HEADER.unpack_from(data)
+        if sequence % 2 == 1:
+            continue
+        tasks = [TASK.unpack_from(data, HEADER.size + i * TASK.size)
+                 for i in range(min(n_tasks, MAX_TASKS))]
+        with open(path, "rb") as f:
+            if HEADER.unpack(f.read(HEADER.size))[0] == sequence:
+                return tasks
+
+
+def print_table(tasks):
+    print("|{:<20}|{:>6}|{:>8}|{:>8}|{:>8}|{:>8}|{:>8}|{:>8}|{:>8}|{:>8}"
+          .format("name", "T-des", "runs", "missed", "rt-p50", "rt-p99",
+                  "rt-max", "wk-p50", "wk-p99", "wk-max"))
+    for task in tasks:
+        name = task[0].split(b"\0", 1)[0].decode()
+        period, running, runs, missed = task[1:5]
+        runtime = [ns / 1e3 for ns in task[5:9]]
+        wakeup = [ns / 1e3 for ns in task[9:13]]
+        print("|{:<20}|{:6.4f}|{:8d}|{:8d}|{:8.1f}|{:8.1f}|{:8.1f}|{:8.1f}"
+              "|{:8.1f}|{:8.1f}{}".format(
+                  name, period, runs, missed, runtime[0], runtime[1],
+                  runtime[3], wakeup[0], wakeup[1], wakeup[3],
+                  "" if running else "  (stopped)"))
+
+
+def main():
+    name = sys.argv[1] if len(sys.argv) > 1 else "periodic-task-status"
+    refresh = float(sys.argv[2]) if len(sys.argv) > 2 else 0
+    path = "/dev/shm/" + name
+    while True:
+        print_table(read_table(path))
+        if refresh <= 0:
+            break
+        time.sleep(refresh)
+        print()
+
+
+if __name__ == "__main__":
+    main()
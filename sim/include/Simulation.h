@@ -27,6 +27,7 @@
 
 #ifdef LCM_MSG
 #include <lcm/lcm-cpp.hpp>
+#include "Utilities/TelemetryPublisher.h"
 #include "simulator_lcmt.hpp"
 #endif
 
@@ -93,6 +94,7 @@ class Simulation {
     delete _robotDataSimulator;
     delete _imuSimulator;
 #ifdef LCM_MSG
+    _telemetry.stop();
     delete _lcm;
 #endif
 
@@ -152,6 +154,8 @@ class Simulation {
   RobotType _robot;
 #ifdef LCM_MSG
   lcm::LCM* _lcm = nullptr;
+  TelemetryPublisher _telemetry{"sim-telemetry"};
+  TelemetryChannel<simulator_lcmt>* _simStateChannel = nullptr;
 #endif
 
   std::function<void(void)> _uiUpdate;
@@ -1,11 +1,10 @@
 #include "Simulation.h"
 #include "Dynamics/Quadruped.h"
-#include "Utilities/ParamHandler.hpp"
+#include "SimUtilities/TerrainLoader.h"
 
 // #include <Configuration.h>
 #include "GameController.h"
 #include <unistd.h>
-#include <fstream>
 
 // if DISABLE_HIGH_LEVEL_CONTROL is defined, the simulator will run freely,
 // without trying to connect to a robot
@@ -37,6 +36,9 @@ Simulation::Simulation(RobotType robot, Graphics3D *window, SimulatorControlPara
       printf("[ERROR] Failed to set up LCM\n");
       throw std::runtime_error("lcm bad");
     }
+    _simStateChannel =
+        _telemetry.addLcmChannel<simulator_lcmt>(_lcm, SIM_LCM_NAME);
+    _telemetry.start();
   }
 #endif
 
@@ -79,6 +81,11 @@ Simulation::Simulation(RobotType robot, Graphics3D *window, SimulatorControlPara
   _model = _quadruped.buildModel();
   _robotDataModel = _quadruped.buildModel();
   _simulator = new DynamicsSimulator<double>(_model, (bool)_simParams.use_spring_damper);
+  if (_simParams.use_spring_damper)
+    _simulator->setIntegrator(_simParams.getDynamicsIntegrator());
+  _simulator->setAdaptiveSubsteps(
+      (size_t)std::max<s64>(1, _simParams.dynamics_max_substeps),
+      _simParams.dynamics_error_tolerance);
   _robotDataSimulator = new DynamicsSimulator<double>(_robotDataModel, false);
 
   DVec<double> zero12(12);
@@ -462,10 +469,11 @@ void Simulation::highLevelControl() {
   _sharedMemory.simulatorIsDone();
 
 #ifdef LCM_MSG
-  // wait for robot code to finish (and send LCM while waiting)
+  // build the LCM message while waiting for the robot code, it is sent by
+  // the telemetry thread
   if (_lcm) {
     buildLcmMessage();
-    _lcm->publish(SIM_LCM_NAME, &_simLCM);
+    _simStateChannel->push(_simLCM);
   }
 #endif
 
@@ -675,168 +683,31 @@ void Simulation::runAtSpeed(std::function<void(std::string)> errorCallback, bool
 
 void Simulation::loadTerrainFile(const std::string& terrainFileName,
                                  bool addGraphics) {
-  printf("load terrain %s\n", terrainFileName.c_str());
-  ParamHandler paramHandler(terrainFileName);
-
-  if (!paramHandler.fileOpenedSuccessfully()) {
-    printf("[ERROR] could not open yaml file for terrain\n");
-    throw std::runtime_error("yaml bad");
-  }
-
-  std::vector<std::string> keys = paramHandler.getKeys();
-
-  for (auto& key : keys) {
-    auto load = [&](double& val, const std::string& name) {
-      if (!paramHandler.getValue<double>(key, name, val))
-        throw std::runtime_error("terrain read bad: " + key + " " + name);
-    };
-
-    auto loadVec = [&](double& val, const std::string& name, size_t idx) {
-      std::vector<double> v;
-      if (!paramHandler.getVector<double>(key, name, v))
-        throw std::runtime_error("terrain read bad: " + key + " " + name);
-      val = v.at(idx);
-    };
-
-    auto loadArray = [&](double* val, const std::string& name, size_t idx) {
-      std::vector<double> v;
-      if (!paramHandler.getVector<double>(key, name, v))
-        throw std::runtime_error("terrain read bad: " + key + " " + name);
-      assert(v.size() == idx);
-      for (size_t i = 0; i < idx; i++) val[i] = v[i];
-    };
-
-    printf("terrain element %s\n", key.c_str());
-    std::string typeName;
-    paramHandler.getString(key, "type", typeName);
-    if (typeName == "infinite-plane") {
-      double mu, resti, height, gfxX, gfxY, checkerX, checkerY;
-      load(mu, "mu");
-      load(resti, "restitution");
-      load(height, "height");
-      loadVec(gfxX, "graphicsSize", 0);
-      loadVec(gfxY, "graphicsSize", 1);
-      loadVec(checkerX, "checkers", 0);
-      loadVec(checkerY, "checkers", 1);
-      addCollisionPlane(mu, resti, height, gfxX, gfxY, checkerX, checkerY,
-                        addGraphics);
-    } else if (typeName == "box") {
-      double mu, resti, depth, width, height, transparent;
-      double pos[3];
-      double ori[3];
-      load(mu, "mu");
-      load(resti, "restitution");
-      load(depth, "depth");
-      load(width, "width");
-      load(height, "height");
-      loadArray(pos, "position", 3);
-      loadArray(ori, "orientation", 3);
-      load(transparent, "transparent");
-
-      Mat3<double> R_box = ori::rpyToRotMat(Vec3<double>(ori));
-      R_box.transposeInPlace();  // collisionBox uses "rotation" matrix instead
-                                 // of "transformation"
-      addCollisionBox(mu, resti, depth, width, height, Vec3<double>(pos), R_box,
-                      addGraphics, transparent != 0.);
-    } else if (typeName == "stairs") {
-      double mu, resti, rise, run, stepsDouble, width, transparent;
-      double pos[3];
-      double ori[3];
-      load(mu, "mu");
-      load(resti, "restitution");
-      load(rise, "rise");
-      load(width, "width");
-      load(run, "run");
-      load(stepsDouble, "steps");
-      loadArray(pos, "position", 3);
-      loadArray(ori, "orientation", 3);
-      load(transparent, "transparent");
-
-      Mat3<double> R = ori::rpyToRotMat(Vec3<double>(ori));
-      Vec3<double> pOff(pos);
-      R.transposeInPlace();  // "graphics" rotation matrix
-
-      size_t steps = (size_t)stepsDouble;
-
-      double heightOffset = rise / 2;
-      double runOffset = run / 2;
-      for (size_t step = 0; step < steps; step++) {
-        Vec3<double> p(runOffset, 0, heightOffset);
-        p = R * p + pOff;
-
-        addCollisionBox(mu, resti, run, width, heightOffset * 2, p, R,
-                        addGraphics, transparent != 0.);
-
-        heightOffset += rise / 2;
-        runOffset += run;
-      }
-    } else if (typeName == "mesh") {
-      double mu, resti, transparent, grid;
-      Vec3<double> left_corner;
-      std::vector<std::vector<double> > height_map_2d;
-      load(mu, "mu");
-      load(resti, "restitution");
-      load(transparent, "transparent");
-      load(grid, "grid");
-      loadVec(left_corner[0], "left_corner_loc", 0);
-      loadVec(left_corner[1], "left_corner_loc", 1);
-      loadVec(left_corner[2], "left_corner_loc", 2);
-
-      int x_len(0);
-      int y_len(0);
-      bool file_input(false);
-      paramHandler.getBoolean(key, "heightmap_file", file_input);
-      if (file_input) {
-        // Read from text file
-        std::string file_name;
-        paramHandler.getString(key, "heightmap_file_name", file_name);
-        std::ifstream f_height;
-        f_height.open(getConfigDirectoryPath(file_name));
-        if (!f_height.good()) {
-          std::cout << "file reading error: " << file_name << std::endl;
-        }
-        int i(0);
-        int j(0);
-        double tmp;
-
-        std::string line;
-        std::vector<double> height_map_vec;
-        while (getline(f_height, line)) {
-          std::istringstream iss(line);
-          j = 0;
-          while (iss >> tmp) {
-            height_map_vec.push_back(tmp);
-            ++j;
-          }
-          y_len = j;
-          height_map_2d.push_back(height_map_vec);
-          height_map_vec.clear();
-          // printf("y len: %d\n", y_len);
-          ++i;
-        }
-        x_len = i;
-
-      } else {
-        paramHandler.get2DArray(key, "height_map", height_map_2d);
-        x_len = height_map_2d.size();
-        y_len = height_map_2d[0].size();
-        // printf("x, y len: %d, %d\n", x_len, y_len);
-      }
-
-      DMat<double> height_map(x_len, y_len);
-      for (int i(0); i < x_len; ++i) {
-        for (int j(0); j < y_len; ++j) {
-          height_map(i, j) = height_map_2d[i][j];
-          // printf("height (%d, %d) : %f\n", i, j, height_map(i,j) );
-        }
-      }
-      addCollisionMesh(mu, resti, grid, left_corner, height_map, addGraphics,
-                       transparent != 0.);
-
-    } else {
-      throw std::runtime_error("unknown terrain " + typeName);
-    }
-  }
+  TerrainCallbacks callbacks;
+  callbacks.addPlane = [&](double mu, double resti, double height,
+                           double gfxX, double gfxY, double checkerX,
+                           double checkerY) {
+    addCollisionPlane(mu, resti, height, gfxX, gfxY, checkerX, checkerY,
+                      addGraphics);
+  };
+  callbacks.addBox = [&](double mu, double resti, double depth, double width,
+                         double height, const Vec3<double>& pos,
+                         const Mat3<double>& ori, bool transparent) {
+    addCollisionBox(mu, resti, depth, width, height, pos, ori, addGraphics,
+                    transparent);
+  };
+  callbacks.addMesh = [&](double mu, double resti, double grid,
+                          const Vec3<double>& leftCorner,
+                          const DMat<double>& heightMap, bool transparent) {
+    addCollisionMesh(mu, resti, grid, leftCorner, heightMap, addGraphics,
+                     transparent);
+  };
+  callbacks.addTiledMesh = [&](double mu, double resti,
+                               const std::string& fileName,
+                               size_t cachedTiles) {
+    _simulator->addCollisionTiledHeightMap(mu, resti, fileName, cachedTiles);
+  };
+  ::loadTerrainFile(terrainFileName, callbacks);
 }
 
 void Simulation::updateGraphics() {
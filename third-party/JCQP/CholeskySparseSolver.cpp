@@ -16,6 +16,7 @@ template<typename T>
 void CholeskySparseSolver<T>::preSetup(const DenseMatrix<T> &kktMat, bool b_print)
 {
   Timer tim;
+  freeAll();
   // get sizes
   A.m = kktMat.rows();
   A.n = kktMat.cols();
@@ -77,6 +78,7 @@ void CholeskySparseSolver<T>::preSetup(const DenseMatrix<T> &kktMat, bool b_prin
 template<typename T>
 void CholeskySparseSolver<T>::preSetup(const std::vector<SparseTriple<T>>& kktMat, u32 _n, bool b_print) {
   Timer tim;
+  freeAll();
 
   A.m = _n;
   A.n = _n;
@@ -107,7 +109,7 @@ void CholeskySparseSolver<T>::preSetup(const std::vector<SparseTriple<T>>& kktMa
   A.colPtrs[0] = 0;
   for(u32 c = 0; c < A.n; c++) {
     u32 cNNZ = 0;
-    while(kktMat[j].c == c && j < A.nnz) {
+    while(j < A.nnz && kktMat[j].c == c) {
       if(kktMat[j].r <= kktMat[j].c) {
         A.values[i] = kktMat[j].value;
         A.rowIdx[i] = kktMat[j].r;
@@ -124,6 +126,10 @@ void CholeskySparseSolver<T>::preSetup(const std::vector<SparseTriple<T>>& kktMa
   A.nnz = i;
 }
 
+/*!
+ * Reorder, do the symbolic factorization and factor.  After this, matrices with the same
+ * pattern only need updateValues() and factor().
+ */
 template<typename T>
 void CholeskySparseSolver<T>::setup(bool b_print)
 {
@@ -140,6 +146,11 @@ void CholeskySparseSolver<T>::setup(bool b_print)
 
   L.values = new T[L.nnz];
   L.rowIdx = new u32[L.nnz];
+  factorY = new T[n];
+  factorNext = new u32[n];
+  factorYIdx = new u32[n];
+  factorColUsed = new u8[n];
+  factorElims = new u32[n];
   factor();
   if(b_print) printf("CHOLSPARSE FACTOR %.3f ms\n", tim.getMs());
   tim.start();
@@ -150,6 +161,38 @@ void CholeskySparseSolver<T>::setup(bool b_print)
 #endif
 }
 
+/*!
+ * Load new values into a matrix which was already set up.  The triples must be sorted and
+ * unique (see sortAndSumTriples), like for preSetup, and have exactly the pattern of the
+ * matrix given to preSetup.  Call factor() afterward.
+ * @return false if the pattern is different, in which case nothing is changed and the
+ * solver needs preSetup() and setup() again
+ */
+template<typename T>
+bool CholeskySparseSolver<T>::updateValues(const std::vector<SparseTriple<T>>& kktMat)
+{
+  if(!isSetup()) return false;
+
+  // check the pattern first, so a mismatch leaves the old factorization alone
+  u32 i = 0;
+  for(auto& triple : kktMat) {
+    if(triple.r > triple.c) continue;
+    if(i >= A.nnz || triple.c >= n || origRowIdx[i] != triple.r ||
+       i < origColPtrs[triple.c] || i >= origColPtrs[triple.c + 1]) {
+      return false;
+    }
+    i++;
+  }
+  if(i != A.nnz) return false;
+
+  i = 0;
+  for(auto& triple : kktMat) {
+    if(triple.r > triple.c) continue;
+    A.values[permutedIdx[i++]] = triple.value;
+  }
+  return true;
+}
+
 template<typename T>
 void CholeskySparseSolver<T>::sanityCheck()
 {
@@ -171,6 +214,15 @@ void CholeskySparseSolver<T>::reorder()
   rP = new u32[n];
   amdOrder(A,P,rP);
 
+  origColPtrs = new u32[n + 1];
+  origRowIdx = new u32[A.nnz];
+  permutedIdx = new u32[A.nnz];
+  for(u32 j = 0; j < n + 1; j++) origColPtrs[j] = A.colPtrs[j];
+  for(u32 p = 0; p < A.nnz; p++) {
+    origRowIdx[p] = A.rowIdx[p];
+    permutedIdx[p] = 0;
+  }
+
   MatCSC<T> permuted;
   permuted.alloc(n, A.nnz);
 
@@ -208,6 +260,7 @@ void CholeskySparseSolver<T>::reorder()
       u32 s = temp[std::max(iNew, jNew)]++;
       permuted.rowIdx[s] = std::min(iNew, jNew);
       permuted.values[s] = A.values[p];
+      permutedIdx[p] = s;
     }
   }
 
@@ -270,15 +323,18 @@ u32 CholeskySparseSolver<T>::symbolicFactor()
   return L.colPtrs[n];
 }
 
+/*!
+ * Numeric factorization, with the ordering and pattern from setup()
+ */
 template<typename T>
 void CholeskySparseSolver<T>::factor()
 {
 
-  T* y = new T[n];
-  u32* next = new u32[n];
-  u32* yIdx = new u32[n];
-  u8* colUsed = new u8[n];
-  u32* elims = new u32[n];
+  T* y = factorY;
+  u32* next = factorNext;
+  u32* yIdx = factorYIdx;
+  u8* colUsed = factorColUsed;
+  u32* elims = factorElims;
 
   L.colPtrs[0] = 0;
   for(s32 i = 0; i < (s32)n; i++) {
@@ -345,12 +401,6 @@ void CholeskySparseSolver<T>::factor()
     rD[k] = 1./D[k];
   }
 
-  delete[] y;
-  delete[] next;
-  delete[] yIdx;
-  delete[] colUsed;
-  delete[] elims;
-
 //  s32* flag = new s32[n];
 //  s32* pat = new s32[n];
 //  for(s32 k = 0; k < n; k++) {
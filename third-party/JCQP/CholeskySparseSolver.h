@@ -12,13 +12,29 @@ class CholeskySparseSolver
 {
 public:
   CholeskySparseSolver() = default;
+  // the arrays are owned, so a copy (of a QpProblem) starts out empty and has to be set up again
+  CholeskySparseSolver(const CholeskySparseSolver&) { }
+  CholeskySparseSolver& operator=(const CholeskySparseSolver&) = delete;
   void preSetup(const DenseMatrix<T>& kktMat, bool b_print = true);
   void preSetup(const std::vector<SparseTriple<T>>& kktMat, u32 n, bool b_print = true);
   void setup(bool b_print = true);
+  bool updateValues(const std::vector<SparseTriple<T>>& kktMat);
+  void factor();
   void solve(Vector<T>& out);
   void amdOrder(MatCSC<T>& mat, u32* perm, u32* iperm);
 
+  /*!
+   * True once setup() has done the ordering and symbolic factorization, so
+   * matrices with the same pattern can go through updateValues() and factor()
+   */
+  bool isSetup() const { return L.values != nullptr; }
+
   ~CholeskySparseSolver() {
+    freeAll();
+  }
+private:
+  // inline, QpProblem<float> needs the destructor but there is no float instantiation
+  void freeAll() {
     A.freeAll();
     L.freeAll();
     delete[] reverseOrder;
@@ -29,11 +45,34 @@ public:
     delete[] rD;
     delete[] parent;
     delete[] tempSolve;
+    delete[] origColPtrs;
+    delete[] origRowIdx;
+    delete[] permutedIdx;
+    delete[] factorY;
+    delete[] factorNext;
+    delete[] factorYIdx;
+    delete[] factorColUsed;
+    delete[] factorElims;
+    reverseOrder = nullptr;
+    nnzLCol = nullptr;
+    P = nullptr;
+    D = nullptr;
+    rP = nullptr;
+    rD = nullptr;
+    parent = nullptr;
+    tempSolve = nullptr;
+    origColPtrs = nullptr;
+    origRowIdx = nullptr;
+    permutedIdx = nullptr;
+    factorY = nullptr;
+    factorNext = nullptr;
+    factorYIdx = nullptr;
+    factorColUsed = nullptr;
+    factorElims = nullptr;
   }
-private:
+
   void reorder();
   u32 symbolicFactor();
-  void factor();
   void sanityCheck();
   void solveOrder();
   SparseTriple<T> A_triple;
@@ -48,6 +87,19 @@ private:
   T*   D = nullptr;       // Diagonal
   T*   rD = nullptr;      // inverse diagonal
   s32* parent = nullptr;  // tree
+
+  // pattern of the matrix before reordering, and where each of its entries
+  // went in the reordered A
+  u32* origColPtrs = nullptr;
+  u32* origRowIdx = nullptr;
+  u32* permutedIdx = nullptr;
+
+  // workspace of factor()
+  T* factorY = nullptr;
+  u32* factorNext = nullptr;
+  u32* factorYIdx = nullptr;
+  u8* factorColUsed = nullptr;
+  u32* factorElims = nullptr;
 };
 
 
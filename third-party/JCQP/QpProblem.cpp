@@ -23,13 +23,14 @@ void QpProblem<T>::coldStart()
 }
 
 /*!
- * Build KKT matrix with triples.
+ * Build KKT matrix with triples.  Zeros in A_triples and P_triples are kept, so the pattern of
+ * the KKT matrix only depends on the pattern of the triples, not on their values.
  * @tparam T
  */
 template<typename T>
 void QpProblem<T>::setupTriples() {
   _kktTriples.clear();
-  _kktTriples.resize(P_triples.size() + A_triples.size() * 2 + n + m);
+  _kktTriples.reserve(P_triples.size() + A_triples.size() * 2 + n + m);
 
   // upper left P term
   _kktTriples.insert(_kktTriples.end(), P_triples.begin(), P_triples.end());
@@ -54,14 +55,17 @@ void QpProblem<T>::setupTriples() {
     _kktTriples.push_back({-_constraintInfos[i].invRho, (u32)(i+n), (u32)(i+n)});
   }
 
-  sortAndSumTriples(_kktTriples);
+  sortAndSumTriples(_kktTriples, true);
 }
 
 /*!
  * Solve QP using A,P values from A_triples and P_triples
+ * @param cachedSolver : optional solver which outlives this problem.  If it was set up for a KKT
+ * matrix with the same pattern, only the numeric factorization is redone.  Otherwise it is set up
+ * from scratch, for the next problem.
  */
 template<typename T>
-void QpProblem<T>::runFromTriples(s64 nIterations, bool b_print) {
+void QpProblem<T>::runFromTriples(s64 nIterations, bool b_print, CholeskySparseSolver<T>* cachedSolver) {
 
   Timer timer;
   Timer totalTimer, setupTimer;
@@ -116,18 +120,29 @@ void QpProblem<T>::runFromTriples(s64 nIterations, bool b_print) {
   }
 
 
-  // pre-setup the solver
-  _cholSparseSolver.preSetup(_kktTriples, n+m, b_print);
-  if(b_print) {
-    printf("QP Cholesky pre-setup Time: %.3f ms\n", timer.getMs());
-    timer.start();
-  }
+  _sparseSolver = cachedSolver ? cachedSolver : &_cholSparseSolver;
+  _reusedSymbolic = _sparseSolver->updateValues(_kktTriples);
+  if(_reusedSymbolic) {
+    // same pattern, only refactor
+    _sparseSolver->factor();
+    if(b_print) {
+      printf("QP Cholesky refactor Time: %.3f ms\n", timer.getMs());
+      timer.start();
+    }
+  } else {
+    // pre-setup the solver
+    _sparseSolver->preSetup(_kktTriples, n+m, b_print);
+    if(b_print) {
+      printf("QP Cholesky pre-setup Time: %.3f ms\n", timer.getMs());
+      timer.start();
+    }
 
-  // setup the solver (factor)
-  _cholSparseSolver.setup(b_print);
-  if(b_print) {
-    printf("QP Cholesky setup Time: %.3f ms\n", timer.getMs());
-    timer.start();
+    // setup the solver (factor)
+    _sparseSolver->setup(b_print);
+    if(b_print) {
+      printf("QP Cholesky setup Time: %.3f ms\n", timer.getMs());
+      timer.start();
+    }
   }
 
   double totalResidTime = 0;
@@ -179,6 +194,7 @@ void QpProblem<T>::runFromDense(s64 nIterations, bool sparse, bool b_print)
 {
     if(nIterations <0) {nIterations = settings.maxIterations; }
   _sparse = sparse;
+  _sparseSolver = &_cholSparseSolver;
   // print info
   if(b_print) {
     printf("n: %ld\nm: %ld\n, sz %ld", n, m, sizeof(T));
@@ -324,7 +340,7 @@ void QpProblem<T>::solveLinearSystem()
 
   if(_sparse)
   {
-    _cholSparseSolver.solve(_xzTilde);
+    _sparseSolver->solve(_xzTilde);
   }
   else
   {
@@ -55,12 +55,16 @@ class QpProblem
 {
 public:
 
-    QpProblem(s64 n_, s64 m_, bool print_timings = true)
-     : A(m_,n_), P(n_,n_),
+    /*!
+     * @param dense : allocate the dense A, P and KKT matrices, which are only used by runFromDense.
+     * Problems solved with runFromTriples can skip them.
+     */
+    QpProblem(s64 n_, s64 m_, bool print_timings = true, bool dense = true)
+     : A(dense ? m_ : 0, dense ? n_ : 0), P(dense ? n_ : 0, dense ? n_ : 0),
     l(m_), u(m_), q(n_), 
     n(n_), m(m_),
     _print(print_timings),
-    _kkt(n_ + m_, n_ + m_),
+    _kkt(dense ? n_ + m_ : 0, dense ? n_ + m_ : 0),
     _cholDenseSolver(print_timings),
     _xzTilde(n_ + m_), _y(m_),
     _x0(n_), _x1(n_), _z0(m_), _z1(m_),   
@@ -75,10 +79,17 @@ public:
     }
 
     void runFromDense(s64 nIterations = -1, bool sparse = false, bool b_print = true);
-    void runFromTriples(s64 nIterations = -1, bool b_print = true);
+    void runFromTriples(s64 nIterations = -1, bool b_print = true,
+                        CholeskySparseSolver<T>* cachedSolver = nullptr);
 
     Vector<T>& getSolution() { return *_x; }
 
+    /*!
+     * True if the last runFromTriples reused the ordering and symbolic factorization of its cached
+     * solver and only had to redo the numeric factorization
+     */
+    bool reusedSymbolicFactor() const { return _reusedSymbolic; }
+
 
 
   // public data
@@ -111,6 +122,7 @@ private:
 
   CholeskyDenseSolver<T> _cholDenseSolver;
   CholeskySparseSolver<T> _cholSparseSolver;
+  CholeskySparseSolver<T>* _sparseSolver = &_cholSparseSolver; // own or cached solver
   Eigen::SparseMatrix<T> Asparse, Psparse;
 
   Vector<T> _xzTilde, _y;
@@ -122,7 +134,7 @@ private:
 
 
 
-  bool _hotStarted = false, _sparse = false;
+  bool _hotStarted = false, _sparse = false, _reusedSymbolic = false;
 };
 
 
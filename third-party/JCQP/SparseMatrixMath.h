@@ -7,6 +7,9 @@
 #ifndef PROJECT_SPARSEMATRIXMATH_H
 #define PROJECT_SPARSEMATRIXMATH_H
 
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
 #include "types.h"
 
 /*!
@@ -32,6 +35,9 @@ struct MatCSC {
     delete[] values;
     delete[] colPtrs;
     delete[] rowIdx;
+    values = nullptr;
+    colPtrs = nullptr;
+    rowIdx = nullptr;
   }
 };
 
@@ -79,10 +85,12 @@ void sortTriples(std::vector<SparseTriple<T>>& triples, bool checkDuplicates) {
 }
 
 /*!
- * Take a sorted list of triples and merges them to create a sorted list of unique triples
+ * Take a sorted list of triples and merges them to create a sorted list of unique triples.
+ * Zeros are dropped, unless keepZeros is set.  Keeping them makes the pattern depend only on
+ * which entries were added, not on their values.
  */
 template<typename T>
-void sumSortedTriples(std::vector<SparseTriple<T>>& triples) {
+void sumSortedTriples(std::vector<SparseTriple<T>>& triples, bool keepZeros = false) {
   std::vector<SparseTriple<T>> temp = triples;
   u64 oldSize = triples.size();
   triples.clear();
@@ -91,7 +99,7 @@ void sumSortedTriples(std::vector<SparseTriple<T>>& triples) {
   u32 lastRow = UINT32_MAX, lastCol = UINT32_MAX;
 
   for(auto& triple : temp) {
-    if(triple.value == 0.0) continue;
+    if(triple.value == 0.0 && !keepZeros) continue;
     if(triple.r == lastRow && triple.c == lastCol) {
       triples.back().value += triple.value;
     } else {
@@ -107,9 +115,9 @@ void sumSortedTriples(std::vector<SparseTriple<T>>& triples) {
  * a list of sorted, unique triples.
  */
 template<typename T>
-void sortAndSumTriples(std::vector<SparseTriple<T>>& triples) {
+void sortAndSumTriples(std::vector<SparseTriple<T>>& triples, bool keepZeros = false) {
   sortTriples(triples, false);
-  sumSortedTriples(triples);
+  sumSortedTriples(triples, keepZeros);
 }
 
 
@@ -1,6 +1,6 @@
 #include "VisionMPC_interface.h"
 #include "../convexMPC/common_types.h"
-#include "VisionSolverMPC.h"
+#include "../convexMPC/CondensedMpcSolver.h"
 #include <Eigen/Dense>
 #include <pthread.h>
 #include <stdio.h>
@@ -17,6 +17,11 @@ pthread_t vision_mpc_solve_thread;
 
 u8 v_first_run = 1;
 
+//same solver as the convex MPC, with the drag acting on the x velocity
+DispatchingMpcSolver<fpt, K_FIXED_HORIZON> vision_solver(MpcDragModel::X_ACCELERATION);
+update_data_t v_solver_update;
+problem_setup v_solver_setup;
+
 void vision_initialize_mpc()
 {
   //printf("Initializing MPC!\n");
@@ -42,7 +47,7 @@ void vision_setup_problem(double dt, int horizon, double mu, double f_max)
   v_problem_config.dt = dt;
 
   //pthread_mutex_unlock(&problem_cfg_mt);
-  vision_resize_qp_mats(horizon);
+  vision_solver.resize(horizon);
 }
 
 //inline to motivate gcc to unroll the loop in here.
@@ -58,6 +63,29 @@ inline void vision_mint_to_u8(u8* dst, mint* src, s32 n_items) {
 
 int vision_has_solved = 0;
 
+void vision_solve_mpc(vision_mpc_update_data_t* update, vision_mpc_problem_setup* setup)
+{
+  memcpy(v_solver_update.p, update->p, sizeof(float) * 3);
+  memcpy(v_solver_update.v, update->v, sizeof(float) * 3);
+  memcpy(v_solver_update.q, update->q, sizeof(float) * 4);
+  memcpy(v_solver_update.w, update->w, sizeof(float) * 3);
+  memcpy(v_solver_update.r, update->r, sizeof(float) * 12);
+  v_solver_update.yaw = update->yaw;
+  memcpy(v_solver_update.weights, update->weights, sizeof(float) * 12);
+  memcpy(v_solver_update.traj, update->traj, sizeof(float) * 12 * setup->horizon);
+  v_solver_update.alpha = update->alpha;
+  memcpy(v_solver_update.gait, update->gait, 4 * setup->horizon);
+  v_solver_update.x_drag = update->x_drag;
+  v_solver_update.use_jcqp = 0;
+
+  v_solver_setup.dt = setup->dt;
+  v_solver_setup.mu = setup->mu;
+  v_solver_setup.f_max = setup->f_max;
+  v_solver_setup.horizon = setup->horizon;
+
+  vision_solver.solve(v_solver_update, v_solver_setup);
+}
+
 //safely copies problem data and starts the solver
 void vision_update_problem_data(double* p, double* v, double* q, double* w, double* r, double yaw, double* weights, double* state_trajectory, double alpha, int* gait)
 {
@@ -100,6 +128,5 @@ void vision_update_problem_data_floats(float* p, float* v, float* q, float* w,
 double vision_get_solution(int index)
 {
   if(!vision_has_solved) return 0.f;
-  mfp* qs = vision_get_q_soln();
-  return qs[index];
+  return vision_solver.solution()[index];
 }
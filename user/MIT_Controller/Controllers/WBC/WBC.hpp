@@ -4,6 +4,7 @@
 #include <Utilities/Utilities_print.h>
 #include <Utilities/pseudoInverse.h>
 #include <cppTypes.h>
+#include <Dynamics/MassMatrixLTL.h>
 #include <vector>
 #include "ContactSpec.hpp"
 #include "Task.hpp"
@@ -25,20 +26,23 @@ class WBC {
   }
   virtual ~WBC() {}
 
-  virtual void UpdateSetting(const DMat<T>& A, const DMat<T>& Ainv,
+  virtual void UpdateSetting(const DMat<T>& A, const MassMatrixLTL<T>& Afactor,
                              const DVec<T>& cori, const DVec<T>& grav,
                              void* extra_setting = NULL) = 0;
 
   virtual void MakeTorque(DVec<T>& cmd, void* extra_input = NULL) = 0;
 
  protected:
-  // full rank fat matrix only
-  void _WeightedInverse(const DMat<T>& J, const DMat<T>& Winv, DMat<T>& Jinv,
+  // full rank fat matrix only, weighted by the inverse of the mass matrix
+  void _WeightedInverse(const DMat<T>& J, DMat<T>& Jinv,
                         double threshold = 0.0001) {
-    DMat<T> lambda(J * Winv * J.transpose());
+    // with A = L^T L, J A^-1 J^T = (L^-T J^T)^T (L^-T J^T)
+    DMat<T> LinvTJt = Afactor_.sqrtInverseTimes(J.transpose());
+    DMat<T> lambda(LinvTJt.transpose() * LinvTJt);
     DMat<T> lambda_inv;
     pseudoInverse(lambda, threshold, lambda_inv);
-    Jinv = Winv * J.transpose() * lambda_inv;
+    Afactor_.applyLInverse(LinvTJt);
+    Jinv = LinvTJt * lambda_inv;
   }
 
   size_t num_act_joint_;
@@ -48,7 +52,7 @@ class WBC {
   DMat<T> Sv_;  // Virtual joint
 
   DMat<T> A_;
-  DMat<T> Ainv_;
+  MassMatrixLTL<T> Afactor_;
   DVec<T> cori_;
   DVec<T> grav_;
 
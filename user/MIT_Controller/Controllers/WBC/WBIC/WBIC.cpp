@@ -35,7 +35,7 @@ void WBIC<T>::MakeTorque(DVec<T>& cmd, void* extra_input) {
 
     // Set inequality constraints
     _SetInEqualityConstraint();
-    WB::_WeightedInverse(_Jc, WB::Ainv_, JcBar);
+    WB::_WeightedInverse(_Jc, JcBar);
     qddot_pre = JcBar * (-_JcDotQdot);
     Npre = _eye - JcBar * _Jc;
     // pretty_print(JcBar, std::cout, "JcBar");
@@ -59,7 +59,7 @@ void WBIC<T>::MakeTorque(DVec<T>& cmd, void* extra_input) {
     task->getCommand(xddot);
 
     JtPre = Jt * Npre;
-    WB::_WeightedInverse(JtPre, WB::Ainv_, JtBar);
+    WB::_WeightedInverse(JtPre, JtBar);
 
     qddot_pre += JtBar * (xddot - JtDotQdot - Jt * qddot_pre);
     Npre = Npre * (_eye - JtBar * JtPre);
@@ -264,11 +264,11 @@ void WBIC<T>::_SetCost() {
 }
 
 template <typename T>
-void WBIC<T>::UpdateSetting(const DMat<T>& A, const DMat<T>& Ainv,
+void WBIC<T>::UpdateSetting(const DMat<T>& A, const MassMatrixLTL<T>& Afactor,
     const DVec<T>& cori, const DVec<T>& grav,
     void* extra_setting) {
   WB::A_ = A;
-  WB::Ainv_ = Ainv;
+  WB::Afactor_ = Afactor;
   WB::cori_ = cori;
   WB::grav_ = grav;
   WB::b_updatesetting_ = true;
@@ -30,7 +30,7 @@ class WBIC : public WBC<T> {
        const std::vector<Task<T>*>* task_list);
   virtual ~WBIC() {}
 
-  virtual void UpdateSetting(const DMat<T>& A, const DMat<T>& Ainv,
+  virtual void UpdateSetting(const DMat<T>& A, const MassMatrixLTL<T>& Afactor,
                              const DVec<T>& cori, const DVec<T>& grav,
                              void* extra_setting = NULL);
 
@@ -224,7 +224,7 @@ void LocomotionCtrl<T>::_LCM_PublishData() {
   WBCtrl::_wbc_data_lcm.body_ori_cmd[3] = _quat_des[3];
   WBCtrl::_wbc_data_lcm.body_ori[3] = WBCtrl::_state.bodyOrientation[3];
 
-  WBCtrl::_wbcLCM.publish("wbc_lcm_data", &(WBCtrl::_wbc_data_lcm) );
+  WBCtrl::_wbcDataChannel->push(WBCtrl::_wbc_data_lcm);
 }
 #endif
 
@@ -2,6 +2,23 @@
 #include <Utilities/Utilities_print.h>
 #include <Utilities/Timer.h>
 
+#ifdef LCM_MSG
+/*!
+ * Channel of the WBC data.  Only one WBC controller runs at a time, all in
+ * the control thread, so they share it.
+ */
+static TelemetryChannel<wbc_test_data_t>* getWbcDataChannel() {
+  static lcm::LCM lcm(getLcmUrl(255));
+  static TelemetryPublisher publisher("wbc-telemetry");
+  static TelemetryChannel<wbc_test_data_t>* channel = [] {
+    auto* c = publisher.addLcmChannel<wbc_test_data_t>(&lcm, "wbc_lcm_data");
+    publisher.start();
+    return c;
+  }();
+  return channel;
+}
+#endif
+
 template<typename T>
 WBC_Ctrl<T>::WBC_Ctrl(FloatingBaseModel<T> model):
 #ifdef LCM_MSG
@@ -9,7 +26,7 @@ WBC_Ctrl<T>::WBC_Ctrl(FloatingBaseModel<T> model):
   _tau_ff(cheetah::num_act_joint),
   _des_jpos(cheetah::num_act_joint),
   _des_jvel(cheetah::num_act_joint),
-  _wbcLCM(getLcmUrl(255))
+  _wbcDataChannel(getWbcDataChannel())
 #else
   _full_config(cheetah::num_act_joint + 7),
   _tau_ff(cheetah::num_act_joint),
@@ -21,6 +38,7 @@ WBC_Ctrl<T>::WBC_Ctrl(FloatingBaseModel<T> model):
   _full_config.setZero();
 
   _model = model;
+  _Afactor.setParents(_model._parents);
   _kin_wbc = new KinWBC<T>(cheetah::dim_config);
 
   _wbic = new WBIC<T>(cheetah::dim_config, &(_contact_list), &(_task_list));
@@ -69,7 +87,7 @@ void WBC_Ctrl<T>::_ComputeWBC() {
                               _des_jpos, _des_jvel);
 
   // WBIC
-  _wbic->UpdateSetting(_A, _Ainv, _coriolis, _grav);
+  _wbic->UpdateSetting(_A, _Afactor, _coriolis, _grav);
   _wbic->MakeTorque(_tau_ff, _wbic_data);
 }
 
@@ -174,7 +192,9 @@ void WBC_Ctrl<T>::_UpdateModel(const StateEstimate<T> & state_est,
   _A = _model.getMassMatrix();
   _grav = _model.getGravityForce();
   _coriolis = _model.getCoriolisForce();
-  _Ainv = _A.inverse();
+  if (!_Afactor.factor(_A)) {
+    printf("[WBC Ctrl] mass matrix is not positive definite\n");
+  }
 }
 
 
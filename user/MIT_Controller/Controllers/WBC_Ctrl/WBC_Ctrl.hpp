@@ -3,6 +3,7 @@
 
 #include <FSM_States/ControlFSMData.h>
 #include <Dynamics/FloatingBaseModel.h>
+#include <Dynamics/MassMatrixLTL.h>
 #include <Dynamics/Quadruped.h>
 #include "cppTypes.h"
 #include <WBC/WBIC/WBIC.hpp>
@@ -10,6 +11,7 @@
 
 #ifdef LCM_MSG
 #include <lcm/lcm-cpp.hpp>
+#include <Utilities/TelemetryPublisher.h>
 #include "wbc_test_data_t.hpp"
 #else
 typedef struct _wbc_test_data_t {
@@ -79,7 +81,7 @@ class WBC_Ctrl{
     std::vector<Task<T> * > _task_list;
 
     DMat<T> _A;
-    DMat<T> _Ainv;
+    MassMatrixLTL<T> _Afactor;
     DVec<T> _grav;
     DVec<T> _coriolis;
 
@@ -96,7 +98,8 @@ class WBC_Ctrl{
     unsigned long long _iter;
 
 #ifdef LCM_MSG
-    lcm::LCM _wbcLCM;
+    // sent by a publisher thread shared by all WBC controllers
+    TelemetryChannel<wbc_test_data_t>* _wbcDataChannel;
     wbc_test_data_t _wbc_data_lcm;
 #else
     wbc_test_data_t _wbc_data_lcm;
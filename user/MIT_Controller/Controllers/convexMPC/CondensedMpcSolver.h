@@ -0,0 +1,924 @@
+/*! @file CondensedMpcSolver.h
+ *  @brief Dense convex MPC of the single rigid body model
+ *
+ * Builds the condensed QP of the convex MPC, removes the forces of feet which
+ * are in swing and solves what is left with qpOASES.  All state is owned by
+ * the solver object, so any number of problems can be set up and solved at
+ * the same time, one per instance.  The convex MPC and the vision MPC both
+ * run on this solver, they differ only in where the drag term enters.
+ *
+ * Storage is sized on the first solve and only reallocated when the horizon
+ * changes.  Horizon fixes the number of MPC steps at compile time, which
+ * makes every matrix and qpOASES buffer fixed-size member storage and lets
+ * the compiler unroll the block loops.  Eigen::Dynamic picks the horizon at
+ * run time.  DispatchingMpcSolver uses the fixed-size solver for the usual
+ * horizon and falls back to the dynamic one for all others.
+ *
+ * With setup.variable_dt each step has its own length, e.g. short steps near
+ * now and long ones further out, which covers a longer lookahead with the same
+ * number of steps.  Each distinct dt is discretized once per solve, and the
+ * cost is condensed with a backward recursion instead of the block Toeplitz
+ * structure of equal steps.
+ */
+
+#ifndef CHEETAH_SOFTWARE_CONDENSEDMPCSOLVER_H
+#define CHEETAH_SOFTWARE_CONDENSEDMPCSOLVER_H
+
+#include <Eigen/Dense>
+#include <qpOASES.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <stdio.h>
+#include <type_traits>
+#include <vector>
+#include "MpcDiscretization.h"
+#include "common_types.h"
+#include "convexMPC_interface.h"
+
+#ifdef LOCO_JCQP
+#include "third-party/JCQP/QpProblem.h"
+#endif
+
+/*!
+ * Where the x velocity drag term enters the continuous time dynamics
+ */
+enum class MpcDragModel {
+  VERTICAL_ACCELERATION,  // z acceleration depends on x velocity
+  X_ACCELERATION          // x acceleration depends on x velocity
+};
+
+template <typename T, int Horizon = Eigen::Dynamic>
+class CondensedMpcSolver {
+ public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  static constexpr int kStates =
+      Horizon == Eigen::Dynamic ? Eigen::Dynamic : 13 * Horizon;
+  static constexpr int kVars =
+      Horizon == Eigen::Dynamic ? Eigen::Dynamic : 12 * Horizon;
+  static constexpr int kCons =
+      Horizon == Eigen::Dynamic ? Eigen::Dynamic : 20 * Horizon;
+
+  static_assert(Horizon == Eigen::Dynamic ||
+                    sizeof(T) * 144 * Horizon * Horizon <=
+                        EIGEN_STACK_ALLOCATION_LIMIT,
+                "fixed horizon too long for a fixed-size Hessian");
+
+  using real_t = qpOASES::real_t;
+
+  // std::array for a fixed horizon, std::vector otherwise
+  template <typename S, int FixedSize>
+  using Buffer = typename std::conditional<Horizon == Eigen::Dynamic,
+                                           std::vector<S>,
+                                           std::array<S, FixedSize>>::type;
+  template <typename M>
+  using Matrices = Buffer<M, Horizon == Eigen::Dynamic ? 1 : Horizon + 1>;
+
+  explicit CondensedMpcSolver(
+      MpcDragModel dragModel = MpcDragModel::VERTICAL_ACCELERATION)
+      : _dragModel(dragModel) {
+    I_body.setZero();
+    I_body.diagonal() << T(.07), T(.26), T(.242);
+  }
+
+  bool resize(s16 horizon);
+  void solve(const update_data_t& update, const problem_setup& setup);
+  void buildQp(const update_data_t& update, const problem_setup& setup);
+  void c2qp(const Eigen::Matrix<T, 13, 13>& Ac,
+            const Eigen::Matrix<T, 13, 12>& Bc, T dt, s16 horizon);
+  void c2qpVariableDt(const Eigen::Matrix<T, 13, 13>& Ac,
+                      const Eigen::Matrix<T, 13, 12>& Bc, const float* dts,
+                      s16 horizon);
+  void condenseCost(T alpha, s16 horizon);
+  int solveReducedQp(qpOASES::int_t nWSR_max);
+  void guessWorkingSet(s16 horizon);
+  T evaluateCost(const real_t* forces) const;
+
+  /*!
+   * Forces of the last solve, 12 per step (3 per foot), zero for swing feet
+   */
+  const real_t* solution() const { return q_soln.data(); }
+
+  /*!
+   * MPC cost of the last solution, sum_k |x_k - x_des[k]|_Q^2 + alpha*|u|^2.
+   * Infinite if the QP solver failed.
+   */
+  T cost() const { return _cost; }
+
+  /*!
+   * Number of horizon steps the buffers are currently sized for
+   */
+  s16 horizon() const { return _horizon; }
+
+  /*!
+   * Number of times the buffers have actually been (re)allocated
+   */
+  u32 allocationCount() const { return _allocationCount; }
+
+  MpcDragModel dragModel() const { return _dragModel; }
+
+  /*!
+   * True if the last QP had steps of different length
+   */
+  bool variableDt() const { return _variableDt; }
+
+  /*!
+   * Discrete dynamics of step k, x[k+1] = stepAdt(k) * x[k] + stepBdt(k) * u[k]
+   */
+  const Eigen::Matrix<T, 13, 13>& stepAdt(s16 k) const {
+    return _variableDt ? Adt_cache[dt_index[k]] : Adt;
+  }
+  const Eigen::Matrix<T, 13, 12>& stepBdt(s16 k) const {
+    return _variableDt ? Bdt_cache[dt_index[k]] : Bdt;
+  }
+
+  // single rigid body model
+  T mass = 9;
+  Eigen::Matrix<T, 3, 3> I_body;
+
+  // condensed dynamics.  B_qp is block lower triangular Toeplitz with block
+  // (r,c) = Adt^(r-c) * Bdt, so only the distinct blocks are stored.
+  Eigen::Matrix<T, 13, 12> Bdt;
+  Eigen::Matrix<T, 13, 13> Adt;
+  Matrices<Eigen::Matrix<T, 13, 13>> powerMats;  // Adt^k, k = 0..horizon
+  Matrices<Eigen::Matrix<T, 13, 12>> AB;  // Adt^k * Bdt, k = 0..horizon-1
+  Matrices<Eigen::Matrix<T, 13, 12>> QAB;  // Q * Adt^k * Bdt
+
+  // with variable dt, the distinct step lengths and their discretizations.
+  // Step k uses entry dt_index[k], Adt and Bdt are those of step 0 and
+  // powerMats[k] is the product of the first k step matrices.
+  Matrices<Eigen::Matrix<T, 13, 13>> Adt_cache;
+  Matrices<Eigen::Matrix<T, 13, 12>> Bdt_cache;
+  Buffer<T, Horizon> dt_cache;
+  Buffer<int, Horizon> dt_index;
+  int dt_cache_size = 0;
+  Matrices<Eigen::Matrix<T, 13, 12>> SB;  // S_k * Bdt_k, see condenseCost
+
+  // initial state and continuous time dynamics
+  Eigen::Matrix<T, 13, 1> x_0;
+  Eigen::Matrix<T, 3, 3> I_world;
+  Eigen::Matrix<T, 13, 13> A_ct;
+  Eigen::Matrix<T, 13, 12> B_ct_r;
+
+  // cost, reference and constraints.  The state weights are the same
+  // diagonal Q at every step, the friction cone constraint matrix is
+  // block diagonal with the same f_block for each foot and step.
+  Eigen::Matrix<T, 13, 1> Q;
+  Eigen::Matrix<T, kStates, 1> X_d;
+  Eigen::Matrix<T, kCons, 1> U_b;
+  Eigen::Matrix<T, 5, 3> f_block;
+
+  // QP cost
+  Eigen::Matrix<T, kVars, kVars> qH;
+  Eigen::Matrix<T, kVars, 1> qg;
+  Eigen::Matrix<T, kStates, 1> Qx_err;  // Q * (Adt^(k+1) * x_0 - x_des[k])
+  T x_err_cost = 0;  // cost of the unforced trajectory, sum_k |x_err[k]|_Q^2
+
+  // solution for all variables
+  Buffer<real_t, kVars> q_soln;
+
+  // QP with the variables of swing feet eliminated, in qpOASES (row major)
+  // format
+  Buffer<real_t, kVars * kVars> H_red;
+  Buffer<real_t, kVars> g_red;
+  Buffer<real_t, kCons * kVars> A_red;
+  Buffer<real_t, kCons> lb_red;
+  Buffer<real_t, kCons> ub_red;
+  Buffer<real_t, kVars> q_red;
+
+  Buffer<char, kVars> var_elim;
+  Buffer<char, kCons> con_elim;
+  Buffer<int, kVars> var_ind;
+  Buffer<int, kCons> con_ind;
+  s32 new_vars = 0;
+  s32 new_cons = 0;
+
+  // qpOASES problem kept between solves so its working set can warm start
+  // the next one.  prev_con_map maps a full constraint index of the last
+  // solved problem to its reduced index, or -1 if it was eliminated.  The
+  // guessed working set is sized by resize for every constraint of the
+  // horizon, solves only change the status of its constraints.
+  std::unique_ptr<qpOASES::SQProblem> qp;
+  Buffer<real_t, kCons> prev_working_set;
+  qpOASES::Constraints guessed_constraints;
+  qpOASES::Bounds guessed_bounds;
+  Buffer<int, kCons> prev_con_map;
+  bool warm_start = true;
+
+  // warm start statistics
+  u64 qp_hotstarts = 0;
+  u64 qp_cold_starts = 0;
+  u64 qp_failed_hotstarts = 0;
+  u64 qp_hotstart_wsr = 0;
+  u64 qp_cold_start_wsr = 0;
+  int qp_last_wsr = 0;
+
+ private:
+  void setState(const update_data_t& update, Eigen::Matrix<T, 3, 4>& r_feet,
+                Eigen::Matrix<T, 3, 3>& R_yaw);
+  void ctSsMats(const Eigen::Matrix<T, 3, 4>& r_feet,
+                const Eigen::Matrix<T, 3, 3>& R_yaw, T x_drag);
+  void setGuessedStatus(int c, qpOASES::SubjectToStatus status);
+  void condenseToeplitz(s16 horizon);
+  void condenseVariableDt(s16 horizon);
+
+  /*!
+   * Number of steps, known at compile time for a fixed horizon
+   */
+  s16 steps(s16 horizon) const {
+    return Horizon == Eigen::Dynamic ? horizon : Horizon;
+  }
+
+  static bool nearZero(real_t a) { return (a < 0.01 && a > -.01); }
+
+  template <typename S>
+  static void sizeBuffer(std::vector<S>& buffer, s32 n) {
+    buffer.assign(n, 0);
+  }
+  template <typename S, size_t N>
+  static void sizeBuffer(std::array<S, N>& buffer, s32 n) {
+    (void)n;
+    buffer.fill(0);
+  }
+  template <typename M>
+  static void sizeMatrices(std::vector<M>& matrices, s32 n) {
+    matrices.resize(n);
+  }
+  template <typename M, size_t N>
+  static void sizeMatrices(std::array<M, N>& matrices, s32 n) {
+    (void)matrices;
+    (void)n;
+  }
+
+  MpcDragModel _dragModel;
+  s16 _horizon = 0;
+  u32 _allocationCount = 0;
+  bool _variableDt = false;
+  T _cost = 0;
+};
+
+/*!
+ * Size all buffers for the given horizon.  Does nothing if the solver is
+ * already sized for this horizon, so it is safe to call on every MPC tick.
+ * @param horizon number of MPC steps
+ * @return true if the buffers were (re)allocated
+ */
+template <typename T, int Horizon>
+bool CondensedMpcSolver<T, Horizon>::resize(s16 horizon) {
+  if (horizon == _horizon) return false;
+  if (horizon > K_MAX_GAIT_SEGMENTS) {
+    throw std::runtime_error("horizon is too long!");
+  }
+  if (Horizon != Eigen::Dynamic && horizon != Horizon) {
+    throw std::runtime_error("horizon does not match the solver!");
+  }
+
+  sizeMatrices(powerMats, horizon + 1);
+  sizeMatrices(AB, horizon);
+  sizeMatrices(QAB, horizon);
+  sizeMatrices(Adt_cache, horizon);
+  sizeMatrices(Bdt_cache, horizon);
+  sizeMatrices(SB, horizon);
+  X_d.resize(13 * horizon, Eigen::NoChange);
+  U_b.resize(20 * horizon, Eigen::NoChange);
+  qH.resize(12 * horizon, 12 * horizon);
+  qg.resize(12 * horizon, Eigen::NoChange);
+  Qx_err.resize(13 * horizon, Eigen::NoChange);
+
+  // entries which are never written by the solver (the gravity rows of X_d)
+  // rely on this zeroing
+  X_d.setZero();
+  U_b.setZero();
+  qH.setZero();
+  qg.setZero();
+  Qx_err.setZero();
+
+  s32 nV = 12 * horizon;
+  s32 nC = 20 * horizon;
+
+  sizeBuffer(q_soln, nV);
+  sizeBuffer(dt_cache, horizon);
+  sizeBuffer(dt_index, horizon);
+  dt_cache_size = 0;
+
+  sizeBuffer(H_red, nV * nV);
+  sizeBuffer(g_red, nV);
+  sizeBuffer(A_red, nC * nV);
+  sizeBuffer(lb_red, nC);
+  sizeBuffer(ub_red, nC);
+  sizeBuffer(q_red, nV);
+
+  sizeBuffer(var_elim, nV);
+  sizeBuffer(con_elim, nC);
+  sizeBuffer(var_ind, nV);
+  sizeBuffer(con_ind, nC);
+
+  // the old working set does not fit the new horizon
+  qp.reset();
+  sizeBuffer(prev_con_map, nC);
+  std::fill(prev_con_map.begin(), prev_con_map.end(), -1);
+  sizeBuffer(prev_working_set, nC);
+  // there are no bounds on the forces, only constraints
+  guessed_bounds.init(nV);
+  guessed_bounds.setupAllFree();
+  guessed_constraints.init(nC);
+  guessed_constraints.setupAllInactive();
+
+  _horizon = horizon;
+  _allocationCount++;
+
+#ifdef K_DEBUG
+  printf("RESIZED MATRICES FOR HORIZON: %d\n", horizon);
+#endif
+  return true;
+}
+
+/*!
+ * Discretize the dynamics and build the first block column of B_qp
+ */
+template <typename T, int Horizon>
+void CondensedMpcSolver<T, Horizon>::c2qp(const Eigen::Matrix<T, 13, 13>& Ac,
+                                          const Eigen::Matrix<T, 13, 12>& Bc,
+                                          T dt, s16 horizon) {
+  horizon = steps(horizon);
+  discretize_dynamics(Ac, Bc, dt, Adt, Bdt);
+
+  // A_qp is never formed either, its blocks are powerMats[1..horizon]
+  powerMats[0].setIdentity();
+  for (s16 i = 1; i < horizon + 1; i++) {
+    powerMats[i].noalias() = Adt * powerMats[i - 1];
+  }
+
+  for (s16 k = 0; k < horizon; k++) {
+    AB[k].noalias() = powerMats[k] * Bdt;
+  }
+}
+
+/*!
+ * Discretize the dynamics for steps of different length.  Steps of the same
+ * length share their discretization.
+ * @param dts length of each step
+ */
+template <typename T, int Horizon>
+void CondensedMpcSolver<T, Horizon>::c2qpVariableDt(
+    const Eigen::Matrix<T, 13, 13>& Ac, const Eigen::Matrix<T, 13, 12>& Bc,
+    const float* dts, s16 horizon) {
+  horizon = steps(horizon);
+  dt_cache_size = 0;
+  for (s16 k = 0; k < horizon; k++) {
+    T dt = T(dts[k]);
+    int i = 0;
+    while (i < dt_cache_size && dt_cache[i] != dt) i++;
+    if (i == dt_cache_size) {
+      dt_cache[i] = dt;
+      discretize_dynamics(Ac, Bc, dt, Adt_cache[i], Bdt_cache[i]);
+      dt_cache_size++;
+    }
+    dt_index[k] = i;
+  }
+  Adt = Adt_cache[dt_index[0]];
+  Bdt = Bdt_cache[dt_index[0]];
+
+  // free response, x[k] = powerMats[k] * x_0 without forces
+  powerMats[0].setIdentity();
+  for (s16 k = 0; k < horizon; k++) {
+    powerMats[k + 1].noalias() = Adt_cache[dt_index[k]] * powerMats[k];
+  }
+}
+
+/*!
+ * Build qH = 2*(B_qp^T*S*B_qp + alpha*I) and qg = 2*B_qp^T*S*(A_qp*x_0 - X_d)
+ * blockwise, without forming A_qp, B_qp or S.
+ */
+template <typename T, int Horizon>
+void CondensedMpcSolver<T, Horizon>::condenseCost(T alpha, s16 horizon) {
+  horizon = steps(horizon);
+  x_err_cost = 0;
+  for (s16 r = 0; r < horizon; r++) {
+    Eigen::Matrix<T, 13, 1> x_err =
+        powerMats[r + 1] * x_0 - X_d.template segment<13>(13 * r);
+    Qx_err.template segment<13>(13 * r) = Q.asDiagonal() * x_err;
+    x_err_cost += x_err.dot(Qx_err.template segment<13>(13 * r));
+  }
+
+  if (_variableDt)
+    condenseVariableDt(horizon);
+  else
+    condenseToeplitz(horizon);
+  qH.diagonal().array() += T(2) * alpha;
+}
+
+/*!
+ * Condense with equal steps.  With S = diag(Q,...,Q), the (i,j) block of
+ * B_qp^T*S*B_qp for j >= i is
+ *   G(j-i, horizon-j) = sum_{m=0}^{horizon-1-j} AB[m+j-i]^T * Q * AB[m]
+ * which is a running sum along each block diagonal, so the whole Hessian
+ * costs O(horizon^2) 12x13x12 products instead of dense O(horizon^3) GEMMs.
+ */
+template <typename T, int Horizon>
+void CondensedMpcSolver<T, Horizon>::condenseToeplitz(s16 horizon) {
+  for (s16 k = 0; k < horizon; k++) {
+    QAB[k].noalias() = Q.asDiagonal() * AB[k];
+  }
+
+  Eigen::Matrix<T, 12, 12> G;
+  for (s16 d = 0; d < horizon; d++) {
+    G.setZero();
+    for (s16 j = horizon - 1; j >= d; j--) {
+      s16 i = j - d;
+      G.noalias() += AB[horizon - 1 - j + d].transpose() * QAB[horizon - 1 - j];
+      qH.template block<12, 12>(12 * i, 12 * j) = T(2) * G;
+      if (d != 0) qH.template block<12, 12>(12 * j, 12 * i) = T(2) * G.transpose();
+    }
+  }
+
+  for (s16 i = 0; i < horizon; i++) {
+    Eigen::Matrix<T, 12, 1> gi = Eigen::Matrix<T, 12, 1>::Zero();
+    for (s16 m = 0; m < horizon - i; m++) {
+      gi.noalias() +=
+          AB[m].transpose() * Qx_err.template segment<13>(13 * (i + m));
+    }
+    qg.template segment<12>(12 * i) = T(2) * gi;
+  }
+}
+
+/*!
+ * Condense with steps of different length, where the blocks of B_qp are
+ * B_qp(r,c) = A_r * ... * A_{c+1} * B_c.  The weight of x[k+1] together with
+ * everything it propagates into,
+ *   S_k = Q + A_{k+1}^T * S_{k+1} * A_{k+1},  S_{horizon-1} = Q
+ * gives the (i,j) block for j >= i as B_qp(j,i)^T * S_j * B_j, and the
+ * gradient from the same recursion on Q * x_err.  Also O(horizon^2).
+ */
+template <typename T, int Horizon>
+void CondensedMpcSolver<T, Horizon>::condenseVariableDt(s16 horizon) {
+  Eigen::Matrix<T, 13, 13> S = Q.asDiagonal();
+  Eigen::Matrix<T, 13, 13> SA;
+  Eigen::Matrix<T, 13, 1> lambda = Qx_err.template segment<13>(13 * (horizon - 1));
+  for (s16 k = horizon - 1; k >= 0; k--) {
+    if (k < horizon - 1) {
+      const Eigen::Matrix<T, 13, 13>& A = stepAdt(k + 1);
+      SA.noalias() = S * A;
+      S.noalias() = A.transpose() * SA;
+      S.diagonal() += Q;
+      lambda = Qx_err.template segment<13>(13 * k) + A.transpose() * lambda;
+    }
+    SB[k].noalias() = S * stepBdt(k);
+    qg.template segment<12>(12 * k) = T(2) * stepBdt(k).transpose() * lambda;
+  }
+
+  Eigen::Matrix<T, 13, 12> M, next;
+  Eigen::Matrix<T, 12, 12> G;
+  for (s16 i = 0; i < horizon; i++) {
+    M = stepBdt(i);  // B_qp(j,i)
+    for (s16 j = i; j < horizon; j++) {
+      if (j > i) {
+        next.noalias() = stepAdt(j) * M;
+        M = next;
+      }
+      G.noalias() = M.transpose() * SB[j];
+      qH.template block<12, 12>(12 * i, 12 * j) = T(2) * G;
+      if (j != i) qH.template block<12, 12>(12 * j, 12 * i) = T(2) * G.transpose();
+    }
+  }
+}
+
+/*!
+ * Initial state and yaw rotation from the update
+ */
+template <typename T, int Horizon>
+void CondensedMpcSolver<T, Horizon>::setState(const update_data_t& update,
+                                              Eigen::Matrix<T, 3, 4>& r_feet,
+                                              Eigen::Matrix<T, 3, 3>& R_yaw) {
+  Eigen::Matrix<T, 3, 1> p, v, w;
+  for (u8 i = 0; i < 3; i++) {
+    p(i) = update.p[i];
+    v(i) = update.v[i];
+    w(i) = update.w[i];
+  }
+  for (u8 rs = 0; rs < 3; rs++)
+    for (u8 c = 0; c < 4; c++) r_feet(rs, c) = update.r[rs * 4 + c];
+
+  T yc = std::cos(T(update.yaw));
+  T ys = std::sin(T(update.yaw));
+  R_yaw << yc, -ys, 0, ys, yc, 0, 0, 0, 1;
+
+  // roll pitch yaw, with the pitch clamped away from the singularity
+  T qw = update.q[0], qx = update.q[1], qy = update.q[2], qz = update.q[3];
+  double as = std::min(-2. * (qx * qz - qw * qy), .99999);
+  T roll = std::atan2(T(2) * (qx * qy + qw * qz),
+                      qw * qw + qx * qx - qy * qy - qz * qz);
+  T pitch = std::asin(as);
+  T yaw = std::atan2(T(2) * (qy * qz + qw * qx),
+                     qw * qw - qx * qx - qy * qy + qz * qz);
+
+  // initial state (13 state representation)
+  x_0 << yaw, pitch, roll, p, w, v, T(-9.8);
+}
+
+/*!
+ * Continuous time state space matrices
+ */
+template <typename T, int Horizon>
+void CondensedMpcSolver<T, Horizon>::ctSsMats(
+    const Eigen::Matrix<T, 3, 4>& r_feet, const Eigen::Matrix<T, 3, 3>& R_yaw,
+    T x_drag) {
+  A_ct.setZero();
+  A_ct(3, 9) = 1;
+  if (_dragModel == MpcDragModel::VERTICAL_ACCELERATION)
+    A_ct(11, 9) = x_drag;
+  else
+    A_ct(9, 9) = x_drag;
+  A_ct(4, 10) = 1;
+  A_ct(5, 11) = 1;
+
+  A_ct(11, 12) = 1;
+  A_ct.template block<3, 3>(0, 6) = R_yaw.transpose();
+
+  B_ct_r.setZero();
+  Eigen::Matrix<T, 3, 3> I_inv = I_world.inverse();
+
+  for (s16 b = 0; b < 4; b++) {
+    Eigen::Matrix<T, 3, 3> cm;
+    cm << 0, -r_feet(2, b), r_feet(1, b), r_feet(2, b), 0, -r_feet(0, b),
+        -r_feet(1, b), r_feet(0, b), 0;
+    B_ct_r.template block<3, 3>(6, b * 3) = I_inv * cm;
+    B_ct_r.template block<3, 3>(9, b * 3) =
+        Eigen::Matrix<T, 3, 3>::Identity() / mass;
+  }
+}
+
+/*!
+ * Build the condensed QP (and the reduced QP for qpOASES).  Does not allocate
+ * once the solver is sized for setup.horizon.
+ */
+template <typename T, int Horizon>
+void CondensedMpcSolver<T, Horizon>::buildQp(const update_data_t& update,
+                                             const problem_setup& setup) {
+  s16 horizon = setup.horizon;
+  resize(horizon);
+
+  Eigen::Matrix<T, 3, 4> r_feet;
+  Eigen::Matrix<T, 3, 3> R_yaw;
+  setState(update, r_feet, R_yaw);
+  I_world = R_yaw * I_body * R_yaw.transpose();
+  ctSsMats(r_feet, R_yaw, T(update.x_drag));
+
+  // QP matrices.  Steps which all have the same length use the Toeplitz
+  // structure.
+  _variableDt = false;
+  if (setup.variable_dt) {
+    for (s16 i = 1; i < horizon; i++)
+      if (setup.dt_steps[i] != setup.dt_steps[0]) _variableDt = true;
+  }
+  if (_variableDt)
+    c2qpVariableDt(A_ct, B_ct_r, setup.dt_steps, horizon);
+  else
+    c2qp(A_ct, B_ct_r, T(setup.variable_dt ? setup.dt_steps[0] : setup.dt),
+         horizon);
+
+  // weights
+  for (u8 i = 0; i < 12; i++) Q(i) = update.weights[i];
+  Q(12) = 0;
+
+  // trajectory
+  for (s16 i = 0; i < horizon; i++) {
+    for (s16 j = 0; j < 12; j++) X_d(13 * i + j, 0) = update.traj[12 * i + j];
+  }
+
+  // note - I'm not doing the shifting here.
+  constexpr T kBigNumber = T(5e10);
+  s16 k = 0;
+  for (s16 i = 0; i < horizon; i++) {
+    for (s16 j = 0; j < 4; j++) {
+      U_b(5 * k + 0) = kBigNumber;
+      U_b(5 * k + 1) = kBigNumber;
+      U_b(5 * k + 2) = kBigNumber;
+      U_b(5 * k + 3) = kBigNumber;
+      U_b(5 * k + 4) = update.gait[i * 4 + j] * T(setup.f_max);
+      k++;
+    }
+  }
+
+  T mu = T(1) / T(setup.mu);
+  f_block << mu, 0, 1, -mu, 0, 1, 0, mu, 1, 0, -mu, 1, 0, 0, 1;
+
+  condenseCost(T(update.alpha), horizon);
+
+  if (update.use_jcqp == 1) return;
+
+  // A foot in swing has an upper bound of zero on its normal force, so its
+  // 3 forces and 5 constraints are eliminated.  Each remaining foot keeps a
+  // contiguous 3x3 block of variables, so the reduced constraint matrix is
+  // block diagonal in f_block again.
+  horizon = steps(horizon);
+  s16 num_feet = 4 * horizon;
+  int nv = 0;
+  int nc = 0;
+  for (s16 foot = 0; foot < num_feet; foot++) {
+    char swing = nearZero(U_b(5 * foot + 4));
+    for (int v = 0; v < 3; v++) {
+      var_elim[3 * foot + v] = swing;
+      if (!swing) var_ind[nv++] = 3 * foot + v;
+    }
+    for (int c = 0; c < 5; c++) {
+      con_elim[5 * foot + c] = swing;
+      if (!swing) con_ind[nc++] = 5 * foot + c;
+    }
+  }
+
+  for (int i = 0; i < nv; i++) {
+    int olda = var_ind[i];
+    g_red[i] = qg(olda);
+    for (int j = 0; j < nv; j++) {
+      H_red[i * nv + j] = qH(olda, var_ind[j]);
+    }
+  }
+
+  std::fill(A_red.begin(), A_red.begin() + nc * nv, real_t(0));
+  for (int foot = 0; foot < nv / 3; foot++) {
+    for (int r = 0; r < 5; r++)
+      for (int c = 0; c < 3; c++)
+        A_red[(5 * foot + r) * nv + 3 * foot + c] = f_block(r, c);
+  }
+  for (int i = 0; i < nc; i++) {
+    ub_red[i] = U_b(con_ind[i]);
+    lb_red[i] = 0;
+  }
+
+  new_vars = nv;
+  new_cons = nc;
+}
+
+/*!
+ * Change the status of a constraint of the guessed working set, by moving it
+ * between the index lists qpOASES keeps, which doesn't allocate
+ */
+template <typename T, int Horizon>
+void CondensedMpcSolver<T, Horizon>::setGuessedStatus(
+    int c, qpOASES::SubjectToStatus status) {
+  qpOASES::SubjectToStatus current = guessed_constraints.getStatus(c);
+  if (current == status) return;
+  if (current != qpOASES::ST_INACTIVE)
+    guessed_constraints.moveActiveToInactive(c);
+  if (status != qpOASES::ST_INACTIVE)
+    guessed_constraints.moveInactiveToActive(c, status);
+}
+
+/*!
+ * Shift the working set of the last solve forward by one horizon step, to
+ * line it up with the current problem.  Constraints of the last step and of
+ * feet which were eliminated last time have no history and start inactive.
+ * Only changes the status of constraints in the working set sized by resize,
+ * so it doesn't allocate.
+ */
+template <typename T, int Horizon>
+void CondensedMpcSolver<T, Horizon>::guessWorkingSet(s16 horizon) {
+  int num_constraints = 20 * horizon;
+
+  // +1 upper bound active, -1 lower bound active, 0 inactive
+  qp->getWorkingSetConstraints(prev_working_set.data());
+  for (int c = 0; c < num_constraints; c++) {
+    qpOASES::SubjectToStatus status = qpOASES::ST_INACTIVE;
+    int prev_full = c < new_cons ? con_ind[c] + 20 : num_constraints;
+    int prev_red = prev_full < num_constraints ? prev_con_map[prev_full] : -1;
+    if (prev_red >= 0) {
+      if (prev_working_set[prev_red] > 0.5)
+        status = qpOASES::ST_UPPER;
+      else if (prev_working_set[prev_red] < -0.5)
+        status = qpOASES::ST_LOWER;
+    }
+    setGuessedStatus(c, status);
+  }
+}
+
+/*!
+ * Solve the reduced QP with qpOASES.  If the previous reduced problem had the
+ * same size, it is hotstarted from the previous working set (shifted by one
+ * step), otherwise (or if that fails) it is solved from scratch.
+ */
+template <typename T, int Horizon>
+int CondensedMpcSolver<T, Horizon>::solveReducedQp(qpOASES::int_t nWSR_max) {
+  int rval = qpOASES::RET_MAX_NWSR_REACHED;
+  qpOASES::int_t nWSR = nWSR_max;
+
+  if (warm_start && qp && qp->getNV() == new_vars && qp->getNC() == new_cons) {
+    guessWorkingSet(_horizon);
+    rval = qp->hotstart(H_red.data(), g_red.data(), A_red.data(), NULL, NULL,
+                        lb_red.data(), ub_red.data(), nWSR, NULL,
+                        &guessed_bounds, &guessed_constraints);
+    if (rval == qpOASES::SUCCESSFUL_RETURN) {
+      qp_hotstarts++;
+      qp_hotstart_wsr += nWSR;
+    } else {
+      qp_failed_hotstarts++;
+    }
+  }
+
+  if (rval != qpOASES::SUCCESSFUL_RETURN) {
+    nWSR = nWSR_max;
+    qp.reset(new qpOASES::SQProblem(new_vars, new_cons));
+    qpOASES::Options op;
+    op.setToMPC();
+    op.printLevel = qpOASES::PL_NONE;
+    qp->setOptions(op);
+    rval = qp->init(H_red.data(), g_red.data(), A_red.data(), NULL, NULL,
+                    lb_red.data(), ub_red.data(), nWSR);
+    qp_cold_starts++;
+    qp_cold_start_wsr += nWSR;
+  }
+  qp_last_wsr = nWSR;
+
+  // remember where each constraint went for the next warm start
+  for (int i = 0; i < 20 * _horizon; i++) prev_con_map[i] = -1;
+  for (int c = 0; c < new_cons; c++) prev_con_map[con_ind[c]] = c;
+
+  int rval2 = qp->getPrimalSolution(q_red.data());
+  if (rval != qpOASES::SUCCESSFUL_RETURN) qp.reset();
+  return rval2;
+}
+
+/*!
+ * MPC cost of a force trajectory.  With the constant x_err_cost added, the
+ * condensed objective 1/2 u^T qH u + qg^T u is the full tracking cost.
+ * @param forces 12 forces per step, like solution()
+ */
+template <typename T, int Horizon>
+T CondensedMpcSolver<T, Horizon>::evaluateCost(const real_t* forces) const {
+  s16 n = 12 * steps(_horizon);
+  Eigen::Map<const Eigen::Matrix<real_t, kVars, 1>> u(forces, n);
+  T quadratic = 0;
+  for (s16 i = 0; i < n; i++) {
+    if (forces[i] == 0) continue;
+    quadratic += T(forces[i]) * qH.col(i).dot(u.template cast<T>());
+  }
+  return x_err_cost + T(.5) * quadratic + qg.dot(u.template cast<T>());
+}
+
+/*!
+ * Build and solve the MPC problem.  The forces end up in solution() and their
+ * cost in cost().
+ */
+template <typename T, int Horizon>
+void CondensedMpcSolver<T, Horizon>::solve(const update_data_t& update,
+                                           const problem_setup& setup) {
+  buildQp(update, setup);
+  s16 num_variables = 12 * setup.horizon;
+
+  if (update.use_jcqp == 1) {
+#ifdef LOCO_JCQP
+    QpProblem<double> jcqp(setup.horizon * 12, setup.horizon * 20);
+    jcqp.A.setZero();
+    for (s16 i = 0; i < setup.horizon * 4; i++)
+      jcqp.A.template block<5, 3>(i * 5, i * 3) = f_block.template cast<double>();
+    jcqp.P = qH.template cast<double>();
+    jcqp.q = qg.template cast<double>();
+    jcqp.u = U_b.template cast<double>();
+    for (s16 i = 0; i < 20 * setup.horizon; i++) jcqp.l[i] = 0.;
+
+    jcqp.settings.sigma = update.sigma;
+    jcqp.settings.alpha = update.solver_alpha;
+    jcqp.settings.terminate = update.terminate;
+    jcqp.settings.rho = update.rho;
+    jcqp.settings.maxIterations = update.max_iterations;
+    jcqp.runFromDense(update.max_iterations, true, false);
+    for (s16 i = 0; i < num_variables; i++) q_soln[i] = jcqp.getSolution()[i];
+#endif
+    _cost = evaluateCost(q_soln.data());
+    return;
+  }
+
+  bool solved = true;
+  if (update.use_jcqp == 0) {
+    int rval2 = solveReducedQp(100);
+    if (rval2 != qpOASES::SUCCESSFUL_RETURN) {
+      printf("failed to solve!\n");
+      solved = false;
+    }
+
+    int vc = 0;
+    for (int i = 0; i < num_variables; i++) {
+      if (var_elim[i]) {
+        q_soln[i] = 0.0f;
+      } else {
+        q_soln[i] = q_red[vc];
+        vc++;
+      }
+    }
+  } else {  // use jcqp == 2
+#ifdef LOCO_JCQP
+    QpProblem<double> reducedProblem(new_vars, new_cons);
+
+    reducedProblem.A = DenseMatrix<double>(new_cons, new_vars);
+    int i = 0;
+    for (int r = 0; r < new_cons; r++)
+      for (int c = 0; c < new_vars; c++) reducedProblem.A(r, c) = A_red[i++];
+
+    reducedProblem.P = DenseMatrix<double>(new_vars, new_vars);
+    i = 0;
+    for (int r = 0; r < new_vars; r++)
+      for (int c = 0; c < new_vars; c++) reducedProblem.P(r, c) = H_red[i++];
+
+    reducedProblem.q = Vector<double>(new_vars);
+    for (int r = 0; r < new_vars; r++) reducedProblem.q[r] = g_red[r];
+
+    reducedProblem.u = Vector<double>(new_cons);
+    for (int r = 0; r < new_cons; r++) reducedProblem.u[r] = ub_red[r];
+
+    reducedProblem.l = Vector<double>(new_cons);
+    for (int r = 0; r < new_cons; r++) reducedProblem.l[r] = lb_red[r];
+
+    reducedProblem.settings.sigma = update.sigma;
+    reducedProblem.settings.alpha = update.solver_alpha;
+    reducedProblem.settings.terminate = update.terminate;
+    reducedProblem.settings.rho = update.rho;
+    reducedProblem.settings.maxIterations = update.max_iterations;
+    reducedProblem.runFromDense(update.max_iterations, true, false);
+
+    int vc = 0;
+    for (int kk = 0; kk < num_variables; kk++) {
+      if (var_elim[kk]) {
+        q_soln[kk] = 0.0f;
+      } else {
+        q_soln[kk] = reducedProblem.getSolution()[vc];
+        vc++;
+      }
+    }
+#endif
+  }
+  _cost = solved ? evaluateCost(q_soln.data())
+                 : std::numeric_limits<T>::infinity();
+}
+
+/*!
+ * Solves with a fixed-size solver when the horizon is FixedHorizon and with a
+ * dynamic one for any other horizon.
+ */
+template <typename T, int FixedHorizon>
+class DispatchingMpcSolver {
+ public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  explicit DispatchingMpcSolver(
+      MpcDragModel dragModel = MpcDragModel::VERTICAL_ACCELERATION)
+      : fixed(dragModel), dynamic(dragModel) {}
+
+  void resize(s16 horizon) {
+    if (horizon == FixedHorizon)
+      fixed.resize(horizon);
+    else
+      dynamic.resize(horizon);
+  }
+
+  void solve(const update_data_t& update, const problem_setup& setup) {
+    _useFixed = setup.horizon == FixedHorizon;
+    if (_useFixed)
+      fixed.solve(update, setup);
+    else
+      dynamic.solve(update, setup);
+  }
+
+  /*!
+   * Forces of the last solve, from whichever solver ran it
+   */
+  const qpOASES::real_t* solution() const {
+    return _useFixed ? fixed.solution() : dynamic.solution();
+  }
+
+  /*!
+   * MPC cost of the last solution
+   */
+  T cost() const { return _useFixed ? fixed.cost() : dynamic.cost(); }
+
+  /*!
+   * Horizon of the last solve
+   */
+  s16 horizon() const { return _useFixed ? fixed.horizon() : dynamic.horizon(); }
+
+  bool lastSolveWasFixedSize() const { return _useFixed; }
+
+  /*!
+   * Warm start statistics of both solvers together
+   */
+  void getQpStats(mpc_qp_stats* stats) const {
+    stats->hotstarts = fixed.qp_hotstarts + dynamic.qp_hotstarts;
+    stats->cold_starts = fixed.qp_cold_starts + dynamic.qp_cold_starts;
+    stats->failed_hotstarts =
+        fixed.qp_failed_hotstarts + dynamic.qp_failed_hotstarts;
+    stats->hotstart_wsr = fixed.qp_hotstart_wsr + dynamic.qp_hotstart_wsr;
+    stats->cold_start_wsr = fixed.qp_cold_start_wsr + dynamic.qp_cold_start_wsr;
+    stats->last_wsr = _useFixed ? fixed.qp_last_wsr : dynamic.qp_last_wsr;
+  }
+
+  CondensedMpcSolver<T, FixedHorizon> fixed;
+  CondensedMpcSolver<T> dynamic;
+
+ private:
+  bool _useFixed = false;
+};
+
+#endif  // CHEETAH_SOFTWARE_CONDENSEDMPCSOLVER_H
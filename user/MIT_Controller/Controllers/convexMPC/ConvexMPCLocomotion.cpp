@@ -1,4 +1,5 @@
 #include <iostream>
+#include <cstring>
 #include <Utilities/Timer.h>
 #include <Utilities/Utilities_print.h>
 
@@ -18,7 +19,7 @@
 
 ConvexMPCLocomotion::ConvexMPCLocomotion(float _dt, int _iterations_between_mpc, MIT_UserParameters* parameters) :
   iterationsBetweenMPC(_iterations_between_mpc),
-  horizonLength(10),
+  horizonLength(K_FIXED_HORIZON),
   dt(_dt),
   trotting(horizonLength, Vec4<int>(0,5,5,0), Vec4<int>(5,5,5,5),"Trotting"),
   bounding(horizonLength, Vec4<int>(5,5,0,0),Vec4<int>(4,4,4,4),"Bounding"),
@@ -60,6 +61,7 @@ ConvexMPCLocomotion::ConvexMPCLocomotion(float _dt, int _iterations_between_mpc,
    pBody_des.setZero();
    vBody_des.setZero();
    aBody_des.setZero();
+   memset(&_gaitSearchUpdate, 0, sizeof(update_data_t));
 }
 
 void ConvexMPCLocomotion::initialize(){
@@ -106,6 +108,47 @@ void ConvexMPCLocomotion::_SetupCommand(ControlFSMData<float> & data){
 
 }
 
+Gait* ConvexMPCLocomotion::gaitFromNumber(int number) {
+  if(number == 1)
+    return &bounding;
+  else if(number == 2)
+    return &pronking;
+  else if(number == 3)
+    return &random;
+  else if(number == 4)
+    return &standing;
+  else if(number == 5)
+    return &trotRunning;
+  else if(number == 6)
+    return &random2;
+  else if(number == 7)
+    return &random2;
+  else if(number == 8)
+    return &pacing;
+  return &trotting;
+}
+
+/*!
+ * Candidates of the gait search: the gaits set in the cmpc_gait_candidates
+ * bit mask (bit n is gait n), and always the current gait.  Numbers of the
+ * same gait are only solved once, as the current number if it is one of them.
+ */
+void ConvexMPCLocomotion::updateGaitCandidates(int number) {
+  int mask = (int)_parameters->cmpc_gait_candidates;
+  _gaitCandidates.clear();
+  _gaitCandidates.push_back(number);
+  for(int g = 0; g < 10; g++) {
+    if(!(mask & (1 << g)))
+      continue;
+    bool duplicate = false;
+    for(int candidate : _gaitCandidates)
+      duplicate = duplicate || gaitFromNumber(candidate) == gaitFromNumber(g);
+    if(!duplicate)
+      _gaitCandidates.push_back(g);
+  }
+  _gaitSearch.setCandidates(_gaitCandidates);
+}
+
 template<>
 void ConvexMPCLocomotion::run(ControlFSMData<float>& data) {
   bool omniMode = false;
@@ -118,6 +161,16 @@ void ConvexMPCLocomotion::run(ControlFSMData<float>& data) {
     omniMode = true;
   }
 
+  // with gait search on, cmpc_gait only picks the gait to start with
+  bool gaitSearch = _parameters->cmpc_gait_search > 0.5;
+  if(gaitSearch) {
+    if(_gaitSelector.current() >= 0)
+      gaitNumber = _gaitSelector.current();
+    updateGaitCandidates(gaitNumber);
+  } else {
+    _gaitSelector.reset();
+  }
+
   auto& seResult = data._stateEstimator->getResult();
 
   // Check if transition to standing
@@ -134,26 +187,14 @@ void ConvexMPCLocomotion::run(ControlFSMData<float>& data) {
   }
 
   // pick gait
-  Gait* gait = &trotting;
-  if(gaitNumber == 1)
-    gait = &bounding;
-  else if(gaitNumber == 2)
-    gait = &pronking;
-  else if(gaitNumber == 3)
-    gait = &random;
-  else if(gaitNumber == 4)
-    gait = &standing;
-  else if(gaitNumber == 5)
-    gait = &trotRunning;
-  else if(gaitNumber == 6)
-    gait = &random2;
-  else if(gaitNumber == 7)
-    gait = &random2;
-  else if(gaitNumber == 8)
-    gait = &pacing;
+  Gait* gait = gaitFromNumber(gaitNumber);
   current_gait = gaitNumber;
 
   gait->setIterations(iterationsBetweenMPC, iterationCounter);
+  if(gaitSearch) {
+    for(int candidate : _gaitCandidates)
+      gaitFromNumber(candidate)->setIterations(iterationsBetweenMPC, iterationCounter);
+  }
   jumping.setIterations(iterationsBetweenMPC, iterationCounter);
 
 
@@ -316,6 +357,9 @@ void ConvexMPCLocomotion::run(ControlFSMData<float>& data) {
   Vec4<float> swingStates = gait->getSwingState();
   int* mpcTable = gait->getMpcTable();
   updateMPCIfNeeded(mpcTable, data, omniMode);
+  if(solve_thread_running()) {
+    readAsyncMPCSolution(data);
+  }
 
   //  StateEstimator* se = hw_i->state_estimator;
   Vec4<float> se_contactState(0,0,0,0);
@@ -609,11 +653,29 @@ void ConvexMPCLocomotion::solveDenseMPC(int *mpcTable, ControlFSMData<float> &da
   float pz_err = p[2] - _body_height;
   Vec3<float> vxy(seResult.vWorld[0], seResult.vWorld[1], 0);
 
+  // the gait search solves in the control thread (and its workers), it
+  // can't run behind like the solve thread
+  bool gaitSearch = _parameters->cmpc_gait_search > 0.5 && !currently_jumping &&
+    _gaitSearch.findCandidate(current_gait) >= 0;
+  bool useAsync = _parameters->cmpc_use_async > 0.5 && !gaitSearch;
+  if(useAsync && !solve_thread_running()) {
+    start_solve_thread((int)_parameters->cmpc_solver_cpu);
+  } else if(!useAsync && solve_thread_running()) {
+    stop_solve_thread();
+  }
+  if(_parameters->cmpc_gait_search > 0.5 && !_gaitSearch.isRunning()) {
+    _gaitSearch.start((int)_parameters->cmpc_gait_search_workers,
+        (int)_parameters->cmpc_gait_search_cpu);
+  } else if(_parameters->cmpc_gait_search < 0.5 && _gaitSearch.isRunning()) {
+    _gaitSearch.stop();
+  }
+
   Timer t1;
   dtMPC = dt * iterationsBetweenMPC;
   setup_problem(dtMPC,horizonLength,0.4,120);
   //setup_problem(dtMPC,horizonLength,0.4,650); //DH
   update_x_drag(x_comp_integral);
+  _gaitSearchUpdate.x_drag = x_comp_integral;
   if(vxy[0] > 0.3 || vxy[0] < -0.3) {
     //x_comp_integral += _parameters->cmpc_x_drag * pxy_err[0] * dtMPC / vxy[0];
     x_comp_integral += _parameters->cmpc_x_drag * pz_err * dtMPC / vxy[0];
@@ -627,10 +689,18 @@ void ConvexMPCLocomotion::solveDenseMPC(int *mpcTable, ControlFSMData<float> &da
 
   Timer t2;
   //cout << "dtMPC: " << dtMPC << "\n";
+  set_solve_tag(iterationCounter);
+  if(gaitSearch) {
+    solveGaitCandidates(p,v,q,w,r,yaw,weights,alpha,data);
+    return;
+  }
   update_problem_data_floats(p,v,q,w,r,yaw,weights,trajAll,alpha,mpcTable);
   //t2.stopPrint("Run MPC");
   //printf("MPC Solve time %f ms\n", t2.getMs());
 
+  // the solve thread's result is picked up in readAsyncMPCSolution
+  if(useAsync) return;
+
   for(int leg = 0; leg < 4; leg++)
   {
     Vec3<float> f;
@@ -645,6 +715,78 @@ void ConvexMPCLocomotion::solveDenseMPC(int *mpcTable, ControlFSMData<float> &da
   }
 }
 
+/*!
+ * Solve the MPC for all candidate gaits, use the forces of the current one
+ * and pick the gait for the next ticks
+ */
+void ConvexMPCLocomotion::solveGaitCandidates(float* p, float* v, float* q, float* w, float* r,
+    float yaw, float* weights, float alpha, ControlFSMData<float> &data) {
+  auto seResult = data._stateEstimator->getResult();
+
+  update_data_t& update = _gaitSearchUpdate;
+  memcpy(update.p, p, sizeof(float) * 3);
+  memcpy(update.v, v, sizeof(float) * 3);
+  memcpy(update.q, q, sizeof(float) * 4);
+  memcpy(update.w, w, sizeof(float) * 3);
+  memcpy(update.r, r, sizeof(float) * 12);
+  memcpy(update.weights, weights, sizeof(float) * 12);
+  memcpy(update.traj, trajAll, sizeof(float) * 12 * horizonLength);
+  update.yaw = yaw;
+  update.alpha = alpha;
+  update.use_jcqp = 0;
+
+  problem_setup setup;
+  setup.dt = dtMPC;
+  setup.mu = 0.4;
+  setup.f_max = 120;
+  setup.horizon = horizonLength;
+
+  for(int i = 0; i < _gaitSearch.candidateCount(); i++) {
+    Gait* candidateGait = gaitFromNumber(_gaitSearch.candidate(i).gait);
+    _gaitSearch.setGaitTable(i, candidateGait->getMpcTable(), horizonLength);
+  }
+  _gaitSearch.solve(update, setup);
+
+  const MpcGaitCandidate& current = _gaitSearch.candidate(_gaitSearch.findCandidate(current_gait));
+  for(int leg = 0; leg < 4; leg++)
+  {
+    Vec3<float> f;
+    for(int axis = 0; axis < 3; axis++)
+      f[axis] = current.solver.solution()[leg*3 + axis];
+
+    f_ff[leg] = -seResult.rBody * f;
+    // Update for WBC
+    Fr_des[leg] = f;
+  }
+
+  _gaitSelector.hysteresis = _parameters->cmpc_gait_hysteresis;
+  _gaitSelector.minHoldSolves = (int)_parameters->cmpc_gait_min_hold;
+  _gaitSelector.select(_gaitSearch);
+}
+
+void ConvexMPCLocomotion::readAsyncMPCSolution(ControlFSMData<float> &data) {
+  long tag;
+  if(!fetch_solution(&tag)) return;
+
+  auto seResult = data._stateEstimator->getResult();
+
+  // the solution starts at the iteration its snapshot was posted, so skip the
+  // horizon steps which have already gone by
+  int step = (iterationCounter - tag) / iterationsBetweenMPC;
+  if(step > horizonLength - 1) step = horizonLength - 1;
+
+  for(int leg = 0; leg < 4; leg++)
+  {
+    Vec3<float> f;
+    for(int axis = 0; axis < 3; axis++)
+      f[axis] = get_solution(step*12 + leg*3 + axis);
+
+    f_ff[leg] = -seResult.rBody * f;
+    // Update for WBC
+    Fr_des[leg] = f;
+  }
+}
+
 #ifdef LOCO_SPARSE_MPC
 void ConvexMPCLocomotion::solveSparseMPC(int *mpcTable, ControlFSMData<float> &data) {
   // X0, contact trajectory, state trajectory, feet, get result!
@@ -674,6 +816,8 @@ void ConvexMPCLocomotion::solveSparseMPC(int *mpcTable, ControlFSMData<float> &d
   _sparseCMPC.setContactTrajectory(contactStates.data(), contactStates.size());
   _sparseCMPC.setStateTrajectory(_sparseTrajectory);
   _sparseCMPC.setFeet(feet);
+  _sparseCMPC.setSolver(_parameters->cmpc_use_sparse > 1.5 ? SparseCMPCSolver::JCQP
+                                                           : SparseCMPCSolver::OSQP);
   _sparseCMPC.run();
 
   Vec12<float> resultForce = _sparseCMPC.getResult();
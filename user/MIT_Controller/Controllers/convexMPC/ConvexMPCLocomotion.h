@@ -6,6 +6,7 @@
 #include <SparseCMPC/SparseCMPC.h>
 #include "cppTypes.h"
 #include "Gait.h"
+#include "MultiGaitMpc.h"
 
 #include <cstdio>
 
@@ -127,6 +128,11 @@ private:
   void recompute_timing(int iterations_per_mpc);
   void updateMPCIfNeeded(int* mpcTable, ControlFSMData<float>& data, bool omniMode);
   void solveDenseMPC(int *mpcTable, ControlFSMData<float> &data);
+  void readAsyncMPCSolution(ControlFSMData<float> &data);
+  Gait* gaitFromNumber(int number);
+  void updateGaitCandidates(int number);
+  void solveGaitCandidates(float* p, float* v, float* q, float* w, float* r,
+      float yaw, float* weights, float alpha, ControlFSMData<float> &data);
 #ifdef LOCO_SPARSE_MPC
   void solveSparseMPC(int *mpcTable, ControlFSMData<float> &data);
   void initSparseMPC();
@@ -163,6 +169,13 @@ private:
 
   vectorAligned<Vec12<double>> _sparseTrajectory;
 
+  // gait search: the MPC is solved for every candidate gait and the
+  // cheapest one is used from the next MPC tick on
+  MultiGaitMpc _gaitSearch;
+  MpcGaitSelector _gaitSelector;
+  std::vector<int> _gaitCandidates;
+  update_data_t _gaitSearchUpdate;
+
 #ifdef LOCO_SPARSE_MPC
   SparseCMPC _sparseCMPC;
 #endif
@@ -0,0 +1,86 @@
+/*! @file MpcDiscretization.h
+ *  @brief Zero order hold discretization of the convex MPC dynamics
+ *
+ * The discrete dynamics are the blocks of exp([A B; 0 0] * dt):
+ *   Adt = exp(A dt)
+ *   Bdt = sum_k (A dt)^k / (k+1)! * B dt
+ * so only a power series in the 13x13 A is needed instead of a Pade
+ * approximation of the full 25x25 matrix.  The continuous time A of the MPC
+ * is nilpotent when the drag term sits on the gravity row, and close to it
+ * otherwise, so the series ends (or reaches float precision) after a few
+ * terms.
+ *
+ * Define CMPC_EIGEN_MATRIX_EXP to always use Eigen's matrix exponential.
+ */
+
+#ifndef CHEETAH_SOFTWARE_MPCDISCRETIZATION_H
+#define CHEETAH_SOFTWARE_MPCDISCRETIZATION_H
+
+#include <Eigen/Dense>
+#include <limits>
+#include <unsupported/Eigen/MatrixFunctions>
+
+/*!
+ * Discretize with Eigen's scaling and squaring matrix exponential of the
+ * 25x25 matrix [A B; 0 0] * dt.
+ */
+template <typename T>
+void discretize_dynamics_exp(const Eigen::Matrix<T, 13, 13>& Ac,
+                             const Eigen::Matrix<T, 13, 12>& Bc, T dt,
+                             Eigen::Matrix<T, 13, 13>& Adt,
+                             Eigen::Matrix<T, 13, 12>& Bdt) {
+  Eigen::Matrix<T, 25, 25> ABc, expmm;
+  ABc.setZero();
+  ABc.template block<13, 13>(0, 0) = Ac * dt;
+  ABc.template block<13, 12>(0, 13) = Bc * dt;
+  expmm = ABc.exp();
+  Adt = expmm.template block<13, 13>(0, 0);
+  Bdt = expmm.template block<13, 12>(0, 13);
+}
+
+/*!
+ * Discretize the continuous time dynamics xdot = Ac x + Bc u with a zero
+ * order hold on u.
+ * @param Ac continuous time state matrix
+ * @param Bc continuous time input matrix
+ * @param dt time step
+ * @param Adt discrete state matrix (output)
+ * @param Bdt discrete input matrix (output)
+ */
+template <typename T>
+void discretize_dynamics(const Eigen::Matrix<T, 13, 13>& Ac,
+                         const Eigen::Matrix<T, 13, 12>& Bc, T dt,
+                         Eigen::Matrix<T, 13, 13>& Adt,
+                         Eigen::Matrix<T, 13, 12>& Bdt) {
+#ifdef CMPC_EIGEN_MATRIX_EXP
+  discretize_dynamics_exp(Ac, Bc, dt, Adt, Bdt);
+#else
+  // with ||A dt|| <= 1 the k-th term is below 1/k!, so kMaxOrder terms reach
+  // double precision.  Larger steps go through scaling and squaring instead.
+  constexpr int kMaxOrder = 18;
+  Eigen::Matrix<T, 13, 13> Ac_dt = Ac * dt;
+  if (Ac_dt.cwiseAbs().rowwise().sum().maxCoeff() > T(1)) {
+    discretize_dynamics_exp(Ac, Bc, dt, Adt, Bdt);
+    return;
+  }
+
+  // term = (A dt)^k / k!,  S = sum_k (A dt)^k / (k+1)!
+  Eigen::Matrix<T, 13, 13> term, next, S;
+  term.setIdentity();
+  Adt.setIdentity();
+  S.setIdentity();
+  for (int k = 1; k <= kMaxOrder; k++) {
+    next.noalias() = term * Ac_dt;
+    term = next / T(k);
+    Adt += term;
+    S += term / T(k + 1);
+    // later terms are below the resolution of the identity part of Adt
+    if (term.cwiseAbs().maxCoeff() <= std::numeric_limits<T>::epsilon() / 4)
+      break;
+  }
+  Bdt.noalias() = S * Bc;
+  Bdt *= dt;
+#endif
+}
+
+#endif  // CHEETAH_SOFTWARE_MPCDISCRETIZATION_H
@@ -0,0 +1,154 @@
+/*! @file MpcSolveThread.cpp
+ *  @brief Runs the dense convex MPC solver in its own thread
+ */
+
+#include "MpcSolveThread.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <Utilities/Timer.h>
+
+MpcSolveThread::MpcSolveThread() {
+  _resultLock[0] = 0;
+  _resultLock[1] = 0;
+  sem_init(&_requestReady, 0, 0);
+}
+
+MpcSolveThread::~MpcSolveThread() {
+  stop();
+  sem_destroy(&_requestReady);
+}
+
+/*!
+ * Start the solve thread
+ * @param cpu : core to pin the thread to, or -1 to let the OS schedule it
+ */
+void MpcSolveThread::start(int cpu) {
+  if (_running) return;
+  _running = true;
+  _thread = std::thread(&MpcSolveThread::solveLoop, this);
+
+  if (cpu >= 0) {
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    CPU_SET(cpu, &cpuSet);
+    if (pthread_setaffinity_np(_thread.native_handle(), sizeof(cpu_set_t),
+                               &cpuSet) != 0) {
+      printf("[MPC Solve Thread] Failed to pin solver to CPU %d\n", cpu);
+    }
+  }
+  printf("[MPC Solve Thread] Started (cpu %d)\n", cpu);
+}
+
+/*!
+ * Stop the solve thread.  Waits for a solve in progress to finish.
+ */
+void MpcSolveThread::stop() {
+  if (!_running) return;
+  _running = false;
+  sem_post(&_requestReady);
+  _thread.join();
+  printf("[MPC Solve Thread] Stopped after %lu solves\n",
+         (unsigned long)_solved.load());
+}
+
+/*!
+ * Hand a problem to the solver.  Never blocks: if the solver has not started
+ * on the previous snapshot yet, that snapshot is replaced.
+ * Must only be called from one thread.
+ * @param tag : returned with the solution, e.g. the control iteration
+ */
+void MpcSolveThread::post(const update_data_t& update,
+                          const problem_setup& setup, s64 tag) {
+  MpcSolveRequest& request = _requests[_requestBack];
+  request.update = update;
+  request.setup = setup;
+  request.tag = tag;
+  request.sequence = _posted.load() + 1;
+
+  u8 old = _requestMiddle.exchange(_requestBack | kNewData,
+                                   std::memory_order_acq_rel);
+  _requestBack = old & kIndexMask;
+  if (old & kNewData) _dropped++;
+  _posted++;
+  sem_post(&_requestReady);
+}
+
+/*!
+ * Solve thread side of the triple buffer
+ * @return true if _requests[_requestFront] now holds a new snapshot
+ */
+bool MpcSolveThread::takeRequest() {
+  if (!(_requestMiddle.load(std::memory_order_acquire) & kNewData))
+    return false;
+  u8 old = _requestMiddle.exchange(_requestFront, std::memory_order_acq_rel);
+  _requestFront = old & kIndexMask;
+  return true;
+}
+
+/*!
+ * Write a solution into the slot the reader is not pointed at
+ */
+void MpcSolveThread::publish(const MpcSolveResult& result) {
+  int front = _resultFront.load(std::memory_order_relaxed);
+  int back = front == 0 ? 1 : 0;
+
+  // odd sequence while writing
+  _resultLock[back].fetch_add(1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  memcpy(&_results[back], &result, sizeof(MpcSolveResult));
+  _resultLock[back].fetch_add(1, std::memory_order_release);
+
+  _resultFront.store(back, std::memory_order_release);
+  _latestSolvedSequence = result.sequence;
+}
+
+/*!
+ * Copy out the newest solution.  Never waits on the solver: if the copy
+ * overlapped a write it is simply retried on the other buffer.
+ * @return true if a solution newer than the previous call was found
+ */
+bool MpcSolveThread::getLatest(MpcSolveResult& result) {
+  for (;;) {
+    int front = _resultFront.load(std::memory_order_acquire);
+    if (front < 0) {
+      _staleReads++;
+      return false;
+    }
+
+    u32 before = _resultLock[front].load(std::memory_order_acquire);
+    if (before & 1) continue;
+    memcpy(&result, &_results[front], sizeof(MpcSolveResult));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    u32 after = _resultLock[front].load(std::memory_order_relaxed);
+    if (before != after) continue;
+
+    bool isNew = result.sequence != _lastReadSequence;
+    _lastReadSequence = result.sequence;
+    if (!isNew) _staleReads++;
+    return isNew;
+  }
+}
+
+void MpcSolveThread::solveLoop() {
+  while (_running) {
+    sem_wait(&_requestReady);
+    if (!_running) break;
+    // extra wakeups happen when several posts land during one solve
+    if (!takeRequest()) continue;
+
+    MpcSolveRequest& request = _requests[_requestFront];
+    Timer solveTimer;
+    _solver.solve(request.update, request.setup);
+
+    int nSoln = 12 * request.setup.horizon;
+    memcpy(_solving.q_soln, _solver.solution(), nSoln * sizeof(mfp));
+    _solving.tag = request.tag;
+    _solving.sequence = request.sequence;
+    _solving.horizon = request.setup.horizon;
+    _solving.solveTimeMs = solveTimer.getMs();
+    _solver.getQpStats(&_solving.qpStats);
+    publish(_solving);
+    _solved++;
+  }
+}
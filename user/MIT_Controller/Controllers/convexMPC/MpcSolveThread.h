@@ -0,0 +1,123 @@
+/*! @file MpcSolveThread.h
+ *  @brief Runs the dense convex MPC solver in its own thread
+ *
+ * The control loop posts problem snapshots into a lock-free single producer /
+ * single consumer slot (a triple buffer, newer snapshots replace ones the
+ * solver has not picked up yet).  The solve thread publishes solutions into a
+ * double buffer guarded by sequence counters, which the control loop reads
+ * without ever waiting on the solver.
+ */
+
+#ifndef CHEETAH_SOFTWARE_MPCSOLVETHREAD_H
+#define CHEETAH_SOFTWARE_MPCSOLVETHREAD_H
+
+#include <semaphore.h>
+#include <atomic>
+#include <thread>
+#include "CondensedMpcSolver.h"
+#include "common_types.h"
+#include "convexMPC_interface.h"
+
+/*!
+ * Everything the solver needs for one solve
+ */
+struct MpcSolveRequest {
+  update_data_t update;
+  problem_setup setup;
+  s64 tag;       // opaque value handed back with the solution
+  u64 sequence;  // number of the post which produced this request
+};
+
+/*!
+ * Solution for one request
+ */
+struct MpcSolveResult {
+  mfp q_soln[12 * K_MAX_GAIT_SEGMENTS];
+  s64 tag;
+  u64 sequence;
+  int horizon;
+  float solveTimeMs;
+  mpc_qp_stats qpStats;  // warm start statistics of the solver after the solve
+};
+
+class MpcSolveThread {
+ public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  MpcSolveThread();
+  ~MpcSolveThread();
+
+  void start(int cpu = -1);
+  void stop();
+  bool isRunning() const { return _running; }
+
+  void post(const update_data_t& update, const problem_setup& setup, s64 tag);
+  bool getLatest(MpcSolveResult& result);
+
+  /*!
+   * Number of snapshots posted by the control loop
+   */
+  u64 getPostedCount() const { return _posted.load(); }
+
+  /*!
+   * Number of snapshots the solver has finished
+   */
+  u64 getSolvedCount() const { return _solved.load(); }
+
+  /*!
+   * Number of snapshots replaced by a newer one before they were solved
+   */
+  u64 getDroppedCount() const { return _dropped.load(); }
+
+  /*!
+   * Number of getLatest() calls which found no solution newer than the last
+   */
+  u64 getStaleReadCount() const { return _staleReads.load(); }
+
+  /*!
+   * Number of snapshots posted after the one the newest solution is for.
+   * Zero means the solver has caught up with the control loop.
+   */
+  u64 getStaleness() const { return _posted.load() - _latestSolvedSequence.load(); }
+
+  /*!
+   * The solver used by the solve thread.  Only safe to look at while the
+   * thread is stopped, its statistics come with each MpcSolveResult.
+   */
+  DispatchingMpcSolver<fpt, K_FIXED_HORIZON>& getSolver() { return _solver; }
+
+ private:
+  void solveLoop();
+  bool takeRequest();
+  void publish(const MpcSolveResult& result);
+
+  static constexpr u8 kNewData = 0x4;
+  static constexpr u8 kIndexMask = 0x3;
+
+  // request triple buffer: _requestBack belongs to the control loop,
+  // _requestFront to the solve thread, _requestMiddle is swapped between them
+  MpcSolveRequest _requests[3];
+  u8 _requestBack = 0;
+  u8 _requestFront = 2;
+  std::atomic<u8> _requestMiddle{1};
+
+  // result double buffer with a sequence lock per slot
+  MpcSolveResult _results[2];
+  std::atomic<u32> _resultLock[2];
+  std::atomic<int> _resultFront{-1};
+  MpcSolveResult _solving;
+  u64 _lastReadSequence = 0;
+
+  std::atomic<u64> _posted{0};
+  std::atomic<u64> _solved{0};
+  std::atomic<u64> _dropped{0};
+  std::atomic<u64> _staleReads{0};
+  std::atomic<u64> _latestSolvedSequence{0};
+
+  DispatchingMpcSolver<fpt, K_FIXED_HORIZON> _solver;
+  sem_t _requestReady;
+  std::atomic<bool> _running{false};
+  std::thread _thread;
+};
+
+#endif  // CHEETAH_SOFTWARE_MPCSOLVETHREAD_H
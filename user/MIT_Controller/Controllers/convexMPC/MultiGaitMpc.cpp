@@ -0,0 +1,230 @@
+/*! @file MultiGaitMpc.cpp
+ *  @brief Solves the dense convex MPC for several gaits at once
+ */
+
+#include "MultiGaitMpc.h"
+#include <pthread.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdexcept>
+#include <Utilities/Timer.h>
+
+MultiGaitMpc::~MultiGaitMpc() { stop(); }
+
+/*!
+ * Start the worker threads
+ * @param workers : number of threads besides the one calling solve()
+ * @param firstCpu : pin worker i to core firstCpu + i, or -1 to let the OS
+ * schedule them
+ */
+void MultiGaitMpc::start(int workers, int firstCpu) {
+  if (isRunning() || workers <= 0) return;
+  _running = true;
+  for (int i = 0; i < workers; i++) {
+    _workers.emplace_back(&MultiGaitMpc::workerLoop, this);
+    if (firstCpu < 0) continue;
+
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    CPU_SET(firstCpu + i, &cpuSet);
+    if (pthread_setaffinity_np(_workers.back().native_handle(),
+                               sizeof(cpu_set_t), &cpuSet) != 0) {
+      printf("[Multi Gait MPC] Failed to pin worker to CPU %d\n", firstCpu + i);
+    }
+  }
+  printf("[Multi Gait MPC] Started %d workers (first cpu %d)\n", workers,
+         firstCpu);
+}
+
+/*!
+ * Stop the worker threads.  Must not be called during solve().
+ */
+void MultiGaitMpc::stop() {
+  if (!isRunning()) return;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _running = false;
+  }
+  _roundStart.notify_all();
+  for (auto& worker : _workers) worker.join();
+  _workers.clear();
+}
+
+/*!
+ * Set the gaits to evaluate.  Solvers of gaits which stay in the set are
+ * kept, along with their warm start.  Must not be called during solve().
+ * @param gaits : at most kMaxCandidates gait numbers
+ * @return true if the set changed
+ */
+bool MultiGaitMpc::setCandidates(const std::vector<int>& gaits) {
+  if (gaits.size() > kMaxCandidates) {
+    throw std::runtime_error("too many gait candidates!");
+  }
+  bool same = gaits.size() == _candidates.size();
+  for (size_t i = 0; same && i < gaits.size(); i++)
+    same = _candidates[i]->gait == gaits[i];
+  if (same) return false;
+
+  std::vector<std::unique_ptr<MpcGaitCandidate>> candidates;
+  for (int gait : gaits) {
+    int old = findCandidate(gait);
+    if (old >= 0) {
+      candidates.push_back(std::move(_candidates[old]));
+    } else {
+      candidates.emplace_back(new MpcGaitCandidate(gait));
+    }
+  }
+  _candidates = std::move(candidates);
+  return true;
+}
+
+/*!
+ * @return index of the candidate for a gait, or -1 if it is not evaluated
+ */
+int MultiGaitMpc::findCandidate(int gait) const {
+  for (size_t i = 0; i < _candidates.size(); i++)
+    if (_candidates[i] && _candidates[i]->gait == gait) return (int)i;
+  return -1;
+}
+
+/*!
+ * Set the gait table of candidate i for the next solve()
+ * @param mpcTable : contact flags, 4 per horizon step (see Gait::getMpcTable)
+ */
+void MultiGaitMpc::setGaitTable(int i, const int* mpcTable, int horizon) {
+  unsigned char* table = _candidates[i]->gaitTable;
+  for (int k = 0; k < 4 * horizon; k++) table[k] = mpcTable[k];
+}
+
+/*!
+ * Solve the MPC for every candidate, on the workers and the calling thread.
+ * Blocks until all candidates are solved.
+ * @param update : problem data shared by all candidates, its gait table is
+ * replaced by each candidate's own
+ */
+void MultiGaitMpc::solve(const update_data_t& update,
+                         const problem_setup& setup) {
+  Timer solveTimer;
+  _update = &update;
+  _setup = setup;
+  _nextCandidate = 0;
+
+  if (isRunning()) {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _round++;
+      _activeWorkers = (int)_workers.size();
+    }
+    _roundStart.notify_all();
+  }
+
+  solveCandidates();
+
+  if (isRunning()) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _roundDone.wait(lock, [this] { return _activeWorkers == 0; });
+  }
+  _update = nullptr;
+  _solveTimeMs = solveTimer.getMs();
+}
+
+/*!
+ * @return index of the candidate with the lowest cost of the last solve(), or
+ * -1 if there are no candidates
+ */
+int MultiGaitMpc::lowestCost() const {
+  int best = -1;
+  for (size_t i = 0; i < _candidates.size(); i++) {
+    if (best < 0 || _candidates[i]->cost < _candidates[best]->cost)
+      best = (int)i;
+  }
+  return best;
+}
+
+/*!
+ * Claim and solve candidates until none are left
+ */
+void MultiGaitMpc::solveCandidates() {
+  int count = (int)_candidates.size();
+  for (;;) {
+    int i = _nextCandidate.fetch_add(1);
+    if (i >= count) return;
+    solveCandidate(*_candidates[i]);
+  }
+}
+
+void MultiGaitMpc::solveCandidate(MpcGaitCandidate& candidate) {
+  Timer solveTimer;
+  candidate.update = *_update;
+  memcpy(candidate.update.gait, candidate.gaitTable, 4 * _setup.horizon);
+  candidate.solver.solve(candidate.update, _setup);
+  candidate.cost = candidate.solver.cost();
+  candidate.solveTimeMs = solveTimer.getMs();
+}
+
+void MultiGaitMpc::workerLoop() {
+  u64 round = 0;
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(_mutex);
+      _roundStart.wait(lock, [&] { return _round != round || !_running; });
+      if (!_running) return;
+      round = _round;
+    }
+
+    solveCandidates();
+
+    bool last;
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      last = --_activeWorkers == 0;
+    }
+    if (last) _roundDone.notify_one();
+  }
+}
+
+/*!
+ * Pick a gait from candidate costs
+ * @param gaits : gait numbers
+ * @param costs : cost of each gait
+ * @return the gait to use (the current one if there are no candidates)
+ */
+int MpcGaitSelector::select(const int* gaits, const float* costs, int count) {
+  int best = -1;
+  int current = -1;
+  for (int i = 0; i < count; i++) {
+    if (best < 0 || costs[i] < costs[best]) best = i;
+    if (gaits[i] == _current) current = i;
+  }
+  if (best < 0) return _current;
+  _held++;
+
+  // the current gait is gone from the candidates (or there is none yet)
+  if (current < 0) {
+    _current = gaits[best];
+    _held = 0;
+    return _current;
+  }
+
+  if (best != current && _held >= minHoldSolves &&
+      costs[best] < (1.f - hysteresis) * costs[current]) {
+    _current = gaits[best];
+    _held = 0;
+  }
+  return _current;
+}
+
+/*!
+ * Pick a gait from the costs of the last MultiGaitMpc::solve()
+ */
+int MpcGaitSelector::select(const MultiGaitMpc& mpc) {
+  int count = mpc.candidateCount();
+  int gaits[MultiGaitMpc::kMaxCandidates];
+  float costs[MultiGaitMpc::kMaxCandidates];
+  for (int i = 0; i < count; i++) {
+    gaits[i] = mpc.candidate(i).gait;
+    costs[i] = mpc.candidate(i).cost;
+  }
+  return select(gaits, costs, count);
+}
@@ -0,0 +1,129 @@
+/*! @file MultiGaitMpc.h
+ *  @brief Solves the dense convex MPC for several gaits at once
+ *
+ * Every candidate gait gets its own solver (so each keeps its own warm start)
+ * and its own copy of the problem, which differs only in the gait table.  The
+ * candidates are handed out to a pool of worker threads, and the thread
+ * calling solve() works on them too, so solve() returns once all of them are
+ * done.  MpcGaitSelector then picks the cheapest gait, with hysteresis so the
+ * robot does not flip between gaits of about the same cost.
+ */
+
+#ifndef CHEETAH_SOFTWARE_MULTIGAITMPC_H
+#define CHEETAH_SOFTWARE_MULTIGAITMPC_H
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "CondensedMpcSolver.h"
+#include "common_types.h"
+#include "convexMPC_interface.h"
+
+/*!
+ * One gait evaluated by MultiGaitMpc
+ */
+struct MpcGaitCandidate {
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  explicit MpcGaitCandidate(int gaitNumber) : gait(gaitNumber) {}
+
+  int gait;  // gait number, as in cmpc_gait
+  unsigned char gaitTable[4 * K_MAX_GAIT_SEGMENTS] = {};
+  update_data_t update;
+  DispatchingMpcSolver<fpt, K_FIXED_HORIZON> solver;
+  float cost = 0;
+  float solveTimeMs = 0;
+};
+
+class MultiGaitMpc {
+ public:
+  static constexpr size_t kMaxCandidates = 16;
+
+  MultiGaitMpc() = default;
+  ~MultiGaitMpc();
+
+  void start(int workers, int firstCpu = -1);
+  void stop();
+  bool isRunning() const { return !_workers.empty(); }
+  int workerCount() const { return (int)_workers.size(); }
+
+  bool setCandidates(const std::vector<int>& gaits);
+  int candidateCount() const { return (int)_candidates.size(); }
+  int findCandidate(int gait) const;
+
+  /*!
+   * Candidate i.  Only safe to look at outside of solve().
+   */
+  MpcGaitCandidate& candidate(int i) { return *_candidates[i]; }
+  const MpcGaitCandidate& candidate(int i) const { return *_candidates[i]; }
+
+  void setGaitTable(int i, const int* mpcTable, int horizon);
+  void solve(const update_data_t& update, const problem_setup& setup);
+  int lowestCost() const;
+
+  /*!
+   * Wall time of the last solve() in ms
+   */
+  float getSolveTimeMs() const { return _solveTimeMs; }
+
+ private:
+  void workerLoop();
+  void solveCandidates();
+  void solveCandidate(MpcGaitCandidate& candidate);
+
+  std::vector<std::unique_ptr<MpcGaitCandidate>> _candidates;
+  const update_data_t* _update = nullptr;
+  problem_setup _setup;
+  float _solveTimeMs = 0;
+
+  // the candidates of a round are claimed through _nextCandidate.  A round
+  // is over when every worker has run out of candidates and checked back in,
+  // so no worker can still be claiming from the previous round.
+  std::vector<std::thread> _workers;
+  std::mutex _mutex;
+  std::condition_variable _roundStart;
+  std::condition_variable _roundDone;
+  u64 _round = 0;
+  int _activeWorkers = 0;
+  bool _running = false;
+  std::atomic<int> _nextCandidate{0};
+};
+
+/*!
+ * Picks the lowest cost gait.  The current gait is only replaced if another
+ * one is cheaper by more than the relative hysteresis margin, and not before
+ * it has been kept for minHoldSolves solves.
+ */
+class MpcGaitSelector {
+ public:
+  explicit MpcGaitSelector(float margin = 0.1f, int minHold = 0)
+      : hysteresis(margin), minHoldSolves(minHold) {}
+
+  int select(const int* gaits, const float* costs, int count);
+  int select(const MultiGaitMpc& mpc);
+
+  /*!
+   * Gait picked by the last select(), or -1 before the first one
+   */
+  int current() const { return _current; }
+
+  /*!
+   * Forget the current gait, the next select() takes the cheapest one
+   */
+  void reset() {
+    _current = -1;
+    _held = 0;
+  }
+
+  float hysteresis;
+  int minHoldSolves;
+
+ private:
+  int _current = -1;
+  int _held = 0;
+};
+
+#endif  // CHEETAH_SOFTWARE_MULTIGAITMPC_H
@@ -5,6 +5,8 @@
 #include <Eigen/Dense>
 #include "common_types.h"
 #include "convexMPC_interface.h"
+#include "CondensedMpcSolver.h"
+#include <qpOASES.hpp>
 #include <iostream>
 #include <stdio.h>
 
@@ -52,11 +54,13 @@ T sq(T a)
 }
 
 
+typedef DispatchingMpcSolver<fpt, K_FIXED_HORIZON> ConvexMpcSolver;
+
 void solve_mpc(update_data_t* update, problem_setup* setup);
 
 void quat_to_rpy(Quaternionf q, Matrix<fpt,3,1>& rpy);
-void ct_ss_mats(Matrix<fpt,3,3> I_world, fpt m, Matrix<fpt,3,4> r_feet, Matrix<fpt,3,3> R_yaw, Matrix<fpt,13,13>& A, Matrix<fpt,13,12>& B);
 void resize_qp_mats(s16 horizon);
 void c2qp(Matrix<fpt,13,13> Ac, Matrix<fpt,13,12> Bc,fpt dt,s16 horizon);
 mfp* get_q_soln();
+ConvexMpcSolver& get_mpc_solver();
 #endif
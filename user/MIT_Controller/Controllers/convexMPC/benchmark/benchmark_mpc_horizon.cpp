@@ -0,0 +1,94 @@
+/*! @file benchmark_mpc_horizon.cpp
+ *  @brief Compare the fixed-size and dynamic horizon convex MPC solvers
+ *
+ * Times building the condensed and reduced QP, and the full solve, for the
+ * trotting problem of the tests at the horizon of ConvexMPCLocomotion.  Also
+ * compares covering a longer lookahead with many equal steps against a few
+ * steps of variable length.
+ * Run the release build: cmpc-benchmark [iterations]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include "CondensedMpcSolver.h"
+#include "Utilities/Timer.h"
+#include "../test/cmpc_test_problem.h"
+
+struct BenchmarkResult {
+  double minUs;
+  double medianUs;
+};
+
+template <typename Solver>
+static BenchmarkResult timeRuns(Solver& solver, update_data_t& update,
+                                problem_setup& setup, int iterations,
+                                bool buildOnly) {
+  std::vector<double> times(iterations);
+  for (int i = 0; i < iterations; i++) {
+    // a slightly different problem each time, like consecutive MPC ticks
+    update.v[0] = 0.5f + 0.001f * (i % 10);
+    Timer timer;
+    if (buildOnly)
+      solver.buildQp(update, setup);
+    else
+      solver.solve(update, setup);
+    times[i] = timer.getNs() / 1e3;
+  }
+
+  std::sort(times.begin(), times.end());
+  return {times[0], times[iterations / 2]};
+}
+
+template <typename Solver>
+static void benchmark(const char* name, Solver& solver, int iterations,
+                      int horizon = K_FIXED_HORIZON, int fineSteps = -1) {
+  update_data_t update;
+  problem_setup setup;
+  makeTrotProblem(update, setup, horizon);
+
+  // fineSteps steps of dt, then steps which stretch the horizon to
+  // 3 * K_FIXED_HORIZON steps of dt
+  if (fineSteps >= 0) {
+    float coarse = setup.dt * (3 * K_FIXED_HORIZON - fineSteps) /
+                   (horizon - fineSteps);
+    float t = 0;
+    setup.variable_dt = 1;
+    for (int i = 0; i < horizon; i++) {
+      setup.dt_steps[i] = i < fineSteps ? setup.dt : coarse;
+      update.traj[12 * i + 3] = 0.5f * t;
+      t += setup.dt_steps[i];
+    }
+  }
+
+  // warm up, sizes the dynamic solver
+  timeRuns(solver, update, setup, 10, false);
+  BenchmarkResult build = timeRuns(solver, update, setup, iterations, true);
+  BenchmarkResult solve = timeRuns(solver, update, setup, iterations, false);
+  printf("%-10s build %8.2f us (min %8.2f)   solve %8.2f us (min %8.2f)\n",
+         name, build.medianUs, build.minUs, solve.medianUs, solve.minUs);
+}
+
+int main(int argc, char** argv) {
+  int iterations = argc > 1 ? atoi(argv[1]) : 2000;
+  if (iterations < 1) iterations = 1;
+
+  std::unique_ptr<CondensedMpcSolver<float, K_FIXED_HORIZON>> fixed(
+      new CondensedMpcSolver<float, K_FIXED_HORIZON>());
+  std::unique_ptr<CondensedMpcSolver<float>> dynamic(
+      new CondensedMpcSolver<float>());
+
+  printf("convex MPC, horizon %d, %d iterations, median (min)\n",
+         K_FIXED_HORIZON, iterations);
+  benchmark("dynamic", *dynamic, iterations);
+  benchmark("fixed", *fixed, iterations);
+
+  std::unique_ptr<CondensedMpcSolver<float>> uniform(
+      new CondensedMpcSolver<float>());
+  printf("lookahead of %d steps of dt\n", 3 * K_FIXED_HORIZON);
+  benchmark("uniform", *uniform, iterations, 3 * K_FIXED_HORIZON);
+  benchmark("variable", *fixed, iterations, K_FIXED_HORIZON, 4);
+  return 0;
+}
@@ -1,6 +1,7 @@
 #include "convexMPC_interface.h"
 #include "common_types.h"
 #include "SolverMPC.h"
+#include "MpcSolveThread.h"
 #include <Eigen/Dense>
 #include <pthread.h>
 #include <stdio.h>
@@ -11,11 +12,14 @@
 #define K_NUM_LEGS 4
 
 problem_setup problem_configuration;
-u8 gait_data[K_MAX_GAIT_SEGMENTS];
+u8 gait_data[4*K_MAX_GAIT_SEGMENTS];
 pthread_mutex_t problem_cfg_mt;
 pthread_mutex_t update_mt;
 update_data_t update;
-pthread_t solve_thread;
+MpcSolveThread solve_thread;
+MpcSolveResult async_result;
+s64 solve_tag = 0;
+int has_async_result = 0;
 
 u8 first_run = 1;
 
@@ -60,9 +64,26 @@ void setup_problem(double dt, int horizon, double mu, double f_max)
   problem_configuration.f_max = f_max;
   problem_configuration.mu = mu;
   problem_configuration.dt = dt;
+  problem_configuration.variable_dt = 0;
 
   //pthread_mutex_unlock(&problem_cfg_mt);
-  resize_qp_mats(horizon);
+  //the workspace is resized by the solver on its next solve
+}
+
+//like setup_problem, with its own dt for each of the horizon steps.  the
+//trajectory and gait passed to update_problem_data must be sampled at the
+//same steps.
+void setup_problem_variable_dt(double* dts, int horizon, double mu, double f_max)
+{
+  if(horizon > K_MAX_GAIT_SEGMENTS)
+  {
+    printf("[MPC ERROR] horizon %d is too long for variable dt\n", horizon);
+    return;
+  }
+  setup_problem(dts[0], horizon, mu, f_max);
+  for(int i = 0; i < horizon; i++)
+    problem_configuration.dt_steps[i] = dts[i];
+  problem_configuration.variable_dt = 1;
 }
 
 //inline to motivate gcc to unroll the loop in here.
@@ -80,6 +101,20 @@ inline void mint_to_u8(u8* dst, mint* src, s32 n_items)
 
 int has_solved = 0;
 
+//solves right away, or hands a snapshot to the solve thread if it is running
+void solve_or_post()
+{
+  if(solve_thread.isRunning())
+  {
+    solve_thread.post(update, problem_configuration, solve_tag);
+  }
+  else
+  {
+    solve_mpc(&update, &problem_configuration);
+    has_solved = 1;
+  }
+}
+
 //void *call_solve(void* ptr)
 //{
 //  solve_mpc(&update, &problem_configuration);
@@ -100,8 +135,7 @@ void update_problem_data(double* p, double* v, double* q, double* w, double* r,
   update.alpha = alpha;
   mint_to_u8(update.gait,gait,4*problem_configuration.horizon);
 
-  solve_mpc(&update, &problem_configuration);
-  has_solved = 1;
+  solve_or_post();
 }
 
 void update_solver_settings(int max_iter, double rho, double sigma, double solver_alpha, double terminate, double use_jcqp) {
@@ -138,9 +172,7 @@ void update_problem_data_floats(float* p, float* v, float* q, float* w,
   memcpy((void*)update.r,(void*)r,sizeof(float)*12);
   memcpy((void*)update.weights,(void*)weights,sizeof(float)*12);
   memcpy((void*)update.traj,(void*)state_trajectory, sizeof(float) * 12 * problem_configuration.horizon);
-  solve_mpc(&update, &problem_configuration);
-  has_solved = 1;
-
+  solve_or_post();
 }
 
 void update_x_drag(float x_drag) {
@@ -149,7 +181,71 @@ void update_x_drag(float x_drag) {
 
 double get_solution(int index)
 {
+  if(solve_thread.isRunning())
+  {
+    if(!has_async_result) return 0.f;
+    return async_result.q_soln[index];
+  }
   if(!has_solved) return 0.f;
   mfp* qs = get_q_soln();
   return qs[index];
 }
+
+void start_solve_thread(int cpu)
+{
+  if(first_run)
+  {
+    first_run = false;
+    initialize_mpc();
+  }
+  has_async_result = 0;
+  solve_thread.start(cpu);
+}
+
+void stop_solve_thread()
+{
+  solve_thread.stop();
+}
+
+int solve_thread_running()
+{
+  return solve_thread.isRunning();
+}
+
+void set_solve_tag(long tag)
+{
+  solve_tag = tag;
+}
+
+int fetch_solution(long* tag)
+{
+  if(!solve_thread.isRunning()) return 0;
+  if(!solve_thread.getLatest(async_result)) return 0;
+  has_async_result = 1;
+  if(tag) *tag = async_result.tag;
+  return 1;
+}
+
+void get_async_status(mpc_async_status* status)
+{
+  status->posted = solve_thread.getPostedCount();
+  status->solved = solve_thread.getSolvedCount();
+  status->dropped = solve_thread.getDroppedCount();
+  status->stale_reads = solve_thread.getStaleReadCount();
+  status->staleness = solve_thread.getStaleness();
+  status->solve_time_ms = has_async_result ? async_result.solveTimeMs : 0.f;
+}
+
+//statistics of the solver in use.  The solve thread's come with its
+//solutions, as of the solution last returned by fetch_solution
+void get_qp_stats(mpc_qp_stats* stats)
+{
+  if(solve_thread.isRunning()) {
+    if(has_async_result)
+      *stats = async_result.qpStats;
+    else
+      memset(stats, 0, sizeof(mpc_qp_stats));
+  }
+  else
+    get_mpc_solver().getQpStats(stats);
+}
@@ -1,6 +1,8 @@
 #ifndef _convexmpc_interface
 #define _convexmpc_interface
 #define K_MAX_GAIT_SEGMENTS 36
+//horizon of ConvexMPCLocomotion, solved by a fixed-size solver
+#define K_FIXED_HORIZON 10
 
 //#include "common_types.h"
 
@@ -16,6 +18,9 @@ struct problem_setup
   float mu;
   float f_max;
   int horizon;
+  //when set, step i of the horizon is dt_steps[i] long instead of dt
+  int variable_dt = 0;
+  float dt_steps[K_MAX_GAIT_SEGMENTS];
 };
 
 struct update_data_t
@@ -29,7 +34,7 @@ struct update_data_t
   float weights[12];
   float traj[12*K_MAX_GAIT_SEGMENTS];
   float alpha;
-  unsigned char gait[K_MAX_GAIT_SEGMENTS];
+  unsigned char gait[4*K_MAX_GAIT_SEGMENTS];
   unsigned char hack_pad[1000];
   int max_iterations;
   double rho, sigma, solver_alpha, terminate;
@@ -37,7 +42,30 @@ struct update_data_t
   float x_drag;
 };
 
+//counters of the asynchronous solver, see MpcSolveThread
+struct mpc_async_status
+{
+  unsigned long posted;       //snapshots posted by the control loop
+  unsigned long solved;       //snapshots solved by the solve thread
+  unsigned long dropped;      //snapshots replaced before they were solved
+  unsigned long stale_reads;  //fetches which found no new solution
+  unsigned long staleness;    //snapshots posted since the current solution's
+  float solve_time_ms;        //solve time of the current solution
+};
+
+//warm start statistics of the qpOASES solver
+struct mpc_qp_stats
+{
+  unsigned long hotstarts;          //solves warm started from the last working set
+  unsigned long cold_starts;        //solves started from scratch
+  unsigned long failed_hotstarts;   //hotstarts which fell back to a cold start
+  unsigned long hotstart_wsr;       //working set recalculations in hotstarts
+  unsigned long cold_start_wsr;     //working set recalculations in cold starts
+  int last_wsr;
+};
+
 EXTERNC void setup_problem(double dt, int horizon, double mu, double f_max);
+EXTERNC void setup_problem_variable_dt(double* dts, int horizon, double mu, double f_max);
 EXTERNC void update_problem_data(double* p, double* v, double* q, double* w, double* r, double yaw, double* weights, double* state_trajectory, double alpha, int* gait);
 EXTERNC double get_solution(int index);
 EXTERNC void update_solver_settings(int max_iter, double rho, double sigma, double solver_alpha, double terminate, double use_jcqp);
@@ -46,4 +74,15 @@ EXTERNC void update_problem_data_floats(float* p, float* v, float* q, float* w,
                                         float* state_trajectory, float alpha, int* gait);
 
 void update_x_drag(float x_drag);
+
+//asynchronous solving: while the solve thread runs, update_problem_data*
+//post a snapshot instead of solving, and get_solution reads the solution
+//last returned by fetch_solution
+EXTERNC void start_solve_thread(int cpu);
+EXTERNC void stop_solve_thread();
+EXTERNC int solve_thread_running();
+EXTERNC void set_solve_tag(long tag);
+EXTERNC int fetch_solution(long* tag);
+EXTERNC void get_async_status(mpc_async_status* status);
+EXTERNC void get_qp_stats(mpc_qp_stats* stats);
 #endif
\ No newline at end of file
@@ -0,0 +1,44 @@
+/*! @file cmpc_test_problem.h
+ *  @brief Example problems shared by the convex MPC tests
+ */
+
+#ifndef CHEETAH_SOFTWARE_CMPC_TEST_PROBLEM_H
+#define CHEETAH_SOFTWARE_CMPC_TEST_PROBLEM_H
+
+#include <cstring>
+#include "convexMPC_interface.h"
+
+/*!
+ * Fill in MPC data for a mini cheetah trotting forward at 0.5 m/s
+ */
+inline void makeTrotProblem(update_data_t& update, problem_setup& setup,
+                            int horizon) {
+  memset(&update, 0, sizeof(update_data_t));
+  setup.dt = 0.026f;
+  setup.mu = 0.4f;
+  setup.f_max = 120.f;
+  setup.horizon = horizon;
+
+  float weights[12] = {0.25, 0.25, 10, 2, 2, 50, 0, 0, 0.3, 0.2, 0.2, 0.1};
+  float feet[12] = {0.19, 0.19, -0.19, -0.19, -0.11, 0.11,
+                    -0.11, 0.11, -0.29, -0.29, -0.29, -0.29};
+  update.p[2] = 0.29f;
+  update.q[0] = 1.f;
+  update.v[0] = 0.5f;
+  memcpy(update.r, feet, sizeof(feet));
+  memcpy(update.weights, weights, sizeof(weights));
+  unsigned char* gait = update.gait;
+  for (int i = 0; i < horizon; i++) {
+    update.traj[12 * i + 3] = 0.5f * setup.dt * i;
+    update.traj[12 * i + 5] = 0.29f;
+    update.traj[12 * i + 9] = 0.5f;
+    for (int leg = 0; leg < 4; leg++) {
+      bool diagonal = (leg == 0 || leg == 3);
+      gait[4 * i + leg] = ((i / 5) % 2 == 0) == diagonal;
+    }
+  }
+  update.alpha = 4e-5f;
+  update.use_jcqp = 0;
+}
+
+#endif  // CHEETAH_SOFTWARE_CMPC_TEST_PROBLEM_H
@@ -0,0 +1,149 @@
+/*! @file test_mpc_condensing.cpp
+ *  @brief Test the structure exploiting condensing of the convex MPC
+ *
+ * Compares the blockwise QP cost against the dense formula
+ * qH = 2*(B_qp^T*S*B_qp + alpha*I), qg = 2*B_qp^T*S*(A_qp*x_0 - X_d)
+ */
+
+#include <memory>
+
+#include "CondensedMpcSolver.h"
+#include "cmpc_test_problem.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using Eigen::Dynamic;
+using Eigen::Matrix;
+
+// steps of 0.02 s for the first half of the horizon and 0.05 s after
+static void setVariableDt(problem_setup& setup) {
+  setup.variable_dt = 1;
+  for (int i = 0; i < setup.horizon; i++)
+    setup.dt_steps[i] = i < setup.horizon / 2 ? 0.02f : 0.05f;
+}
+
+static void checkCondensing(int horizon, bool variableDt = false) {
+  update_data_t update;
+  problem_setup setup;
+  makeTrotProblem(update, setup, horizon);
+  update.w[2] = 0.3f;
+  if (variableDt) setVariableDt(setup);
+
+  CondensedMpcSolver<float> ws;
+  ws.buildQp(update, setup);
+  EXPECT_EQ(variableDt, ws.variableDt());
+
+  // dense reference in double precision from the same discretization
+  int h = horizon;
+  Matrix<double, Dynamic, Dynamic> A_qp(13 * h, 13), B_qp(13 * h, 12 * h),
+      S(13 * h, 13 * h);
+  B_qp.setZero();
+  S.setZero();
+  Matrix<double, 13, 13> power = Matrix<double, 13, 13>::Identity();
+  for (int r = 0; r < h; r++) {
+    power = ws.stepAdt(r).cast<double>() * power;
+    A_qp.block(13 * r, 0, 13, 13) = power;
+    for (int c = 0; c <= r; c++) {
+      Matrix<double, 13, 13> Ak = Matrix<double, 13, 13>::Identity();
+      for (int k = c + 1; k <= r; k++) Ak = ws.stepAdt(k).cast<double>() * Ak;
+      B_qp.block(13 * r, 12 * c, 13, 12) = Ak * ws.stepBdt(c).cast<double>();
+    }
+    S.diagonal().segment(13 * r, 13) = ws.Q.cast<double>();
+  }
+
+  Matrix<double, Dynamic, Dynamic> qH =
+      2 * (B_qp.transpose() * S * B_qp +
+           update.alpha *
+               Matrix<double, Dynamic, Dynamic>::Identity(12 * h, 12 * h));
+  Matrix<double, Dynamic, 1> qg =
+      2 * B_qp.transpose() * S *
+      (A_qp * ws.x_0.cast<double>() - ws.X_d.cast<double>());
+
+  double hScale = qH.cwiseAbs().maxCoeff();
+  double gScale = qg.cwiseAbs().maxCoeff();
+  EXPECT_LT((ws.qH.cast<double>() - qH).cwiseAbs().maxCoeff(), 1e-4 * hScale);
+  EXPECT_LT((ws.qg.cast<double>() - qg).cwiseAbs().maxCoeff(), 1e-4 * gScale);
+  EXPECT_TRUE(ws.qH.isApprox(ws.qH.transpose()));
+}
+
+TEST(ConvexMPC, condensingMatchesDense) { checkCondensing(10); }
+
+TEST(ConvexMPC, condensingLongHorizon) {
+  // horizons past the old limit of 19 steps
+  checkCondensing(30);
+  checkCondensing(10);
+}
+
+TEST(ConvexMPC, condensingVariableDt) {
+  checkCondensing(10, true);
+  checkCondensing(30, true);
+}
+
+TEST(ConvexMPC, variableDtSharesDiscretizations) {
+  update_data_t update;
+  problem_setup setup;
+  makeTrotProblem(update, setup, K_FIXED_HORIZON);
+  setVariableDt(setup);
+
+  // a fixed-size solver is too big for the stack
+  std::unique_ptr<CondensedMpcSolver<float, K_FIXED_HORIZON>> solverPtr(
+      new CondensedMpcSolver<float, K_FIXED_HORIZON>());
+  CondensedMpcSolver<float, K_FIXED_HORIZON>& solver = *solverPtr;
+  solver.buildQp(update, setup);
+  EXPECT_TRUE(solver.variableDt());
+  EXPECT_EQ(2, solver.dt_cache_size);
+  EXPECT_TRUE(solver.stepAdt(0) == solver.Adt);
+  EXPECT_TRUE(solver.stepAdt(K_FIXED_HORIZON - 1) != solver.Adt);
+
+  // the same step everywhere is the usual problem
+  std::unique_ptr<CondensedMpcSolver<float, K_FIXED_HORIZON>> uniformPtr(
+      new CondensedMpcSolver<float, K_FIXED_HORIZON>());
+  CondensedMpcSolver<float, K_FIXED_HORIZON>& uniform = *uniformPtr;
+  for (int i = 0; i < K_FIXED_HORIZON; i++) setup.dt_steps[i] = setup.dt;
+  solver.buildQp(update, setup);
+  setup.variable_dt = 0;
+  uniform.buildQp(update, setup);
+  EXPECT_FALSE(solver.variableDt());
+  EXPECT_TRUE(solver.qH == uniform.qH);
+  EXPECT_TRUE(solver.qg == uniform.qg);
+}
+
+TEST(ConvexMPC, reducedQpDropsSwingFeet) {
+  update_data_t update;
+  problem_setup setup;
+  int h = 10;
+  makeTrotProblem(update, setup, h);
+  update.gait[5] = 0;  // one more foot in swing
+
+  CondensedMpcSolver<float> solver;
+  solver.buildQp(update, setup);
+
+  // dense friction cone constraints and the feet in stance
+  Matrix<double, Dynamic, Dynamic> fmat =
+      Matrix<double, Dynamic, Dynamic>::Zero(20 * h, 12 * h);
+  for (int foot = 0; foot < 4 * h; foot++)
+    fmat.block<5, 3>(5 * foot, 3 * foot) = solver.f_block.cast<double>();
+  const unsigned char* gait = update.gait;
+  std::vector<int> vars, cons;
+  for (int foot = 0; foot < 4 * h; foot++) {
+    if (!gait[foot]) continue;
+    for (int v = 0; v < 3; v++) vars.push_back(3 * foot + v);
+    for (int c = 0; c < 5; c++) cons.push_back(5 * foot + c);
+  }
+
+  int nv = vars.size(), nc = cons.size();
+  ASSERT_EQ(nv, solver.new_vars);
+  ASSERT_EQ(nc, solver.new_cons);
+  for (int i = 0; i < nv; i++) {
+    EXPECT_EQ(solver.qg(vars[i]), solver.g_red[i]);
+    for (int j = 0; j < nv; j++)
+      EXPECT_EQ(solver.qH(vars[i], vars[j]), solver.H_red[i * nv + j]);
+  }
+  for (int r = 0; r < nc; r++) {
+    EXPECT_EQ(0., solver.lb_red[r]);
+    EXPECT_EQ(solver.U_b(cons[r]), solver.ub_red[r]);
+    for (int c = 0; c < nv; c++)
+      EXPECT_EQ(fmat(cons[r], vars[c]), solver.A_red[r * nv + c]);
+  }
+}
@@ -0,0 +1,57 @@
+/*! @file test_mpc_discretization.cpp
+ *  @brief Test the series discretization of the convex MPC dynamics
+ */
+
+#include "MpcDiscretization.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+/*!
+ * Continuous time dynamics with the structure built by ct_ss_mats.  The
+ * convex MPC puts the drag term on the gravity row, the vision MPC on the
+ * x velocity row.
+ */
+template <typename T>
+static void makeDynamics(T yaw, T drag, bool dragOnVelocity,
+                         Eigen::Matrix<T, 13, 13>& A,
+                         Eigen::Matrix<T, 13, 12>& B) {
+  Eigen::Matrix<T, 3, 3> R_yaw;
+  R_yaw << std::cos(yaw), -std::sin(yaw), 0, std::sin(yaw), std::cos(yaw), 0,
+      0, 0, 1;
+  A.setZero();
+  A(3, 9) = 1;
+  A(4, 10) = 1;
+  A(5, 11) = 1;
+  A(11, 12) = 1;
+  if (dragOnVelocity)
+    A(9, 9) = drag;
+  else
+    A(11, 9) = drag;
+  A.template block<3, 3>(0, 6) = R_yaw.transpose();
+
+  B.setRandom();
+  B.template topRows<6>().setZero();
+  B.template bottomRows<1>().setZero();
+}
+
+template <typename T>
+static void checkAgainstExp(T dt, T drag, bool dragOnVelocity, T tol) {
+  Eigen::Matrix<T, 13, 13> A, Adt, Adt_ref;
+  Eigen::Matrix<T, 13, 12> B, Bdt, Bdt_ref;
+  makeDynamics<T>(0.7, drag, dragOnVelocity, A, B);
+  discretize_dynamics(A, B, dt, Adt, Bdt);
+  discretize_dynamics_exp(A, B, dt, Adt_ref, Bdt_ref);
+  EXPECT_LT((Adt - Adt_ref).cwiseAbs().maxCoeff(), tol) << "dt " << dt;
+  EXPECT_LT((Bdt - Bdt_ref).cwiseAbs().maxCoeff(), tol * B.norm()) << "dt " << dt;
+}
+
+TEST(ConvexMPC, seriesDiscretizationMatchesExp) {
+  for (double dt : {0.005, 0.026, 0.05, 0.2, 2.}) {
+    checkAgainstExp<double>(dt, 0, false, 1e-12);
+    checkAgainstExp<double>(dt, 0.3, false, 1e-12);
+    checkAgainstExp<double>(dt, -0.3, true, 1e-12);
+    checkAgainstExp<float>(dt, 0.3, false, 1e-5);
+    checkAgainstExp<float>(dt, -0.3, true, 1e-5);
+  }
+}
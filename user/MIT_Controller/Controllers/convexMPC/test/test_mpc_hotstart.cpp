@@ -0,0 +1,41 @@
+/*! @file test_mpc_hotstart.cpp
+ *  @brief Test warm starting of the convex MPC QP
+ */
+
+#include "CondensedMpcSolver.h"
+#include "cmpc_test_problem.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+TEST(ConvexMPC, consecutiveSolvesHotstart) {
+  update_data_t update;
+  problem_setup setup;
+  makeTrotProblem(update, setup, 10);
+  CondensedMpcSolver<float> solver;
+
+  // a new horizon always starts cold
+  solver.solve(update, setup);
+  u64 cold = solver.qp_cold_starts;
+  u64 hot = solver.qp_hotstarts;
+  EXPECT_GE(cold, 1u);
+
+  // the reduced problem keeps its size, so the next solves are warm
+  for (int i = 0; i < 3; i++) {
+    update.v[0] += 0.01f;
+    solver.solve(update, setup);
+  }
+  EXPECT_EQ(cold, solver.qp_cold_starts);
+  EXPECT_EQ(hot + 3, solver.qp_hotstarts);
+  EXPECT_EQ(0u, solver.qp_failed_hotstarts);
+
+  // lifting one more foot changes the reduced size and forces a cold start
+  update.gait[0] = 1 - update.gait[0];
+  solver.solve(update, setup);
+  EXPECT_EQ(cold + 1, solver.qp_cold_starts);
+
+  // warm starting can be turned off
+  solver.warm_start = false;
+  solver.solve(update, setup);
+  EXPECT_EQ(cold + 2, solver.qp_cold_starts);
+}
@@ -0,0 +1,167 @@
+/*! @file test_mpc_multi_gait.cpp
+ *  @brief Test solving the convex MPC for several gaits at once
+ */
+
+#include "CondensedMpcSolver.h"
+#include "MultiGaitMpc.h"
+#include "cmpc_test_problem.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+// contact table of a gait with two groups of feet, each in stance for
+// stanceSteps out of 2 * stanceSteps
+static std::vector<int> makeGaitTable(int horizon, int stanceSteps,
+                                      const bool* firstGroup) {
+  std::vector<int> table(4 * horizon);
+  for (int i = 0; i < horizon; i++)
+    for (int leg = 0; leg < 4; leg++)
+      table[4 * i + leg] = ((i / stanceSteps) % 2 == 0) == firstGroup[leg];
+  return table;
+}
+
+TEST(ConvexMPC, costMatchesRollout) {
+  update_data_t update;
+  problem_setup setup;
+  makeTrotProblem(update, setup, 10);
+  update.w[2] = 0.3f;
+  update.v[1] = -0.1f;
+
+  CondensedMpcSolver<double> solver;
+  solver.buildQp(update, setup);
+
+  std::vector<double> forces(12 * 10);
+  for (size_t i = 0; i < forces.size(); i++)
+    forces[i] = 20. * std::sin(0.7 * i) + (i % 3 == 2 ? 30. : 0.);
+
+  // simulate the discrete dynamics and add up the cost
+  Eigen::Matrix<double, 13, 1> x = solver.x_0;
+  double cost = 0;
+  for (int k = 0; k < 10; k++) {
+    Eigen::Matrix<double, 12, 1> u =
+        Eigen::Map<Eigen::Matrix<double, 12, 1>>(&forces[12 * k]);
+    x = solver.Adt * x + solver.Bdt * u;
+    Eigen::Matrix<double, 13, 1> err = x - solver.X_d.segment<13>(13 * k);
+    cost += err.dot(solver.Q.asDiagonal() * err) + update.alpha * u.squaredNorm();
+  }
+
+  EXPECT_NEAR(cost, solver.evaluateCost(forces.data()), 1e-9 * cost);
+}
+
+TEST(ConvexMPC, multiGaitMatchesSingleSolves) {
+  update_data_t update;
+  problem_setup setup;
+  makeTrotProblem(update, setup, K_FIXED_HORIZON);
+
+  bool trot[4] = {true, false, false, true};
+  bool bound[4] = {true, true, false, false};
+  bool pronk[4] = {true, true, true, true};
+  std::vector<int> gaits = {0, 1, 2};
+  std::vector<std::vector<int>> tables = {
+      makeGaitTable(K_FIXED_HORIZON, 5, trot),
+      makeGaitTable(K_FIXED_HORIZON, 4, bound),
+      makeGaitTable(K_FIXED_HORIZON, 4, pronk)};
+
+  // each gait on its own solver
+  std::vector<std::vector<double>> soln;
+  std::vector<float> cost;
+  for (size_t g = 0; g < gaits.size(); g++) {
+    update_data_t gaitUpdate = update;
+    unsigned char* gait = gaitUpdate.gait;
+    for (int i = 0; i < 4 * K_FIXED_HORIZON; i++) gait[i] = tables[g][i];
+    std::unique_ptr<DispatchingMpcSolver<fpt, K_FIXED_HORIZON>> solver(
+        new DispatchingMpcSolver<fpt, K_FIXED_HORIZON>());
+    solver->solve(gaitUpdate, setup);
+    soln.emplace_back(solver->solution(),
+                      solver->solution() + 12 * K_FIXED_HORIZON);
+    cost.push_back(solver->cost());
+  }
+
+  // on the calling thread only, and with workers
+  for (int workers : {0, 2, 4}) {
+    MultiGaitMpc mpc;
+    mpc.start(workers);
+    EXPECT_EQ(workers, mpc.workerCount());
+    EXPECT_TRUE(mpc.setCandidates(gaits));
+    EXPECT_FALSE(mpc.setCandidates(gaits));
+    for (size_t g = 0; g < gaits.size(); g++)
+      mpc.setGaitTable(g, tables[g].data(), K_FIXED_HORIZON);
+
+    for (int round = 0; round < 5; round++) {
+      for (size_t g = 0; g < gaits.size(); g++)
+        mpc.candidate(g).solver.fixed.warm_start = false;
+      mpc.solve(update, setup);
+      for (size_t g = 0; g < gaits.size(); g++) {
+        const MpcGaitCandidate& candidate = mpc.candidate(g);
+        EXPECT_EQ(gaits[g], candidate.gait);
+        EXPECT_EQ(cost[g], candidate.cost);
+        for (int i = 0; i < 12 * K_FIXED_HORIZON; i++)
+          EXPECT_EQ(soln[g][i], candidate.solver.solution()[i]);
+      }
+    }
+
+    int best = 0;
+    for (size_t g = 1; g < gaits.size(); g++)
+      if (cost[g] < cost[best]) best = g;
+    EXPECT_EQ(best, mpc.lowestCost());
+    mpc.stop();
+    EXPECT_FALSE(mpc.isRunning());
+  }
+}
+
+TEST(ConvexMPC, multiGaitKeepsSolversOfRemainingGaits) {
+  MultiGaitMpc mpc;
+  mpc.setCandidates({0, 5, 8});
+  MpcGaitCandidate* pacing = &mpc.candidate(2);
+
+  EXPECT_TRUE(mpc.setCandidates({8, 1}));
+  EXPECT_EQ(2, mpc.candidateCount());
+  EXPECT_EQ(pacing, &mpc.candidate(0));
+  EXPECT_EQ(1, mpc.candidate(1).gait);
+  EXPECT_EQ(-1, mpc.findCandidate(0));
+  EXPECT_EQ(1, mpc.findCandidate(1));
+
+  std::vector<int> tooMany(MultiGaitMpc::kMaxCandidates + 1, 0);
+  EXPECT_THROW(mpc.setCandidates(tooMany), std::runtime_error);
+}
+
+TEST(ConvexMPC, gaitSelectorHysteresis) {
+  MpcGaitSelector selector(0.1f, 2);
+  int gaits[3] = {0, 5, 8};
+  EXPECT_EQ(-1, selector.current());
+
+  // the first selection takes the cheapest gait
+  float costs[3] = {10.f, 12.f, 11.f};
+  EXPECT_EQ(0, selector.select(gaits, costs, 3));
+
+  // cheaper, but not by more than the margin
+  costs[1] = 9.5f;
+  EXPECT_EQ(0, selector.select(gaits, costs, 3));
+  EXPECT_EQ(0, selector.select(gaits, costs, 3));
+
+  // cheaper by more than the margin
+  costs[1] = 8.5f;
+  EXPECT_EQ(5, selector.select(gaits, costs, 3));
+
+  // just switched, so it is held even though pacing is much cheaper
+  costs[2] = 1.f;
+  EXPECT_EQ(5, selector.select(gaits, costs, 3));
+  EXPECT_EQ(8, selector.select(gaits, costs, 3));
+
+  // a failed solve has infinite cost
+  costs[2] = INFINITY;
+  selector.minHoldSolves = 0;
+  EXPECT_EQ(5, selector.select(gaits, costs, 3));
+
+  // the current gait was dropped from the candidates
+  int others[2] = {0, 8};
+  float otherCosts[2] = {4.f, 3.f};
+  EXPECT_EQ(8, selector.select(others, otherCosts, 2));
+
+  selector.reset();
+  EXPECT_EQ(-1, selector.current());
+}
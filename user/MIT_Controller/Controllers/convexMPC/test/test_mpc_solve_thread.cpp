@@ -0,0 +1,79 @@
+/*! @file test_mpc_solve_thread.cpp
+ *  @brief Test the asynchronous convex MPC solver
+ */
+
+#include "MpcSolveThread.h"
+#include "SolverMPC.h"
+#include "cmpc_test_problem.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include <unistd.h>
+
+/*!
+ * Poll for a solution like the control loop would, giving up after 1 second
+ */
+static bool waitForSolution(MpcSolveThread& thread, MpcSolveResult& result) {
+  for (int i = 0; i < 1000; i++) {
+    if (thread.getLatest(result)) return true;
+    usleep(1000);
+  }
+  return false;
+}
+
+TEST(ConvexMPC, solveThreadMatchesSynchronousSolve) {
+  update_data_t update;
+  problem_setup setup;
+  makeTrotProblem(update, setup, 10);
+
+  solve_mpc(&update, &setup);
+  std::vector<mfp> reference(get_q_soln(), get_q_soln() + 12 * 10);
+
+  MpcSolveThread thread;
+  MpcSolveResult result;
+  EXPECT_FALSE(thread.getLatest(result));
+
+  thread.start();
+  EXPECT_TRUE(thread.isRunning());
+  thread.post(update, setup, 42);
+  ASSERT_TRUE(waitForSolution(thread, result));
+
+  EXPECT_EQ(42, result.tag);
+  EXPECT_EQ(1u, result.sequence);
+  EXPECT_EQ(10, result.horizon);
+  EXPECT_EQ(0u, thread.getStaleness());
+  for (int i = 0; i < 12 * 10; i++) EXPECT_EQ(reference[i], result.q_soln[i]);
+  EXPECT_EQ(1u, result.qpStats.hotstarts + result.qpStats.cold_starts);
+
+  // reading again without a new solve is stale
+  EXPECT_FALSE(thread.getLatest(result));
+  EXPECT_EQ(42, result.tag);
+  EXPECT_GE(thread.getStaleReadCount(), 1u);
+
+  thread.stop();
+  EXPECT_FALSE(thread.isRunning());
+}
+
+TEST(ConvexMPC, solveThreadKeepsNewestSnapshot) {
+  update_data_t update;
+  problem_setup setup;
+  makeTrotProblem(update, setup, 10);
+
+  MpcSolveThread thread;
+  thread.start();
+  // post faster than the solver runs, snapshots it has not taken are replaced
+  for (int i = 1; i <= 50; i++) thread.post(update, setup, i);
+
+  MpcSolveResult result;
+  for (int i = 0; i < 1000 && thread.getStaleness() != 0; i++) usleep(1000);
+  EXPECT_EQ(0u, thread.getStaleness());
+  EXPECT_EQ(50u, thread.getPostedCount());
+  EXPECT_EQ(thread.getPostedCount(),
+            thread.getSolvedCount() + thread.getDroppedCount());
+
+  EXPECT_TRUE(thread.getLatest(result));
+  EXPECT_EQ(50, result.tag);
+  EXPECT_EQ(50u, result.sequence);
+  thread.stop();
+}
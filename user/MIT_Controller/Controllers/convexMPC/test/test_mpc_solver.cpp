@@ -0,0 +1,103 @@
+/*! @file test_mpc_solver.cpp
+ *  @brief Test that convex MPC solver instances are independent
+ */
+
+#include "CondensedMpcSolver.h"
+#include "SolverMPC.h"
+#include "cmpc_test_problem.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+static std::vector<double> solveAlone(const update_data_t& update,
+                                      const problem_setup& setup) {
+  CondensedMpcSolver<float> solver;
+  solver.solve(update, setup);
+  return std::vector<double>(solver.solution(),
+                             solver.solution() + 12 * setup.horizon);
+}
+
+TEST(ConvexMPC, solverInstancesAreIndependent) {
+  update_data_t trot, turn;
+  problem_setup trotSetup, turnSetup;
+  makeTrotProblem(trot, trotSetup, 10);
+  makeTrotProblem(turn, turnSetup, 12);
+  turn.w[2] = 0.5f;
+  turn.yaw = 0.3f;
+
+  std::vector<double> trotReference = solveAlone(trot, trotSetup);
+  std::vector<double> turnReference = solveAlone(turn, turnSetup);
+
+  // interleaved solves on two instances do not see each other
+  CondensedMpcSolver<float> a, b;
+  for (int i = 0; i < 3; i++) {
+    a.solve(trot, trotSetup);
+    b.solve(turn, turnSetup);
+  }
+  a.warm_start = false;
+  b.warm_start = false;
+  a.solve(trot, trotSetup);
+  b.solve(turn, turnSetup);
+  for (int i = 0; i < 12 * 10; i++)
+    EXPECT_DOUBLE_EQ(trotReference[i], a.solution()[i]);
+  for (int i = 0; i < 12 * 12; i++)
+    EXPECT_DOUBLE_EQ(turnReference[i], b.solution()[i]);
+
+  // the C interface runs on its own instance
+  solve_mpc(&trot, &trotSetup);
+  EXPECT_EQ(10, get_mpc_solver().horizon());
+  EXPECT_TRUE(get_mpc_solver().lastSolveWasFixedSize());
+  EXPECT_EQ(12, b.horizon());
+}
+
+TEST(ConvexMPC, dragModelSelectsDynamicsRow) {
+  update_data_t update;
+  problem_setup setup;
+  makeTrotProblem(update, setup, 10);
+  update.x_drag = 0.2f;
+
+  CondensedMpcSolver<float> convex;
+  CondensedMpcSolver<float> vision(MpcDragModel::X_ACCELERATION);
+  convex.buildQp(update, setup);
+  vision.buildQp(update, setup);
+
+  EXPECT_FLOAT_EQ(0.2f, convex.A_ct(11, 9));
+  EXPECT_FLOAT_EQ(0.f, convex.A_ct(9, 9));
+  EXPECT_FLOAT_EQ(0.2f, vision.A_ct(9, 9));
+  EXPECT_FLOAT_EQ(0.f, vision.A_ct(11, 9));
+  EXPECT_TRUE(convex.B_ct_r.isApprox(vision.B_ct_r));
+}
+
+TEST(ConvexMPC, fixedHorizonMatchesDynamic) {
+  update_data_t update;
+  problem_setup setup;
+  makeTrotProblem(update, setup, 10);
+  update.w[2] = 0.3f;
+
+  // a fixed-size solver is too big for the stack
+  std::unique_ptr<CondensedMpcSolver<float, 10>> fixed(
+      new CondensedMpcSolver<float, 10>());
+  CondensedMpcSolver<float> dynamic;
+  fixed->solve(update, setup);
+  dynamic.solve(update, setup);
+
+  ASSERT_EQ(dynamic.new_vars, fixed->new_vars);
+  ASSERT_EQ(dynamic.new_cons, fixed->new_cons);
+  EXPECT_TRUE(fixed->qH.isApprox(dynamic.qH));
+  EXPECT_TRUE(fixed->qg.isApprox(dynamic.qg));
+  int nv = dynamic.new_vars, nc = dynamic.new_cons;
+  for (int i = 0; i < nv * nv; i++)
+    EXPECT_FLOAT_EQ(dynamic.H_red[i], fixed->H_red[i]);
+  for (int i = 0; i < nc * nv; i++)
+    EXPECT_EQ(dynamic.A_red[i], fixed->A_red[i]);
+  for (int i = 0; i < 12 * 10; i++)
+    EXPECT_FLOAT_EQ(dynamic.solution()[i], fixed->solution()[i]);
+
+  // other horizons are rejected rather than overrunning the storage
+  setup.horizon = 12;
+  EXPECT_THROW(fixed->solve(update, setup), std::runtime_error);
+}
@@ -0,0 +1,110 @@
+/*! @file test_mpc_workspace.cpp
+ *  @brief Test the persistent storage of the dense convex MPC
+ *
+ * The steady state MPC setup path is checked for heap allocations by
+ * interposing malloc for the whole test binary.
+ */
+
+#include "CondensedMpcSolver.h"
+#include "convexMPC_interface.h"
+#include "cmpc_test_problem.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+#include <cstdlib>
+#include <vector>
+
+// operator new and Eigen's aligned allocator both end up in malloc
+extern "C" void* __libc_malloc(size_t size);
+
+static bool countAllocations = false;
+static int allocationCount = 0;
+
+extern "C" void* malloc(size_t size) {
+  if (countAllocations) allocationCount++;
+  return __libc_malloc(size);
+}
+
+TEST(ConvexMPC, workspaceOnlyReallocatesOnHorizonChange) {
+  CondensedMpcSolver<float> ws;
+  EXPECT_TRUE(ws.resize(10));
+  EXPECT_FALSE(ws.resize(10));
+  EXPECT_FALSE(ws.resize(10));
+  EXPECT_EQ(1u, ws.allocationCount());
+  EXPECT_EQ(10, ws.horizon());
+
+  EXPECT_TRUE(ws.resize(12));
+  EXPECT_EQ(2u, ws.allocationCount());
+  EXPECT_EQ(12 * 12, (int)ws.q_soln.size());
+  EXPECT_EQ(12 * 12 * 20 * 12, (int)ws.A_red.size());
+}
+
+TEST(ConvexMPC, steadyStateSetupDoesNotAllocate) {
+  update_data_t update;
+  problem_setup setup;
+  makeTrotProblem(update, setup, 10);
+  CondensedMpcSolver<float> solver;
+
+  // first build sizes the solver
+  solver.buildQp(update, setup);
+
+  allocationCount = 0;
+  countAllocations = true;
+  for (int i = 0; i < 5; i++) {
+    solver.resize(10);
+    solver.buildQp(update, setup);
+  }
+  countAllocations = false;
+
+  EXPECT_EQ(0, allocationCount);
+
+  // half the feet are in swing, so their forces were eliminated
+  EXPECT_EQ(12 * 10 - 3 * 2 * 10, solver.new_vars);
+  EXPECT_EQ(20 * 10 - 5 * 2 * 10, solver.new_cons);
+
+  // make sure the hook sees allocations at all
+  countAllocations = true;
+  solver.resize(12);
+  countAllocations = false;
+  EXPECT_GT(allocationCount, 0);
+}
+
+TEST(ConvexMPC, warmStartGuessDoesNotAllocate) {
+  update_data_t update;
+  problem_setup setup;
+  makeTrotProblem(update, setup, 10);
+  CondensedMpcSolver<float> solver;
+
+  // the first solve is cold, the second hotstarts from its working set
+  solver.solve(update, setup);
+  solver.solve(update, setup);
+  ASSERT_TRUE(solver.qp);
+  EXPECT_GE(solver.qp_hotstarts, 1u);
+
+  // steady state: same problem size, previous working set present
+  allocationCount = 0;
+  countAllocations = true;
+  for (int i = 0; i < 5; i++) {
+    update.v[0] += 0.01f;
+    solver.resize(10);
+    solver.buildQp(update, setup);
+    solver.guessWorkingSet(10);
+  }
+  countAllocations = false;
+  EXPECT_EQ(0, allocationCount);
+
+  // the guess is the last working set, shifted one step
+  std::vector<qpOASES::real_t> workingSet(solver.new_cons);
+  solver.qp->getWorkingSetConstraints(workingSet.data());
+  for (int c = 0; c < 20 * 10; c++) {
+    int status = qpOASES::ST_INACTIVE;
+    int prev_full = c < solver.new_cons ? solver.con_ind[c] + 20 : 20 * 10;
+    if (prev_full < 20 * 10 && solver.prev_con_map[prev_full] >= 0) {
+      qpOASES::real_t w = workingSet[solver.prev_con_map[prev_full]];
+      status = w > 0.5 ? qpOASES::ST_UPPER
+                       : w < -0.5 ? qpOASES::ST_LOWER : qpOASES::ST_INACTIVE;
+    }
+    EXPECT_EQ(status, solver.guessed_constraints.getStatus(c));
+  }
+}
@@ -10,6 +10,14 @@ public:
         INIT_PARAMETER(cmpc_gait),
         INIT_PARAMETER(cmpc_x_drag),
         INIT_PARAMETER(cmpc_use_sparse),
+        INIT_PARAMETER(cmpc_use_async),
+        INIT_PARAMETER(cmpc_solver_cpu),
+        INIT_PARAMETER(cmpc_gait_search),
+        INIT_PARAMETER(cmpc_gait_candidates),
+        INIT_PARAMETER(cmpc_gait_search_workers),
+        INIT_PARAMETER(cmpc_gait_search_cpu),
+        INIT_PARAMETER(cmpc_gait_hysteresis),
+        INIT_PARAMETER(cmpc_gait_min_hold),
         INIT_PARAMETER(use_wbc),
         INIT_PARAMETER(cmpc_bonus_swing),
         INIT_PARAMETER(Kp_body),
@@ -82,6 +90,14 @@ public:
   DECLARE_PARAMETER(double, cmpc_gait);
   DECLARE_PARAMETER(double, cmpc_x_drag);
   DECLARE_PARAMETER(double, cmpc_use_sparse);
+  DECLARE_PARAMETER(double, cmpc_use_async);
+  DECLARE_PARAMETER(double, cmpc_solver_cpu);
+  DECLARE_PARAMETER(double, cmpc_gait_search);
+  DECLARE_PARAMETER(double, cmpc_gait_candidates);
+  DECLARE_PARAMETER(double, cmpc_gait_search_workers);
+  DECLARE_PARAMETER(double, cmpc_gait_search_cpu);
+  DECLARE_PARAMETER(double, cmpc_gait_hysteresis);
+  DECLARE_PARAMETER(double, cmpc_gait_min_hold);
   DECLARE_PARAMETER(double, use_wbc);
   DECLARE_PARAMETER(double, cmpc_bonus_swing);
 
@@ -0,0 +1,15 @@
+/*!
+ * @file headless_main.cpp
+ * @brief Main Function for the headless simulation of the MIT Controller
+ *
+ * Runs the controller and the simulator in the same process, without
+ * graphics.  For repeatable runs, set cmpc_use_async to 0 in the script or
+ * the user parameters: the asynchronous MPC depends on thread timing.
+ */
+
+#include <main_helper.h>
+#include "MIT_Controller.hpp"
+
+int main(int argc, char** argv) {
+  return headless_main_helper(argc, argv, new MIT_Controller());
+}